@@ -0,0 +1,167 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "hermes_matrix_utils.h"
+
+// This example solves the Poisson problem from P01-linear/03-poisson on a
+// much finer mesh and uses it to measure multithreaded assembly. The
+// Jacobian matrix and residual vector are assembled by the class
+// NativeDiscreteProblem (see the directory common/) with 1, 2, 4, ...
+// threads. We will learn how to:
+//
+//   - assemble the discrete problem with several threads,
+//   - verify that the result does not depend on the number of threads,
+//   - compare it with the standard DiscreteProblem,
+//   - use NativeDiscreteProblem with the NewtonSolver.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.mesh).
+//
+// The following parameters can be changed:
+
+const bool HERMES_VISUALIZATION = false;          // Set to "true" to enable Hermes OpenGL visualization.
+const int P_INIT = 5;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 6;                       // Number of initial uniform mesh refinements.
+const int MAX_THREADS = 32;                       // Assembly is timed with 1, 2, 4, ... threads up to
+                                                  // this number.
+const int NUM_REPEATS = 3;                        // Each assembly is repeated and the fastest run is taken.
+const double TOLERANCE = 1e-12;                   // Allowed relative difference from DiscreteProblem.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Aluminum", new Hermes1DFunction<double>(LAMBDA_AL), "Copper",
+                           new Hermes1DFunction<double>(LAMBDA_CU), new Hermes2DFunction<double>(-VOLUME_HEAT_SRC));
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d, elements = %d", ndof, mesh.get_num_active_elements());
+
+  // Coefficient vector of the first Newton step.
+  double* coeff_vec = new double[ndof];
+  memset(coeff_vec, 0, ndof*sizeof(double));
+
+  TimePeriod cpu_time;
+
+  // Reference: the standard DiscreteProblem.
+  DiscreteProblem<double> dp(&wf, &space);
+  SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
+  Vector<double>* rhs = create_vector<double>(matrix_solver);
+  cpu_time.tick(HERMES_SKIP);
+  dp.assemble(coeff_vec, matrix, rhs);
+  double time_hermes = cpu_time.tick().last();
+  info("DiscreteProblem: %g s", time_hermes);
+
+  CSRMatrix<double> matrix_hermes;
+  if (!import_hermes_matrix(matrix, &matrix_hermes))
+    error("Matrix type of the selected solver cannot be compared, use SOLVER_UMFPACK.");
+  double* rhs_hermes = new double[ndof];
+  for (int i = 0; i < ndof; i++)
+    rhs_hermes[i] = rhs->get(i);
+
+  // Multithreaded assembly.
+  NativeDiscreteProblem ndp(&wf, &space);
+  CSRMatrix<double> matrix_serial, matrix_parallel;
+  double* rhs_serial = new double[ndof];
+  double* rhs_parallel = new double[ndof];
+  double time_serial = 0.0;
+
+  info("threads   time [s]   speedup   identical to 1 thread");
+  for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2)
+  {
+    ndp.set_num_threads(num_threads);
+    CSRMatrix<double>* mat = (num_threads == 1) ? &matrix_serial : &matrix_parallel;
+    double* vec = (num_threads == 1) ? rhs_serial : rhs_parallel;
+
+    double time = 0.0;
+    for (int r = 0; r < NUM_REPEATS; r++)
+    {
+      cpu_time.tick(HERMES_SKIP);
+      ndp.assemble(coeff_vec, mat, vec);
+      double t = cpu_time.tick().last();
+      if (r == 0 || t < time) time = t;
+    }
+    if (num_threads == 1) time_serial = time;
+
+    // Same pattern, so comparing the value arrays is enough.
+    bool identical = (memcmp(mat->get_values(), matrix_serial.get_values(), mat->get_nnz()*sizeof(double)) == 0)
+                     && (memcmp(vec, rhs_serial, ndof*sizeof(double)) == 0);
+    info("%7d   %8.4f   %7.2f   %s", num_threads, time, time_serial / time, identical ? "yes" : "NO");
+  }
+
+  // The standard DiscreteProblem sums the contributions in a different
+  // order and evaluates the previous iterate through a Solution, so the
+  // results agree up to rounding only.
+  double diff_matrix = relative_difference(matrix_serial, matrix_hermes);
+  double diff_rhs = 0.0, max_rhs = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff_rhs = std::max(diff_rhs, std::abs(rhs_serial[i] - rhs_hermes[i]));
+    max_rhs = std::max(max_rhs, std::abs(rhs_hermes[i]));
+  }
+  if (max_rhs > 0.0) diff_rhs /= max_rhs;
+  info("Relative difference from DiscreteProblem: matrix %g, residual %g.", diff_matrix, diff_rhs);
+  if (diff_matrix > TOLERANCE || diff_rhs > TOLERANCE)
+    warn("Difference exceeds the tolerance %g.", TOLERANCE);
+
+  // NativeDiscreteProblem can be used with the NewtonSolver.
+  ndp.set_num_threads(MAX_THREADS);
+  NewtonSolver<double> newton(&ndp, matrix_solver);
+  try
+  {
+    newton.solve(coeff_vec);
+  }
+  catch(Hermes::Exceptions::Exception e)
+  {
+    e.printMsg();
+    error("Newton's iteration failed.");
+  }
+
+  // Translate the resulting coefficient vector into a Solution.
+  Solution<double> sln;
+  Solution<double>::vector_to_solution(newton.get_sln_vector(), &space, &sln);
+
+  // Visualize the solution.
+  if (HERMES_VISUALIZATION)
+  {
+    ScalarView view("Solution", new WinGeom(0, 0, 440, 350));
+    view.show(&sln, HERMES_EPS_HIGH);
+    View::wait();
+  }
+
+  // Clean up.
+  delete [] coeff_vec;
+  delete [] rhs_hermes;
+  delete [] rhs_serial;
+  delete [] rhs_parallel;
+  delete matrix;
+  delete rhs;
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+
+using namespace RefinementSelectors;
+
+// This example runs the adaptivity loop of P04-adaptivity/01-intro
+// (electrostatic micromotor) and shows the effect of the ShapeTableCache.
+// Every adaptivity step constructs a new reference space and a new
+// discrete problem. Values of shape functions at quadrature points do not
+// depend on the element though, so NativeDiscreteProblem takes them from
+// a process-wide cache that survives from step to step. In each step,
+// the fine mesh problem is first assembled with the tables kept from the
+// previous steps ("warm") and then once more with an empty cache ("cold").
+//
+// PDE: -div[eps_r(x,y) grad phi] = 0
+//      eps_r = EPS_1 in Omega_1 (surrounding air)
+//      eps_r = EPS_2 in Omega_2 (moving part of the motor)
+//
+// BC: phi = 0 V on Gamma_1 (left edge and also the rest of the outer boundary
+//     phi = VOLTAGE on Gamma_2 (boundary of stator)
+//
+// The following parameters can be changed:
+
+const int P_INIT = 2;                             // Initial polynomial degree of all mesh elements.
+const double THRESHOLD = 0.2;                     // This is a quantitative parameter of the adapt(...) function and
+                                                  // it has different meanings for various adaptive strategies.
+const int STRATEGY = 0;                           // Adaptive strategy, see P04-adaptivity/01-intro.
+const CandList CAND_LIST = H2D_HP_ANISO_H;        // Predefined list of element refinement candidates.
+const int MESH_REGULARITY = -1;                   // Maximum allowed level of hanging nodes.
+const double CONV_EXP = 1.0;                      // Parameter of the selection of candidates in hp-adaptivity.
+const double ERR_STOP = 1.0;                      // Stopping criterion for adaptivity (rel. error tolerance between the
+                                                  // fine mesh and coarse mesh solution in percent).
+const int NDOF_STOP = 60000;                      // Adaptivity process stops when the number of degrees of freedom grows
+                                                  // over this limit.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const size_t CACHE_MEMORY = 64 * 1024 * 1024;     // Memory bound of the shape table cache in bytes.
+MatrixSolverType matrix_solver_type = SOLVER_UMFPACK; // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                      // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+const double EPS0 = 8.863e-12;
+const double VOLTAGE = 50.0;
+const double EPS_MOTOR = 10.0 * EPS0;
+const double EPS_AIR = 1.0 * EPS0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", &mesh);
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Motor", EPS_MOTOR, "Air", EPS_AIR);
+
+  // Initialize boundary conditions
+  DefaultEssentialBCConst<double> bc_essential_out("Outer", 0.0);
+  DefaultEssentialBCConst<double> bc_essential_stator("Stator", VOLTAGE);
+  EssentialBCs<double> bcs(Hermes::vector<EssentialBoundaryCondition<double> *>(&bc_essential_out, &bc_essential_stator));
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+
+  // Initialize coarse and fine mesh solution.
+  Solution<double> sln, ref_sln;
+
+  // Initialize refinement selector.
+  H1ProjBasedSelector<double> selector(CAND_LIST, CONV_EXP, H2DRS_DEFAULT_ORDER);
+
+  // The cache is shared by all discrete problems in the process.
+  ShapeTableCache* cache = ShapeTableCache::get_instance();
+  cache->set_max_memory(CACHE_MEMORY);
+
+  TimePeriod cpu_time;
+  double time_cold_total = 0.0, time_warm_total = 0.0;
+
+  // Adaptivity loop:
+  int as = 1; bool done = false;
+  do
+  {
+    info("---- Adaptivity step %d:", as);
+
+    // Construct globally refined mesh and setup fine mesh space.
+    Space<double>* ref_space = Space<double>::construct_refined_space(&space);
+    int ndof_ref = ref_space->get_num_dofs();
+
+    // Initialize fine mesh problem.
+    NativeDiscreteProblem dp(&wf, ref_space);
+    dp.set_num_threads(NUM_THREADS);
+
+    // Initial coefficient vector for the Newton's method.
+    double* coeff_vec = new double[ndof_ref];
+    memset(coeff_vec, 0, ndof_ref * sizeof(double));
+
+    // The first assembly uses the tables kept from the previous steps
+    // ("warm"). For comparison, the same assembly is repeated with an
+    // empty cache ("cold"), this fills the cache again.
+    CSRMatrix<double> mat;
+    double* rhs = new double[ndof_ref];
+    unsigned long hits = cache->get_num_hits();
+    unsigned long misses = cache->get_num_misses();
+    cpu_time.tick(HERMES_SKIP);
+    dp.assemble(coeff_vec, &mat, rhs);
+    double time_warm = cpu_time.tick().last();
+    unsigned long hits_warm = cache->get_num_hits() - hits;
+    unsigned long misses_warm = cache->get_num_misses() - misses;
+
+    cache->clear();
+    misses = cache->get_num_misses();
+    cpu_time.tick(HERMES_SKIP);
+    dp.assemble(coeff_vec, &mat, rhs);
+    double time_cold = cpu_time.tick().last();
+    info("Assembly: warm %g s (%lu hits, %lu misses), cold %g s (%lu misses), %d tables cached (%g MB).",
+         time_warm, hits_warm, misses_warm, time_cold, cache->get_num_misses() - misses,
+         cache->get_num_tables(), cache->get_memory_size() / 1048576.0);
+    time_cold_total += time_cold;
+    time_warm_total += time_warm;
+    delete [] rhs;
+
+    // Solve on the fine mesh.
+    NewtonSolver<double> newton(&dp, matrix_solver_type);
+    newton.set_verbose_output(false);
+    try
+    {
+      newton.solve(coeff_vec);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+
+    // Translate the resulting coefficient vector into the instance of Solution.
+    Solution<double>::vector_to_solution(newton.get_sln_vector(), ref_space, &ref_sln);
+
+    // Project the fine mesh solution onto the coarse mesh.
+    OGProjection<double>::project_global(&space, &ref_sln, &sln, matrix_solver_type);
+
+    // Calculate element errors and total error estimate.
+    Adapt<double> adaptivity(&space);
+    double err_est_rel = adaptivity.calc_err_est(&sln, &ref_sln) * 100;
+
+    // Report results.
+    info("ndof_coarse: %d, ndof_fine: %d, err_est_rel: %g%%",
+      space.get_num_dofs(), ref_space->get_num_dofs(), err_est_rel);
+
+    // If err_est too large, adapt the mesh.
+    if (err_est_rel < ERR_STOP)
+      done = true;
+    else
+    {
+      done = adaptivity.adapt(&selector, THRESHOLD, STRATEGY, MESH_REGULARITY);
+
+      // Increase the counter of performed adaptivity steps.
+      if (done == false)
+        as++;
+    }
+    if (space.get_num_dofs() >= NDOF_STOP)
+      done = true;
+
+    // Clean up.
+    delete [] coeff_vec;
+    // Keep the mesh from final step, the fine mesh solution refers to it.
+    if(done == false)
+      delete ref_space->get_mesh();
+    delete ref_space;
+  }
+  while (done == false);
+
+  info("Total assembly time: warm %g s, cold %g s.", time_warm_total, time_cold_total);
+  info("Shape table cache: %lu hits, %lu misses, %lu evictions.",
+       cache->get_num_hits(), cache->get_num_misses(), cache->get_num_evictions());
+
+  return 0;
+}
@@ -0,0 +1,27 @@
+#include "definitions.h"
+
+/* Weak forms */
+
+CustomWeakFormPoissonBatched::CustomWeakFormPoissonBatched(std::string mat_al, double lambda_al,
+                                                           std::string mat_cu, double lambda_cu,
+                                                           double volume_heat_src) : WeakForm<double>(1)
+{
+  // Jacobian forms.
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, mat_al, lambda_al));
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, mat_cu, lambda_cu));
+
+  // Residual forms.
+  add_vector_form(new DefaultResidualDiffusion<double>(0, mat_al, new Hermes1DFunction<double>(lambda_al)));
+  add_vector_form(new DefaultResidualDiffusion<double>(0, mat_cu, new Hermes1DFunction<double>(lambda_cu)));
+  add_vector_form(new DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(-volume_heat_src)));
+};
+
+CustomWeakFormAdvectionDiffusion::CustomWeakFormAdvectionDiffusion(double eps, double b1, double b2,
+                                                                   double c, double f) : WeakForm<double>(1)
+{
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, HERMES_ANY, eps));
+  add_matrix_form(new BatchedJacobianAdvection(0, 0, HERMES_ANY, b1, b2));
+  add_matrix_form(new BatchedMatrixFormMass(0, 0, HERMES_ANY, c));
+
+  add_vector_form(new DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(f)));
+};
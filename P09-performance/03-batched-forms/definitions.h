@@ -0,0 +1,26 @@
+#include "hermes2d.h"
+#include "batched_forms.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+using namespace Hermes::Hermes2D::Views;
+
+/* Weak forms */
+
+// Weak form of P01-linear/03-poisson with batched Jacobian forms.
+class CustomWeakFormPoissonBatched : public WeakForm<double>
+{
+public:
+  CustomWeakFormPoissonBatched(std::string mat_al, double lambda_al,
+                               std::string mat_cu, double lambda_cu,
+                               double volume_heat_src);
+};
+
+// Linear advection-diffusion-reaction problem
+// -eps Laplace u + b . grad u + c u = f.
+class CustomWeakFormAdvectionDiffusion : public WeakForm<double>
+{
+public:
+  CustomWeakFormAdvectionDiffusion(double eps, double b1, double b2, double c, double f);
+};
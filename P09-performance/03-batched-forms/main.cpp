@@ -0,0 +1,116 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "batched_kernels.h"
+
+// This example compares the element-by-element evaluation of volumetric
+// matrix forms with the batched evaluation. Forms that implement the
+// interface BatchedMatrixForm (see common/batched_forms.h) are evaluated
+// by NativeDiscreteProblem for all pairs of basis and test functions of an
+// element in one call. The values of the shape functions are stored as
+// structure of arrays, so that the loops over integration points can be
+// vectorized (AVX2 or AVX-512, see WITH_AVX2 and WITH_AVX512 in
+// CMake.vars). We will learn how to:
+//
+//   - use the batched forms BatchedJacobianDiffusion, BatchedMatrixFormMass
+//     and BatchedJacobianAdvection,
+//   - switch the batched evaluation on and off,
+//   - verify that both evaluations give the same matrix.
+//
+// Two problems are assembled on the L-shaped domain of P01-linear/03-poisson:
+//
+// PDE 1: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+// PDE 2: -EPSILON Laplace u + B . grad u + C u = F.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// The following parameters can be changed:
+
+const int P_INIT = 5;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 1;                        // Number of assembly threads.
+const int NUM_REPEATS = 3;                        // Each assembly is repeated and the fastest run is taken.
+const double TOLERANCE = 1e-12;                   // Allowed relative difference between both evaluations.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+const double EPSILON = 0.01;               // Diffusivity of the advection-diffusion-reaction problem.
+const double B1 = 1.0, B2 = 0.5;           // Advection velocity.
+const double C = 1.0;                      // Reaction coefficient.
+const double F = 1.0;                      // Right-hand side.
+
+// Assembles the problem with the element-by-element and with the batched
+// evaluation of matrix forms and reports the times.
+static void compare(const char* name, WeakForm<double>* wf, Space<double>* space, bool linear)
+{
+  int ndof = space->get_num_dofs();
+  double* coeff_vec = NULL;
+  if (!linear)
+  {
+    coeff_vec = new double[ndof];
+    memset(coeff_vec, 0, ndof*sizeof(double));
+  }
+
+  NativeDiscreteProblem dp(wf, space);
+  dp.set_num_threads(NUM_THREADS);
+
+  CSRMatrix<double> mat_single, mat_batched;
+  double* rhs = new double[ndof];
+  double time[2];
+  TimePeriod cpu_time;
+  for (int batched = 0; batched < 2; batched++)
+  {
+    dp.set_batched_forms(batched == 1);
+    time[batched] = 0.0;
+    for (int r = 0; r < NUM_REPEATS; r++)
+    {
+      cpu_time.tick(HERMES_SKIP);
+      dp.assemble(coeff_vec, batched ? &mat_batched : &mat_single, rhs);
+      double t = cpu_time.tick().last();
+      if (r == 0 || t < time[batched]) time[batched] = t;
+    }
+  }
+
+  double diff = relative_difference(mat_batched, mat_single);
+  info("%s: single %g s, batched %g s, speedup %g, relative difference %g.",
+       name, time[0], time[1], time[0] / time[1], diff);
+  if (diff > TOLERANCE)
+    warn("Difference exceeds the tolerance %g.", TOLERANCE);
+
+  delete [] rhs;
+  delete [] coeff_vec;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulations.
+  CustomWeakFormPoissonBatched wf_poisson("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+  CustomWeakFormAdvectionDiffusion wf_adr(EPSILON, B1, B2, C, F);
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  info("ndof = %d, elements = %d, kernels: %s", space.get_num_dofs(), mesh.get_num_active_elements(),
+       batched_kernels_isa());
+
+  compare("Poisson", &wf_poisson, &space, false);
+  compare("Advection-diffusion-reaction", &wf_adr, &space, true);
+
+  return 0;
+}
@@ -0,0 +1,19 @@
+#include "hermes2d.h"
+#include "batched_forms.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+using namespace Hermes::Hermes2D::Views;
+
+/* Weak forms */
+
+// Weak form of P01-linear/03-poisson. The Jacobian forms have constant
+// coefficients and implement AffineMatrixForm.
+class CustomWeakFormPoissonAffine : public WeakForm<double>
+{
+public:
+  CustomWeakFormPoissonAffine(std::string mat_al, double lambda_al,
+                              std::string mat_cu, double lambda_cu,
+                              double volume_heat_src);
+};
@@ -0,0 +1,100 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+
+// This example shows how NativeDiscreteProblem avoids numerical quadrature
+// of forms with constant coefficients. On a triangle or a parallelogram the
+// Jacobian of the reference map is constant, and the local stiffness matrix
+// of the form LAMBDA int grad u . grad v is
+//
+//   K_ij = |J| sum_ab G_ab S^ab_ij,   G = LAMBDA J^{-1} J^{-T},
+//
+// where the reference template S^ab_ij = int du_j/dxi_a dv_i/dxi_b over the
+// reference element depends only on the shape functions. The templates are
+// computed once, every element then costs a short tensor contraction. Mass
+// and advection terms are treated in the same way.
+//
+// The Jacobian of the Poisson problem from P01-linear/03-poisson is assembled
+// with quadrature (value() for every pair of functions), with the batched
+// evaluation of 03-batched-forms, and with reference templates.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.mesh).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 5;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 1;                        // Number of assembly threads.
+const int NUM_REPEATS = 3;                        // Each assembly is repeated and the fastest run is taken.
+const double TOLERANCE = 1e-12;                   // Allowed relative difference from the quadrature.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoissonAffine wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d, elements = %d", ndof, mesh.get_num_active_elements());
+
+  // The matrix only, the residual is the same in all variants.
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+  double* coeff_vec = new double[ndof];
+  memset(coeff_vec, 0, ndof*sizeof(double));
+
+  const char* names[3] = { "quadrature", "batched", "templates" };
+  CSRMatrix<double> mat[3];
+  double time[3];
+  TimePeriod cpu_time;
+  for (int v = 0; v < 3; v++)
+  {
+    dp.set_batched_forms(v == 1);
+    dp.set_affine_templates(v == 2);
+    time[v] = 0.0;
+    for (int r = 0; r < NUM_REPEATS; r++)
+    {
+      cpu_time.tick(HERMES_SKIP);
+      dp.assemble(coeff_vec, &mat[v], NULL);
+      double t = cpu_time.tick().last();
+      if (r == 0 || t < time[v]) time[v] = t;
+    }
+    double diff = relative_difference(mat[v], mat[0]);
+    info("%-10s  %8.4f s   speedup %6.2f   relative difference %g", names[v], time[v], time[0] / time[v], diff);
+    if (diff > TOLERANCE)
+      warn("Difference exceeds the tolerance %g.", TOLERANCE);
+  }
+
+  ReferenceTemplateCache* templates = dp.get_template_cache();
+  info("%d reference templates (%g MB), %lu hits, %lu misses.", templates->get_num_templates(),
+       templates->get_memory_size() / 1048576.0, templates->get_num_hits(), templates->get_num_misses());
+
+  delete [] coeff_vec;
+
+  return 0;
+}
@@ -0,0 +1,125 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+
+//  This example solves the nonlinear problem of P02-nonlinear/02-newton-analytic
+//  on a finer mesh and shows selective reassembly of the Jacobian matrix.
+//  Late in the Newton's iteration the solution changes on few elements only.
+//  With a reassembly tolerance, NativeDiscreteProblem integrates the Jacobian
+//  only on elements whose coefficients changed by more than the tolerance
+//  (relative to the largest coefficient) since they were last integrated.
+//  The contributions of the other elements stay in the matrix. The residual
+//  is always exact, so the iteration converges to the same solution, though
+//  possibly in more steps.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, - div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, alpha).
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 4;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const int INIT_GLOB_REF_NUM = 5;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+const double REASSEMBLY_TOL = 1e-4;               // Elements whose coefficients changed by less than this
+                                                  // (relative to the largest coefficient) are not integrated.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_UMFPACK (the selective
+                                                  // reassembly needs a compressed matrix).
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // Initialize the weak formulation
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+
+  // Project the initial condition on the FE space to obtain initial
+  // coefficient vector for the Newton's method.
+  info("Projecting to obtain initial vector for the Newton's method.");
+  double* coeff_vec_init = new double[ndof];
+  CustomInitialCondition init_sln(&mesh);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec_init, matrix_solver);
+
+  // Solve once with full and once with selective reassembly.
+  double* coeff_vec = new double[ndof];
+  Solution<double> sln[2];
+  TimePeriod cpu_time;
+  for (int selective = 0; selective < 2; selective++)
+  {
+    NativeDiscreteProblem dp(&wf, &space);
+    dp.set_num_threads(NUM_THREADS);
+    dp.set_reassembly_tolerance(selective ? REASSEMBLY_TOL : 0.0);
+
+    memcpy(coeff_vec, coeff_vec_init, ndof*sizeof(double));
+    NewtonSolver<double> newton(&dp, matrix_solver);
+    newton.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    double time = cpu_time.tick().last();
+
+    unsigned long skipped = dp.get_num_skipped_elements();
+    unsigned long integrated = dp.get_num_integrated_elements();
+    info("%s reassembly: %g s, %lu elements integrated, %lu skipped (%g%%).",
+         selective ? "Selective" : "Full", time, integrated, skipped,
+         100.0 * skipped / std::max(1ul, skipped + integrated));
+
+    Solution<double>::vector_to_solution(newton.get_sln_vector(), &space, &sln[selective]);
+  }
+
+  // Both solutions satisfy the same discrete equations.
+  double diff = Global<double>::calc_rel_error(&sln[1], &sln[0], HERMES_H1_NORM) * 100;
+  info("Relative difference of the solutions: %g%%.", diff);
+
+  // Clean up.
+  delete [] coeff_vec;
+  delete [] coeff_vec_init;
+
+  // Visualise the solution and mesh.
+  ScalarView s_view("Solution", new WinGeom(0, 0, 440, 350));
+  s_view.show_mesh(false);
+  s_view.show(&sln[1]);
+  OrderView o_view("Mesh", new WinGeom(450, 0, 400, 350));
+  o_view.show(&space);
+
+  // Wait for all views to be closed.
+  View::wait();
+  return 0;
+}
@@ -0,0 +1,125 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+
+//  This example runs the time-dependent heat transfer problem of
+//  P03-transient/01-implicit-euler (St. Vitus Cathedral during one 24-hour
+//  cycle) and shows that the matrix structure does not need to be rebuilt
+//  in every time step. The space does not change during the computation,
+//  so NativeDiscreteProblem keeps the sparsity pattern, and the Jacobian
+//  matrix of the NewtonSolver, which is the same object in all steps,
+//  keeps its storage. Only its values are set to zero. The computation
+//  is run with and without the pattern cache, the time spent in the
+//  phases of the assembly is reported.
+//
+//  PDE: non-stationary heat transfer equation
+//  dT/dt - LAMBDA / (HEATCAP * RHO) * Laplace T = 0.
+//
+//  Domain: St. Vitus cathedral (file cathedral.mesh).
+//
+//  IC:  T = TEMP_INIT.
+//  BC:  T = TEMP_INIT on the bottom edge ... Dirichlet,
+//       LAMBDA * dT/dn = ALPHA*(t_exterior(time) - T) ... Newton, time-dependent.
+//
+//  Time-stepping: implicit Euler method.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 2;                             // Polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int INIT_REF_NUM_BDY = 3;                   // Number of initial uniform mesh refinements towards the boundary.
+const double time_step = 300.0;                   // Time step in seconds.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+const double TEMP_INIT = 10;       // Temperature of the ground (also initial temperature).
+const double ALPHA = 10;           // Heat flux coefficient for Newton's boundary condition.
+const double LAMBDA = 1e2;         // Thermal conductivity of the material.
+const double HEATCAP = 1e2;        // Heat capacity.
+const double RHO = 3000;           // Material density.
+const double T_FINAL = 86400;      // Length of time interval (24 hours) in seconds.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Boundary air", INIT_REF_NUM_BDY);
+  mesh.refine_towards_boundary("Boundary ground", INIT_REF_NUM_BDY);
+
+  // Initialize boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential("Boundary ground", TEMP_INIT);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  double* coeff_vec = new double[ndof];
+  double* coeff_vec_no_cache = new double[ndof];
+  for (int cache = 0; cache < 2; cache++)
+  {
+    // Previous time level solution (initialized by the external temperature).
+    CustomInitialCondition tsln(&mesh, TEMP_INIT);
+
+    // Initialize the weak formulation.
+    double current_time = 0;
+    CustomWeakFormHeatRK1 wf("Boundary air", ALPHA, LAMBDA, HEATCAP, RHO, time_step,
+                             &current_time, TEMP_INIT, T_FINAL, &tsln);
+
+    // Initialize the FE problem.
+    NativeDiscreteProblem dp(&wf, &space);
+    dp.set_num_threads(NUM_THREADS);
+    dp.set_pattern_cache(cache == 1);
+
+    // Initial coefficient vector for the Newton's method.
+    memset(coeff_vec, 0, ndof*sizeof(double));
+
+    // Initialize Newton solver.
+    NewtonSolver<double> newton(&dp, matrix_solver);
+    newton.set_verbose_output(false);
+
+    // Time stepping. The Jacobian is assembled in every step.
+    int ts = 0;
+    do
+    {
+      try
+      {
+        newton.solve(coeff_vec);
+      }
+      catch(Hermes::Exceptions::Exception e)
+      {
+        e.printMsg();
+        error("Newton's iteration failed.");
+      }
+      Solution<double>::vector_to_solution(coeff_vec, &space, &tsln);
+
+      current_time += time_step;
+      ts++;
+    }
+    while (current_time < T_FINAL);
+    if (cache == 0)
+      memcpy(coeff_vec_no_cache, coeff_vec, ndof*sizeof(double));
+
+    const NativeDiscreteProblem::AssemblyTimes& times = dp.get_assembly_times();
+    info("Pattern cache %s, %d time steps:", cache ? "on" : "off", ts);
+    info("  pattern     %8.4f s (%d patterns computed)", times.pattern, times.num_patterns);
+    info("  allocation  %8.4f s (%d matrices allocated)", times.allocation, times.num_allocations);
+    info("  integration %8.4f s", times.integration);
+  }
+  bool identical = (memcmp(coeff_vec, coeff_vec_no_cache, ndof*sizeof(double)) == 0);
+  info("Final solutions with and without the cache identical: %s", identical ? "yes" : "NO");
+
+  // Cleaning up.
+  delete [] coeff_vec;
+  delete [] coeff_vec_no_cache;
+
+  return 0;
+}
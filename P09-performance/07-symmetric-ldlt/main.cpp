@@ -0,0 +1,116 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "ldlt_solver.h"
+
+// This example solves the linear Poisson problem of P01-linear/03-poisson
+// with a symmetric matrix that stores the upper triangle only, and with the
+// sparse LDL^T factorization of the directory common/. We will learn how to:
+//
+//   - assemble a symmetric matrix with NativeDiscreteProblem,
+//   - solve it with a native solver selected by NativeSolverType,
+//   - compare memory and time with the full matrix and UMFPACK.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.mesh).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 4;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 4;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+NativeSolverType native_solver = NATIVE_SOLVER_LDLT;  // Native solver for the symmetric matrix.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Hermes solver used for comparison.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoissonLinear wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+  TimePeriod cpu_time;
+
+  // Full storage.
+  CSRMatrix<double> matrix_full;
+  double* rhs = new double[ndof];
+  cpu_time.tick(HERMES_SKIP);
+  dp.assemble(NULL, &matrix_full, rhs);
+  double time_full = cpu_time.tick().last();
+
+  // Symmetric storage.
+  dp.set_symmetric_storage(true);
+  CSRMatrix<double> matrix_sym;
+  cpu_time.tick(HERMES_SKIP);
+  dp.assemble(NULL, &matrix_sym, rhs);
+  double time_sym = cpu_time.tick().last();
+
+  info("Assembly: full %g s (%g MB), symmetric %g s (%g MB), relative difference %g.",
+       time_full, matrix_full.get_memory_size() / 1048576.0, time_sym,
+       matrix_sym.get_memory_size() / 1048576.0, relative_difference(matrix_sym, matrix_full));
+
+  // Native solver.
+  NativeLinearSolver<double>* solver = create_native_linear_solver(native_solver, &matrix_sym, rhs);
+  if (!solver->solve())
+    error("Native solver failed.");
+  info("%s: %g s.", get_native_solver_name(native_solver), solver->get_time());
+  LDLTSolver* ldlt = dynamic_cast<LDLTSolver*>(solver);
+  if (ldlt != NULL)
+    info("Factor: %d nonzeros (%g MB).", ldlt->get_factor_nnz(), ldlt->get_memory_size() / 1048576.0);
+
+  // Hermes UMFPACK with the full matrix.
+  dp.set_symmetric_storage(false);
+  SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
+  Vector<double>* vector = create_vector<double>(matrix_solver);
+  LinearSolver<double>* hermes_solver = create_linear_solver<double>(matrix_solver, matrix, vector);
+  dp.assemble(matrix, vector);
+  cpu_time.tick(HERMES_SKIP);
+  if (!hermes_solver->solve())
+    error("Matrix solver failed.");
+  info("UMFPACK: %g s.", cpu_time.tick().last());
+
+  double diff = 0.0, max_sln = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff = std::max(diff, std::abs(solver->get_sln_vector()[i] - hermes_solver->get_sln_vector()[i]));
+    max_sln = std::max(max_sln, std::abs(hermes_solver->get_sln_vector()[i]));
+  }
+  info("Relative difference of the solutions: %g.", diff / max_sln);
+
+  // Clean up.
+  delete solver;
+  delete hermes_solver;
+  delete matrix;
+  delete vector;
+  delete [] rhs;
+
+  return 0;
+}
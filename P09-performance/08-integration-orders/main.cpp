@@ -0,0 +1,135 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+
+//  This example uses the nonlinear problem of P02-nonlinear/02-newton-analytic
+//  to show how integration orders are determined. The order of a form comes
+//  from its ord() method, which Hermes evaluates with the arithmetic type
+//  Ord on every element. NativeDiscreteProblem calls ord() only once per
+//  combination of function orders and element type and remembers the result.
+//  The nonlinearity of this problem returns Ord(10) for lambda(u), so its
+//  forms are integrated with very high orders. The example prints the orders
+//  chosen for every form, and then solves the problem once more with an
+//  order set explicitly for all forms.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, - div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, alpha).
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 3;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const int INIT_GLOB_REF_NUM = 5;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+const int FIXED_ORDER = 3 * P_INIT;               // Integration order set for all forms in the second run.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // Initialize the weak formulation
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+
+  // Project the initial condition on the FE space to obtain initial
+  // coefficient vector for the Newton's method.
+  info("Projecting to obtain initial vector for the Newton's method.");
+  double* coeff_vec_init = new double[ndof];
+  CustomInitialCondition init_sln(&mesh);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec_init, matrix_solver);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+
+  // One assembly of the Jacobian and the residual with and without
+  // the cache of orders.
+  CSRMatrix<double> matrix;
+  double* rhs = new double[ndof];
+  TimePeriod cpu_time;
+  for (int cached = 0; cached < 2; cached++)
+  {
+    dp.set_order_cache(cached == 1);
+    dp.reset_form_order_stats();
+    cpu_time.tick(HERMES_SKIP);
+    dp.assemble(coeff_vec_init, &matrix, rhs);
+    info("Assembly %s the order cache: %g s.", cached ? "with" : "without", cpu_time.tick().last());
+    dp.print_form_orders();
+  }
+
+  // Solve with the orders of ord(), then with the fixed order.
+  double* coeff_vec = new double[ndof];
+  Solution<double> sln[2];
+  for (int fixed = 0; fixed < 2; fixed++)
+  {
+    if (fixed)
+    {
+      Hermes::vector<MatrixFormVol<double>*> mfvol = wf.get_mfvol();
+      Hermes::vector<VectorFormVol<double>*> vfvol = wf.get_vfvol();
+      for (unsigned int k = 0; k < mfvol.size(); k++)
+        dp.set_form_order(mfvol[k], FIXED_ORDER);
+      for (unsigned int k = 0; k < vfvol.size(); k++)
+        dp.set_form_order(vfvol[k], FIXED_ORDER);
+    }
+    dp.reset_form_order_stats();
+
+    memcpy(coeff_vec, coeff_vec_init, ndof*sizeof(double));
+    NewtonSolver<double> newton(&dp, matrix_solver);
+    newton.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    info("Newton's method with %s orders: %g s.", fixed ? "fixed" : "automatic", cpu_time.tick().last());
+    dp.print_form_orders();
+
+    Solution<double>::vector_to_solution(newton.get_sln_vector(), &space, &sln[fixed]);
+  }
+
+  // The difference shows what the lower order costs in accuracy.
+  double diff = Global<double>::calc_rel_error(&sln[1], &sln[0], HERMES_H1_NORM) * 100;
+  info("Relative difference of the solutions: %g%%.", diff);
+
+  // Clean up.
+  delete [] coeff_vec;
+  delete [] coeff_vec_init;
+  delete [] rhs;
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "matrix_free_operator.h"
+#include "matrix_free_newton.h"
+
+// This example solves the electrostatic problem of P04-adaptivity/01-intro-matrix-free
+// on a fixed mesh without assembling any matrix, and without Trilinos. We will
+// learn how to:
+//
+//   - apply the Jacobian with MatrixFreeOperator (sum factorization on quads),
+//   - solve the problem with MatrixFreeNewtonSolver (Newton's method with CG),
+//   - compare memory and time with an assembled matrix.
+//
+// PDE: -div[eps_r(x,y) grad phi] = 0
+//      eps_r = EPS_1 in Omega_1 (surrounding air)
+//      eps_r = EPS_2 in Omega_2 (moving part of the motor)
+//
+// BC: phi = 0 V on Gamma_1 (left edge and also the rest of the outer boundary
+//     phi = VOLTAGE on Gamma_2 (boundary of stator)
+//
+// The following parameters can be changed:
+
+const int P_INIT = 4;                             // Uniform polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int NUM_APPLY = 20;                         // Number of operator applications that are timed.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method
+                                                  // (relative to the initial residual).
+const double CG_TOL = 1e-10;                      // Relative tolerance of the CG method.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+
+// Problem parameters.
+const double EPS0 = 8.863e-12;
+const double VOLTAGE = 50.0;
+const double EPS_MOTOR = 10.0 * EPS0;
+const double EPS_AIR = 1.0 * EPS0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Motor", EPS_MOTOR, "Air", EPS_AIR);
+
+  // Initialize boundary conditions
+  DefaultEssentialBCConst<double> bc_essential_out("Outer", 0.0);
+  DefaultEssentialBCConst<double> bc_essential_stator("Stator", VOLTAGE);
+  EssentialBCs<double> bcs(Hermes::vector<EssentialBoundaryCondition<double> *>(&bc_essential_out, &bc_essential_stator));
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d, elements = %d", ndof, mesh.get_num_active_elements());
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+  TimePeriod cpu_time;
+
+  // Assembled Jacobian.
+  double* coeff_vec = new double[ndof];
+  memset(coeff_vec, 0, ndof*sizeof(double));
+  CSRMatrix<double> matrix;
+  cpu_time.tick(HERMES_SKIP);
+  dp.assemble(coeff_vec, &matrix, NULL);
+  info("Assembly: %g s, %g MB.", cpu_time.tick().last(), matrix.get_memory_size() / 1048576.0);
+
+  // Matrix-free Jacobian.
+  MatrixFreeOperator op(&wf, &space);
+  cpu_time.tick(HERMES_SKIP);
+  op.update();
+  info("Matrix-free setup: %g s, %g MB, %d points per direction.", cpu_time.tick().last(),
+       op.get_memory_size() / 1048576.0, op.get_num_points());
+
+  // Both applied to the same vector.
+  for (int i = 0; i < ndof; i++)
+    coeff_vec[i] = std::sin(0.1 * i);
+  double* y_assembled = new double[ndof];
+  double* y_free = new double[ndof];
+  cpu_time.tick(HERMES_SKIP);
+  for (int k = 0; k < NUM_APPLY; k++)
+    matrix.multiply(coeff_vec, y_assembled);
+  double time_assembled = cpu_time.tick().last() / NUM_APPLY;
+  for (int k = 0; k < NUM_APPLY; k++)
+    op.apply(coeff_vec, y_free);
+  double time_free = cpu_time.tick().last() / NUM_APPLY;
+  double diff = 0.0, max_y = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff = std::max(diff, std::abs(y_free[i] - y_assembled[i]));
+    max_y = std::max(max_y, std::abs(y_assembled[i]));
+  }
+  info("One application: assembled %g s, matrix-free %g s, relative difference %g.",
+       time_assembled, time_free, diff / max_y);
+
+  // Newton's method with both operators. The tolerance is relative to the
+  // residual of the zero vector.
+  double* rhs = new double[ndof];
+  memset(coeff_vec, 0, ndof*sizeof(double));
+  dp.assemble(coeff_vec, (CSRMatrix<double>*) NULL, rhs);
+  double residual_norm = 0.0;
+  for (int i = 0; i < ndof; i++)
+    residual_norm += rhs[i] * rhs[i];
+  residual_norm = std::sqrt(residual_norm);
+
+  CSRMatrixOperator matrix_op(&matrix);
+  LinearOperator* ops[2] = { &matrix_op, &op };
+  const char* names[2] = { "Assembled", "Matrix-free" };
+  double* sln[2];
+  for (int k = 0; k < 2; k++)
+  {
+    MatrixFreeNewtonSolver newton(&dp, ops[k]);
+    newton.set_cg_tolerance(CG_TOL);
+    newton.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(NULL, NEWTON_TOL * residual_norm);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    info("%s: %g s, %d Newton iterations, %d CG iterations.", names[k], cpu_time.tick().last(),
+         newton.get_num_iterations(), newton.get_num_cg_iterations());
+    sln[k] = new double[ndof];
+    memcpy(sln[k], newton.get_sln_vector(), ndof*sizeof(double));
+  }
+
+  diff = 0.0;
+  max_y = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff = std::max(diff, std::abs(sln[1][i] - sln[0][i]));
+    max_y = std::max(max_y, std::abs(sln[0][i]));
+  }
+  info("Relative difference of the solutions: %g.", diff / max_y);
+
+  // Clean up.
+  delete [] coeff_vec;
+  delete [] y_assembled;
+  delete [] y_free;
+  delete [] rhs;
+  delete [] sln[0];
+  delete [] sln[1];
+
+  return 0;
+}
@@ -0,0 +1,18 @@
+#include "hermes2d.h"
+#include "batched_forms.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+using namespace Hermes::Hermes2D::Views;
+
+/* Weak forms */
+
+// Weak form of P04-adaptivity/01-intro with the batched Jacobian forms
+// of the directory common/.
+class CustomWeakFormPoisson : public WeakForm<double>
+{
+public:
+  CustomWeakFormPoisson(const std::string& mat_motor, double eps_motor,
+                        const std::string& mat_air, double eps_air);
+};
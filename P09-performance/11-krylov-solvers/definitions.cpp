@@ -0,0 +1,17 @@
+#include "definitions.h"
+
+/* Weak forms */
+
+CustomWeakFormPoisson::CustomWeakFormPoisson(std::string mat_al, double lambda_al,
+                                             std::string mat_cu, double lambda_cu,
+                                             double volume_heat_src) : WeakForm<double>(1)
+{
+  // Jacobian forms.
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, mat_al, lambda_al));
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, mat_cu, lambda_cu));
+
+  // Residual forms.
+  add_vector_form(new DefaultResidualDiffusion<double>(0, mat_al, new Hermes1DFunction<double>(lambda_al)));
+  add_vector_form(new DefaultResidualDiffusion<double>(0, mat_cu, new Hermes1DFunction<double>(lambda_cu)));
+  add_vector_form(new DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(-volume_heat_src)));
+};
@@ -0,0 +1,148 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "iterative_solver.h"
+#include "native_newton.h"
+
+// This example solves the Poisson problem of P01-linear/03-poisson on a
+// finer mesh with the Krylov solvers of the directory common/, which need
+// neither Trilinos nor any other external library. We will learn how to:
+//
+//   - select CG, GMRES or BiCGStab by NativeSolverType,
+//   - combine them with the Jacobi, SSOR and ILU(0) preconditioners,
+//   - use them in Newton's method with NativeNewtonSolver,
+//   - compare them with a direct solver.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.xml).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 5;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double KRYLOV_TOL = 1e-10;                  // Relative tolerance of the Krylov solvers.
+NativeSolverType native_solver = NATIVE_SOLVER_CG;           // Solver of Newton's method: NATIVE_SOLVER_CG,
+                                                             // NATIVE_SOLVER_GMRES, NATIVE_SOLVER_BICGSTAB.
+NativePreconditionerType native_precond = NATIVE_PRECOND_SSOR;  // Its preconditioner.
+const bool COMPARE_DIRECT = true;                 // Solve with the Hermes solver below as well.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+
+  // The first Newton step: J(0) x = -F(0).
+  CSRMatrix<double> jacobian;
+  double* rhs = new double[ndof];
+  double* zero = new double[ndof];
+  memset(zero, 0, ndof * sizeof(double));
+  dp.assemble(zero, &jacobian, rhs);
+  for (int i = 0; i < ndof; i++)
+    rhs[i] = -rhs[i];
+
+  // All methods with their sensible preconditioners.
+  const int num_variants = 7;
+  NativeSolverType types[num_variants] = { NATIVE_SOLVER_CG, NATIVE_SOLVER_CG, NATIVE_SOLVER_CG,
+                                           NATIVE_SOLVER_GMRES, NATIVE_SOLVER_GMRES,
+                                           NATIVE_SOLVER_BICGSTAB, NATIVE_SOLVER_BICGSTAB };
+  NativePreconditionerType preconds[num_variants] = { NATIVE_PRECOND_JACOBI, NATIVE_PRECOND_SSOR, NATIVE_PRECOND_ILU0,
+                                                      NATIVE_PRECOND_SSOR, NATIVE_PRECOND_ILU0,
+                                                      NATIVE_PRECOND_SSOR, NATIVE_PRECOND_ILU0 };
+  for (int k = 0; k < num_variants; k++)
+  {
+    IterativeSolver solver(types[k], &jacobian, rhs);
+    solver.set_preconditioner(preconds[k]);
+    solver.set_tolerance(KRYLOV_TOL);
+    bool converged = solver.solve();
+    info("%s + %s: %d iterations, %g s, residual %g%s.", get_native_solver_name(types[k]),
+         get_native_preconditioner_name(preconds[k]), solver.get_num_iterations(), solver.get_time(),
+         solver.get_residual_norm(), converged ? "" : " (not converged)");
+  }
+
+  // Newton's method with the selected solver.
+  NativeNewtonSolver newton(&dp, native_solver);
+  newton.set_verbose_output(false);
+  IterativeSolver* iterative = dynamic_cast<IterativeSolver*>(newton.get_linear_solver());
+  if (iterative != NULL)
+  {
+    iterative->set_preconditioner(native_precond);
+    iterative->set_tolerance(KRYLOV_TOL);
+  }
+  try
+  {
+    newton.solve(zero);
+  }
+  catch(Hermes::Exceptions::Exception e)
+  {
+    e.printMsg();
+    error("Newton's iteration failed.");
+  }
+  info("Newton with %s + %s: %d iterations, linear solver %g s.", get_native_solver_name(native_solver),
+       get_native_preconditioner_name(native_precond), newton.get_num_iterations(), newton.get_linear_solver_time());
+
+  // Hermes' Newton's method with the direct solver.
+  if (COMPARE_DIRECT)
+  {
+    NewtonSolver<double> newton_direct(&dp, matrix_solver);
+    newton_direct.set_verbose_output(false);
+    TimePeriod cpu_time;
+    try
+    {
+      newton_direct.solve(zero);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    info("Newton with the direct solver: %g s.", cpu_time.tick().last());
+
+    double diff = 0.0, max_sln = 0.0;
+    for (int i = 0; i < ndof; i++)
+    {
+      diff = std::max(diff, std::abs(newton.get_sln_vector()[i] - newton_direct.get_sln_vector()[i]));
+      max_sln = std::max(max_sln, std::abs(newton_direct.get_sln_vector()[i]));
+    }
+    info("Relative difference of the solutions: %g.", diff / max_sln);
+  }
+
+  // Clean up.
+  delete [] rhs;
+  delete [] zero;
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "iterative_solver.h"
+#include "amg_preconditioner.h"
+#include "hermes_matrix_utils.h"
+#include <sstream>
+
+// This example solves the electrostatic micromotor of P04-adaptivity/02-kelly
+// on a sequence of uniformly refined meshes with CG and the smoothed
+// aggregation algebraic multigrid (AMG) preconditioner of the directory
+// common/. We will learn how to:
+//
+//   - select the AMG preconditioner of the native Krylov solvers,
+//   - set its number of levels, aggregation threshold and smoother,
+//   - pass the near null space of the hierarchic shapeset to it,
+//   - observe that the number of CG iterations does not grow with the mesh
+//     size, unlike with SSOR.
+//
+// The large jump of the permittivity between the motor and the air does
+// not hurt the aggregation: the strength of connection is measured
+// relative to the diagonal.
+//
+// PDE: -div[eps_r(x,y) grad phi] = 0
+//      eps_r = EPS_1 in Omega_1 (surrounding air)
+//      eps_r = EPS_2 in Omega_2 (moving part of the motor)
+//
+// BC: phi = 0 V on Gamma_1 (left edge and also the rest of the outer boundary
+//     phi = VOLTAGE on Gamma_2 (boundary of stator)
+//
+// The following parameters can be changed:
+
+const int P_INIT = 2;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM_MIN = 1;                   // Number of uniform mesh refinements of the first mesh.
+const int INIT_REF_NUM_MAX = 5;                   // Number of uniform mesh refinements of the last mesh.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double KRYLOV_TOL = 1e-10;                  // Relative tolerance of CG.
+const int AMG_MAX_LEVELS = 10;                    // Maximum number of AMG levels.
+const int AMG_COARSE_SIZE = 500;                  // Levels up to this size are solved directly.
+const double AMG_THRESHOLD = 0.08;                // Strength of connection threshold of the aggregation.
+AMGSmootherType amg_smoother = AMG_SMOOTHER_GAUSS_SEIDEL;  // Possibilities: AMG_SMOOTHER_GAUSS_SEIDEL,
+                                                           // AMG_SMOOTHER_CHEBYSHEV.
+const int AMG_SMOOTHING_STEPS = 1;                // Sweeps of Gauss-Seidel, or the Chebyshev degree.
+const bool COMPARE_SSOR = true;                   // Solve with CG + SSOR as well.
+
+// Problem parameters.
+const double EPS0 = 8.863e-12;
+const double VOLTAGE = 50.0;
+const double EPS_MOTOR = 10.0 * EPS0;
+const double EPS_AIR = 1.0 * EPS0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("motor.mesh", &mesh);
+
+  // Perform the refinements of the first mesh.
+  for (int i = 0; i < INIT_REF_NUM_MIN; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Motor", EPS_MOTOR, "Air", EPS_AIR);
+
+  // Initialize boundary conditions
+  DefaultEssentialBCConst<double> bc_essential_out("Outer", 0.0);
+  DefaultEssentialBCConst<double> bc_essential_stator("Stator", VOLTAGE);
+  EssentialBCs<double> bcs(Hermes::vector<EssentialBoundaryCondition<double> *>(&bc_essential_out, &bc_essential_stator));
+
+  for (int ref = INIT_REF_NUM_MIN; ref <= INIT_REF_NUM_MAX; ref++)
+  {
+    if (ref > INIT_REF_NUM_MIN)
+      mesh.refine_all_elements();
+
+    // Create an H1 space with default shapeset.
+    H1Space<double> space(&mesh, &bcs, P_INIT);
+    int ndof = space.get_num_dofs();
+    info("---- Refinements %d, ndof = %d:", ref, ndof);
+
+    NativeDiscreteProblem dp(&wf, &space);
+    dp.set_num_threads(NUM_THREADS);
+
+    // The first Newton step: J(0) x = -F(0).
+    CSRMatrix<double> jacobian;
+    double* rhs = new double[ndof];
+    double* zero = new double[ndof];
+    memset(zero, 0, ndof * sizeof(double));
+    dp.assemble(zero, &jacobian, rhs);
+    for (int i = 0; i < ndof; i++)
+      rhs[i] = -rhs[i];
+
+    // The constant function in the coefficients of the hierarchic basis.
+    std::vector<double> constant;
+    get_constant_coefficients(&space, constant);
+
+    // CG + AMG.
+    IterativeSolver solver(NATIVE_SOLVER_CG, &jacobian, rhs);
+    solver.set_preconditioner(NATIVE_PRECOND_AMG);
+    solver.set_tolerance(KRYLOV_TOL);
+    AMGPreconditioner* amg = dynamic_cast<AMGPreconditioner*>(solver.get_preconditioner());
+    amg->set_max_levels(AMG_MAX_LEVELS);
+    amg->set_coarse_size(AMG_COARSE_SIZE);
+    amg->set_threshold(AMG_THRESHOLD);
+    amg->set_smoother(amg_smoother, AMG_SMOOTHING_STEPS);
+    amg->set_near_null_space(&constant[0], ndof);
+    bool converged = solver.solve();
+    info("CG + AMG: %d iterations, %g s (setup %g s), residual %g%s.", solver.get_num_iterations(),
+         solver.get_time(), amg->get_setup_time(), solver.get_residual_norm(), converged ? "" : " (not converged)");
+
+    // The hierarchy.
+    std::stringstream sizes;
+    for (int l = 0; l < amg->get_num_levels(); l++)
+      sizes << (l > 0 ? ", " : "") << amg->get_level_size(l);
+    info("AMG levels: %d (%s), operator complexity %g.", amg->get_num_levels(), sizes.str().c_str(),
+         amg->get_operator_complexity());
+
+    // CG + SSOR for comparison.
+    if (COMPARE_SSOR)
+    {
+      IterativeSolver solver_ssor(NATIVE_SOLVER_CG, &jacobian, rhs);
+      solver_ssor.set_preconditioner(NATIVE_PRECOND_SSOR);
+      solver_ssor.set_tolerance(KRYLOV_TOL);
+      converged = solver_ssor.solve();
+      info("CG + SSOR: %d iterations, %g s, residual %g%s.", solver_ssor.get_num_iterations(),
+           solver_ssor.get_time(), solver_ssor.get_residual_norm(), converged ? "" : " (not converged)");
+    }
+
+    // Clean up.
+    delete [] rhs;
+    delete [] zero;
+  }
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "iterative_solver.h"
+#include "pmultigrid_preconditioner.h"
+
+using namespace RefinementSelectors;
+
+// This example runs the hp-adaptivity loop of P04-adaptivity/01-intro
+// (electrostatic micromotor) and solves the problems on the reference
+// spaces iteratively. Their polynomial degrees reach 8 - 10, where the
+// incomplete factorizations degrade. We will learn how to:
+//
+//   - build a p-multigrid preconditioner from the hierarchic H1 space,
+//   - pass a preconditioner created by the user to IterativeSolver,
+//   - compare it with SSOR and ILU(0) as the orders grow.
+//
+// PDE: -div[eps_r(x,y) grad phi] = 0
+//      eps_r = EPS_1 in Omega_1 (surrounding air)
+//      eps_r = EPS_2 in Omega_2 (moving part of the motor)
+//
+// BC: phi = 0 V on Gamma_1 (left edge and also the rest of the outer boundary
+//     phi = VOLTAGE on Gamma_2 (boundary of stator)
+//
+// The following parameters can be changed:
+
+const int P_INIT = 2;                             // Initial polynomial degree of all mesh elements.
+const double THRESHOLD = 0.2;                     // This is a quantitative parameter of the adapt(...) function and
+                                                  // it has different meanings for various adaptive strategies.
+const int STRATEGY = 0;                           // Adaptive strategy, see P04-adaptivity/01-intro.
+const CandList CAND_LIST = H2D_HP_ANISO;          // Predefined list of element refinement candidates.
+const int MESH_REGULARITY = -1;                   // Maximum allowed level of hanging nodes.
+const double CONV_EXP = 1.0;                      // Parameter of the selection of candidates in hp-adaptivity.
+const double ERR_STOP = 0.1;                      // Stopping criterion for adaptivity (rel. error tolerance between the
+                                                  // fine mesh and coarse mesh solution in percent).
+const int NDOF_STOP = 60000;                      // Adaptivity process stops when the number of degrees of freedom grows
+                                                  // over this limit.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double KRYLOV_TOL = 1e-10;                  // Relative tolerance of the Krylov solvers.
+PMultigridCoarsening pmg_coarsening = PMG_COARSEN_HALVE;  // Orders of the levels: PMG_COARSEN_HALVE,
+                                                          // PMG_COARSEN_DECREMENT.
+const int PMG_SMOOTHING_STEPS = 2;                // Block Jacobi steps before and after the coarse correction.
+const double PMG_DAMPING = 0.7;                   // Damping of the block Jacobi steps.
+const bool COMPARE = true;                        // Solve with CG + SSOR and GMRES + ILU(0) as well.
+MatrixSolverType matrix_solver_type = SOLVER_UMFPACK; // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                      // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+const double EPS0 = 8.863e-12;
+const double VOLTAGE = 50.0;
+const double EPS_MOTOR = 10.0 * EPS0;
+const double EPS_AIR = 1.0 * EPS0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", &mesh);
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Motor", EPS_MOTOR, "Air", EPS_AIR);
+
+  // Initialize boundary conditions
+  DefaultEssentialBCConst<double> bc_essential_out("Outer", 0.0);
+  DefaultEssentialBCConst<double> bc_essential_stator("Stator", VOLTAGE);
+  EssentialBCs<double> bcs(Hermes::vector<EssentialBoundaryCondition<double> *>(&bc_essential_out, &bc_essential_stator));
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+
+  // Initialize coarse and fine mesh solution.
+  Solution<double> sln, ref_sln;
+
+  // Initialize refinement selector.
+  H1ProjBasedSelector<double> selector(CAND_LIST, CONV_EXP, H2DRS_DEFAULT_ORDER);
+
+  // Adaptivity loop:
+  int as = 1; bool done = false;
+  do
+  {
+    info("---- Adaptivity step %d:", as);
+
+    // Construct globally refined mesh and setup fine mesh space.
+    Space<double>* ref_space = Space<double>::construct_refined_space(&space);
+    int ndof_ref = ref_space->get_num_dofs();
+
+    // Initialize fine mesh problem.
+    NativeDiscreteProblem dp(&wf, ref_space);
+    dp.set_num_threads(NUM_THREADS);
+
+    // The problem is linear, one Newton step J(0) x = -F(0) solves it.
+    CSRMatrix<double> jacobian;
+    double* rhs = new double[ndof_ref];
+    double* coeff_vec = new double[ndof_ref];
+    memset(coeff_vec, 0, ndof_ref * sizeof(double));
+    dp.assemble(coeff_vec, &jacobian, rhs);
+    for (int i = 0; i < ndof_ref; i++)
+      rhs[i] = -rhs[i];
+
+    // CG + p-multigrid. With the problem the preconditioner also follows a
+    // renumbering of the DOFs.
+    PMultigridPreconditioner pmg(ref_space, &dp);
+    pmg.set_coarsening(pmg_coarsening);
+    pmg.set_smoothing(PMG_SMOOTHING_STEPS, PMG_DAMPING);
+    IterativeSolver solver(NATIVE_SOLVER_CG, &jacobian, rhs);
+    solver.set_preconditioner(&pmg);
+    solver.set_tolerance(KRYLOV_TOL);
+    bool converged = solver.solve();
+    info("Max. order %d, %d levels (p = 1: %d DOFs).", pmg.get_max_order(), pmg.get_num_levels(),
+         pmg.get_level_size(pmg.get_num_levels() - 1));
+    info("CG + p-multigrid: %d iterations, %g s (setup %g s)%s.", solver.get_num_iterations(),
+         solver.get_time(), pmg.get_setup_time(), converged ? "" : " (not converged)");
+
+    // The same system with the standard preconditioners.
+    if (COMPARE)
+    {
+      NativeSolverType types[2] = { NATIVE_SOLVER_CG, NATIVE_SOLVER_GMRES };
+      NativePreconditionerType preconds[2] = { NATIVE_PRECOND_SSOR, NATIVE_PRECOND_ILU0 };
+      for (int k = 0; k < 2; k++)
+      {
+        IterativeSolver other(types[k], &jacobian, rhs);
+        other.set_preconditioner(preconds[k]);
+        other.set_tolerance(KRYLOV_TOL);
+        bool other_converged = other.solve();
+        info("%s + %s: %d iterations, %g s%s.", get_native_solver_name(types[k]),
+             get_native_preconditioner_name(preconds[k]), other.get_num_iterations(), other.get_time(),
+             other_converged ? "" : " (not converged)");
+      }
+    }
+
+    // Translate the resulting coefficient vector into the instance of Solution.
+    Solution<double>::vector_to_solution(solver.get_sln_vector(), ref_space, &ref_sln);
+
+    // Project the fine mesh solution onto the coarse mesh.
+    OGProjection<double>::project_global(&space, &ref_sln, &sln, matrix_solver_type);
+
+    // Calculate element errors and total error estimate.
+    Adapt<double> adaptivity(&space);
+    double err_est_rel = adaptivity.calc_err_est(&sln, &ref_sln) * 100;
+
+    // Report results.
+    info("ndof_coarse: %d, ndof_fine: %d, err_est_rel: %g%%",
+      space.get_num_dofs(), ref_space->get_num_dofs(), err_est_rel);
+
+    // If err_est too large, adapt the mesh.
+    if (err_est_rel < ERR_STOP)
+      done = true;
+    else
+    {
+      done = adaptivity.adapt(&selector, THRESHOLD, STRATEGY, MESH_REGULARITY);
+
+      // Increase the counter of performed adaptivity steps.
+      if (done == false)
+        as++;
+    }
+    if (space.get_num_dofs() >= NDOF_STOP)
+      done = true;
+
+    // Clean up.
+    delete [] rhs;
+    delete [] coeff_vec;
+    // Keep the mesh from final step, the fine mesh solution refers to it.
+    if(done == false)
+      delete ref_space->get_mesh();
+    delete ref_space;
+  }
+  while (done == false);
+
+  return 0;
+}
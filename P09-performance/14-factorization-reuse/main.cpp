@@ -0,0 +1,154 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_newton.h"
+#include "ldlt_solver.h"
+
+// This example solves the heat transfer problem of P03-transient/01-implicit-euler
+// (St. Vitus Cathedral during one day) with the native Newton's method and the
+// LDL^T solver of the directory common/. The Jacobian (mass matrix / tau +
+// diffusion + Newton boundary condition) is the same in all time steps, only
+// the residual changes with the previous solution and the exterior
+// temperature. We will learn how to:
+//
+//   - keep the factorization of a native solver between calls to solve(),
+//   - choose between the schemes NATIVE_FACTORIZE_FROM_SCRATCH,
+//     NATIVE_REUSE_MATRIX_REORDERING and NATIVE_REUSE_FACTORIZATION_COMPLETELY,
+//   - rely on the detection of unchanged matrices, so that the whole day
+//     (288 time steps) is solved with one factorization.
+//
+// PDE: non-stationary heat transfer equation
+// dT/dt - LAMBDA / (HEATCAP * RHO) * Laplace T = 0.
+//
+// Domain: St. Vitus cathedral (file domain.mesh).
+//
+// IC:  T = TEMP_INIT.
+// BC:  T = TEMP_INIT on the bottom edge ... Dirichlet,
+//      LAMBDA * dT/dn = ALPHA*(t_exterior(time) - T) ... Newton, time-dependent.
+//
+// Time-stepping: implicit Euler method.
+//
+// The following parameters can be changed:
+
+const int P_INIT = 2;                             // Polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 1;                       // Number of initial uniform mesh refinements.
+const int INIT_REF_NUM_BDY = 3;                   // Number of initial uniform mesh refinements towards the boundary.
+const double time_step = 300.0;                   // Time step in seconds.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const bool COMPARE_SCHEMES = true;                // Run the simulation with all schemes, otherwise
+                                                  // with the one below only.
+NativeFactorizationScheme factorization_scheme = NATIVE_REUSE_MATRIX_REORDERING;  // Reuse of the factorization.
+
+// Problem parameters.
+const double TEMP_INIT = 10;       // Temperature of the ground (also initial temperature).
+const double ALPHA = 10;           // Heat flux coefficient for Newton's boundary condition.
+const double LAMBDA = 1e2;         // Thermal conductivity of the material.
+const double HEATCAP = 1e2;        // Heat capacity.
+const double RHO = 3000;           // Material density.
+const double T_FINAL = 86400;      // Length of time interval (24 hours) in seconds.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Boundary air", INIT_REF_NUM_BDY);
+  mesh.refine_towards_boundary("Boundary ground", INIT_REF_NUM_BDY);
+
+  // Initialize boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential("Boundary ground", TEMP_INIT);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  const int num_schemes = 3;
+  NativeFactorizationScheme schemes[num_schemes] = { NATIVE_FACTORIZE_FROM_SCRATCH, NATIVE_REUSE_MATRIX_REORDERING,
+                                                     NATIVE_REUSE_FACTORIZATION_COMPLETELY };
+  const char* scheme_names[num_schemes] = { "factorize from scratch", "reuse matrix reordering",
+                                            "reuse factorization completely" };
+  std::vector<double> first_sln;
+  for (int k = 0; k < num_schemes; k++)
+  {
+    if (!COMPARE_SCHEMES && schemes[k] != factorization_scheme)
+      continue;
+    info("---- Scheme: %s", scheme_names[k]);
+
+    // Previous time level solution (initialized by the external temperature).
+    CustomInitialCondition tsln(&mesh, TEMP_INIT);
+
+    // Initialize the weak formulation.
+    double current_time = 0;
+    CustomWeakFormHeatRK1 wf("Boundary air", ALPHA, LAMBDA, HEATCAP, RHO, time_step,
+                             &current_time, TEMP_INIT, T_FINAL, &tsln);
+
+    // Initialize the FE problem, the Jacobian is symmetric.
+    NativeDiscreteProblem dp(&wf, &space);
+    dp.set_num_threads(NUM_THREADS);
+    dp.set_symmetric_storage(true);
+
+    // Initial coefficient vector for the Newton's method.
+    double* coeff_vec = new double[ndof];
+    memset(coeff_vec, 0, ndof*sizeof(double));
+
+    // Initialize Newton solver, its linear solver lives through all time steps.
+    NativeNewtonSolver newton(&dp, NATIVE_SOLVER_LDLT);
+    newton.set_verbose_output(false);
+    LDLTSolver* ldlt = dynamic_cast<LDLTSolver*>(newton.get_linear_solver());
+    ldlt->set_factorization_scheme(schemes[k]);
+
+    // Time stepping:
+    int ts = 1;
+    double linear_solver_time = 0.0;
+    TimePeriod cpu_time;
+    do
+    {
+      // Perform Newton's iteration.
+      try
+      {
+        newton.solve(coeff_vec, NEWTON_TOL);
+      }
+      catch(Hermes::Exceptions::Exception e)
+      {
+        e.printMsg();
+        error("Newton's iteration failed.");
+      }
+      linear_solver_time += newton.get_linear_solver_time();
+      memcpy(coeff_vec, newton.get_sln_vector(), ndof * sizeof(double));
+
+      // Translate the resulting coefficient vector into the Solution sln.
+      Solution<double>::vector_to_solution(coeff_vec, &space, &tsln);
+
+      // Increase current time and time step counter.
+      current_time += time_step;
+      ts++;
+    }
+    while (current_time < T_FINAL);
+
+    info("%d time steps: %d analyses, %d factorizations, linear solver %g s, total %g s.", ts - 1,
+         ldlt->get_num_analyses(), ldlt->get_num_factorizations(), linear_solver_time, cpu_time.tick().last());
+
+    // All schemes give the same solution.
+    if (first_sln.empty())
+      first_sln.assign(coeff_vec, coeff_vec + ndof);
+    else
+    {
+      double diff = 0.0;
+      for (int i = 0; i < ndof; i++)
+        diff = std::max(diff, std::abs(coeff_vec[i] - first_sln[i]));
+      info("Largest difference of the final solution from the first scheme: %g.", diff);
+    }
+
+    // Cleaning up.
+    delete [] coeff_vec;
+  }
+
+  return 0;
+}
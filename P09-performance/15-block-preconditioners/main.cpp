@@ -0,0 +1,144 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "iterative_solver.h"
+#include "block_preconditioners.h"
+#include "ldlt_solver.h"
+#include "hermes_matrix_utils.h"
+
+// This example solves the linear elasticity problem of P01-linear/08-system
+// with the block preconditioners of the directory common/. The stiffness
+// matrix of the two displacement components consists of the blocks
+// [A_00 A_01; A_10 A_11], the diagonal blocks are much better behaved than
+// the whole matrix and each of them is only a quarter of it. We will learn how to:
+//
+//   - split an assembled matrix into the blocks of its components,
+//   - precondition CG with the block Jacobi method and GMRES with the block
+//     Gauss-Seidel method or the approximate Schur complement,
+//   - solve the blocks with the LDL^T factorization or the AMG preconditioner,
+//   - compare memory and time with the LDL^T factorization of the whole matrix.
+//
+// PDE: Lame equations of linear elasticity.
+//
+// BC: du_1/dn = f0 on Gamma_top (top edge),
+//     du_2/dn = f1 on Gamma_top (top edge),
+//     u_1 = 0 and u_2 = 0 on Gamma_bottom (bottom edge),
+//     du_1/dn = 0 on Gamma_rest (rest of boundary),
+//     du_2/dn = 0 on Gamma_rest (rest of boundary).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 4;                             // Initial polynomial degree of all elements.
+const int INIT_REF_NUM = 4;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double KRYLOV_TOL = 1e-10;                  // Relative tolerance of the Krylov solvers.
+const bool AMG_BLOCKS = true;                     // Also solve with AMG in the blocks of block Jacobi.
+
+// Problem parameters.
+const double E  = 200e9;                          // Young modulus (steel).
+const double nu = 0.3;                            // Poisson ratio.
+const double rho = 8000.0;                        // Density.
+const double g1 = -9.81;                          // Gravitational acceleration.
+const double f0  = 0;                             // Surface force in x-direction.
+const double f1  = 8e4;                           // Surface force in y-direction.
+
+// Solves the system with a block preconditioner and reports it.
+static void solve_with_blocks(const char* name, NativeSolverType solver_type, BlockPreconditioner* precond,
+                              CSRMatrix<double>* matrix, double* rhs, const double* reference)
+{
+  IterativeSolver solver(solver_type, matrix, rhs);
+  solver.set_preconditioner(precond);
+  solver.set_tolerance(KRYLOV_TOL);
+  bool converged = solver.solve();
+
+  int ndof = matrix->get_size();
+  double diff = 0.0, max_sln = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff = std::max(diff, std::abs(solver.get_sln_vector()[i] - reference[i]));
+    max_sln = std::max(max_sln, std::abs(reference[i]));
+  }
+  info("%s: %d iterations, %g s (setup %g s), %g MB, relative difference %g%s.", name,
+       solver.get_num_iterations(), solver.get_time(), precond->get_setup_time(),
+       precond->get_memory_size() / 1048576.0, diff / max_sln, converged ? "" : " (not converged)");
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize boundary conditions.
+  DefaultEssentialBCConst<double> zero_disp("Bottom", 0.0);
+  EssentialBCs<double> bcs(&zero_disp);
+
+  // Create x- and y- displacement space using the default H1 shapeset.
+  H1Space<double> u1_space(&mesh, &bcs, P_INIT);
+  H1Space<double> u2_space(&mesh, &bcs, P_INIT);
+  Hermes::vector<Space<double> *> spaces(&u1_space, &u2_space);
+
+  // Initialize the weak formulation.
+  CustomWeakFormLinearElasticity wf(E, nu, rho*g1, "Top", f0, f1);
+
+  // Initialize the FE problem, the stiffness matrix is symmetric.
+  NativeDiscreteProblem dp(&wf, spaces);
+  dp.set_num_threads(NUM_THREADS);
+  dp.set_symmetric_storage(true);
+  int ndof = dp.get_num_dofs();
+
+  // The DOFs of u_1 come first, then those of u_2.
+  std::vector<int> offsets;
+  get_block_offsets(spaces, offsets);
+  info("ndof = %d (%d + %d)", ndof, offsets[1], offsets[2] - offsets[1]);
+
+  // The linear system K u = -F(0).
+  CSRMatrix<double> matrix;
+  double* rhs = new double[ndof];
+  double* zero = new double[ndof];
+  memset(zero, 0, ndof * sizeof(double));
+  dp.assemble(zero, &matrix, rhs);
+  for (int i = 0; i < ndof; i++)
+    rhs[i] = -rhs[i];
+  info("Matrix: %d nonzeros (%g MB).", matrix.get_nnz(), matrix.get_memory_size() / 1048576.0);
+
+  // The LDL^T factorization of the whole matrix is the reference.
+  LDLTSolver ldlt(&matrix, rhs);
+  if (!ldlt.solve())
+    error("LDL^T solver failed.");
+  info("LDL^T: %g s, factor %d nonzeros (%g MB).", ldlt.get_time(), ldlt.get_factor_nnz(),
+       ldlt.get_memory_size() / 1048576.0);
+  const double* reference = ldlt.get_sln_vector();
+
+  // Block Jacobi with the LDL^T factorizations of A_00 and A_11.
+  BlockPreconditioner jacobi(offsets, BLOCK_JACOBI);
+  solve_with_blocks("CG + block Jacobi (LDL^T)", NATIVE_SOLVER_CG, &jacobi, &matrix, rhs, reference);
+
+  // Block Jacobi with one AMG V-cycle per block.
+  if (AMG_BLOCKS)
+  {
+    BlockPreconditioner jacobi_amg(offsets, BLOCK_JACOBI);
+    jacobi_amg.set_block_preconditioner(0, NATIVE_PRECOND_AMG);
+    jacobi_amg.set_block_preconditioner(1, NATIVE_PRECOND_AMG);
+    solve_with_blocks("CG + block Jacobi (AMG)", NATIVE_SOLVER_CG, &jacobi_amg, &matrix, rhs, reference);
+  }
+
+  // Block Gauss-Seidel uses the coupling A_10 as well.
+  BlockPreconditioner gauss_seidel(offsets, BLOCK_GAUSS_SEIDEL);
+  solve_with_blocks("GMRES + block Gauss-Seidel", NATIVE_SOLVER_GMRES, &gauss_seidel, &matrix, rhs, reference);
+
+  // Approximate Schur complement of A_00.
+  BlockPreconditioner schur(offsets, BLOCK_SCHUR);
+  solve_with_blocks("GMRES + Schur complement", NATIVE_SOLVER_GMRES, &schur, &matrix, rhs, reference);
+
+  // Clean up.
+  delete [] rhs;
+  delete [] zero;
+
+  return 0;
+}
@@ -0,0 +1,140 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "hermes_matrix_utils.h"
+#include "lu_solver.h"
+#include "complex_solvers.h"
+#include "complex_kernels.h"
+
+// This example solves the time-harmonic eddy current problem of
+// P04-adaptivity/04-complex for a sweep of frequencies with the complex
+// native solvers of the directory common/. The matrix is assembled by
+// DiscreteProblem<std::complex<double> > and imported into a complex
+// CSRMatrix. We will learn how to:
+//
+//   - solve complex systems with the sparse LU factorization LUSolver,
+//   - solve them with GMRES and the complex ILU(0) preconditioner,
+//   - keep the ordering of the LU factorization over the whole sweep, only
+//     the values of the matrix change with the frequency,
+//   - compare with UMFPACK.
+//
+// PDE: -(1/mu)Laplace A + ii*omega*gamma*A - J_ext = 0.
+//
+// Domain: Rectangle of height 0.003 and width 0.004. Different
+// materials for the wire, air, and iron (see mesh file domain.mesh).
+//
+// BC: Zero Dirichlet on the top and right edges, zero Neumann
+// elsewhere.
+//
+// The following parameters can be changed:
+
+const int P_INIT = 2;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const double FREQ_MIN = 1e3;                      // First frequency of the sweep.
+const double FREQ_MAX = 1e4;                      // Last frequency of the sweep.
+const int NUM_FREQ = 5;                           // Number of frequencies.
+const double KRYLOV_TOL = 1e-10;                  // Relative tolerance of GMRES.
+const int GMRES_RESTART = 50;                     // Restart of GMRES.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Hermes solver used for comparison; its matrix
+                                                  // has to be imported, so SOLVER_UMFPACK only.
+
+// Problem parameters.
+const double MU_0 = 4.0*M_PI*1e-7;
+const double MU_IRON = 1e3 * MU_0;
+const double GAMMA_IRON = 6e6;
+const double J_EXT = 1e6;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize boundary conditions.
+  DefaultEssentialBCConst<std::complex<double> > bc_essential("Dirichlet", std::complex<double>(0.0, 0.0));
+  EssentialBCs<std::complex<double> > bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<std::complex<double> > space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d, complex kernels: %s", ndof, complex_kernels_isa());
+
+  // The Jacobian J and the residual F(0) of the first Newton step. All
+  // solvers solve J x = F(0), the solution is -x.
+  SparseMatrix<std::complex<double> >* matrix = create_matrix<std::complex<double> >(matrix_solver);
+  Vector<std::complex<double> >* vector = create_vector<std::complex<double> >(matrix_solver);
+  LinearSolver<std::complex<double> >* hermes_solver = create_linear_solver<std::complex<double> >(matrix_solver,
+                                                                                                  matrix, vector);
+  std::complex<double>* coeff_vec = new std::complex<double>[ndof];
+  std::fill(coeff_vec, coeff_vec + ndof, std::complex<double>(0.0));
+
+  // The native solvers live through the whole sweep.
+  CSRMatrix<std::complex<double> > csr_matrix;
+  std::complex<double>* rhs = new std::complex<double>[ndof];
+  LUSolver<std::complex<double> > lu(&csr_matrix, rhs);
+  ComplexGMRESSolver gmres(&csr_matrix, rhs, GMRES_RESTART);
+  gmres.set_preconditioner(NATIVE_PRECOND_ILU0);
+  gmres.set_tolerance(KRYLOV_TOL);
+
+  double time_lu = 0.0, time_gmres = 0.0, time_hermes = 0.0;
+  TimePeriod cpu_time;
+  for (int f = 0; f < NUM_FREQ; f++)
+  {
+    double freq = (NUM_FREQ > 1) ? FREQ_MIN + f * (FREQ_MAX - FREQ_MIN) / (NUM_FREQ - 1) : FREQ_MIN;
+    double omega = 2 * M_PI * freq;
+
+    // Initialize the weak formulation and assemble.
+    CustomWeakForm wf("Air", MU_0, "Iron", MU_IRON, GAMMA_IRON,
+      "Wire", MU_0, std::complex<double>(J_EXT, 0.0), omega);
+    DiscreteProblem<std::complex<double> > dp(&wf, &space);
+    dp.assemble(coeff_vec, matrix, vector);
+    if (!import_hermes_matrix(matrix, &csr_matrix))
+      error("Matrix type of the selected solver cannot be imported, use SOLVER_UMFPACK.");
+    for (int i = 0; i < ndof; i++)
+      rhs[i] = vector->get(i);
+
+    // UMFPACK.
+    cpu_time.tick(HERMES_SKIP);
+    if (!hermes_solver->solve())
+      error("Matrix solver failed.");
+    time_hermes += cpu_time.tick().last();
+    std::complex<double>* reference = hermes_solver->get_sln_vector();
+
+    // Native LU.
+    if (!lu.solve())
+      error("LU solver failed.");
+    time_lu += lu.get_time();
+
+    // Native GMRES + ILU(0).
+    bool converged = gmres.solve();
+    time_gmres += gmres.get_time();
+
+    double diff_lu = 0.0, diff_gmres = 0.0, max_sln = 0.0;
+    for (int i = 0; i < ndof; i++)
+    {
+      diff_lu = std::max(diff_lu, std::abs(lu.get_sln_vector()[i] - reference[i]));
+      diff_gmres = std::max(diff_gmres, std::abs(gmres.get_sln_vector()[i] - reference[i]));
+      max_sln = std::max(max_sln, std::abs(reference[i]));
+    }
+    info("f = %g Hz: LU %g s, GMRES + ILU(0) %d iterations, %g s%s; relative difference %g (LU), %g (GMRES).",
+         freq, lu.get_time(), gmres.get_num_iterations(), gmres.get_time(), converged ? "" : " (not converged)",
+         diff_lu / max_sln, diff_gmres / max_sln);
+  }
+
+  info("LU factor: %d nonzeros (%g MB), %d analyses and %d factorizations in %d solves.", lu.get_factor_nnz(),
+       lu.get_memory_size() / 1048576.0, lu.get_num_analyses(), lu.get_num_factorizations(), NUM_FREQ);
+  info("Total time: UMFPACK %g s, LU %g s, GMRES + ILU(0) %g s.", time_hermes, time_lu, time_gmres);
+
+  // Clean up.
+  delete hermes_solver;
+  delete matrix;
+  delete vector;
+  delete [] coeff_vec;
+  delete [] rhs;
+
+  return 0;
+}
@@ -0,0 +1,19 @@
+#include "hermes2d.h"
+#include "batched_forms.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+using namespace Hermes::Hermes2D::Views;
+
+/* Weak forms */
+
+// Linear weak form of P01-linear/03-poisson. The matrix form is declared
+// symmetric (HERMES_SYM).
+class CustomWeakFormPoissonLinear : public WeakForm<double>
+{
+public:
+  CustomWeakFormPoissonLinear(std::string mat_al, double lambda_al,
+                              std::string mat_cu, double lambda_cu,
+                              double volume_heat_src);
+};
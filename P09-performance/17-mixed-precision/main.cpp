@@ -0,0 +1,104 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "ldlt_solver.h"
+#include "mixed_precision_solver.h"
+
+// This example solves the linear Poisson problem of P01-linear/03-poisson
+// (heat conduction in aluminum and copper) on a fine mesh with the mixed
+// precision solver of the directory common/. The LDL^T factor is computed
+// and stored in single precision, the accuracy of the double precision
+// factorization is recovered by iterative refinement. We will learn how to:
+//
+//   - use MixedPrecisionSolver (NATIVE_SOLVER_LDLT_MIXED),
+//   - choose between the classic refinement and GMRES-IR,
+//   - read the number of refinement iterations and see whether the solver
+//     fell back to the double precision factorization,
+//   - compare memory and accuracy with the double precision LDL^T.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.xml).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 4;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 6;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double REFINEMENT_TOL = 1e-12;              // Relative residual of the refinement.
+const int REFINEMENT_MAX_ITER = 20;               // Maximum number of refinement iterations.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoissonLinear wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  // Assemble the symmetric matrix.
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+  dp.set_symmetric_storage(true);
+  CSRMatrix<double> matrix;
+  double* rhs = new double[ndof];
+  dp.assemble(NULL, &matrix, rhs);
+
+  // Double precision LDL^T as the reference.
+  LDLTSolver ldlt(&matrix, rhs);
+  if (!ldlt.solve())
+    error("LDL^T solver failed.");
+  info("LDL^T (double): %g s, factor %g MB.", ldlt.get_time(), ldlt.get_memory_size() / 1048576.0);
+  double max_sln = 0.0;
+  for (int i = 0; i < ndof; i++)
+    max_sln = std::max(max_sln, std::abs(ldlt.get_sln_vector()[i]));
+
+  // Single precision factor with both kinds of refinement.
+  MixedRefinementType types[2] = { MIXED_REFINEMENT_CLASSIC, MIXED_REFINEMENT_GMRES };
+  for (int k = 0; k < 2; k++)
+  {
+    MixedPrecisionSolver solver(&matrix, rhs, types[k]);
+    solver.set_tolerance(REFINEMENT_TOL);
+    solver.set_max_iterations(REFINEMENT_MAX_ITER);
+    if (!solver.solve())
+      error("Mixed precision solver failed.");
+
+    double diff = 0.0;
+    for (int i = 0; i < ndof; i++)
+      diff = std::max(diff, std::abs(solver.get_sln_vector()[i] - ldlt.get_sln_vector()[i]));
+    info("LDL^T (single, %s): %g s, factor %g MB, %d refinements (%d GMRES iterations), residual %g, "
+         "relative difference %g%s.", get_mixed_refinement_name(types[k]), solver.get_time(),
+         solver.get_ldlt_solver()->get_memory_size() / 1048576.0, solver.get_num_refinements(),
+         solver.get_num_inner_iterations(), solver.get_residual_norm(), diff / max_sln,
+         solver.has_fallen_back() ? " (fell back to double precision)" : "");
+  }
+
+  // Clean up.
+  delete [] rhs;
+
+  return 0;
+}
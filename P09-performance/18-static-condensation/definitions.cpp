@@ -0,0 +1,13 @@
+#include "definitions.h"
+
+/* Weak forms */
+
+CustomWeakFormPoissonLinear::CustomWeakFormPoissonLinear(std::string mat_al, double lambda_al,
+                                                         std::string mat_cu, double lambda_cu,
+                                                         double volume_heat_src) : WeakForm<double>(1)
+{
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, mat_al, lambda_al, HERMES_SYM));
+  add_matrix_form(new BatchedJacobianDiffusion(0, 0, mat_cu, lambda_cu, HERMES_SYM));
+
+  add_vector_form(new DefaultVectorFormVol<double>(0, HERMES_ANY, new Hermes2DFunction<double>(volume_heat_src)));
+};
@@ -0,0 +1,125 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "ldlt_solver.h"
+
+// This example solves the linear Poisson problem of P01-linear/03-poisson
+// (heat conduction in aluminum and copper) with high polynomial degrees and
+// static condensation of the bubble functions. We will learn how to:
+//
+//   - eliminate the bubbles element by element during the assembly with
+//     NativeDiscreteProblem::set_static_condensation(),
+//   - solve the global system of the vertex and edge functions only,
+//   - recover the bubbles from its solution by get_space_vector(),
+//   - compare size, time and solution with the full system, for a uniform
+//     degree and for an hp space with degrees up to 10.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.xml).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 5;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 4;                       // Number of initial uniform mesh refinements.
+const int HP_P_MIN = 2;                           // Lowest degree of the elements of the hp space.
+const int HP_P_MAX = 10;                          // Highest degree of the elements of the hp space.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e3;        // Volume heat sources generated (for example) by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+// Solves the problem with the full and with the condensed system, and
+// compares the solutions.
+void solve_and_compare(const char* name, WeakForm<double>* wf, Space<double>* space)
+{
+  int ndof = space->get_num_dofs();
+  double* sln_full = new double[ndof];
+  double* sln_condensed = new double[ndof];
+  TimePeriod cpu_time;
+
+  for (int condensed = 0; condensed < 2; condensed++)
+  {
+    NativeDiscreteProblem dp(wf, space);
+    dp.set_num_threads(NUM_THREADS);
+    dp.set_symmetric_storage(true);
+    dp.set_static_condensation(condensed != 0);
+    int size = dp.get_num_dofs();
+
+    CSRMatrix<double> matrix;
+    double* rhs = new double[size];
+    cpu_time.tick(HERMES_SKIP);
+    dp.assemble(NULL, &matrix, rhs);
+    double time_assembly = cpu_time.tick().last();
+
+    LDLTSolver solver(&matrix, rhs);
+    if (!solver.solve())
+      error("LDL^T solver failed.");
+
+    // Bubbles of the condensed system.
+    cpu_time.tick(HERMES_SKIP);
+    dp.get_space_vector(solver.get_sln_vector(), condensed ? sln_condensed : sln_full);
+    double time_recovery = cpu_time.tick().last();
+
+    if (condensed)
+      info("%s, condensed: %d equations, %d nonzeros, assembly %g s, LDL^T %g s (factor %g MB), "
+           "recovery %g s (%g MB).", name, size, matrix.get_nnz(), time_assembly, solver.get_time(),
+           solver.get_memory_size() / 1048576.0, time_recovery, dp.get_condensation_memory_size() / 1048576.0);
+    else
+      info("%s, full: %d equations, %d nonzeros, assembly %g s, LDL^T %g s (factor %g MB).", name, size,
+           matrix.get_nnz(), time_assembly, solver.get_time(), solver.get_memory_size() / 1048576.0);
+    delete [] rhs;
+  }
+
+  double diff = 0.0, max_sln = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff = std::max(diff, std::abs(sln_condensed[i] - sln_full[i]));
+    max_sln = std::max(max_sln, std::abs(sln_full[i]));
+  }
+  info("%s: relative difference of the solutions %g.", name, diff / max_sln);
+
+  delete [] sln_full;
+  delete [] sln_condensed;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoissonLinear wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+
+  // Initialize essential boundary conditions.
+  DefaultEssentialBCConst<double> bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"),
+                                               FIXED_BDY_TEMP);
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  info("Uniform degree %d: ndof = %d", P_INIT, space.get_num_dofs());
+  solve_and_compare("uniform", &wf, &space);
+
+  // The same mesh with degrees between HP_P_MIN and HP_P_MAX, as an hp
+  // adaptive computation could produce them.
+  H1Space<double> hp_space(&mesh, &bcs, HP_P_MIN);
+  Element* e;
+  for_all_active_elements(e, &mesh)
+    hp_space.set_element_order(e->id, HP_P_MIN + (7 * e->id) % (HP_P_MAX - HP_P_MIN + 1));
+  info("Degrees %d - %d: ndof = %d", HP_P_MIN, HP_P_MAX, hp_space.get_num_dofs());
+  solve_and_compare("hp", &wf, &hp_space);
+
+  return 0;
+}
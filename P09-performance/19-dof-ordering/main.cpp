@@ -0,0 +1,239 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_newton.h"
+#include "iterative_solver.h"
+#include "ldlt_solver.h"
+
+using namespace RefinementSelectors;
+
+// This example runs the hp-adaptivity loop of P04-adaptivity/01-intro
+// (electrostatic micromotor) and compares orderings of the DOFs of the
+// reference spaces. After a few adaptivity steps the numbering of the
+// spaces, which follows the traversal of elements and nodes, scatters the
+// entries of the matrix far from the diagonal. We will learn how to:
+//
+//   - renumber the DOFs by NativeDiscreteProblem::set_dof_ordering(),
+//   - pass projections and solutions between the numbering of the global
+//     system and the one of the spaces,
+//   - measure the bandwidth, the time of matrix-vector products and of CG,
+//     and the fill-in of the LDL^T factorization for every ordering.
+//
+// PDE: -div[eps_r(x,y) grad phi] = 0
+//      eps_r = EPS_1 in Omega_1 (surrounding air)
+//      eps_r = EPS_2 in Omega_2 (moving part of the motor)
+//
+// BC: phi = 0 V on Gamma_1 (left edge and also the rest of the outer boundary
+//     phi = VOLTAGE on Gamma_2 (boundary of stator)
+//
+// The following parameters can be changed:
+
+const int P_INIT = 2;                             // Initial polynomial degree of all mesh elements.
+const double THRESHOLD = 0.2;                     // This is a quantitative parameter of the adapt(...) function and
+                                                  // it has different meanings for various adaptive strategies.
+const int STRATEGY = 0;                           // Adaptive strategy, see P04-adaptivity/01-intro.
+const CandList CAND_LIST = H2D_HP_ANISO_H;        // Predefined list of element refinement candidates.
+const int MESH_REGULARITY = -1;                   // Maximum allowed level of hanging nodes.
+const double CONV_EXP = 1.0;                      // Parameter of the selection of candidates in hp-adaptivity.
+const double ERR_STOP = 0.1;                      // Stopping criterion for adaptivity (rel. error tolerance between the
+                                                  // fine mesh and coarse mesh solution in percent).
+const int NDOF_STOP = 60000;                      // Adaptivity process stops when the number of degrees of freedom grows
+                                                  // over this limit.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+DofOrdering dof_ordering = DOF_ORDERING_NESTED_DISSECTION;  // Ordering of the adaptivity loop: DOF_ORDERING_NATURAL,
+                                                            // DOF_ORDERING_RCM, DOF_ORDERING_NESTED_DISSECTION.
+const bool COMPARE_ORDERINGS = true;              // Compare all orderings in every adaptivity step.
+const int NUM_SPMV = 100;                         // Matrix-vector products of the comparison.
+const double KRYLOV_TOL = 1e-10;                  // Relative tolerance of CG.
+MatrixSolverType matrix_solver_type = SOLVER_UMFPACK; // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                      // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+const double EPS0 = 8.863e-12;
+const double VOLTAGE = 50.0;
+const double EPS_MOTOR = 10.0 * EPS0;
+const double EPS_AIR = 1.0 * EPS0;
+
+// Assembles the problem on the space with every ordering and measures the
+// matrix-vector product, CG + Jacobi and LDL^T in the numbering of the
+// problem (LDLTSolver::set_reordering(false)). The solutions are compared
+// in the numbering of the space.
+void compare_orderings(WeakForm<double>* wf, Space<double>* space)
+{
+  DofOrdering orderings[3] = { DOF_ORDERING_NATURAL, DOF_ORDERING_RCM, DOF_ORDERING_NESTED_DISSECTION };
+  int ndof = space->get_num_dofs();
+  std::vector<double> reference(ndof), space_sln(ndof);
+  TimePeriod cpu_time;
+
+  for (int k = 0; k < 3; k++)
+  {
+    NativeDiscreteProblem dp(wf, space);
+    dp.set_num_threads(NUM_THREADS);
+    dp.set_dof_ordering(orderings[k]);
+
+    // J(0) x = -F(0), stored in full for the matrix-vector products.
+    CSRMatrix<double> matrix;
+    std::vector<double> rhs(ndof), zero(ndof, 0.0);
+    dp.assemble(&zero[0], &matrix, &rhs[0]);
+    for (int i = 0; i < ndof; i++)
+      rhs[i] = -rhs[i];
+    int bandwidth = pattern_bandwidth(ndof, matrix.get_row_ptr(), matrix.get_col_idx());
+
+    std::vector<double> x(ndof, 1.0), y(ndof);
+    cpu_time.tick(HERMES_SKIP);
+    for (int r = 0; r < NUM_SPMV; r++)
+      matrix.multiply(&x[0], &y[0]);
+    double time_spmv = cpu_time.tick().last() / NUM_SPMV;
+
+    IterativeSolver cg(NATIVE_SOLVER_CG, &matrix, &rhs[0]);
+    cg.set_preconditioner(NATIVE_PRECOND_JACOBI);
+    cg.set_tolerance(KRYLOV_TOL);
+    bool converged = cg.solve();
+
+    // The upper triangle for LDL^T.
+    dp.set_symmetric_storage(true);
+    CSRMatrix<double> upper;
+    dp.assemble(&zero[0], &upper, &rhs[0]);
+    for (int i = 0; i < ndof; i++)
+      rhs[i] = -rhs[i];
+    LDLTSolver ldlt(&upper, &rhs[0]);
+    ldlt.set_reordering(false);
+    if (!ldlt.solve())
+      error("LDL^T solver failed.");
+
+    info("%-17s: bandwidth %6d, SpMV %.3g ms, CG + Jacobi %d iterations %g s%s, LDL^T %d nonzeros %g s.",
+         get_dof_ordering_name(orderings[k]), bandwidth, 1e3 * time_spmv, cg.get_num_iterations(), cg.get_time(),
+         converged ? "" : " (not converged)", ldlt.get_factor_nnz(), ldlt.get_time());
+
+    // The solutions agree in the numbering of the space.
+    dp.get_space_vector(ldlt.get_sln_vector(), &space_sln[0]);
+    if (k == 0)
+    {
+      reference = space_sln;
+
+      // The reordering of the LDL^T solver itself, for reference.
+      LDLTSolver ldlt_rcm(&upper, &rhs[0]);
+      if (!ldlt_rcm.solve())
+        error("LDL^T solver failed.");
+      info("%-17s: LDL^T with its own RCM ordering %d nonzeros %g s.", get_dof_ordering_name(orderings[k]),
+           ldlt_rcm.get_factor_nnz(), ldlt_rcm.get_time());
+    }
+    else
+    {
+      double diff = 0.0, max_sln = 0.0;
+      for (int i = 0; i < ndof; i++)
+      {
+        diff = std::max(diff, std::abs(space_sln[i] - reference[i]));
+        max_sln = std::max(max_sln, std::abs(reference[i]));
+      }
+      if (diff > 1e-8 * max_sln)
+        warn("The solution with the %s ordering differs by %g.", get_dof_ordering_name(orderings[k]), diff);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("motor.mesh", &mesh);
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Motor", EPS_MOTOR, "Air", EPS_AIR);
+
+  // Initialize boundary conditions
+  DefaultEssentialBCConst<double> bc_essential_out("Outer", 0.0);
+  DefaultEssentialBCConst<double> bc_essential_stator("Stator", VOLTAGE);
+  EssentialBCs<double> bcs(Hermes::vector<EssentialBoundaryCondition<double> *>(&bc_essential_out, &bc_essential_stator));
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+
+  // Initialize coarse and fine mesh solution.
+  Solution<double> sln, ref_sln;
+
+  // Initialize refinement selector.
+  H1ProjBasedSelector<double> selector(CAND_LIST, CONV_EXP, H2DRS_DEFAULT_ORDER);
+
+  // Adaptivity loop:
+  int as = 1; bool done = false;
+  do
+  {
+    info("---- Adaptivity step %d:", as);
+
+    // Construct globally refined mesh and setup fine mesh space.
+    Space<double>* ref_space = Space<double>::construct_refined_space(&space);
+    int ndof_ref = ref_space->get_num_dofs();
+
+    // Initialize fine mesh problem with ordered DOFs.
+    NativeDiscreteProblem dp(&wf, ref_space);
+    dp.set_num_threads(NUM_THREADS);
+    dp.set_symmetric_storage(true);
+    dp.set_dof_ordering(dof_ordering);
+
+    // The initial guess is the coarse mesh solution projected on the fine
+    // mesh. Projections are numbered as the space, NativeNewtonSolver
+    // converts them.
+    double* coeff_vec = new double[ndof_ref];
+    if (as == 1)
+      memset(coeff_vec, 0, ndof_ref * sizeof(double));
+    else
+      OGProjection<double>::project_global(ref_space, &sln, coeff_vec, matrix_solver_type);
+
+    // The factorization keeps the ordering of the problem.
+    NativeNewtonSolver newton(&dp, NATIVE_SOLVER_LDLT);
+    dynamic_cast<LDLTSolver*>(newton.get_linear_solver())->set_reordering(dof_ordering == DOF_ORDERING_NATURAL);
+    newton.set_verbose_output(false);
+    try
+    {
+      newton.solve(coeff_vec);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+
+    // Translate the resulting coefficient vector into the instance of Solution.
+    Solution<double>::vector_to_solution(newton.get_sln_vector(), ref_space, &ref_sln);
+
+    // Project the fine mesh solution onto the coarse mesh.
+    OGProjection<double>::project_global(&space, &ref_sln, &sln, matrix_solver_type);
+
+    if (COMPARE_ORDERINGS)
+      compare_orderings(&wf, ref_space);
+
+    // Calculate element errors and total error estimate.
+    Adapt<double> adaptivity(&space);
+    double err_est_rel = adaptivity.calc_err_est(&sln, &ref_sln) * 100;
+
+    // Report results.
+    info("ndof_coarse: %d, ndof_fine: %d, err_est_rel: %g%%",
+      space.get_num_dofs(), ref_space->get_num_dofs(), err_est_rel);
+
+    // If err_est too large, adapt the mesh.
+    if (err_est_rel < ERR_STOP)
+      done = true;
+    else
+    {
+      done = adaptivity.adapt(&selector, THRESHOLD, STRATEGY, MESH_REGULARITY);
+
+      // Increase the counter of performed adaptivity steps.
+      if (done == false)
+        as++;
+    }
+    if (space.get_num_dofs() >= NDOF_STOP)
+      done = true;
+
+    // Clean up.
+    delete [] coeff_vec;
+    // Keep the mesh from final step, the fine mesh solution refers to it.
+    if(done == false)
+      delete ref_space->get_mesh();
+    delete ref_space;
+  }
+  while (done == false);
+
+  return 0;
+}
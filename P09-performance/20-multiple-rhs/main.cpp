@@ -0,0 +1,123 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "multi_load_solver.h"
+
+// This example solves the linear Poisson problem of P01-linear/03-poisson
+// (heat conduction in aluminum and copper) for a sweep of load cases: the
+// volume heat source and the temperature of the boundary change, the
+// conductivities and thus the matrix do not. We will learn how to:
+//
+//   - add load cases, each with its own weak form (parameters of the
+//     vector forms) and space (Dirichlet values), to MultiLoadSolver,
+//   - assemble and factorize the matrix once and solve all cases by one
+//     blocked substitution,
+//   - compare the time with assembling and solving every case on its own.
+//
+// PDE: Poisson equation -div(LAMBDA grad u) - VOLUME_HEAT_SRC = 0.
+//
+// Boundary conditions: Dirichlet u(x, y) = FIXED_BDY_TEMP on the boundary.
+//
+// Geometry: L-Shape domain (see file domain.xml).
+//
+// The following parameters can be changed:
+
+const int P_INIT = 3;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const int NUM_CASES = 16;                         // Number of load cases.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double SRC_MIN = 1e3;                // Volume heat sources of the first and the last load case.
+const double SRC_MAX = 1e4;
+const double TEMP_MIN = 0.0;               // Fixed temperatures on the boundary of the first and
+const double TEMP_MAX = 40.0;              // the last load case.
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load("domain.xml", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Weak forms, boundary conditions and spaces of the load cases. The
+  // spaces differ in the Dirichlet values only, so they share the DOFs.
+  std::vector<CustomWeakFormPoissonLinear*> wfs(NUM_CASES);
+  std::vector<DefaultEssentialBCConst<double>*> bcs_essential(NUM_CASES);
+  std::vector<EssentialBCs<double>*> bcs(NUM_CASES);
+  std::vector<H1Space<double>*> spaces(NUM_CASES);
+  for (int c = 0; c < NUM_CASES; c++)
+  {
+    double t = (NUM_CASES > 1) ? (double) c / (NUM_CASES - 1) : 0.0;
+    wfs[c] = new CustomWeakFormPoissonLinear("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU,
+                                             SRC_MIN + t * (SRC_MAX - SRC_MIN));
+    bcs_essential[c] = new DefaultEssentialBCConst<double>(Hermes::vector<std::string>("Bottom", "Inner", "Outer",
+                                                           "Left"), TEMP_MIN + t * (TEMP_MAX - TEMP_MIN));
+    bcs[c] = new EssentialBCs<double>(bcs_essential[c]);
+    spaces[c] = new H1Space<double>(&mesh, bcs[c], P_INIT);
+  }
+  int ndof = spaces[0]->get_num_dofs();
+  info("ndof = %d, %d load cases", ndof, NUM_CASES);
+
+  // The matrix is the one of the first load case.
+  NativeDiscreteProblem dp(wfs[0], spaces[0]);
+  dp.set_num_threads(NUM_THREADS);
+  dp.set_symmetric_storage(true);
+
+  // All cases with one factorization.
+  MultiLoadSolver multi(&dp, NATIVE_SOLVER_LDLT);
+  for (int c = 0; c < NUM_CASES; c++)
+    multi.add_load_case(wfs[c], spaces[c]);
+  multi.solve();
+  double time_multi = multi.get_matrix_time() + multi.get_factorization_time() + multi.get_rhs_time()
+    + multi.get_substitution_time();
+  info("MultiLoadSolver: matrix %g s, factorization %g s, right-hand sides %g s, substitution %g s, total %g s.",
+       multi.get_matrix_time(), multi.get_factorization_time(), multi.get_rhs_time(),
+       multi.get_substitution_time(), time_multi);
+
+  // Every case on its own, as the reference.
+  double time_single = 0.0, diff = 0.0, max_sln = 0.0;
+  TimePeriod cpu_time;
+  for (int c = 0; c < NUM_CASES; c++)
+  {
+    NativeDiscreteProblem dp_case(wfs[c], spaces[c]);
+    dp_case.set_num_threads(NUM_THREADS);
+    dp_case.set_symmetric_storage(true);
+    CSRMatrix<double> matrix;
+    double* rhs = new double[ndof];
+    cpu_time.tick(HERMES_SKIP);
+    dp_case.assemble(NULL, &matrix, rhs);
+    time_single += cpu_time.tick().last();
+
+    LDLTSolver solver(&matrix, rhs);
+    if (!solver.solve())
+      error("LDL^T solver failed.");
+    time_single += solver.get_time();
+
+    for (int i = 0; i < ndof; i++)
+    {
+      diff = std::max(diff, std::abs(multi.get_sln_vector(c)[i] - solver.get_sln_vector()[i]));
+      max_sln = std::max(max_sln, std::abs(solver.get_sln_vector()[i]));
+    }
+    delete [] rhs;
+  }
+  info("Separate solves: total %g s (%.2fx), relative difference %g.", time_single, time_single / time_multi,
+       diff / max_sln);
+
+  // Clean up.
+  for (int c = 0; c < NUM_CASES; c++)
+  {
+    delete spaces[c];
+    delete bcs[c];
+    delete bcs_essential[c];
+    delete wfs[c];
+  }
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include "definitions.h"
+
+CustomNonlinearity::CustomNonlinearity(double alpha): Hermes1DFunction<double>()
+{
+  this->is_const = false;
+  this->alpha = alpha;
+}
+
+double CustomNonlinearity::value(double u) const
+{
+  return 1 + Hermes::pow(u, alpha);
+}
+
+Ord CustomNonlinearity::value(Ord u) const
+{
+  return Ord(10);
+}
+
+double CustomNonlinearity::derivative(double u) const
+{
+  return alpha * Hermes::pow(u, alpha - 1.0);
+}
+
+Ord CustomNonlinearity::derivative(Ord u) const
+{
+  // Same comment as above applies.
+  return Ord(10);
+}
+
+double CustomInitialCondition::value(double x, double y) const 
+{
+  return (x+10) * (y+10) / 100. + 2;
+}
+
+void CustomInitialCondition::derivatives(double x, double y, double& dx, double& dy) const 
+{   
+  dx = (y+10) / 100.;
+  dy = (x+10) / 100.;
+}
+
+Ord CustomInitialCondition::ord(Ord x, Ord y) const 
+{
+  return x*y;
+}
+
+EssentialBoundaryCondition<double>::EssentialBCValueType CustomEssentialBCNonConst::get_value_type() const 
+{ 
+  return EssentialBoundaryCondition<double>::BC_FUNCTION; 
+}
+
+double CustomEssentialBCNonConst::value(double x, double y, double n_x, double n_y, 
+                                        double t_x, double t_y) const
+{
+  return (x+10) * (y+10) / 100.;
+}
+
+CustomWeakFormPreconditioner::CustomWeakFormPreconditioner(Hermes1DFunction<double>* lambda) : WeakForm<double>(1)
+{
+  add_matrix_form(new PreconditionerForm(lambda));
+}
+
+double CustomWeakFormPreconditioner::PreconditionerForm::value(int n, double *wt, Func<double>* u_ext[],
+                   Func<double> *vj, Func<double> *vi, Geom<double> *e, ExtData<double> *ext) const
+{
+  double result = 0;
+  for (int i = 0; i < n; i++)
+    result += wt[i] * lambda->value(u_ext[0]->val[i]) * (vj->dx[i] * vi->dx[i] + vj->dy[i] * vi->dy[i]);
+  return result;
+}
+
+Ord CustomWeakFormPreconditioner::PreconditionerForm::ord(int n, double *wt, Func<Ord>* u_ext[],
+                   Func<Ord> *vj, Func<Ord> *vi, Geom<Ord> *e, ExtData<Ord> *ext) const
+{
+  return lambda->value(u_ext[0]->val[0]) * (vj->dx[0] * vi->dx[0] + vj->dy[0] * vi->dy[0]);
+}
@@ -0,0 +1,85 @@
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+using namespace Hermes::Hermes2D::Views;
+
+/* Nonlinearity lambda(u) = Hermes::pow(u, alpha) */
+
+class CustomNonlinearity : public Hermes1DFunction<double>
+{
+public:
+  CustomNonlinearity(double alpha);
+
+  virtual double value(double u) const;
+
+  virtual Ord value(Ord u) const;
+
+  virtual double derivative(double u) const;
+
+  virtual Ord derivative(Ord u) const;
+
+protected:
+  double alpha;
+};
+
+/* Initial condition */
+
+class CustomInitialCondition : public ExactSolutionScalar<double>
+{
+public:
+  CustomInitialCondition(Mesh* mesh) : ExactSolutionScalar<double>(mesh) 
+  {
+  };
+
+  virtual double value(double x, double y) const;
+
+  virtual void derivatives(double x, double y, double& dx, double& dy) const;
+
+  virtual Ord ord(Ord x, Ord y) const;
+};
+
+/* Essential boundary conditions */
+
+class CustomEssentialBCNonConst : public EssentialBoundaryCondition<double>
+{
+public:
+  CustomEssentialBCNonConst(std::string marker) 
+           : EssentialBoundaryCondition<double>(Hermes::vector<std::string>()) 
+  {
+    this->markers.push_back(marker);
+  }
+
+  virtual EssentialBCValueType get_value_type() const;
+
+  virtual double value(double x, double y, double n_x, double n_y, 
+                       double t_x, double t_y) const;
+};
+
+
+/* Weak form of the preconditioner of the Jacobian-free Newton-Krylov
+   method: the Jacobian without the derivative of lambda(u), which is
+   symmetric and cheaper to integrate. */
+
+class CustomWeakFormPreconditioner : public WeakForm<double>
+{
+public:
+  CustomWeakFormPreconditioner(Hermes1DFunction<double>* lambda);
+
+private:
+  class PreconditionerForm : public MatrixFormVol<double>
+  {
+  public:
+    PreconditionerForm(Hermes1DFunction<double>* lambda)
+            : MatrixFormVol<double>(0, 0, HERMES_ANY, HERMES_SYM), lambda(lambda) {};
+
+    virtual double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u,
+                         Func<double> *v, Geom<double> *e, ExtData<double> *ext) const;
+
+    virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v,
+                    Geom<Ord> *e, ExtData<Ord> *ext) const;
+
+    Hermes1DFunction<double>* lambda;
+  };
+};
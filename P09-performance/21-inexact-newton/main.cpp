@@ -0,0 +1,161 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_newton.h"
+#include "iterative_solver.h"
+#include "jfnk_solver.h"
+
+//  This example solves the nonlinear problem of P02-nonlinear/02-newton-analytic
+//  on a finer mesh with inexact Newton methods. Far from the solution the
+//  linear systems do not need to be solved to full accuracy. We will learn
+//  how to:
+//
+//    - let the Eisenstat-Walker forcing term choose the tolerance of GMRES
+//      in every Newton step (NativeNewtonSolver::set_forcing()),
+//    - solve the problem without assembling the Jacobian (JFNKSolver), with
+//      the assembled matrix of a simpler weak form as the preconditioner,
+//    - compare the Newton and GMRES iterations with the exact solves.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, - div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, alpha).
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 2;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const int INIT_GLOB_REF_NUM = 5;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double KRYLOV_TOL = 1e-10;                  // Tolerance of GMRES without a forcing term.
+const int GMRES_RESTART = 50;                     // Restart of GMRES.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // Initialize the weak formulation and the one of the preconditioner.
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+  CustomWeakFormPreconditioner wf_precond(&lambda);
+
+  // Project the initial condition on the FE space to obtain initial
+  // coefficient vector for the Newton's method.
+  info("Projecting to obtain initial vector for the Newton's method.");
+  double* coeff_vec = new double[ndof];
+  CustomInitialCondition init_sln(&mesh);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec, matrix_solver);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+
+  // Exact Newton's method with LU as the reference.
+  TimePeriod cpu_time;
+  NativeNewtonSolver newton_lu(&dp, NATIVE_SOLVER_LU);
+  newton_lu.set_verbose_output(false);
+  cpu_time.tick(HERMES_SKIP);
+  try
+  {
+    newton_lu.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+  }
+  catch(Hermes::Exceptions::Exception e)
+  {
+    e.printMsg();
+    error("Newton's iteration failed.");
+  }
+  info("LU: %d Newton iterations, %g s.", newton_lu.get_num_iterations(), cpu_time.tick().last());
+  double* reference = newton_lu.get_sln_vector();
+  double max_sln = 0.0;
+  for (int i = 0; i < ndof; i++)
+    max_sln = std::max(max_sln, std::abs(reference[i]));
+
+  // GMRES + ILU(0) with a fixed tolerance and with both forcing terms.
+  NewtonForcingType forcings[3] = { NEWTON_FORCING_NONE, NEWTON_FORCING_EISENSTAT_WALKER_1,
+                                    NEWTON_FORCING_EISENSTAT_WALKER_2 };
+  for (int k = 0; k < 3; k++)
+  {
+    NativeNewtonSolver newton(&dp, NATIVE_SOLVER_GMRES);
+    IterativeSolver* gmres = dynamic_cast<IterativeSolver*>(newton.get_linear_solver());
+    gmres->set_tolerance(KRYLOV_TOL);
+    gmres->set_restart(GMRES_RESTART);
+    newton.set_forcing(forcings[k]);
+    newton.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    double time = cpu_time.tick().last();
+
+    double diff = 0.0;
+    for (int i = 0; i < ndof; i++)
+      diff = std::max(diff, std::abs(newton.get_sln_vector()[i] - reference[i]));
+    info("GMRES + ILU(0), forcing %s: %d Newton iterations, %d GMRES iterations, %g s, relative difference %g.",
+         get_newton_forcing_name(forcings[k]), newton.get_num_iterations(), newton.get_num_linear_iterations(),
+         time, diff / max_sln);
+  }
+
+  // Jacobian-free, preconditioned by ILU(0) of the matrix of wf_precond.
+  NativeDiscreteProblem dp_precond(&wf_precond, &space);
+  dp_precond.set_num_threads(NUM_THREADS);
+  JFNKSolver jfnk(&dp, &dp_precond, NATIVE_PRECOND_ILU0);
+  jfnk.set_restart(GMRES_RESTART);
+  jfnk.set_verbose_output(false);
+  cpu_time.tick(HERMES_SKIP);
+  try
+  {
+    jfnk.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+  }
+  catch(Hermes::Exceptions::Exception e)
+  {
+    e.printMsg();
+    error("Jacobian-free Newton's iteration failed.");
+  }
+  double time = cpu_time.tick().last();
+  double diff = 0.0;
+  for (int i = 0; i < ndof; i++)
+    diff = std::max(diff, std::abs(jfnk.get_sln_vector()[i] - reference[i]));
+  info("JFNK, forcing %s: %d Newton iterations, %d GMRES iterations, %d residual assemblies, %g s, "
+       "relative difference %g.", get_newton_forcing_name(jfnk.get_forcing()->get_type()),
+       jfnk.get_num_iterations(), jfnk.get_num_gmres_iterations(), jfnk.get_num_residual_assemblies(), time,
+       diff / max_sln);
+
+  // Clean up.
+  delete [] coeff_vec;
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_newton.h"
+
+//  This example solves the nonlinear problem of P02-nonlinear/02-newton-analytic
+//  on a finer mesh with the chord method, Newton's method with a frozen
+//  Jacobian. The nonlinearity is mild, so the Jacobian of an early iterate
+//  is a good approximation of the later ones. We will learn how to:
+//
+//    - keep the Jacobian and its factorization over several iterations with
+//      NativeNewtonSolver::set_jacobian_reuse(),
+//    - refresh it when the residual stops contracting fast enough, or after
+//      a number of steps,
+//    - read the numbers of Jacobian assemblies, reuses and factorizations.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, - div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, alpha).
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 4;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const int INIT_GLOB_REF_NUM = 5;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double MAX_CONTRACTION = 0.5;               // The Jacobian is refreshed when the residual drops by less
+                                                  // than this factor in a chord iteration.
+const int MAX_REUSE = 5;                          // Limit of iterations with the same Jacobian (second run).
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // Initialize the weak formulation
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+
+  // Project the initial condition on the FE space to obtain initial
+  // coefficient vector for the Newton's method.
+  info("Projecting to obtain initial vector for the Newton's method.");
+  double* coeff_vec = new double[ndof];
+  CustomInitialCondition init_sln(&mesh);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec, matrix_solver);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+
+  // Newton's method, the chord method refreshed by the contraction only,
+  // and by the contraction or after MAX_REUSE steps.
+  const char* names[3] = { "Newton", "chord", "chord (limited reuse)" };
+  double contractions[3] = { 0.0, MAX_CONTRACTION, MAX_CONTRACTION };
+  int reuses[3] = { 0, 0, MAX_REUSE };
+  std::vector<double> reference(ndof);
+  TimePeriod cpu_time;
+  for (int k = 0; k < 3; k++)
+  {
+    NativeNewtonSolver newton(&dp, NATIVE_SOLVER_LU);
+    newton.set_jacobian_reuse(contractions[k], reuses[k]);
+    newton.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    double time = cpu_time.tick().last();
+
+    double diff = 0.0, max_sln = 0.0;
+    for (int i = 0; i < ndof; i++)
+    {
+      if (k == 0)
+        reference[i] = newton.get_sln_vector()[i];
+      diff = std::max(diff, std::abs(newton.get_sln_vector()[i] - reference[i]));
+      max_sln = std::max(max_sln, std::abs(reference[i]));
+    }
+    info("%s: %d iterations, %d Jacobian assemblies, %d reuses, %d factorizations, %g s (linear solver %g s), "
+         "relative difference %g.", names[k], newton.get_num_iterations(), newton.get_num_jacobian_assemblies(),
+         newton.get_num_jacobian_reuses(), newton.get_linear_solver()->get_num_factorizations(), time,
+         newton.get_linear_solver_time(), diff / max_sln);
+  }
+
+  // Clean up.
+  delete [] coeff_vec;
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_newton.h"
+
+//  This example solves the nonlinear problem of P02-nonlinear/02-newton-analytic
+//  from a poor initial guess, a constant far above the solution. Full Newton
+//  steps overshoot: the conductivity lambda(u) = 1 + u^4 varies over orders
+//  of magnitude between the guess and the solution. We will learn how to:
+//
+//    - let a backtracking line search choose the step lengths,
+//    - use dogleg steps within a trust region instead,
+//    - compare the Newton iterations, Jacobian and residual assemblies with
+//      full steps.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, - div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, alpha).
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 2;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const int INIT_GLOB_REF_NUM = 4;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double INIT_GUESS = 20.0;                   // Constant initial guess.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // Initialize the weak formulation
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+
+  // Project the constant initial guess on the FE space.
+  info("Projecting to obtain initial vector for the Newton's method.");
+  double* coeff_vec = new double[ndof];
+  ConstantSolution<double> init_sln(&mesh, INIT_GUESS);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec, matrix_solver);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+
+  // Full steps, line search and trust region.
+  const char* names[3] = { "Full steps", "Line search", "Trust region" };
+  NewtonGlobalizationType globalizations[3] = { NEWTON_GLOBALIZATION_NONE, NEWTON_GLOBALIZATION_LINE_SEARCH,
+                                                NEWTON_GLOBALIZATION_DOGLEG };
+  TimePeriod cpu_time;
+  for (int k = 0; k < 3; k++)
+  {
+    NativeNewtonSolver newton(&dp, NATIVE_SOLVER_LU);
+    newton.set_globalization(globalizations[k]);
+    newton.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      warn("%s: Newton's iteration failed.", names[k]);
+      continue;
+    }
+    double time = cpu_time.tick().last();
+    info("%s: %d iterations, %d Jacobian assemblies, %d residual assemblies, %d step reductions, %g s.",
+         names[k], newton.get_num_iterations(), newton.get_num_jacobian_assemblies(),
+         newton.get_num_residual_assemblies(), newton.get_num_step_reductions(), time);
+  }
+
+  // Clean up.
+  delete [] coeff_vec;
+
+  return 0;
+}
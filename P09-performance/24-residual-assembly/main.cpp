@@ -0,0 +1,144 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_newton.h"
+
+//  This example solves the nonlinear problem of P02-nonlinear/02-newton-analytic
+//  and measures what the residual costs without the Jacobian. Newton's
+//  method needs the residual alone in its convergence test, in the chord
+//  iterations and in the trial steps of a line search. We will learn how to:
+//
+//    - assemble the residual alone by NativeDiscreteProblem::assemble_residual(),
+//    - compare its time with the assembly of the Jacobian and the residual,
+//    - compare the separate assemblies of the Jacobian and the residual
+//      with the one that assembles both in one pass,
+//    - count the Jacobian and residual assemblies of NativeNewtonSolver,
+//      and the Jacobian of the converged iterate saved by the prediction of
+//      convergence.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, - div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, alpha).
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 3;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const int INIT_GLOB_REF_NUM = 5;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const int NUM_ASSEMBLIES = 10;                    // Repetitions of every kind of assembly.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // Initialize the weak formulation
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+
+  // Project the initial condition on the FE space to obtain initial
+  // coefficient vector for the Newton's method.
+  info("Projecting to obtain initial vector for the Newton's method.");
+  double* coeff_vec = new double[ndof];
+  CustomInitialCondition init_sln(&mesh);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec, matrix_solver);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+
+  // The Jacobian and the residual, the Jacobian alone and the residual
+  // alone at the initial guess. The first assembly computes the pattern.
+  CSRMatrix<double> jacobian;
+  std::vector<double> residual(ndof), residual_alone(ndof);
+  dp.assemble(coeff_vec, &jacobian, &residual[0]);
+  TimePeriod cpu_time;
+  cpu_time.tick(HERMES_SKIP);
+  for (int r = 0; r < NUM_ASSEMBLIES; r++)
+    dp.assemble(coeff_vec, &jacobian, &residual[0]);
+  double time_both = cpu_time.tick().last() / NUM_ASSEMBLIES;
+  for (int r = 0; r < NUM_ASSEMBLIES; r++)
+    dp.assemble(coeff_vec, &jacobian, (double*) NULL);
+  double time_jacobian = cpu_time.tick().last() / NUM_ASSEMBLIES;
+  for (int r = 0; r < NUM_ASSEMBLIES; r++)
+    dp.assemble_residual(coeff_vec, &residual_alone[0]);
+  double time_residual = cpu_time.tick().last() / NUM_ASSEMBLIES;
+
+  double diff = 0.0, max_residual = 0.0;
+  for (int i = 0; i < ndof; i++)
+  {
+    diff = std::max(diff, std::abs(residual_alone[i] - residual[i]));
+    max_residual = std::max(max_residual, std::abs(residual[i]));
+  }
+  info("Jacobian and residual %g s, Jacobian %g s, residual %g s (%.1f%% of both), relative difference %g.",
+       time_both, time_jacobian, time_residual, 100.0 * time_residual / time_both, diff / max_residual);
+  info("Separate assemblies of the Jacobian and the residual %g s, %.1f%% more than one pass.",
+       time_jacobian + time_residual, 100.0 * (time_jacobian + time_residual - time_both) / time_both);
+
+  // Newton's method with full steps, without and with the prediction of
+  // convergence, and with the line search.
+  const char* names[3] = { "Full steps, no prediction", "Full steps", "Line search" };
+  NewtonGlobalizationType globalizations[3] = { NEWTON_GLOBALIZATION_NONE, NEWTON_GLOBALIZATION_NONE,
+                                                NEWTON_GLOBALIZATION_LINE_SEARCH };
+  for (int k = 0; k < 3; k++)
+  {
+    NativeNewtonSolver newton(&dp, NATIVE_SOLVER_LU);
+    newton.set_globalization(globalizations[k]);
+    if (k == 0)
+      newton.set_convergence_prediction(0.0);
+    newton.set_verbose_output(false);
+    dp.reset_assembly_times();
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      newton.solve(coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    double time = cpu_time.tick().last();
+
+    const NativeDiscreteProblem::AssemblyTimes& times = dp.get_assembly_times();
+    info("%s: %d iterations, %d Jacobian assemblies %g s, %d residual assemblies %g s, total %g s.", names[k],
+         newton.get_num_iterations(), times.num_matrix_assemblies, times.integration - times.vector_integration,
+         times.num_vector_assemblies, times.vector_integration, time);
+    info("%s: %d predictions of convergence, %d wrong, %d Jacobians saved.", names[k], newton.get_num_predictions(),
+         newton.get_num_wrong_predictions(), newton.get_num_predictions() - newton.get_num_wrong_predictions());
+  }
+
+  // Clean up.
+  delete [] coeff_vec;
+
+  return 0;
+}
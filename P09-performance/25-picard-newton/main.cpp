@@ -0,0 +1,146 @@
+#define HERMES_REPORT_ALL
+#include "definitions.h"
+#include "native_discrete_problem.h"
+#include "native_picard.h"
+
+//  This example solves the nonlinear problem of P02-nonlinear/01-picard with
+//  Picard's method in the native assembly and compares it with Newton's
+//  method. A Picard step needs the symmetric matrix of lambda(u_k) only,
+//  but the method converges linearly. We will learn how to:
+//
+//    - accelerate Picard's method by AndersonAcceleration, which keeps only
+//      coefficient vectors and updates the QR factors of its least squares
+//      problem,
+//    - switch to Newton's method once the contraction of Picard's method
+//      stalls (NativePicardSolver::set_newton_switch()),
+//    - compare the iterations, matrix assemblies and times of all variants.
+//
+//  PDE: Stationary heat transfer equation with nonlinear thermal
+//       conductivity, -div[lambda(u) grad u] + src(x, y) = 0.
+//
+//  Nonlinearity: lambda(u) = 1 + Hermes::pow(u, 4).
+//
+//  Picard's linearization: -div[lambda(u^n) grad u^{n+1}] + src(x, y) = 0.
+//
+//  Domain: square (-10, 10)^2.
+//
+//  BC: Nonconstant Dirichlet.
+//
+//  The following parameters can be changed:
+
+const int P_INIT = 2;                             // Initial polynomial degree.
+const int INIT_GLOB_REF_NUM = 5;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 5;                   // Number of initial refinements towards boundary.
+const double INIT_COND_CONST = 3.0;               // Value for custom constant initial condition.
+const int NUM_THREADS = 4;                        // Number of assembly threads.
+const double TOL = 1e-8;                          // Stopping criterion (norm of the residual).
+const int MAX_ITER = 100;                         // Maximum allowed number of iterations.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+// Picard's method.
+const int PICARD_NUM_LAST_ITER_USED = 4;          // Number of last iterations used.
+const double PICARD_ANDERSON_BETA = 0.2;          // 0 <= beta <= 1, parameter for the Anderson acceleration.
+const double STALL_RATIO = 0.9;                   // Newton's method takes over when the contraction of the residual
+                                                  // improves by less than this factor.
+
+// Problem parameters.
+double heat_src = 1.0;
+double alpha = 4.0;
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary("Bdy", INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions.
+  CustomEssentialBCNonConst bc_essential("Bdy");
+  EssentialBCs<double> bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof: %d, elements: %d", ndof, mesh.get_num_active_elements());
+
+  // The weak form of the problem (residual and Jacobian) and the one of
+  // the matrix of Picard's method.
+  CustomNonlinearity lambda(alpha);
+  Hermes2DFunction<double> src(-heat_src);
+  DefaultWeakFormPoisson<double> wf(HERMES_ANY, &lambda, &src);
+  CustomWeakFormPicard wf_picard(&lambda);
+
+  // Project the constant initial condition on the FE space.
+  info("Projecting to obtain the initial vector.");
+  double* coeff_vec = new double[ndof];
+  ConstantSolution<double> init_sln(&mesh, INIT_COND_CONST);
+  OGProjection<double>::project_global(&space, &init_sln, coeff_vec, matrix_solver);
+
+  NativeDiscreteProblem dp(&wf, &space);
+  dp.set_num_threads(NUM_THREADS);
+  NativeDiscreteProblem dp_picard(&wf_picard, &space);
+  dp_picard.set_num_threads(NUM_THREADS);
+  dp_picard.set_symmetric_storage(true);
+
+  // Newton's method with the line search, as the reference.
+  TimePeriod cpu_time;
+  NativeNewtonSolver newton(&dp, NATIVE_SOLVER_LU);
+  newton.set_globalization(NEWTON_GLOBALIZATION_LINE_SEARCH);
+  newton.set_verbose_output(false);
+  cpu_time.tick(HERMES_SKIP);
+  try
+  {
+    newton.solve(coeff_vec, TOL, MAX_ITER);
+  }
+  catch(Hermes::Exceptions::Exception e)
+  {
+    e.printMsg();
+    error("Newton's iteration failed.");
+  }
+  info("Newton: %d iterations, %g s.", newton.get_num_iterations(), cpu_time.tick().last());
+  std::vector<double> reference(newton.get_sln_vector(), newton.get_sln_vector() + ndof);
+  double max_sln = 0.0;
+  for (int i = 0; i < ndof; i++)
+    max_sln = std::max(max_sln, std::abs(reference[i]));
+
+  // Picard's method, with Anderson acceleration, and with the switch to
+  // Newton's method.
+  const char* names[3] = { "Picard", "Picard + Anderson", "Picard + Anderson -> Newton" };
+  for (int k = 0; k < 3; k++)
+  {
+    NativePicardSolver picard(&dp, &dp_picard, NATIVE_SOLVER_LDLT);
+    if (k > 0)
+      picard.set_anderson(PICARD_NUM_LAST_ITER_USED, PICARD_ANDERSON_BETA);
+    if (k > 1)
+      picard.set_newton_switch(&newton, STALL_RATIO);
+    picard.set_verbose_output(false);
+    cpu_time.tick(HERMES_SKIP);
+    try
+    {
+      picard.solve(coeff_vec, TOL, MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      warn("%s: the iteration failed.", names[k]);
+      continue;
+    }
+    double time = cpu_time.tick().last();
+
+    double diff = 0.0;
+    for (int i = 0; i < ndof; i++)
+      diff = std::max(diff, std::abs(picard.get_sln_vector()[i] - reference[i]));
+    info("%s: %d Picard and %d Newton iterations, %g s, history %g MB, relative difference %g.", names[k],
+         picard.get_num_picard_iterations(), picard.get_num_newton_iterations(), time,
+         picard.get_anderson()->get_memory_size() / 1048576.0, diff / max_sln);
+  }
+
+  // Clean up.
+  delete [] coeff_vec;
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "affine_templates.h"
+
+AffineCoefficients::AffineCoefficients() : mass(0.0)
+{
+  diffusion[0][0] = diffusion[0][1] = diffusion[1][0] = diffusion[1][1] = 0.0;
+  advection[0] = advection[1] = 0.0;
+}
+
+bool ReferenceTemplateKey::operator<(const ReferenceTemplateKey& other) const
+{
+  if (shapeset_u != other.shapeset_u) return shapeset_u < other.shapeset_u;
+  if (shapeset_v != other.shapeset_v) return shapeset_v < other.shapeset_v;
+  if (mode != other.mode) return mode < other.mode;
+  if (order != other.order) return order < other.order;
+  if (idx_u != other.idx_u) return idx_u < other.idx_u;
+  return idx_v < other.idx_v;
+}
+
+ReferenceTemplateCache::ReferenceTemplateCache() : max_memory(32 * 1024 * 1024), memory(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+  reset_stats();
+}
+
+ReferenceTemplateCache::~ReferenceTemplateCache()
+{
+  clear();
+  pthread_mutex_destroy(&mutex);
+}
+
+const ReferenceTemplate* ReferenceTemplateCache::get(const ReferenceTemplateKey& key, Shapeset* shapeset_u,
+                                                     Shapeset* shapeset_v, Quad2D* quad)
+{
+  pthread_mutex_lock(&mutex);
+  ReferenceTemplate* tpl;
+  std::map<ReferenceTemplateKey, ReferenceTemplate*>::iterator it = templates.find(key);
+  if (it != templates.end())
+  {
+    tpl = it->second;
+    num_hits++;
+  }
+  else
+  {
+    ShapeTableCache* shape_cache = ShapeTableCache::get_instance();
+    int np = quad->get_num_points(key.order);
+    double3* pt = quad->get_points(key.order);
+
+    tpl = new ReferenceTemplate;
+    tpl->nu = key.idx_u.size();
+    tpl->nv = key.idx_v.size();
+    int size = tpl->nu * tpl->nv;
+    for (int a = 0; a < 2; a++)
+    {
+      tpl->s[a][0].resize(size);
+      tpl->s[a][1].resize(size);
+      tpl->t[a].resize(size);
+    }
+    tpl->m.resize(size);
+
+    std::vector<const ShapeTable*> u(tpl->nu), v(tpl->nv);
+    for (int j = 0; j < tpl->nu; j++)
+      u[j] = shape_cache->get(shapeset_u, quad, key.mode, key.order, key.idx_u[j]);
+    for (int i = 0; i < tpl->nv; i++)
+      v[i] = shape_cache->get(shapeset_v, quad, key.mode, key.order, key.idx_v[i]);
+
+    for (int i = 0; i < tpl->nv; i++)
+      for (int j = 0; j < tpl->nu; j++)
+      {
+        double s00 = 0.0, s01 = 0.0, s10 = 0.0, s11 = 0.0, t0 = 0.0, t1 = 0.0, mm = 0.0;
+        for (int k = 0; k < np; k++)
+        {
+          double w = pt[k][2];
+          s00 += w * u[j]->dx[k] * v[i]->dx[k];
+          s01 += w * u[j]->dx[k] * v[i]->dy[k];
+          s10 += w * u[j]->dy[k] * v[i]->dx[k];
+          s11 += w * u[j]->dy[k] * v[i]->dy[k];
+          t0 += w * u[j]->dx[k] * v[i]->val[k];
+          t1 += w * u[j]->dy[k] * v[i]->val[k];
+          mm += w * u[j]->val[k] * v[i]->val[k];
+        }
+        int ij = i * tpl->nu + j;
+        tpl->s[0][0][ij] = s00;
+        tpl->s[0][1][ij] = s01;
+        tpl->s[1][0][ij] = s10;
+        tpl->s[1][1][ij] = s11;
+        tpl->t[0][ij] = t0;
+        tpl->t[1][ij] = t1;
+        tpl->m[ij] = mm;
+      }
+
+    templates[key] = tpl;
+    memory += sizeof(ReferenceTemplate) + 7 * size * sizeof(double)
+              + (tpl->nu + tpl->nv) * 2 * sizeof(int);
+    num_misses++;
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return tpl;
+}
+
+void ReferenceTemplateCache::set_max_memory(size_t bytes)
+{
+  max_memory = bytes;
+}
+
+void ReferenceTemplateCache::trim()
+{
+  if (memory > max_memory)
+    clear();
+}
+
+void ReferenceTemplateCache::clear()
+{
+  pthread_mutex_lock(&mutex);
+  std::map<ReferenceTemplateKey, ReferenceTemplate*>::iterator it;
+  for (it = templates.begin(); it != templates.end(); it++)
+    delete it->second;
+  templates.clear();
+  memory = 0;
+  pthread_mutex_unlock(&mutex);
+}
+
+void ReferenceTemplateCache::reset_stats()
+{
+  num_hits = 0;
+  num_misses = 0;
+}
+
+void contract_reference_template(const ReferenceTemplate& tpl, const AffineCoefficients& c,
+                                 double jac, double2x2& m, double* result)
+{
+  // Physical derivatives are d/dx_r = sum_a m[r][a] d/dxi_a, hence
+  // (D grad u) . grad v = sum_ab g[a][b] du/dxi_a dv/dxi_b with
+  // g[a][b] = sum_rs m[s][a] D[r][s] m[r][b], and similarly for b . grad u.
+  double g[2][2], beta[2];
+  for (int a = 0; a < 2; a++)
+  {
+    for (int b = 0; b < 2; b++)
+    {
+      g[a][b] = 0.0;
+      for (int r = 0; r < 2; r++)
+        for (int s = 0; s < 2; s++)
+          g[a][b] += m[s][a] * c.diffusion[r][s] * m[r][b];
+      g[a][b] *= jac;
+    }
+    beta[a] = jac * (c.advection[0] * m[0][a] + c.advection[1] * m[1][a]);
+  }
+  double mass = jac * c.mass;
+
+  int size = tpl.nu * tpl.nv;
+  if (size == 0) return;
+  for (int ij = 0; ij < size; ij++)
+    result[ij] = 0.0;
+  for (int a = 0; a < 2; a++)
+  {
+    for (int b = 0; b < 2; b++)
+    {
+      if (g[a][b] == 0.0) continue;
+      const double* s = &tpl.s[a][b][0];
+      for (int ij = 0; ij < size; ij++)
+        result[ij] += g[a][b] * s[ij];
+    }
+    if (beta[a] == 0.0) continue;
+    const double* t = &tpl.t[a][0];
+    for (int ij = 0; ij < size; ij++)
+      result[ij] += beta[a] * t[ij];
+  }
+  if (mass != 0.0)
+    for (int ij = 0; ij < size; ij++)
+      result[ij] += mass * tpl.m[ij];
+}
@@ -0,0 +1,110 @@
+#ifndef __P09_AFFINE_TEMPLATES_H
+#define __P09_AFFINE_TEMPLATES_H
+
+#include "hermes2d.h"
+#include "shape_table_cache.h"
+#include <pthread.h>
+#include <map>
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Constant coefficients of the bilinear form
+///   int (D grad u) . grad v + (b . grad u) v + c u v,
+/// D = diffusion, b = advection, c = mass. Unused terms are zero.
+struct AffineCoefficients
+{
+  AffineCoefficients();
+
+  double diffusion[2][2];
+  double advection[2];
+  double mass;
+};
+
+/// Optional interface of a volumetric matrix form whose coefficients are
+/// constant. On elements with a constant Jacobian (triangles and
+/// parallelograms) NativeDiscreteProblem then builds the local matrix
+/// from precomputed reference templates instead of quadrature.
+class AffineMatrixForm
+{
+public:
+  virtual ~AffineMatrixForm() {}
+
+  /// Fills in the coefficients of the form. Returns false if the form
+  /// cannot be written in this way, then value() is used.
+  virtual bool get_affine_coefficients(AffineCoefficients& c) const = 0;
+};
+
+/// Integrals of products of reference shape functions and their
+/// derivatives over the reference element, for all pairs of test
+/// functions v_i (i < nv) and basis functions u_j (j < nu). Entries are
+/// stored row by row, index i * nu + j; a stands for the reference
+/// coordinate xi_a.
+struct ReferenceTemplate
+{
+  int nu, nv;
+  std::vector<double> s[2][2];   ///< int du_j/dxi_a dv_i/dxi_b
+  std::vector<double> t[2];      ///< int du_j/dxi_a v_i
+  std::vector<double> m;         ///< int u_j v_i
+};
+
+/// Identifies a reference template: shapesets, element mode, quadrature
+/// order and the shape function indices of both assembly lists.
+struct ReferenceTemplateKey
+{
+  bool operator<(const ReferenceTemplateKey& other) const;
+
+  int shapeset_u, shapeset_v;
+  int mode;
+  int order;
+  std::vector<int> idx_u, idx_v;
+};
+
+/// Reference templates of a discrete problem. Lookups may come from several
+/// threads at a time. A returned template stays valid until the next call
+/// to trim() or clear(), these must not run concurrently with an assembly.
+class ReferenceTemplateCache
+{
+public:
+  ReferenceTemplateCache();
+  ~ReferenceTemplateCache();
+
+  /// Template for the key. The quadrature must be set to the mode.
+  const ReferenceTemplate* get(const ReferenceTemplateKey& key, Shapeset* shapeset_u, Shapeset* shapeset_v,
+                               Quad2D* quad);
+
+  /// Bound of the memory occupied by the templates in bytes (32 MB by
+  /// default). Templates are combinations of shape functions, there are
+  /// many more of them than of shape tables, so the whole cache is emptied
+  /// by trim() when the bound is exceeded.
+  void set_max_memory(size_t bytes);
+  void trim();
+  void clear();
+
+  unsigned long get_num_hits() const { return num_hits; }
+  unsigned long get_num_misses() const { return num_misses; }
+  void reset_stats();
+
+  int get_num_templates() const { return templates.size(); }
+  size_t get_memory_size() const { return memory; }
+
+protected:
+  std::map<ReferenceTemplateKey, ReferenceTemplate*> templates;
+  pthread_mutex_t mutex;
+
+  size_t max_memory;
+  size_t memory;
+
+  unsigned long num_hits;
+  unsigned long num_misses;
+};
+
+/// Local matrix of an affine element from a template,
+///   result[i * nu + j] = jac * (G : S_ij + beta . T_ij + c M_ij),
+/// where G and beta are the coefficients transformed by the constant
+/// inverse reference map m (the one returned by RefMap) and jac is the
+/// constant Jacobian of the element.
+void contract_reference_template(const ReferenceTemplate& tpl, const AffineCoefficients& c,
+                                 double jac, double2x2& m, double* result);
+
+#endif
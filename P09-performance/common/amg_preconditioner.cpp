@@ -0,0 +1,508 @@
+#include "amg_preconditioner.h"
+#include "hermes2d.h"
+#include <cmath>
+
+using namespace Hermes;
+
+// y = A x.
+static void multiply(const std::vector<int>& ptr, const std::vector<int>& idx, const std::vector<double>& val,
+                     int rows, const double* x, double* y)
+{
+  for (int i = 0; i < rows; i++)
+  {
+    double sum = 0.0;
+    for (int k = ptr[i]; k < ptr[i + 1]; k++)
+      sum += val[k] * x[idx[k]];
+    y[i] = sum;
+  }
+}
+
+static double norm(const std::vector<double>& x)
+{
+  double sum = 0.0;
+  for (unsigned int i = 0; i < x.size(); i++)
+    sum += x[i] * x[i];
+  return std::sqrt(sum);
+}
+
+AMGPreconditioner::AMGPreconditioner()
+  : max_levels(10), coarse_size(500), threshold(0.08), smoother(AMG_SMOOTHER_GAUSS_SEIDEL), smoothing_steps(1),
+    setup_time(0.0)
+{
+}
+
+void AMGPreconditioner::set_smoother(AMGSmootherType smoother, int steps)
+{
+  if (steps < 1)
+    throw Hermes::Exceptions::Exception("The AMG smoother needs at least one step.");
+  this->smoother = smoother;
+  smoothing_steps = steps;
+}
+
+void AMGPreconditioner::set_near_null_space(const double* vec, int size)
+{
+  if (vec == NULL)
+    near_null_space.clear();
+  else
+    near_null_space.assign(vec, vec + size);
+}
+
+double AMGPreconditioner::get_operator_complexity() const
+{
+  if (levels.empty() || levels[0].a.idx.empty())
+    return 1.0;
+  double nnz = 0.0;
+  for (unsigned int l = 0; l < levels.size(); l++)
+    nnz += levels[l].a.idx.size();
+  return nnz / levels[0].a.idx.size();
+}
+
+// C = A B by rows; marker[c] is the position of column c in the current
+// row of C, or -1.
+static void multiply_matrices(const std::vector<int>& a_ptr, const std::vector<int>& a_idx,
+                              const std::vector<double>& a_val, int a_rows,
+                              const std::vector<int>& b_ptr, const std::vector<int>& b_idx,
+                              const std::vector<double>& b_val, int b_cols,
+                              std::vector<int>& c_ptr, std::vector<int>& c_idx, std::vector<double>& c_val)
+{
+  std::vector<int> marker(b_cols, -1);
+  c_ptr.assign(a_rows + 1, 0);
+  c_idx.clear();
+  c_val.clear();
+  for (int i = 0; i < a_rows; i++)
+  {
+    int row_start = c_idx.size();
+    for (int ka = a_ptr[i]; ka < a_ptr[i + 1]; ka++)
+    {
+      int j = a_idx[ka];
+      for (int kb = b_ptr[j]; kb < b_ptr[j + 1]; kb++)
+      {
+        int c = b_idx[kb];
+        if (marker[c] < row_start)
+        {
+          marker[c] = c_idx.size();
+          c_idx.push_back(c);
+          c_val.push_back(a_val[ka] * b_val[kb]);
+        }
+        else
+          c_val[marker[c]] += a_val[ka] * b_val[kb];
+      }
+    }
+    c_ptr[i + 1] = c_idx.size();
+  }
+}
+
+int AMGPreconditioner::aggregate(const Matrix& a, std::vector<int>& agg)
+{
+  int n = a.rows;
+  std::vector<double> diag(n, 0.0);
+  for (int i = 0; i < n; i++)
+    for (int k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+      if (a.idx[k] == i)
+        diag[i] += a.val[k];
+
+  // Strong neighbours of every unknown.
+  std::vector<int> s_ptr(n + 1, 0), s_idx;
+  std::vector<double> s_val;
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+    {
+      int j = a.idx[k];
+      if (j != i && std::abs(a.val[k]) >= threshold * std::sqrt(std::abs(diag[i] * diag[j])))
+      {
+        s_idx.push_back(j);
+        s_val.push_back(std::abs(a.val[k]));
+      }
+    }
+    s_ptr[i + 1] = s_idx.size();
+  }
+
+  // 1. Unknowns whose strong neighbours are all free form an aggregate
+  //    with them.
+  agg.assign(n, -1);
+  int num_agg = 0;
+  for (int i = 0; i < n; i++)
+  {
+    if (agg[i] >= 0 || s_ptr[i] == s_ptr[i + 1]) continue;
+    bool free = true;
+    for (int k = s_ptr[i]; k < s_ptr[i + 1] && free; k++)
+      free = (agg[s_idx[k]] < 0);
+    if (!free) continue;
+    agg[i] = num_agg;
+    for (int k = s_ptr[i]; k < s_ptr[i + 1]; k++)
+      agg[s_idx[k]] = num_agg;
+    num_agg++;
+  }
+
+  // 2. Remaining unknowns join the aggregate of their strongest aggregated
+  //    neighbour from step 1.
+  std::vector<int> joined(agg);
+  for (int i = 0; i < n; i++)
+  {
+    if (agg[i] >= 0) continue;
+    double best = 0.0;
+    for (int k = s_ptr[i]; k < s_ptr[i + 1]; k++)
+      if (agg[s_idx[k]] >= 0 && s_val[k] > best)
+      {
+        best = s_val[k];
+        joined[i] = agg[s_idx[k]];
+      }
+  }
+  agg.swap(joined);
+
+  // 3. What is left forms aggregates with its free strong neighbours.
+  //    Isolated unknowns are not aggregated, they are left to the smoother.
+  for (int i = 0; i < n; i++)
+  {
+    if (agg[i] >= 0 || s_ptr[i] == s_ptr[i + 1]) continue;
+    agg[i] = num_agg;
+    for (int k = s_ptr[i]; k < s_ptr[i + 1]; k++)
+      if (agg[s_idx[k]] < 0)
+        agg[s_idx[k]] = num_agg;
+    num_agg++;
+  }
+  return num_agg;
+}
+
+bool AMGPreconditioner::build_prolongator(Level& level, const std::vector<double>& null_vec,
+                                          std::vector<double>& coarse_null_vec)
+{
+  const Matrix& a = level.a;
+  int n = a.rows;
+  std::vector<int> agg;
+  int num_agg = aggregate(a, agg);
+  if (num_agg == 0 || num_agg >= n)
+    return false;
+
+  // Tentative prolongator: the near null space vector restricted to each
+  // aggregate, normalized. The coarse vector reproduces it, T c = v.
+  coarse_null_vec.assign(num_agg, 0.0);
+  for (int i = 0; i < n; i++)
+    if (agg[i] >= 0)
+      coarse_null_vec[agg[i]] += null_vec[i] * null_vec[i];
+  for (int c = 0; c < num_agg; c++)
+    coarse_null_vec[c] = std::sqrt(coarse_null_vec[c]);
+  std::vector<double> t(n);
+  for (int i = 0; i < n; i++)
+    t[i] = (agg[i] >= 0 && coarse_null_vec[agg[i]] > 0.0) ? null_vec[i] / coarse_null_vec[agg[i]] : 0.0;
+
+  // P = T - omega D^{-1} A T.
+  double omega = 4.0 / 3.0 / level.lambda_max;
+  Matrix& p = level.p;
+  p.rows = n;
+  p.cols = num_agg;
+  p.ptr.assign(n + 1, 0);
+  p.idx.clear();
+  p.val.clear();
+  std::vector<int> marker(num_agg, -1);
+  for (int i = 0; i < n; i++)
+  {
+    int row_start = p.idx.size();
+    if (agg[i] >= 0)
+    {
+      marker[agg[i]] = row_start;
+      p.idx.push_back(agg[i]);
+      p.val.push_back(t[i]);
+    }
+    for (int k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+    {
+      int j = a.idx[k];
+      if (t[j] == 0.0) continue;
+      double value = -omega * level.inv_diag[i] * a.val[k] * t[j];
+      int c = agg[j];
+      if (marker[c] < row_start)
+      {
+        marker[c] = p.idx.size();
+        p.idx.push_back(c);
+        p.val.push_back(value);
+      }
+      else
+        p.val[marker[c]] += value;
+    }
+    p.ptr[i + 1] = p.idx.size();
+  }
+
+  // R = P^T by counting.
+  Matrix& r = level.r;
+  r.rows = num_agg;
+  r.cols = n;
+  r.ptr.assign(num_agg + 1, 0);
+  for (unsigned int k = 0; k < p.idx.size(); k++)
+    r.ptr[p.idx[k] + 1]++;
+  for (int c = 0; c < num_agg; c++)
+    r.ptr[c + 1] += r.ptr[c];
+  r.idx.resize(p.idx.size());
+  r.val.resize(p.idx.size());
+  std::vector<int> next(r.ptr.begin(), r.ptr.end() - 1);
+  for (int i = 0; i < n; i++)
+    for (int k = p.ptr[i]; k < p.ptr[i + 1]; k++)
+    {
+      int pos = next[p.idx[k]]++;
+      r.idx[pos] = i;
+      r.val[pos] = p.val[k];
+    }
+  return true;
+}
+
+void AMGPreconditioner::setup(LinearOperator* op)
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  const CSRMatrix<double>* matrix = get_operator_matrix(op, "AMG");
+  int n = matrix->get_size();
+  if (!near_null_space.empty() && (int) near_null_space.size() != n)
+    throw Hermes::Exceptions::Exception("The near null space vector of the AMG preconditioner has a wrong size.");
+
+  // The finest level, symmetric storage is expanded.
+  levels.clear();
+  levels.push_back(Level());
+  Matrix& a = levels[0].a;
+  a.rows = a.cols = n;
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+  const double* values = matrix->get_values();
+  a.ptr.assign(n + 1, 0);
+  for (int i = 0; i < n; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      a.ptr[i + 1]++;
+      if (matrix->is_symmetric() && col_idx[k] != i)
+        a.ptr[col_idx[k] + 1]++;
+    }
+  for (int i = 0; i < n; i++)
+    a.ptr[i + 1] += a.ptr[i];
+  a.idx.resize(a.ptr[n]);
+  a.val.resize(a.ptr[n]);
+  std::vector<int> next(a.ptr.begin(), a.ptr.end() - 1);
+  for (int i = 0; i < n; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      a.idx[next[i]] = col_idx[k];
+      a.val[next[i]++] = values[k];
+      if (matrix->is_symmetric() && col_idx[k] != i)
+      {
+        a.idx[next[col_idx[k]]] = i;
+        a.val[next[col_idx[k]]++] = values[k];
+      }
+    }
+
+  std::vector<double> null_vec(near_null_space);
+  if (null_vec.empty())
+    null_vec.assign(n, 1.0);
+
+  while (true)
+  {
+    Level& level = levels.back();
+    int size = level.a.rows;
+    level.x.resize(size);
+    level.b.resize(size);
+    level.res.resize(size);
+    level.work.resize(size);
+
+    level.inv_diag.assign(size, 1.0);
+    for (int i = 0; i < size; i++)
+      for (int k = level.a.ptr[i]; k < level.a.ptr[i + 1]; k++)
+        if (level.a.idx[k] == i && level.a.val[k] != 0.0)
+          level.inv_diag[i] = 1.0 / level.a.val[k];
+
+    // Largest eigenvalue of D^{-1} A by a few power iterations, with a
+    // safety factor since they approach it from below.
+    std::vector<double>& v = level.x;
+    std::vector<double>& w = level.work;
+    for (int i = 0; i < size; i++)
+      v[i] = 0.5 + (i * 7919 % 1000) / 1000.0;
+    double lambda = 1.0;
+    for (int it = 0; it < 15 && size > 0; it++)
+    {
+      multiply(level.a.ptr, level.a.idx, level.a.val, size, &v[0], &w[0]);
+      for (int i = 0; i < size; i++)
+        w[i] *= level.inv_diag[i];
+      lambda = norm(w) / norm(v);
+      double w_norm = norm(w);
+      if (w_norm == 0.0) break;
+      for (int i = 0; i < size; i++)
+        v[i] = w[i] / w_norm;
+    }
+    level.lambda_max = 1.1 * lambda;
+
+    if ((int) levels.size() >= max_levels || size <= coarse_size)
+      break;
+    std::vector<double> coarse_null_vec;
+    if (!build_prolongator(level, null_vec, coarse_null_vec))
+      break;
+
+    // Galerkin product R A P.
+    Level coarse;
+    Matrix ap;
+    multiply_matrices(level.a.ptr, level.a.idx, level.a.val, size, level.p.ptr, level.p.idx, level.p.val,
+                      level.p.cols, ap.ptr, ap.idx, ap.val);
+    multiply_matrices(level.r.ptr, level.r.idx, level.r.val, level.r.rows, ap.ptr, ap.idx, ap.val,
+                      level.p.cols, coarse.a.ptr, coarse.a.idx, coarse.a.val);
+    coarse.a.rows = coarse.a.cols = level.p.cols;
+    levels.push_back(coarse);
+    null_vec.swap(coarse_null_vec);
+  }
+
+  factorize_coarse();
+  setup_time = timer.tick().last();
+}
+
+void AMGPreconditioner::factorize_coarse()
+{
+  // A coarsest level that is too large is only smoothed.
+  const Matrix& a = levels.back().a;
+  int n = a.rows;
+  coarse_lu.clear();
+  coarse_piv.clear();
+  if (n > coarse_size)
+    return;
+
+  coarse_lu.assign(n * n, 0.0);
+  for (int i = 0; i < n; i++)
+    for (int k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+      coarse_lu[i * n + a.idx[k]] += a.val[k];
+
+  coarse_piv.resize(n);
+  for (int j = 0; j < n; j++)
+  {
+    int piv = j;
+    for (int i = j + 1; i < n; i++)
+      if (std::abs(coarse_lu[i * n + j]) > std::abs(coarse_lu[piv * n + j]))
+        piv = i;
+    coarse_piv[j] = piv;
+    if (coarse_lu[piv * n + j] == 0.0)
+      throw Hermes::Exceptions::Exception("Singular coarse matrix in the AMG preconditioner.");
+    if (piv != j)
+      for (int k = 0; k < n; k++)
+        std::swap(coarse_lu[j * n + k], coarse_lu[piv * n + k]);
+    for (int i = j + 1; i < n; i++)
+    {
+      double l = coarse_lu[i * n + j] /= coarse_lu[j * n + j];
+      if (l == 0.0) continue;
+      for (int k = j + 1; k < n; k++)
+        coarse_lu[i * n + k] -= l * coarse_lu[j * n + k];
+    }
+  }
+}
+
+void AMGPreconditioner::solve_coarse(Level& level)
+{
+  int n = level.a.rows;
+  std::vector<double>& x = level.x;
+  x = level.b;
+  for (int j = 0; j < n; j++)
+    std::swap(x[j], x[coarse_piv[j]]);
+  for (int i = 0; i < n; i++)
+    for (int k = 0; k < i; k++)
+      x[i] -= coarse_lu[i * n + k] * x[k];
+  for (int i = n - 1; i >= 0; i--)
+  {
+    for (int k = i + 1; k < n; k++)
+      x[i] -= coarse_lu[i * n + k] * x[k];
+    x[i] /= coarse_lu[i * n + i];
+  }
+}
+
+void AMGPreconditioner::smooth(Level& level, bool pre)
+{
+  const Matrix& a = level.a;
+  int n = a.rows;
+  std::vector<double>& x = level.x;
+  const std::vector<double>& b = level.b;
+
+  if (smoother == AMG_SMOOTHER_GAUSS_SEIDEL)
+  {
+    for (int sweep = 0; sweep < smoothing_steps; sweep++)
+      for (int ii = 0; ii < n; ii++)
+      {
+        int i = pre ? ii : n - 1 - ii;
+        double sum = b[i];
+        for (int k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+          sum -= a.val[k] * x[a.idx[k]];
+        x[i] += level.inv_diag[i] * sum;
+      }
+    return;
+  }
+
+  // Chebyshev polynomial for the eigenvalues of D^{-1} A in
+  // [lambda_max / 30, lambda_max], the upper part of the spectrum.
+  double upper = level.lambda_max;
+  double lower = upper / 30.0;
+  double theta = 0.5 * (upper + lower);
+  double delta = 0.5 * (upper - lower);
+  double sigma = theta / delta;
+  double rho = 1.0 / sigma;
+  std::vector<double>& r = level.res;
+  std::vector<double>& d = level.work;
+
+  multiply(a.ptr, a.idx, a.val, n, &x[0], &r[0]);
+  for (int i = 0; i < n; i++)
+  {
+    r[i] = b[i] - r[i];
+    d[i] = level.inv_diag[i] * r[i] / theta;
+  }
+  for (int k = 0; k < smoothing_steps; k++)
+  {
+    for (int i = 0; i < n; i++)
+      x[i] += d[i];
+    if (k + 1 == smoothing_steps) break;
+
+    // r -= A d.
+    for (int i = 0; i < n; i++)
+    {
+      double sum = 0.0;
+      for (int kk = a.ptr[i]; kk < a.ptr[i + 1]; kk++)
+        sum += a.val[kk] * d[a.idx[kk]];
+      r[i] -= sum;
+    }
+    double rho_new = 1.0 / (2.0 * sigma - rho);
+    for (int i = 0; i < n; i++)
+      d[i] = rho_new * rho * d[i] + 2.0 * rho_new / delta * level.inv_diag[i] * r[i];
+    rho = rho_new;
+  }
+}
+
+void AMGPreconditioner::cycle(int l)
+{
+  Level& level = levels[l];
+  int n = level.a.rows;
+  std::fill(level.x.begin(), level.x.end(), 0.0);
+
+  if (l + 1 == (int) levels.size())
+  {
+    if (!coarse_lu.empty())
+      solve_coarse(level);
+    else
+    {
+      smooth(level, true);
+      smooth(level, false);
+    }
+    return;
+  }
+
+  smooth(level, true);
+
+  // Restriction of the residual, coarse correction, prolongation.
+  Level& coarse = levels[l + 1];
+  multiply(level.a.ptr, level.a.idx, level.a.val, n, &level.x[0], &level.res[0]);
+  for (int i = 0; i < n; i++)
+    level.res[i] = level.b[i] - level.res[i];
+  multiply(level.r.ptr, level.r.idx, level.r.val, level.r.rows, &level.res[0], &coarse.b[0]);
+  cycle(l + 1);
+  for (int i = 0; i < n; i++)
+    for (int k = level.p.ptr[i]; k < level.p.ptr[i + 1]; k++)
+      level.x[i] += level.p.val[k] * coarse.x[level.p.idx[k]];
+
+  smooth(level, false);
+}
+
+void AMGPreconditioner::apply(const double* r, double* z)
+{
+  if (levels.empty() || levels[0].a.rows == 0)
+    return;
+  std::copy(r, r + levels[0].a.rows, levels[0].b.begin());
+  cycle(0);
+  std::copy(levels[0].x.begin(), levels[0].x.end(), z);
+}
@@ -0,0 +1,112 @@
+#ifndef __P09_AMG_PRECONDITIONER_H
+#define __P09_AMG_PRECONDITIONER_H
+
+#include "preconditioners.h"
+
+/// Smoothers of the AMG preconditioner.
+enum AMGSmootherType
+{
+  AMG_SMOOTHER_GAUSS_SEIDEL,   ///< Forward sweeps before, backward sweeps after the coarse correction.
+  AMG_SMOOTHER_CHEBYSHEV       ///< Chebyshev polynomial in D^{-1} A.
+};
+
+/// Smoothed aggregation algebraic multigrid, one V-cycle per application.
+///
+/// On every level, the unknowns are grouped into aggregates of strongly
+/// connected unknowns; i and j are strongly connected if
+/// |a_ij| >= threshold * sqrt(|a_ii a_jj|). The tentative prolongator
+/// restricts the near null space vector (by default the constant vector)
+/// to the aggregates, and is smoothed by one damped Jacobi step,
+/// P = (I - 4/3 / lambda_max D^{-1} A) T. The coarse matrix is the Galerkin
+/// product P^T A P. Coarsening stops at the maximum number of levels or
+/// when a level is small enough for the dense LU factorization.
+///
+/// With symmetric smoothing (Gauss-Seidel forward before and backward after
+/// the correction, or Chebyshev) the V-cycle is a symmetric operator, so it
+/// can precondition CG.
+///
+/// The hierarchic H1 shapeset of Hermes represents the constant function
+/// by the vertex functions only, so the near null space vector should be
+/// set (see get_constant_coefficients() in hermes_matrix_utils.h) for
+/// polynomial degrees above one.
+class AMGPreconditioner : public Preconditioner
+{
+public:
+  AMGPreconditioner();
+
+  virtual void setup(LinearOperator* op);
+  virtual void apply(const double* r, double* z);
+
+  /// Maximum number of levels including the finest one (default 10).
+  void set_max_levels(int max_levels) { this->max_levels = max_levels; }
+
+  /// Levels with at most this many unknowns are solved directly (default 500).
+  void set_coarse_size(int coarse_size) { this->coarse_size = coarse_size; }
+
+  /// Strength of connection threshold of the aggregation (default 0.08).
+  void set_threshold(double threshold) { this->threshold = threshold; }
+
+  /// Smoother and the number of sweeps before and after the coarse
+  /// correction, or the degree of the Chebyshev polynomial (default
+  /// Gauss-Seidel, one sweep).
+  void set_smoother(AMGSmootherType smoother, int steps = 1);
+
+  /// Near null space vector of the finest level, NULL for the constant
+  /// vector. The array is copied.
+  void set_near_null_space(const double* vec, int size);
+
+  int get_num_levels() const { return (int) levels.size(); }
+  int get_level_size(int level) const { return levels[level].a.rows; }
+
+  /// Sum of the nonzeros of all levels divided by the nonzeros of the finest.
+  double get_operator_complexity() const;
+
+  /// Wall clock time of the last setup() in seconds.
+  double get_setup_time() const { return setup_time; }
+
+protected:
+  /// Sparse matrix in CSR format; rows need not be sorted.
+  struct Matrix
+  {
+    int rows, cols;
+    std::vector<int> ptr, idx;
+    std::vector<double> val;
+  };
+
+  struct Level
+  {
+    Matrix a, p, r;
+    std::vector<double> inv_diag;
+    double lambda_max;               ///< Estimate of the largest eigenvalue of D^{-1} A.
+    std::vector<double> x, b, res, work;
+  };
+
+  /// Groups the unknowns of the matrix into aggregates, returns their number.
+  /// Unknowns without strong connections get the aggregate -1.
+  int aggregate(const Matrix& a, std::vector<int>& agg);
+
+  /// Builds the prolongator of the level, returns false if the level does not coarsen.
+  bool build_prolongator(Level& level, const std::vector<double>& null_vec, std::vector<double>& coarse_null_vec);
+
+  void smooth(Level& level, bool pre);
+  void cycle(int l);
+  void factorize_coarse();
+  void solve_coarse(Level& level);
+
+  int max_levels;
+  int coarse_size;
+  double threshold;
+  AMGSmootherType smoother;
+  int smoothing_steps;
+  std::vector<double> near_null_space;
+
+  std::vector<Level> levels;
+
+  /// Dense LU factorization of the coarsest matrix with row pivots.
+  std::vector<double> coarse_lu;
+  std::vector<int> coarse_piv;
+
+  double setup_time;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "assembly_profiler.h"
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+void AssemblyProfiler::Stats::add(const Stats& other)
+{
+  time += other.time;
+  calls += other.calls;
+  points += other.points;
+}
+
+AssemblyProfiler::AssemblyProfiler()
+{
+  reset();
+}
+
+double AssemblyProfiler::now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+void AssemblyProfiler::add_phase(Phase phase, const Stats& stats)
+{
+  phases[phase].add(stats);
+}
+
+void AssemblyProfiler::add_form(const std::string& name, const Stats& stats)
+{
+  forms[name].add(stats);
+}
+
+void AssemblyProfiler::add_assembly(double time)
+{
+  num_assemblies++;
+  total_time += time;
+}
+
+void AssemblyProfiler::add(const AssemblyProfiler& other)
+{
+  for (int p = 0; p < NUM_PHASES; p++)
+    phases[p].add(other.phases[p]);
+  std::map<std::string, Stats>::const_iterator it;
+  for (it = other.forms.begin(); it != other.forms.end(); it++)
+    forms[it->first].add(it->second);
+  num_assemblies += other.num_assemblies;
+  total_time += other.total_time;
+}
+
+void AssemblyProfiler::reset()
+{
+  for (int p = 0; p < NUM_PHASES; p++)
+    phases[p] = Stats();
+  forms.clear();
+  num_assemblies = 0;
+  total_time = 0.0;
+}
+
+const char* AssemblyProfiler::get_phase_name(Phase phase)
+{
+  switch (phase)
+  {
+  case PATTERN: return "pattern";
+  case ALLOCATION: return "allocation";
+  case GEOMETRY: return "geometry";
+  case SHAPE_FUNCTIONS: return "shape_functions";
+  case ORDERS: return "orders";
+  case FORMS: return "forms";
+  case DIRICHLET_LIFT: return "dirichlet_lift";
+  case CONDENSATION: return "condensation";
+  case INSERTION: return "insertion";
+  default: return "unknown";
+  }
+}
+
+std::string AssemblyProfiler::get_class_name(const std::type_info& type)
+{
+#ifdef __GNUC__
+  int status;
+  char* name = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+  if (status == 0 && name != NULL)
+  {
+    std::string result(name);
+    free(name);
+    return result;
+  }
+#endif
+  return type.name();
+}
+
+// Names of forms may contain characters that must be escaped in JSON.
+static std::string json_string(const std::string& s)
+{
+  std::string result = "\"";
+  for (unsigned int i = 0; i < s.size(); i++)
+  {
+    if (s[i] == '"' || s[i] == '\\')
+      result += '\\';
+    result += s[i];
+  }
+  return result + "\"";
+}
+
+static void write_stats_json(std::ostream& out, const AssemblyProfiler::Stats& stats)
+{
+  out << "{ \"time\": " << stats.time << ", \"calls\": " << stats.calls << ", \"points\": " << stats.points << " }";
+}
+
+void AssemblyProfiler::print(std::ostream& out) const
+{
+  out << "Assemblies: " << num_assemblies << ", total time " << total_time << " s, the phases sum up all threads" << std::endl;
+  out << std::left << std::setw(48) << "phase / form" << std::right << std::setw(12) << "time [s]"
+      << std::setw(12) << "calls" << std::setw(14) << "points" << std::endl;
+  for (int p = 0; p < NUM_PHASES; p++)
+    out << std::left << std::setw(48) << get_phase_name((Phase) p) << std::right << std::setw(12) << phases[p].time
+        << std::setw(12) << phases[p].calls << std::setw(14) << phases[p].points << std::endl;
+  std::map<std::string, Stats>::const_iterator it;
+  for (it = forms.begin(); it != forms.end(); it++)
+    out << std::left << std::setw(48) << ("  " + it->first) << std::right << std::setw(12) << it->second.time
+        << std::setw(12) << it->second.calls << std::setw(14) << it->second.points << std::endl;
+}
+
+void AssemblyProfiler::write_json(std::ostream& out) const
+{
+  out << "{" << std::endl;
+  out << "  \"assemblies\": " << num_assemblies << "," << std::endl;
+  out << "  \"total_time\": " << total_time << "," << std::endl;
+  out << "  \"phases\": {" << std::endl;
+  for (int p = 0; p < NUM_PHASES; p++)
+  {
+    out << "    " << json_string(get_phase_name((Phase) p)) << ": ";
+    write_stats_json(out, phases[p]);
+    out << (p + 1 < NUM_PHASES ? "," : "") << std::endl;
+  }
+  out << "  }," << std::endl;
+  out << "  \"forms\": {" << std::endl;
+  std::map<std::string, Stats>::const_iterator it;
+  for (it = forms.begin(); it != forms.end(); )
+  {
+    out << "    " << json_string(it->first) << ": ";
+    write_stats_json(out, it->second);
+    it++;
+    out << (it != forms.end() ? "," : "") << std::endl;
+  }
+  out << "  }" << std::endl;
+  out << "}" << std::endl;
+}
+
+bool AssemblyProfiler::write_json(const char* filename) const
+{
+  std::ofstream out(filename);
+  if (!out)
+    return false;
+  write_json(out);
+  return out.good();
+}
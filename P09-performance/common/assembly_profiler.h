@@ -0,0 +1,78 @@
+#ifndef __P09_ASSEMBLY_PROFILER_H
+#define __P09_ASSEMBLY_PROFILER_H
+
+#include <map>
+#include <string>
+#include <ostream>
+#include <typeinfo>
+
+/// Timers of the phases of the assembly, and of every form class, with
+/// call counts and numbers of integration points. A profiler is attached
+/// to any number of discrete problems (NativeDiscreteProblem::set_profiler),
+/// e.g. to all problems of an adaptivity loop, and sums up all their
+/// assemblies. The results are printed as a table or written as JSON.
+class AssemblyProfiler
+{
+public:
+  enum Phase
+  {
+    PATTERN,           ///< Sparsity pattern.
+    ALLOCATION,        ///< Allocation or zeroing of the matrix.
+    GEOMETRY,          ///< Reference maps, Jacobians and geometry at the integration points.
+    SHAPE_FUNCTIONS,   ///< Shape functions and previous iterates at the integration points.
+    ORDERS,            ///< Integration orders of the forms.
+    FORMS,             ///< Evaluation of all forms (see also get_forms()).
+    DIRICHLET_LIFT,    ///< Moving the Dirichlet columns to the right-hand side.
+    CONDENSATION,      ///< Static condensation of the bubble functions.
+    INSERTION,         ///< Adding local matrices and vectors to the global system.
+    NUM_PHASES
+  };
+
+  struct Stats
+  {
+    Stats() : time(0.0), calls(0), points(0) {}
+    void add(const Stats& other);
+
+    double time;             ///< Seconds, summed over all threads.
+    unsigned long calls;
+    unsigned long points;    ///< Integration points, where this makes sense.
+  };
+
+  AssemblyProfiler();
+
+  /// Current time in seconds, for the measurements.
+  static double now();
+
+  void add_phase(Phase phase, const Stats& stats);
+  void add_form(const std::string& name, const Stats& stats);
+  /// Counts an assembly, time is the wall clock time of its integration
+  /// and insertion (pattern and allocation are separate phases).
+  void add_assembly(double time);
+  void add(const AssemblyProfiler& other);
+  void reset();
+
+  const Stats& get_phase(Phase phase) const { return phases[phase]; }
+  const std::map<std::string, Stats>& get_forms() const { return forms; }
+  int get_num_assemblies() const { return num_assemblies; }
+  double get_total_time() const { return total_time; }
+
+  static const char* get_phase_name(Phase phase);
+
+  /// Readable name of a class, e.g. of a form.
+  static std::string get_class_name(const std::type_info& type);
+
+  /// Table with one line per phase and form.
+  void print(std::ostream& out) const;
+
+  /// The same as a JSON object.
+  void write_json(std::ostream& out) const;
+  bool write_json(const char* filename) const;
+
+protected:
+  Stats phases[NUM_PHASES];
+  std::map<std::string, Stats> forms;
+  int num_assemblies;
+  double total_time;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "batched_forms.h"
+#include "batched_kernels.h"
+
+BatchedJacobianDiffusion::BatchedJacobianDiffusion(int i, int j, std::string area, double coeff, SymFlag sym)
+  : MatrixFormVol<double>(i, j, area, sym), coeff(coeff)
+{
+}
+
+double BatchedJacobianDiffusion::value(int n, double* wt, Func<double>*[], Func<double>* u, Func<double>* v,
+                                       Geom<double>*, ExtData<double>*) const
+{
+  double result = 0.0;
+  for (int i = 0; i < n; i++)
+    result += wt[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]);
+  return coeff * result;
+}
+
+Ord BatchedJacobianDiffusion::ord(int n, double* wt, Func<Ord>*[], Func<Ord>* u, Func<Ord>* v,
+                                  Geom<Ord>*, ExtData<Ord>*) const
+{
+  Ord result = Ord(0);
+  for (int i = 0; i < n; i++)
+    result += wt[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]);
+  return result;
+}
+
+void BatchedJacobianDiffusion::value_batch(int np, double* wt, Func<double>*[], const BasisBlock& u, const BasisBlock& v,
+                                           Geom<double>*, ExtData<double>*, double* result) const
+{
+  batched_diffusion(np, wt, coeff, u.n, u.dx, u.dy, v.n, v.dx, v.dy, result);
+}
+
+bool BatchedJacobianDiffusion::get_affine_coefficients(AffineCoefficients& c) const
+{
+  c.diffusion[0][0] = c.diffusion[1][1] = coeff;
+  return true;
+}
+
+MatrixFormVol<double>* BatchedJacobianDiffusion::clone()
+{
+  return new BatchedJacobianDiffusion(*this);
+}
+
+BatchedMatrixFormMass::BatchedMatrixFormMass(int i, int j, std::string area, double coeff, SymFlag sym)
+  : MatrixFormVol<double>(i, j, area, sym), coeff(coeff)
+{
+}
+
+double BatchedMatrixFormMass::value(int n, double* wt, Func<double>*[], Func<double>* u, Func<double>* v,
+                                    Geom<double>*, ExtData<double>*) const
+{
+  double result = 0.0;
+  for (int i = 0; i < n; i++)
+    result += wt[i] * u->val[i] * v->val[i];
+  return coeff * result;
+}
+
+Ord BatchedMatrixFormMass::ord(int n, double* wt, Func<Ord>*[], Func<Ord>* u, Func<Ord>* v,
+                               Geom<Ord>*, ExtData<Ord>*) const
+{
+  Ord result = Ord(0);
+  for (int i = 0; i < n; i++)
+    result += wt[i] * u->val[i] * v->val[i];
+  return result;
+}
+
+void BatchedMatrixFormMass::value_batch(int np, double* wt, Func<double>*[], const BasisBlock& u, const BasisBlock& v,
+                                        Geom<double>*, ExtData<double>*, double* result) const
+{
+  batched_mass(np, wt, coeff, u.n, u.val, v.n, v.val, result);
+}
+
+bool BatchedMatrixFormMass::get_affine_coefficients(AffineCoefficients& c) const
+{
+  c.mass = coeff;
+  return true;
+}
+
+MatrixFormVol<double>* BatchedMatrixFormMass::clone()
+{
+  return new BatchedMatrixFormMass(*this);
+}
+
+BatchedJacobianAdvection::BatchedJacobianAdvection(int i, int j, std::string area, double b1, double b2)
+  : MatrixFormVol<double>(i, j, area, HERMES_NONSYM), b1(b1), b2(b2)
+{
+}
+
+double BatchedJacobianAdvection::value(int n, double* wt, Func<double>*[], Func<double>* u, Func<double>* v,
+                                       Geom<double>*, ExtData<double>*) const
+{
+  double result = 0.0;
+  for (int i = 0; i < n; i++)
+    result += wt[i] * (b1 * u->dx[i] + b2 * u->dy[i]) * v->val[i];
+  return result;
+}
+
+Ord BatchedJacobianAdvection::ord(int n, double* wt, Func<Ord>*[], Func<Ord>* u, Func<Ord>* v,
+                                  Geom<Ord>*, ExtData<Ord>*) const
+{
+  Ord result = Ord(0);
+  for (int i = 0; i < n; i++)
+    result += wt[i] * (u->dx[i] + u->dy[i]) * v->val[i];
+  return result;
+}
+
+void BatchedJacobianAdvection::value_batch(int np, double* wt, Func<double>*[], const BasisBlock& u, const BasisBlock& v,
+                                           Geom<double>*, ExtData<double>*, double* result) const
+{
+  batched_advection(np, wt, b1, b2, u.n, u.dx, u.dy, v.n, v.val, result);
+}
+
+bool BatchedJacobianAdvection::get_affine_coefficients(AffineCoefficients& c) const
+{
+  c.advection[0] = b1;
+  c.advection[1] = b2;
+  return true;
+}
+
+MatrixFormVol<double>* BatchedJacobianAdvection::clone()
+{
+  return new BatchedJacobianAdvection(*this);
+}
@@ -0,0 +1,101 @@
+#ifndef __P09_BATCHED_FORMS_H
+#define __P09_BATCHED_FORMS_H
+
+#include "hermes2d.h"
+#include "affine_templates.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Values and derivatives of n functions at np integration points, stored
+/// as structure of arrays: the data of the function j start at val + j * np
+/// (and the same for dx, dy).
+struct BasisBlock
+{
+  int n;
+  int np;
+  const double* val;
+  const double* dx;
+  const double* dy;
+};
+
+/// Optional batched entry point of a volumetric matrix form. A form class
+/// derives from MatrixFormVol<double> as usual and, in addition, from this
+/// class. NativeDiscreteProblem then evaluates the form for all pairs of
+/// test functions v and basis functions u of an element in one call,
+/// instead of calling value() for every pair. The value() method remains
+/// the reference and is used by the standard DiscreteProblem.
+class BatchedMatrixForm
+{
+public:
+  virtual ~BatchedMatrixForm() {}
+
+  /// Stores the value of the form for the pair (v_i, u_j) in
+  /// result[i * u.n + j].
+  virtual void value_batch(int np, double* wt, Func<double>* u_ext[], const BasisBlock& u, const BasisBlock& v,
+                           Geom<double>* e, ExtData<double>* ext, double* result) const = 0;
+};
+
+/// The following forms have constant coefficients, they are also evaluated
+/// from reference templates on affine elements (see AffineMatrixForm).
+
+/// Diffusion with a constant coefficient, coeff * int grad u . grad v.
+class BatchedJacobianDiffusion : public MatrixFormVol<double>, public BatchedMatrixForm, public AffineMatrixForm
+{
+public:
+  BatchedJacobianDiffusion(int i, int j, std::string area = HERMES_ANY, double coeff = 1.0,
+                           SymFlag sym = HERMES_SYM);
+
+  virtual double value(int n, double* wt, Func<double>* u_ext[], Func<double>* u, Func<double>* v,
+                       Geom<double>* e, ExtData<double>* ext) const;
+  virtual Ord ord(int n, double* wt, Func<Ord>* u_ext[], Func<Ord>* u, Func<Ord>* v,
+                  Geom<Ord>* e, ExtData<Ord>* ext) const;
+  virtual void value_batch(int np, double* wt, Func<double>* u_ext[], const BasisBlock& u, const BasisBlock& v,
+                           Geom<double>* e, ExtData<double>* ext, double* result) const;
+  virtual bool get_affine_coefficients(AffineCoefficients& c) const;
+  virtual MatrixFormVol<double>* clone();
+
+protected:
+  double coeff;
+};
+
+/// Mass matrix with a constant coefficient, coeff * int u v.
+class BatchedMatrixFormMass : public MatrixFormVol<double>, public BatchedMatrixForm, public AffineMatrixForm
+{
+public:
+  BatchedMatrixFormMass(int i, int j, std::string area = HERMES_ANY, double coeff = 1.0,
+                        SymFlag sym = HERMES_SYM);
+
+  virtual double value(int n, double* wt, Func<double>* u_ext[], Func<double>* u, Func<double>* v,
+                       Geom<double>* e, ExtData<double>* ext) const;
+  virtual Ord ord(int n, double* wt, Func<Ord>* u_ext[], Func<Ord>* u, Func<Ord>* v,
+                  Geom<Ord>* e, ExtData<Ord>* ext) const;
+  virtual void value_batch(int np, double* wt, Func<double>* u_ext[], const BasisBlock& u, const BasisBlock& v,
+                           Geom<double>* e, ExtData<double>* ext, double* result) const;
+  virtual bool get_affine_coefficients(AffineCoefficients& c) const;
+  virtual MatrixFormVol<double>* clone();
+
+protected:
+  double coeff;
+};
+
+/// Advection with a constant velocity, int (b1 du/dx + b2 du/dy) v.
+class BatchedJacobianAdvection : public MatrixFormVol<double>, public BatchedMatrixForm, public AffineMatrixForm
+{
+public:
+  BatchedJacobianAdvection(int i, int j, std::string area = HERMES_ANY, double b1 = 1.0, double b2 = 0.0);
+
+  virtual double value(int n, double* wt, Func<double>* u_ext[], Func<double>* u, Func<double>* v,
+                       Geom<double>* e, ExtData<double>* ext) const;
+  virtual Ord ord(int n, double* wt, Func<Ord>* u_ext[], Func<Ord>* u, Func<Ord>* v,
+                  Geom<Ord>* e, ExtData<Ord>* ext) const;
+  virtual void value_batch(int np, double* wt, Func<double>* u_ext[], const BasisBlock& u, const BasisBlock& v,
+                           Geom<double>* e, ExtData<double>* ext, double* result) const;
+  virtual bool get_affine_coefficients(AffineCoefficients& c) const;
+  virtual MatrixFormVol<double>* clone();
+
+protected:
+  double b1, b2;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "batched_kernels.h"
+#include <vector>
+
+#if defined(WITH_AVX512) || defined(WITH_AVX2)
+#include <immintrin.h>
+#endif
+
+// The kernels first scale the test functions by the weights, after that
+// every entry of the result is a dot product (or a sum of two) over the
+// integration points. These are vectorized over the points.
+
+#if defined(WITH_AVX512)
+
+static inline double dot(int n, const double* a, const double* b)
+{
+  __m512d acc = _mm512_setzero_pd();
+  int k = 0;
+  for (; k + 8 <= n; k += 8)
+    acc = _mm512_fmadd_pd(_mm512_loadu_pd(a + k), _mm512_loadu_pd(b + k), acc);
+  if (k < n)
+  {
+    __mmask8 mask = (__mmask8) ((1 << (n - k)) - 1);
+    acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + k), _mm512_maskz_loadu_pd(mask, b + k), acc);
+  }
+  return _mm512_reduce_add_pd(acc);
+}
+
+static inline double dot2(int n, const double* a1, const double* b1, const double* a2, const double* b2)
+{
+  __m512d acc = _mm512_setzero_pd();
+  int k = 0;
+  for (; k + 8 <= n; k += 8)
+  {
+    acc = _mm512_fmadd_pd(_mm512_loadu_pd(a1 + k), _mm512_loadu_pd(b1 + k), acc);
+    acc = _mm512_fmadd_pd(_mm512_loadu_pd(a2 + k), _mm512_loadu_pd(b2 + k), acc);
+  }
+  if (k < n)
+  {
+    __mmask8 mask = (__mmask8) ((1 << (n - k)) - 1);
+    acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a1 + k), _mm512_maskz_loadu_pd(mask, b1 + k), acc);
+    acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a2 + k), _mm512_maskz_loadu_pd(mask, b2 + k), acc);
+  }
+  return _mm512_reduce_add_pd(acc);
+}
+
+#elif defined(WITH_AVX2)
+
+static inline double hsum(__m256d v)
+{
+  __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+static inline double dot(int n, const double* a, const double* b)
+{
+  __m256d acc = _mm256_setzero_pd();
+  int k = 0;
+  for (; k + 4 <= n; k += 4)
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(a + k), _mm256_loadu_pd(b + k), acc);
+  double sum = hsum(acc);
+  for (; k < n; k++)
+    sum += a[k] * b[k];
+  return sum;
+}
+
+static inline double dot2(int n, const double* a1, const double* b1, const double* a2, const double* b2)
+{
+  __m256d acc = _mm256_setzero_pd();
+  int k = 0;
+  for (; k + 4 <= n; k += 4)
+  {
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(a1 + k), _mm256_loadu_pd(b1 + k), acc);
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(a2 + k), _mm256_loadu_pd(b2 + k), acc);
+  }
+  double sum = hsum(acc);
+  for (; k < n; k++)
+    sum += a1[k] * b1[k] + a2[k] * b2[k];
+  return sum;
+}
+
+#else
+
+static inline double dot(int n, const double* a, const double* b)
+{
+  double sum = 0.0;
+  for (int k = 0; k < n; k++)
+    sum += a[k] * b[k];
+  return sum;
+}
+
+static inline double dot2(int n, const double* a1, const double* b1, const double* a2, const double* b2)
+{
+  double sum = 0.0;
+  for (int k = 0; k < n; k++)
+    sum += a1[k] * b1[k] + a2[k] * b2[k];
+  return sum;
+}
+
+#endif
+
+// scaled[i * np + k] = coeff * w[k] * v[i * np + k]
+static void scale_by_weights(int np, const double* w, double coeff, int nv, const double* v, std::vector<double>& scaled)
+{
+  scaled.resize(nv * np);
+  for (int i = 0; i < nv; i++)
+    for (int k = 0; k < np; k++)
+      scaled[i * np + k] = coeff * w[k] * v[i * np + k];
+}
+
+void batched_diffusion(int np, const double* w, double coeff,
+                       int nu, const double* u_dx, const double* u_dy,
+                       int nv, const double* v_dx, const double* v_dy, double* result)
+{
+  std::vector<double> wv_dx, wv_dy;
+  scale_by_weights(np, w, coeff, nv, v_dx, wv_dx);
+  scale_by_weights(np, w, coeff, nv, v_dy, wv_dy);
+  for (int i = 0; i < nv; i++)
+    for (int j = 0; j < nu; j++)
+      result[i * nu + j] = dot2(np, u_dx + j * np, &wv_dx[i * np], u_dy + j * np, &wv_dy[i * np]);
+}
+
+void batched_mass(int np, const double* w, double coeff,
+                  int nu, const double* u_val,
+                  int nv, const double* v_val, double* result)
+{
+  std::vector<double> wv;
+  scale_by_weights(np, w, coeff, nv, v_val, wv);
+  for (int i = 0; i < nv; i++)
+    for (int j = 0; j < nu; j++)
+      result[i * nu + j] = dot(np, u_val + j * np, &wv[i * np]);
+}
+
+void batched_advection(int np, const double* w, double b1, double b2,
+                       int nu, const double* u_dx, const double* u_dy,
+                       int nv, const double* v_val, double* result)
+{
+  std::vector<double> wv_x, wv_y;
+  scale_by_weights(np, w, b1, nv, v_val, wv_x);
+  scale_by_weights(np, w, b2, nv, v_val, wv_y);
+  for (int i = 0; i < nv; i++)
+    for (int j = 0; j < nu; j++)
+      result[i * nu + j] = dot2(np, u_dx + j * np, &wv_x[i * np], u_dy + j * np, &wv_y[i * np]);
+}
+
+const char* batched_kernels_isa()
+{
+#if defined(WITH_AVX512)
+  return "AVX-512";
+#elif defined(WITH_AVX2)
+  return "AVX2";
+#else
+  return "portable";
+#endif
+}
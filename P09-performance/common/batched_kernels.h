@@ -0,0 +1,33 @@
+#ifndef __P09_BATCHED_KERNELS_H
+#define __P09_BATCHED_KERNELS_H
+
+/// Kernels that evaluate a volumetric bilinear form for all pairs of test
+/// functions v_i (i < nv) and basis functions u_j (j < nu) of an element at
+/// once. Function values and derivatives are stored as structure of arrays,
+/// the values of the function j at the np integration points start at
+/// u_val + j * np. The result is stored row by row, result[i * nu + j]
+/// belongs to the pair (v_i, u_j). The weights w contain the Jacobian.
+///
+/// The kernels use AVX-512 or AVX2 instructions if the library is built
+/// with WITH_AVX512 or WITH_AVX2, respectively. Otherwise portable code is
+/// used. Results agree with a plain loop over the points up to rounding.
+
+/// coeff * sum_k w[k] (du_j/dx dv_i/dx + du_j/dy dv_i/dy)
+void batched_diffusion(int np, const double* w, double coeff,
+                       int nu, const double* u_dx, const double* u_dy,
+                       int nv, const double* v_dx, const double* v_dy, double* result);
+
+/// coeff * sum_k w[k] u_j v_i
+void batched_mass(int np, const double* w, double coeff,
+                  int nu, const double* u_val,
+                  int nv, const double* v_val, double* result);
+
+/// sum_k w[k] (b1 du_j/dx + b2 du_j/dy) v_i
+void batched_advection(int np, const double* w, double b1, double b2,
+                       int nu, const double* u_dx, const double* u_dy,
+                       int nv, const double* v_val, double* result);
+
+/// Instruction set the kernels were built for: "AVX-512", "AVX2" or "portable".
+const char* batched_kernels_isa();
+
+#endif
@@ -0,0 +1,131 @@
+#include "block_matrix.h"
+#include "hermes2d.h"
+
+using namespace Hermes;
+
+void MatrixBlock::multiply(const double* x, double* y) const
+{
+  for (int i = 0; i < rows; i++)
+  {
+    double sum = 0.0;
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      sum += values[k] * x[col_idx[k]];
+    y[i] = sum;
+  }
+}
+
+void MatrixBlock::multiply_sub(const double* x, double* y) const
+{
+  for (int i = 0; i < rows; i++)
+  {
+    double sum = 0.0;
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      sum += values[k] * x[col_idx[k]];
+    y[i] -= sum;
+  }
+}
+
+size_t MatrixBlock::get_memory_size() const
+{
+  return (row_ptr.size() + col_idx.size()) * sizeof(int) + values.size() * sizeof(double);
+}
+
+BlockMatrixView::BlockMatrixView(const CSRMatrix<double>* matrix, const std::vector<int>& offsets)
+  : matrix(matrix), offsets(offsets)
+{
+  if (offsets.size() < 2 || offsets[0] != 0)
+    throw Hermes::Exceptions::Exception("BlockMatrixView needs the offsets of at least one block.");
+  int nb = get_num_blocks();
+  diagonal.resize(nb);
+  blocks.resize(nb * nb);
+  update();
+}
+
+void BlockMatrixView::update()
+{
+  int n = matrix->get_size();
+  int nb = get_num_blocks();
+  if (offsets[nb] != n)
+    throw Hermes::Exceptions::Exception("The blocks of BlockMatrixView do not cover the matrix.");
+  bool symmetric = matrix->is_symmetric();
+
+  std::vector<int> block_of(n);
+  for (int b = 0; b < nb; b++)
+    for (int i = offsets[b]; i < offsets[b + 1]; i++)
+      block_of[i] = b;
+
+  // Entries of every block in the order of the rows of the matrix, so
+  // that the columns stay sorted within the rows of the blocks. With
+  // symmetric storage the entries above the diagonal blocks also go to
+  // the transposed blocks below them.
+  std::vector<std::vector<int> > rows(nb * nb), cols(nb * nb);
+  std::vector<std::vector<double> > vals(nb * nb);
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+  const double* values = matrix->get_values();
+  for (int r = 0; r < n; r++)
+  {
+    int bi = block_of[r];
+    for (int k = row_ptr[r]; k < row_ptr[r + 1]; k++)
+    {
+      int c = col_idx[k];
+      int bj = block_of[c];
+      rows[bi * nb + bj].push_back(r - offsets[bi]);
+      cols[bi * nb + bj].push_back(c - offsets[bj]);
+      vals[bi * nb + bj].push_back(values[k]);
+      if (symmetric && bi != bj)
+      {
+        rows[bj * nb + bi].push_back(c - offsets[bj]);
+        cols[bj * nb + bi].push_back(r - offsets[bi]);
+        vals[bj * nb + bi].push_back(values[k]);
+      }
+    }
+  }
+
+  // Stable counting sort by rows.
+  for (int bi = 0; bi < nb; bi++)
+    for (int bj = 0; bj < nb; bj++)
+    {
+      int b = bi * nb + bj;
+      int nrows = get_block_size(bi);
+      int nnz = rows[b].size();
+      std::vector<int> ptr(nrows + 1, 0), idx(nnz);
+      std::vector<double> val(nnz);
+      for (int k = 0; k < nnz; k++)
+        ptr[rows[b][k] + 1]++;
+      for (int i = 0; i < nrows; i++)
+        ptr[i + 1] += ptr[i];
+      std::vector<int> next(ptr.begin(), ptr.end() - 1);
+      for (int k = 0; k < nnz; k++)
+      {
+        int pos = next[rows[b][k]]++;
+        idx[pos] = cols[b][k];
+        val[pos] = vals[b][k];
+      }
+
+      if (bi == bj)
+      {
+        diagonal[bi].create(nrows, &ptr[0], idx.empty() ? NULL : &idx[0], symmetric);
+        std::copy(val.begin(), val.end(), diagonal[bi].get_values());
+      }
+      else
+      {
+        MatrixBlock& block = blocks[b];
+        block.rows = nrows;
+        block.cols = get_block_size(bj);
+        block.row_ptr.swap(ptr);
+        block.col_idx.swap(idx);
+        block.values.swap(val);
+      }
+    }
+}
+
+size_t BlockMatrixView::get_memory_size() const
+{
+  size_t size = 0;
+  for (unsigned int i = 0; i < diagonal.size(); i++)
+    size += diagonal[i].get_memory_size();
+  for (unsigned int b = 0; b < blocks.size(); b++)
+    size += blocks[b].get_memory_size();
+  return size;
+}
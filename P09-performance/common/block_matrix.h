@@ -0,0 +1,65 @@
+#ifndef __P09_BLOCK_MATRIX_H
+#define __P09_BLOCK_MATRIX_H
+
+#include "csr_matrix.h"
+
+/// Rectangular block of a BlockMatrixView in CSR storage, with sorted
+/// column indices.
+struct MatrixBlock
+{
+  MatrixBlock() : rows(0), cols(0) {}
+
+  int rows, cols;
+  std::vector<int> row_ptr, col_idx;
+  std::vector<double> values;
+
+  int get_nnz() const { return (int) col_idx.size(); }
+
+  /// y = A x.
+  void multiply(const double* x, double* y) const;
+
+  /// y -= A x.
+  void multiply_sub(const double* x, double* y) const;
+
+  size_t get_memory_size() const;
+};
+
+/// A matrix of a system of equations split into the blocks (i, j) of its
+/// components. Hermes numbers the DOFs of the spaces one after another, the
+/// block i holds the rows and columns offsets[i] ... offsets[i + 1] - 1
+/// (see get_block_offsets() in hermes_matrix_utils.h).
+///
+/// The diagonal blocks are square CSRMatrix objects, so that the native
+/// solvers and preconditioners can work with them. They keep the symmetric
+/// storage of a symmetric matrix, the blocks below the diagonal are then
+/// the transposes of those above it.
+class BlockMatrixView
+{
+public:
+  BlockMatrixView(const CSRMatrix<double>* matrix, const std::vector<int>& offsets);
+
+  /// Copies the matrix into the blocks, again whenever it changed.
+  void update();
+
+  const CSRMatrix<double>* get_matrix() const { return matrix; }
+
+  int get_num_blocks() const { return (int) offsets.size() - 1; }
+  int get_offset(int i) const { return offsets[i]; }
+  int get_block_size(int i) const { return offsets[i + 1] - offsets[i]; }
+
+  CSRMatrix<double>* get_diagonal_block(int i) { return &diagonal[i]; }
+
+  /// Block (i, j) for i != j, empty if the components are not coupled.
+  const MatrixBlock* get_block(int i, int j) const { return &blocks[i * get_num_blocks() + j]; }
+
+  /// Memory occupied by all blocks in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  const CSRMatrix<double>* matrix;
+  std::vector<int> offsets;
+  std::vector<CSRMatrix<double> > diagonal;
+  std::vector<MatrixBlock> blocks;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "block_preconditioners.h"
+#include "hermes2d.h"
+#include <algorithm>
+
+using namespace Hermes;
+
+const char* get_block_preconditioner_name(BlockPreconditionerType type)
+{
+  switch (type)
+  {
+  case BLOCK_JACOBI: return "block Jacobi";
+  case BLOCK_GAUSS_SEIDEL: return "block Gauss-Seidel";
+  case BLOCK_SCHUR: return "Schur complement";
+  }
+  return "unknown";
+}
+
+// Upper triangle of a square matrix as a symmetric CSRMatrix.
+static void extract_upper(const CSRMatrix<double>* a, CSRMatrix<double>* upper)
+{
+  int n = a->get_size();
+  const int* row_ptr = a->get_row_ptr();
+  const int* col_idx = a->get_col_idx();
+  const double* values = a->get_values();
+  std::vector<int> ptr(n + 1, 0), idx;
+  std::vector<double> val;
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      if (col_idx[k] >= i)
+      {
+        idx.push_back(col_idx[k]);
+        val.push_back(values[k]);
+      }
+    ptr[i + 1] = idx.size();
+  }
+  upper->create(n, &ptr[0], idx.empty() ? NULL : &idx[0], true);
+  std::copy(val.begin(), val.end(), upper->get_values());
+}
+
+BlockPreconditioner::BlockPreconditioner(const std::vector<int>& offsets, BlockPreconditionerType type)
+  : type(type), offsets(offsets), view(NULL), setup_time(0.0)
+{
+  if (offsets.size() < 2)
+    throw Hermes::Exceptions::Exception("BlockPreconditioner needs the offsets of at least one block.");
+  if (type == BLOCK_SCHUR && offsets.size() != 3)
+    throw Hermes::Exceptions::Exception("The Schur complement preconditioner needs two blocks.");
+  for (unsigned int i = 0; i + 1 < offsets.size(); i++)
+    solvers.push_back(new BlockSolver);
+}
+
+BlockPreconditioner::~BlockPreconditioner()
+{
+  for (unsigned int i = 0; i < solvers.size(); i++)
+    delete solvers[i];
+  delete view;
+}
+
+void BlockPreconditioner::set_block_preconditioner(int block, NativePreconditionerType type)
+{
+  delete solvers[block];
+  solvers[block] = new BlockSolver;
+  solvers[block]->type = type;
+}
+
+void BlockPreconditioner::setup_solver(BlockSolver* solver, const CSRMatrix<double>* block)
+{
+  if (block->get_size() == 0)
+    return;
+
+  if (solver->type == NATIVE_PRECOND_NONE)
+  {
+    // The LDL^T solver compares the matrix with the last one and keeps
+    // the factorization if the block did not change.
+    if (block->is_symmetric())
+      solver->matrix = *block;
+    else
+      extract_upper(block, &solver->matrix);
+    if (solver->ldlt == NULL)
+      solver->ldlt = new LDLTSolver(&solver->matrix, NULL);
+    if (!solver->ldlt->setup())
+      throw Hermes::Exceptions::Exception("Zero pivot in the LDL^T factorization of a block.");
+    return;
+  }
+
+  solver->matrix = *block;
+  if (solver->precond == NULL)
+  {
+    solver->precond = create_native_preconditioner(solver->type);
+    solver->op = new CSRMatrixOperator(&solver->matrix);
+  }
+  solver->precond->setup(solver->op);
+}
+
+void BlockPreconditioner::solve_block(BlockSolver* solver, const double* b, double* x)
+{
+  if (solver->matrix.get_size() == 0)
+    return;
+  if (solver->ldlt != NULL)
+    solver->ldlt->substitute(b, x);
+  else
+    solver->precond->apply(b, x);
+}
+
+void BlockPreconditioner::build_schur_complement()
+{
+  const CSRMatrix<double>* a00 = view->get_diagonal_block(0);
+  const CSRMatrix<double>* a11 = view->get_diagonal_block(1);
+  const MatrixBlock* a01 = view->get_block(0, 1);
+  const MatrixBlock* a10 = view->get_block(1, 0);
+  int n0 = a00->get_size();
+  int n1 = a11->get_size();
+
+  std::vector<double> inv_diag(n0);
+  for (int i = 0; i < n0; i++)
+  {
+    double d = a00->get(i, i);
+    inv_diag[i] = (d != 0.0) ? 1.0 / d : 0.0;
+  }
+
+  // Rows of A_11 in full, also from symmetric storage.
+  std::vector<std::vector<std::pair<int, double> > > rows(n1);
+  const int* row_ptr = a11->get_row_ptr();
+  const int* col_idx = a11->get_col_idx();
+  const double* values = a11->get_values();
+  for (int i = 0; i < n1; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      rows[i].push_back(std::make_pair(col_idx[k], values[k]));
+      if (a11->is_symmetric() && col_idx[k] != i)
+        rows[col_idx[k]].push_back(std::make_pair(i, values[k]));
+    }
+
+  // Row i of S; marker[c] is the position of column c in it, or -1.
+  std::vector<int> ptr(n1 + 1, 0), idx;
+  std::vector<double> val;
+  std::vector<int> marker(n1, -1);
+  std::vector<std::pair<int, double> > row;
+  for (int i = 0; i < n1; i++)
+  {
+    row = rows[i];
+    for (unsigned int k = 0; k < row.size(); k++)
+      marker[row[k].first] = k;
+    for (int k = a10->row_ptr[i]; k < a10->row_ptr[i + 1]; k++)
+    {
+      int j = a10->col_idx[k];
+      double w = a10->values[k] * inv_diag[j];
+      for (int kk = a01->row_ptr[j]; kk < a01->row_ptr[j + 1]; kk++)
+      {
+        int c = a01->col_idx[kk];
+        if (marker[c] < 0)
+        {
+          marker[c] = row.size();
+          row.push_back(std::make_pair(c, 0.0));
+        }
+        row[marker[c]].second -= w * a01->values[kk];
+      }
+    }
+    for (unsigned int k = 0; k < row.size(); k++)
+      marker[row[k].first] = -1;
+
+    std::sort(row.begin(), row.end());
+    for (unsigned int k = 0; k < row.size(); k++)
+    {
+      idx.push_back(row[k].first);
+      val.push_back(row[k].second);
+    }
+    ptr[i + 1] = idx.size();
+  }
+  schur.create(n1, &ptr[0], idx.empty() ? NULL : &idx[0]);
+  std::copy(val.begin(), val.end(), schur.get_values());
+}
+
+void BlockPreconditioner::setup(LinearOperator* op)
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  const CSRMatrix<double>* matrix = get_operator_matrix(op, "block");
+  if (view == NULL || view->get_matrix() != matrix)
+  {
+    delete view;
+    view = new BlockMatrixView(matrix, offsets);
+  }
+  else
+    view->update();
+
+  for (int i = 0; i < view->get_num_blocks(); i++)
+  {
+    if (type == BLOCK_SCHUR && i == 1)
+    {
+      build_schur_complement();
+      setup_solver(solvers[i], &schur);
+    }
+    else
+      setup_solver(solvers[i], view->get_diagonal_block(i));
+  }
+  work.resize(matrix->get_size());
+  work2.resize(matrix->get_size());
+
+  setup_time = timer.tick().last();
+}
+
+void BlockPreconditioner::apply(const double* r, double* z)
+{
+  int nb = view->get_num_blocks();
+  if (type == BLOCK_JACOBI)
+  {
+    for (int i = 0; i < nb; i++)
+      solve_block(solvers[i], r + offsets[i], z + offsets[i]);
+    return;
+  }
+
+  if (type == BLOCK_GAUSS_SEIDEL)
+  {
+    for (int i = 0; i < nb; i++)
+    {
+      std::copy(r + offsets[i], r + offsets[i + 1], work.begin());
+      for (int j = 0; j < i; j++)
+        view->get_block(i, j)->multiply_sub(z + offsets[j], &work[0]);
+      solve_block(solvers[i], &work[0], z + offsets[i]);
+    }
+    return;
+  }
+
+  // [A_00 A_01; A_10 A_11] = [I 0; A_10 A_00^{-1} I] [A_00 0; 0 S] [I A_00^{-1} A_01; 0 I].
+  double* z0 = z;
+  double* z1 = z + offsets[1];
+  solve_block(solvers[0], r, z0);
+  std::copy(r + offsets[1], r + offsets[2], work.begin());
+  view->get_block(1, 0)->multiply_sub(z0, &work[0]);
+  solve_block(solvers[1], &work[0], z1);
+  view->get_block(0, 1)->multiply(z1, &work2[0]);
+  solve_block(solvers[0], &work2[0], &work[0]);
+  for (int i = 0; i < offsets[1]; i++)
+    z0[i] -= work[i];
+}
+
+size_t BlockPreconditioner::get_memory_size() const
+{
+  size_t size = schur.get_memory_size();
+  if (view != NULL)
+    size += view->get_memory_size();
+  for (unsigned int i = 0; i < solvers.size(); i++)
+  {
+    size += solvers[i]->matrix.get_memory_size();
+    if (solvers[i]->ldlt != NULL)
+      size += solvers[i]->ldlt->get_memory_size();
+  }
+  return size;
+}
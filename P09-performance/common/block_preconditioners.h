@@ -0,0 +1,87 @@
+#ifndef __P09_BLOCK_PRECONDITIONERS_H
+#define __P09_BLOCK_PRECONDITIONERS_H
+
+#include "block_matrix.h"
+#include "preconditioners.h"
+#include "ldlt_solver.h"
+
+/// Preconditioners for systems of equations, built from solvers of the
+/// blocks of the components.
+enum BlockPreconditionerType
+{
+  BLOCK_JACOBI,          ///< Diagonal blocks only; symmetric, so it can precondition CG.
+  BLOCK_GAUSS_SEIDEL,    ///< Block lower triangle, z_i = A_ii^{-1} (r_i - sum_{j<i} A_ij z_j).
+  BLOCK_SCHUR            ///< Block LDU factorization of two components with the approximate Schur
+                         ///< complement S = A_11 - A_10 diag(A_00)^{-1} A_01.
+};
+
+/// Name of the block preconditioner type, for reports.
+const char* get_block_preconditioner_name(BlockPreconditionerType type);
+
+/// Block preconditioner on a BlockMatrixView of an assembled matrix.
+///
+/// Every diagonal block (and the Schur complement, which takes the place
+/// of the block 1 with BLOCK_SCHUR) has its own solver. By default it is
+/// the sparse LDL^T factorization of the upper triangle, which needs a
+/// symmetric block; any native preconditioner can be applied instead, e.g.
+/// the AMG for large blocks or ILU(0) for non-symmetric ones. The solvers
+/// are kept by setup() and factorize again only if their block changed.
+///
+/// BLOCK_GAUSS_SEIDEL and BLOCK_SCHUR are not symmetric, use them with GMRES
+/// or BiCGStab.
+class BlockPreconditioner : public Preconditioner
+{
+public:
+  BlockPreconditioner(const std::vector<int>& offsets, BlockPreconditionerType type = BLOCK_JACOBI);
+  virtual ~BlockPreconditioner();
+
+  virtual void setup(LinearOperator* op);
+  virtual void apply(const double* r, double* z);
+
+  /// Solver of the diagonal block i: NATIVE_PRECOND_NONE (default) for the
+  /// LDL^T factorization, another type for one application of that
+  /// preconditioner.
+  void set_block_preconditioner(int block, NativePreconditionerType type);
+
+  /// The blocks of the last setup().
+  BlockMatrixView* get_view() { return view; }
+
+  /// Memory occupied by the blocks, the Schur complement and the factors
+  /// of the block solvers in bytes.
+  size_t get_memory_size() const;
+
+  /// Wall clock time of the last setup() in seconds.
+  double get_setup_time() const { return setup_time; }
+
+protected:
+  struct BlockSolver
+  {
+    BlockSolver() : type(NATIVE_PRECOND_NONE), ldlt(NULL), precond(NULL), op(NULL) {}
+    ~BlockSolver() { delete ldlt; delete precond; delete op; }
+
+    NativePreconditionerType type;
+    CSRMatrix<double> matrix;          ///< Upper triangle for the LDL^T factorization, else the block.
+    LDLTSolver* ldlt;
+    Preconditioner* precond;
+    CSRMatrixOperator* op;
+  };
+
+  /// Copies the block into the solver and factorizes it.
+  void setup_solver(BlockSolver* solver, const CSRMatrix<double>* block);
+
+  /// x = S^{-1} b with the solver of the block.
+  void solve_block(BlockSolver* solver, const double* b, double* x);
+
+  /// S = A_11 - A_10 diag(A_00)^{-1} A_01.
+  void build_schur_complement();
+
+  BlockPreconditionerType type;
+  std::vector<int> offsets;
+  BlockMatrixView* view;
+  std::vector<BlockSolver*> solvers;
+  CSRMatrix<double> schur;
+  std::vector<double> work, work2;
+  double setup_time;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "complex_kernels.h"
+
+#if defined(WITH_AVX512) || defined(WITH_AVX2)
+#include <immintrin.h>
+#endif
+
+// With a = (ar, ai) and x = (xr, xi) in one register, a * x gives
+// (ar xr, ai xi) and a * swap(x) gives (ar xi, ai xr). The products are
+// summed separately, the real part of the result is the difference of the
+// first pair and the imaginary part the sum of the second one.
+
+#if defined(WITH_AVX512) || defined(WITH_AVX2)
+
+static inline __m128d hsum_halves(__m256d v)
+{
+  return _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+}
+
+void complex_spmv(int size, const int* row_ptr, const int* col_idx, const std::complex<double>* values,
+                  const std::complex<double>* x, std::complex<double>* y)
+{
+  const double* a = reinterpret_cast<const double*>(values);
+  const double* xd = reinterpret_cast<const double*>(x);
+  for (int i = 0; i < size; i++)
+  {
+    __m256d acc_re = _mm256_setzero_pd();
+    __m256d acc_im = _mm256_setzero_pd();
+    int k = row_ptr[i];
+    int end = row_ptr[i + 1];
+    for (; k + 2 <= end; k += 2)
+    {
+      __m256d av = _mm256_loadu_pd(a + 2 * k);
+      __m256d xv = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(xd + 2 * col_idx[k])),
+                                        _mm_loadu_pd(xd + 2 * col_idx[k + 1]), 1);
+      acc_re = _mm256_fmadd_pd(av, xv, acc_re);
+      acc_im = _mm256_fmadd_pd(av, _mm256_permute_pd(xv, 0x5), acc_im);
+    }
+    __m128d re = hsum_halves(acc_re);
+    __m128d im = hsum_halves(acc_im);
+    if (k < end)
+    {
+      __m128d av = _mm_loadu_pd(a + 2 * k);
+      __m128d xv = _mm_loadu_pd(xd + 2 * col_idx[k]);
+      re = _mm_fmadd_pd(av, xv, re);
+      im = _mm_fmadd_pd(av, _mm_shuffle_pd(xv, xv, 0x1), im);
+    }
+    double* yd = reinterpret_cast<double*>(y + i);
+    yd[0] = _mm_cvtsd_f64(_mm_sub_sd(re, _mm_unpackhi_pd(re, re)));
+    yd[1] = _mm_cvtsd_f64(_mm_add_sd(im, _mm_unpackhi_pd(im, im)));
+  }
+}
+
+std::complex<double> complex_dotc(int n, const std::complex<double>* a, const std::complex<double>* b)
+{
+  // conj(a) b = (ar br + ai bi, ar bi - ai br).
+  const double* ad = reinterpret_cast<const double*>(a);
+  const double* bd = reinterpret_cast<const double*>(b);
+  __m256d acc_re = _mm256_setzero_pd();
+  __m256d acc_im = _mm256_setzero_pd();
+  int k = 0;
+  for (; k + 2 <= n; k += 2)
+  {
+    __m256d av = _mm256_loadu_pd(ad + 2 * k);
+    __m256d bv = _mm256_loadu_pd(bd + 2 * k);
+    acc_re = _mm256_fmadd_pd(av, bv, acc_re);
+    acc_im = _mm256_fmadd_pd(av, _mm256_permute_pd(bv, 0x5), acc_im);
+  }
+  __m128d re = hsum_halves(acc_re);
+  __m128d im = hsum_halves(acc_im);
+  if (k < n)
+  {
+    __m128d av = _mm_loadu_pd(ad + 2 * k);
+    __m128d bv = _mm_loadu_pd(bd + 2 * k);
+    re = _mm_fmadd_pd(av, bv, re);
+    im = _mm_fmadd_pd(av, _mm_shuffle_pd(bv, bv, 0x1), im);
+  }
+  double sum_re = _mm_cvtsd_f64(_mm_add_sd(re, _mm_unpackhi_pd(re, re)));
+  double sum_im = _mm_cvtsd_f64(_mm_sub_sd(im, _mm_unpackhi_pd(im, im)));
+  return std::complex<double>(sum_re, sum_im);
+}
+
+void complex_axpy(int n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y)
+{
+  // alpha x = (alpha_r xr - alpha_i xi, alpha_r xi + alpha_i xr).
+  const double* xd = reinterpret_cast<const double*>(x);
+  double* yd = reinterpret_cast<double*>(y);
+  __m256d ar = _mm256_set1_pd(alpha.real());
+  __m256d ai = _mm256_setr_pd(-alpha.imag(), alpha.imag(), -alpha.imag(), alpha.imag());
+  int k = 0;
+  for (; k + 2 <= n; k += 2)
+  {
+    __m256d xv = _mm256_loadu_pd(xd + 2 * k);
+    __m256d yv = _mm256_loadu_pd(yd + 2 * k);
+    yv = _mm256_fmadd_pd(ar, xv, yv);
+    yv = _mm256_fmadd_pd(ai, _mm256_permute_pd(xv, 0x5), yv);
+    _mm256_storeu_pd(yd + 2 * k, yv);
+  }
+  for (; k < n; k++)
+  {
+    yd[2 * k] += alpha.real() * xd[2 * k] - alpha.imag() * xd[2 * k + 1];
+    yd[2 * k + 1] += alpha.real() * xd[2 * k + 1] + alpha.imag() * xd[2 * k];
+  }
+}
+
+const char* complex_kernels_isa()
+{
+  return "AVX2";
+}
+
+#else
+
+void complex_spmv(int size, const int* row_ptr, const int* col_idx, const std::complex<double>* values,
+                  const std::complex<double>* x, std::complex<double>* y)
+{
+  const double* a = reinterpret_cast<const double*>(values);
+  const double* xd = reinterpret_cast<const double*>(x);
+  for (int i = 0; i < size; i++)
+  {
+    double rr = 0.0, ii = 0.0, ri = 0.0, ir = 0.0;
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      const double* xc = xd + 2 * col_idx[k];
+      rr += a[2 * k] * xc[0];
+      ii += a[2 * k + 1] * xc[1];
+      ri += a[2 * k] * xc[1];
+      ir += a[2 * k + 1] * xc[0];
+    }
+    y[i] = std::complex<double>(rr - ii, ri + ir);
+  }
+}
+
+std::complex<double> complex_dotc(int n, const std::complex<double>* a, const std::complex<double>* b)
+{
+  const double* ad = reinterpret_cast<const double*>(a);
+  const double* bd = reinterpret_cast<const double*>(b);
+  double re = 0.0, im = 0.0;
+  for (int k = 0; k < n; k++)
+  {
+    re += ad[2 * k] * bd[2 * k] + ad[2 * k + 1] * bd[2 * k + 1];
+    im += ad[2 * k] * bd[2 * k + 1] - ad[2 * k + 1] * bd[2 * k];
+  }
+  return std::complex<double>(re, im);
+}
+
+void complex_axpy(int n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y)
+{
+  const double* xd = reinterpret_cast<const double*>(x);
+  double* yd = reinterpret_cast<double*>(y);
+  for (int k = 0; k < n; k++)
+  {
+    yd[2 * k] += alpha.real() * xd[2 * k] - alpha.imag() * xd[2 * k + 1];
+    yd[2 * k + 1] += alpha.real() * xd[2 * k + 1] + alpha.imag() * xd[2 * k];
+  }
+}
+
+const char* complex_kernels_isa()
+{
+  return "portable";
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __P09_COMPLEX_KERNELS_H
+#define __P09_COMPLEX_KERNELS_H
+
+#include <complex>
+
+/// Kernels of the complex solvers. Complex numbers are stored interleaved
+/// (real and imaginary part next to each other), as std::complex<double>
+/// arrays are, and the kernels work on the real and imaginary parts
+/// directly instead of going through the complex operators.
+///
+/// The kernels use AVX2 instructions, two complex numbers per register, if
+/// the library is built with WITH_AVX2 or WITH_AVX512. Otherwise portable
+/// code is used. Results agree with the complex operators up to rounding.
+
+/// y = A x for a CSR matrix stored in full.
+void complex_spmv(int size, const int* row_ptr, const int* col_idx, const std::complex<double>* values,
+                  const std::complex<double>* x, std::complex<double>* y);
+
+/// sum_i conj(a_i) b_i
+std::complex<double> complex_dotc(int n, const std::complex<double>* a, const std::complex<double>* b);
+
+/// y += alpha x
+void complex_axpy(int n, std::complex<double> alpha, const std::complex<double>* x, std::complex<double>* y);
+
+/// Instruction set the kernels were built for: "AVX2" or "portable".
+const char* complex_kernels_isa();
+
+#endif
@@ -0,0 +1,263 @@
+#include "complex_solvers.h"
+#include "complex_kernels.h"
+#include "lu_solver.h"
+#include "hermes2d.h"
+#include <cmath>
+
+using namespace Hermes;
+
+typedef std::complex<double> cplx;
+
+void ComplexILU0Preconditioner::setup(const CSRMatrix<cplx>* matrix)
+{
+  if (matrix->is_symmetric())
+    throw Hermes::Exceptions::Exception("The ILU(0) preconditioner needs a matrix stored in full.");
+  this->matrix = matrix;
+
+  int n = matrix->get_size();
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+  lu.assign(matrix->get_values(), matrix->get_values() + matrix->get_nnz());
+  diag_pos.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    diag_pos[i] = matrix->find(i, i);
+    if (diag_pos[i] < 0 || lu[diag_pos[i]] == 0.0)
+      throw Hermes::Exceptions::Exception("Zero diagonal entry in row %d in the ILU(0) preconditioner.", i);
+  }
+
+  // The same elimination as in ILU0Preconditioner::setup().
+  pos.assign(n, -1);
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      pos[col_idx[k]] = k;
+    for (int k = row_ptr[i]; k < diag_pos[i]; k++)
+    {
+      int j = col_idx[k];
+      lu[k] /= lu[diag_pos[j]];
+      for (int kk = diag_pos[j] + 1; kk < row_ptr[j + 1]; kk++)
+        if (pos[col_idx[kk]] >= 0)
+          lu[pos[col_idx[kk]]] -= lu[k] * lu[kk];
+    }
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      pos[col_idx[k]] = -1;
+    if (lu[diag_pos[i]] == 0.0)
+      throw Hermes::Exceptions::Exception("Zero pivot in row %d in the ILU(0) preconditioner.", i);
+  }
+}
+
+void ComplexILU0Preconditioner::apply(const cplx* r, cplx* z)
+{
+  int n = matrix->get_size();
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+
+  // L has a unit diagonal.
+  for (int i = 0; i < n; i++)
+  {
+    cplx sum = r[i];
+    for (int k = row_ptr[i]; k < diag_pos[i]; k++)
+      sum -= lu[k] * z[col_idx[k]];
+    z[i] = sum;
+  }
+  for (int i = n - 1; i >= 0; i--)
+  {
+    cplx sum = z[i];
+    for (int k = diag_pos[i] + 1; k < row_ptr[i + 1]; k++)
+      sum -= lu[k] * z[col_idx[k]];
+    z[i] = sum / lu[diag_pos[i]];
+  }
+}
+
+size_t ComplexILU0Preconditioner::get_memory_size() const
+{
+  return lu.size() * sizeof(cplx) + diag_pos.size() * sizeof(int);
+}
+
+ComplexGMRESSolver::ComplexGMRESSolver(CSRMatrix<cplx>* matrix, cplx* rhs, int restart)
+  : NativeLinearSolver<cplx>(matrix, rhs), tolerance(1e-10), max_iterations(10000), num_iterations(0),
+    residual_norm(0.0), precond_type(NATIVE_PRECOND_ILU0)
+{
+  set_restart(restart);
+}
+
+void ComplexGMRESSolver::set_restart(int restart)
+{
+  if (restart < 1)
+    throw Hermes::Exceptions::Exception("The restart of GMRES must be positive.");
+  this->restart = restart;
+}
+
+void ComplexGMRESSolver::set_preconditioner(NativePreconditionerType precond_type)
+{
+  if (precond_type != NATIVE_PRECOND_NONE && precond_type != NATIVE_PRECOND_JACOBI
+      && precond_type != NATIVE_PRECOND_ILU0)
+    throw Hermes::Exceptions::Exception("The %s preconditioner is not available for complex matrices.",
+                                        get_native_preconditioner_name(precond_type));
+  this->precond_type = precond_type;
+  forget_matrix();
+}
+
+void ComplexGMRESSolver::multiply(const cplx* x, cplx* y)
+{
+  if (matrix->is_symmetric())
+    matrix->multiply(x, y);
+  else
+    complex_spmv(matrix->get_size(), matrix->get_row_ptr(), matrix->get_col_idx(), matrix->get_values(), x, y);
+}
+
+void ComplexGMRESSolver::precondition(const cplx* r, cplx* z)
+{
+  int n = matrix->get_size();
+  if (precond_type == NATIVE_PRECOND_ILU0)
+    ilu.apply(r, z);
+  else if (precond_type == NATIVE_PRECOND_JACOBI)
+    for (int i = 0; i < n; i++)
+      z[i] = inv_diag[i] * r[i];
+  else
+    std::copy(r, r + n, z);
+}
+
+double ComplexGMRESSolver::calc_residual(const cplx* b, const cplx* x, cplx* r)
+{
+  int n = matrix->get_size();
+  multiply(x, r);
+  for (int i = 0; i < n; i++)
+    r[i] = b[i] - r[i];
+  return std::sqrt(complex_dotc(n, r, r).real());
+}
+
+bool ComplexGMRESSolver::solve()
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  int n = matrix->get_size();
+  delete [] sln;
+  sln = new cplx[n];
+  std::fill(sln, sln + n, cplx(0.0));
+  cplx* x = sln;
+
+  // The preconditioner is built again when the matrix changed.
+  if (check_matrix() != NATIVE_REUSE_FACTORIZATION_COMPLETELY)
+  {
+    if (precond_type == NATIVE_PRECOND_ILU0)
+      ilu.setup(matrix);
+    else if (precond_type == NATIVE_PRECOND_JACOBI)
+    {
+      inv_diag.resize(n);
+      for (int i = 0; i < n; i++)
+      {
+        cplx d = matrix->get(i, i);
+        inv_diag[i] = (d != 0.0) ? 1.0 / d : cplx(1.0);
+      }
+    }
+    num_factorizations++;
+  }
+
+  int m = restart;
+  v.resize(m + 1);
+  for (int j = 0; j <= m; j++)
+    v[j].resize(n);
+  h.resize((m + 1) * m);
+  cs.resize(m);
+  sn.resize(m);
+  g.resize(m + 1);
+  y.resize(m);
+  w.resize(n);
+  z.resize(n);
+
+  double b_norm = std::sqrt(complex_dotc(n, rhs, rhs).real());
+  double stop = tolerance * (b_norm > 0.0 ? b_norm : 1.0);
+  double beta = calc_residual(rhs, x, &v[0][0]);
+  residual_norm = beta;
+  num_iterations = 0;
+
+  while (beta > stop && num_iterations < max_iterations)
+  {
+    for (int i = 0; i < n; i++)
+      v[0][i] /= beta;
+    std::fill(g.begin(), g.end(), cplx(0.0));
+    g[0] = beta;
+
+    // Arnoldi process as in GMRESSolver::solve(). The complex Givens
+    // rotation [conj(c) conj(s); -s c] with |c|^2 + |s|^2 = 1 eliminates
+    // h(k + 1, k), which is real.
+    int k = 0;
+    while (k < m && num_iterations < max_iterations)
+    {
+      precondition(&v[k][0], &z[0]);
+      multiply(&z[0], &w[0]);
+      for (int i = 0; i <= k; i++)
+      {
+        cplx hik = complex_dotc(n, &v[i][0], &w[0]);
+        h[i * m + k] = hik;
+        complex_axpy(n, -hik, &v[i][0], &w[0]);
+      }
+      double h_next = std::sqrt(complex_dotc(n, &w[0], &w[0]).real());
+      if (h_next > 0.0)
+        for (int l = 0; l < n; l++)
+          v[k + 1][l] = w[l] / h_next;
+
+      for (int i = 0; i < k; i++)
+      {
+        cplx temp = std::conj(cs[i]) * h[i * m + k] + std::conj(sn[i]) * h[(i + 1) * m + k];
+        h[(i + 1) * m + k] = -sn[i] * h[i * m + k] + cs[i] * h[(i + 1) * m + k];
+        h[i * m + k] = temp;
+      }
+      double denom = std::sqrt(std::norm(h[k * m + k]) + h_next * h_next);
+      if (denom == 0.0)
+      {
+        time = timer.tick().last();
+        return false;
+      }
+      cs[k] = h[k * m + k] / denom;
+      sn[k] = h_next / denom;
+      h[k * m + k] = denom;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] *= std::conj(cs[k]);
+
+      k++;
+      num_iterations++;
+      residual_norm = std::abs(g[k]);
+      if (residual_norm <= stop || h_next == 0.0)
+        break;
+    }
+
+    // x += M^{-1} V y, where H y = g.
+    for (int i = k - 1; i >= 0; i--)
+    {
+      cplx sum = g[i];
+      for (int j = i + 1; j < k; j++)
+        sum -= h[i * m + j] * y[j];
+      y[i] = sum / h[i * m + i];
+    }
+    std::fill(w.begin(), w.end(), cplx(0.0));
+    for (int j = 0; j < k; j++)
+      complex_axpy(n, y[j], &v[j][0], &w[0]);
+    precondition(&w[0], &z[0]);
+    for (int l = 0; l < n; l++)
+      x[l] += z[l];
+
+    // The restart starts from the true residual.
+    beta = calc_residual(rhs, x, &v[0][0]);
+    residual_norm = beta;
+  }
+
+  time = timer.tick().last();
+  return residual_norm <= stop;
+}
+
+NativeLinearSolver<cplx>* create_native_complex_solver(NativeSolverType type, CSRMatrix<cplx>* matrix, cplx* rhs)
+{
+  switch (type)
+  {
+  case NATIVE_SOLVER_LU: return new LUSolver<cplx>(matrix, rhs);
+  case NATIVE_SOLVER_GMRES: return new ComplexGMRESSolver(matrix, rhs);
+  default:
+    throw Hermes::Exceptions::Exception("The %s solver is not available for complex matrices.",
+                                        get_native_solver_name(type));
+  }
+  return NULL;
+}
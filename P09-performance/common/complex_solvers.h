@@ -0,0 +1,91 @@
+#ifndef __P09_COMPLEX_SOLVERS_H
+#define __P09_COMPLEX_SOLVERS_H
+
+#include "native_solvers.h"
+#include "preconditioners.h"
+
+/// Native solvers for complex matrices, e.g. of time-harmonic problems
+/// assembled by DiscreteProblem<std::complex<double> > and imported by
+/// import_hermes_matrix(). They work in complex arithmetic with the
+/// interleaved storage of std::complex<double> (see complex_kernels.h),
+/// no real equivalent system of twice the size is formed.
+
+/// ILU(0) of a complex matrix stored in full, as ILU0Preconditioner.
+class ComplexILU0Preconditioner
+{
+public:
+  ComplexILU0Preconditioner() : matrix(NULL) {}
+
+  /// Factorizes the matrix, again whenever its values change.
+  void setup(const CSRMatrix<std::complex<double> >* matrix);
+
+  /// z = (LU)^{-1} r. The arrays do not overlap.
+  void apply(const std::complex<double>* r, std::complex<double>* z);
+
+  /// Memory occupied by the factors in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  const CSRMatrix<std::complex<double> >* matrix;
+  std::vector<std::complex<double> > lu;
+  std::vector<int> diag_pos;
+  std::vector<int> pos;
+};
+
+/// Restarted GMRES(m) for complex matrices, preconditioned from the right,
+/// as GMRESSolver. The matrix may use symmetric storage (complex symmetric,
+/// not Hermitian, matrices) unless ILU(0) is used. The preconditioner is
+/// built again in solve() when the matrix changed, the factorization scheme
+/// applies to it. The iteration starts from zero.
+class ComplexGMRESSolver : public NativeLinearSolver<std::complex<double> >
+{
+public:
+  ComplexGMRESSolver(CSRMatrix<std::complex<double> >* matrix, std::complex<double>* rhs, int restart = 30);
+
+  virtual bool solve();
+
+  /// NATIVE_PRECOND_NONE, NATIVE_PRECOND_JACOBI or NATIVE_PRECOND_ILU0 (default).
+  void set_preconditioner(NativePreconditionerType precond_type);
+  NativePreconditionerType get_preconditioner_type() const { return precond_type; }
+
+  /// Relative tolerance of the residual norm (default 1e-10), iteration
+  /// limit (default 10000) and restart (default 30).
+  void set_tolerance(double tolerance) { this->tolerance = tolerance; }
+  void set_max_iterations(int max_iterations) { this->max_iterations = max_iterations; }
+  void set_restart(int restart);
+
+  /// Iterations and residual norm of the last solve().
+  int get_num_iterations() const { return num_iterations; }
+  double get_residual_norm() const { return residual_norm; }
+
+protected:
+  /// y = A x.
+  void multiply(const std::complex<double>* x, std::complex<double>* y);
+
+  /// z = M^{-1} r.
+  void precondition(const std::complex<double>* r, std::complex<double>* z);
+
+  /// r = b - A x, returns the norm of r.
+  double calc_residual(const std::complex<double>* b, const std::complex<double>* x, std::complex<double>* r);
+
+  int restart;
+  double tolerance;
+  int max_iterations;
+  int num_iterations;
+  double residual_norm;
+
+  NativePreconditionerType precond_type;
+  ComplexILU0Preconditioner ilu;
+  std::vector<std::complex<double> > inv_diag;
+
+  std::vector<std::vector<std::complex<double> > > v;
+  std::vector<std::complex<double> > h, cs, sn, g, y, w, z;
+};
+
+/// Creates a native solver of a complex matrix: NATIVE_SOLVER_LU or
+/// NATIVE_SOLVER_GMRES (with ILU(0)).
+NativeLinearSolver<std::complex<double> >* create_native_complex_solver(NativeSolverType type,
+                                                                        CSRMatrix<std::complex<double> >* matrix,
+                                                                        std::complex<double>* rhs);
+
+#endif
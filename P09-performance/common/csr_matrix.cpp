@@ -0,0 +1,169 @@
+#include "csr_matrix.h"
+#include <algorithm>
+#include <cmath>
+
+template<typename Scalar>
+CSRMatrix<Scalar>::CSRMatrix() : size(0), symmetric(false)
+{
+}
+
+template<typename Scalar>
+void CSRMatrix<Scalar>::create(int size, const int* row_ptr, const int* col_idx, bool symmetric)
+{
+  this->size = size;
+  this->symmetric = symmetric;
+  this->row_ptr.assign(row_ptr, row_ptr + size + 1);
+  this->col_idx.assign(col_idx, col_idx + row_ptr[size]);
+  this->values.assign(row_ptr[size], Scalar(0));
+}
+
+template<typename Scalar>
+void CSRMatrix<Scalar>::free()
+{
+  size = 0;
+  symmetric = false;
+  std::vector<int>().swap(row_ptr);
+  std::vector<int>().swap(col_idx);
+  std::vector<Scalar>().swap(values);
+}
+
+template<typename Scalar>
+void CSRMatrix<Scalar>::zero()
+{
+  std::fill(values.begin(), values.end(), Scalar(0));
+}
+
+template<typename Scalar>
+int CSRMatrix<Scalar>::find(int row, int col) const
+{
+  if (symmetric && row > col) std::swap(row, col);
+  if (row < 0 || row >= size || col_idx.empty()) return -1;
+  const int* begin = &col_idx[0] + row_ptr[row];
+  const int* end = &col_idx[0] + row_ptr[row + 1];
+  const int* it = std::lower_bound(begin, end, col);
+  if (it == end || *it != col) return -1;
+  return (int) (it - &col_idx[0]);
+}
+
+template<typename Scalar>
+Scalar CSRMatrix<Scalar>::get(int row, int col) const
+{
+  int pos = find(row, col);
+  return pos < 0 ? Scalar(0) : values[pos];
+}
+
+template<typename Scalar>
+bool CSRMatrix<Scalar>::add(int row, int col, Scalar value)
+{
+  int pos = find(row, col);
+  if (pos < 0) return false;
+  values[pos] += value;
+  return true;
+}
+
+template<typename Scalar>
+void CSRMatrix<Scalar>::multiply(const Scalar* x, Scalar* y) const
+{
+  if (!symmetric)
+  {
+    for (int i = 0; i < size; i++)
+    {
+      Scalar sum = Scalar(0);
+      for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+        sum += values[k] * x[col_idx[k]];
+      y[i] = sum;
+    }
+    return;
+  }
+
+  // Every stored off-diagonal entry also acts as its mirror image.
+  std::fill(y, y + size, Scalar(0));
+  for (int i = 0; i < size; i++)
+  {
+    Scalar sum = Scalar(0);
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      int j = col_idx[k];
+      sum += values[k] * x[j];
+      if (j != i)
+        y[j] += values[k] * x[i];
+    }
+    y[i] += sum;
+  }
+}
+
+template<typename Scalar>
+void CSRMatrix<Scalar>::multiply_transpose(const Scalar* x, Scalar* y) const
+{
+  if (symmetric)
+  {
+    multiply(x, y);
+    return;
+  }
+
+  std::fill(y, y + size, Scalar(0));
+  for (int i = 0; i < size; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      y[col_idx[k]] += values[k] * x[i];
+}
+
+template<typename Scalar>
+size_t CSRMatrix<Scalar>::get_memory_size() const
+{
+  return row_ptr.size() * sizeof(int) + col_idx.size() * sizeof(int) + values.size() * sizeof(Scalar);
+}
+
+template<typename Scalar>
+double relative_difference(const CSRMatrix<Scalar>& a, const CSRMatrix<Scalar>& b)
+{
+  double max_diff = 0.0, max_a = 0.0;
+  for (int i = 0; i < a.get_size(); i++)
+  {
+    for (int k = a.get_row_ptr()[i]; k < a.get_row_ptr()[i + 1]; k++)
+    {
+      int j = a.get_col_idx()[k];
+      max_a = std::max(max_a, (double) std::abs(a.get_values()[k]));
+      max_diff = std::max(max_diff, (double) std::abs(a.get_values()[k] - b.get(i, j)));
+    }
+  }
+  // Entries present only in b.
+  for (int i = 0; i < b.get_size(); i++)
+    for (int k = b.get_row_ptr()[i]; k < b.get_row_ptr()[i + 1]; k++)
+      if (a.find(i, b.get_col_idx()[k]) < 0)
+        max_diff = std::max(max_diff, (double) std::abs(b.get_values()[k]));
+  return max_a > 0.0 ? max_diff / max_a : max_diff;
+}
+
+SparsityPatternBuilder::SparsityPatternBuilder(int size) : rows(size)
+{
+}
+
+void SparsityPatternBuilder::add(int row, int col)
+{
+  rows[row].push_back(col);
+}
+
+void SparsityPatternBuilder::finalize(std::vector<int>& row_ptr, std::vector<int>& col_idx)
+{
+  int size = (int) rows.size();
+  row_ptr.resize(size + 1);
+  row_ptr[0] = 0;
+  for (int i = 0; i < size; i++)
+  {
+    std::sort(rows[i].begin(), rows[i].end());
+    rows[i].erase(std::unique(rows[i].begin(), rows[i].end()), rows[i].end());
+    row_ptr[i + 1] = row_ptr[i] + (int) rows[i].size();
+  }
+  col_idx.resize(row_ptr[size]);
+  for (int i = 0; i < size; i++)
+  {
+    std::copy(rows[i].begin(), rows[i].end(), col_idx.begin() + row_ptr[i]);
+    std::vector<int>().swap(rows[i]);
+  }
+}
+
+template class CSRMatrix<double>;
+template class CSRMatrix<std::complex<double> >;
+template double relative_difference<double>(const CSRMatrix<double>& a, const CSRMatrix<double>& b);
+template double relative_difference<std::complex<double> >(const CSRMatrix<std::complex<double> >& a,
+                                                           const CSRMatrix<std::complex<double> >& b);
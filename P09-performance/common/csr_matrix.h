@@ -0,0 +1,89 @@
+#ifndef __P09_CSR_MATRIX_H
+#define __P09_CSR_MATRIX_H
+
+#include <vector>
+#include <complex>
+
+/// Compressed sparse row matrix used by the native assembly and solver
+/// code of this tutorial part. Column indices are sorted within each row,
+/// so that entries can be located by a binary search. The class does not
+/// depend on Hermes, conversions to Hermes matrices live in hermes_matrix_utils.h.
+///
+/// A symmetric matrix stores the upper triangle only (col >= row). The
+/// entries (row, col) and (col, row) then denote the same stored value,
+/// find(), get() and add() accept either of them.
+template<typename Scalar>
+class CSRMatrix
+{
+public:
+  CSRMatrix();
+
+  /// Allocates the structure given by row pointers (size + 1 entries)
+  /// and sorted column indices. All values are set to zero. The pattern
+  /// of a symmetric matrix must not contain entries below the diagonal.
+  void create(int size, const int* row_ptr, const int* col_idx, bool symmetric = false);
+
+  /// Releases all storage.
+  void free();
+
+  /// Sets all values to zero, keeping the structure.
+  void zero();
+
+  int get_size() const { return size; }
+  int get_nnz() const { return (int) col_idx.size(); }
+  bool is_symmetric() const { return symmetric; }
+
+  const int* get_row_ptr() const { return row_ptr.empty() ? NULL : &row_ptr[0]; }
+  const int* get_col_idx() const { return col_idx.empty() ? NULL : &col_idx[0]; }
+  Scalar* get_values() { return values.empty() ? NULL : &values[0]; }
+  const Scalar* get_values() const { return values.empty() ? NULL : &values[0]; }
+
+  /// Position of the entry (row, col) in the value array, -1 if the entry
+  /// is not part of the sparsity pattern.
+  int find(int row, int col) const;
+
+  /// Value of the entry (row, col), zero if not in the pattern.
+  Scalar get(int row, int col) const;
+
+  /// Adds to an entry that is part of the pattern. Returns false otherwise.
+  bool add(int row, int col, Scalar value);
+
+  /// y = A x.
+  void multiply(const Scalar* x, Scalar* y) const;
+
+  /// y = A^T x, the same as multiply() for symmetric storage.
+  void multiply_transpose(const Scalar* x, Scalar* y) const;
+
+  /// Memory occupied by the structure and values in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  int size;
+  bool symmetric;
+  std::vector<int> row_ptr;
+  std::vector<int> col_idx;
+  std::vector<Scalar> values;
+};
+
+/// Largest entry-wise difference of two matrices over the union of their
+/// patterns, divided by the largest magnitude of an entry of a.
+template<typename Scalar>
+double relative_difference(const CSRMatrix<Scalar>& a, const CSRMatrix<Scalar>& b);
+
+/// Builds a CSR sparsity pattern from (row, col) pairs that are added
+/// in arbitrary order and with repetitions.
+class SparsityPatternBuilder
+{
+public:
+  SparsityPatternBuilder(int size);
+
+  void add(int row, int col);
+
+  /// Sorts and removes duplicates, fills row pointers and column indices.
+  void finalize(std::vector<int>& row_ptr, std::vector<int>& col_idx);
+
+protected:
+  std::vector<std::vector<int> > rows;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "form_order_cache.h"
+
+bool FormOrderKey::operator<(const FormOrderKey& other) const
+{
+  if (form != other.form) return form < other.form;
+  if (mode != other.mode) return mode < other.mode;
+  if (inc != other.inc) return inc < other.inc;
+  return orders < other.orders;
+}
+
+FormOrderCache::FormOrderCache()
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+FormOrderCache::~FormOrderCache()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+bool FormOrderCache::find(const FormOrderKey& key, int& order)
+{
+  pthread_mutex_lock(&mutex);
+  std::map<FormOrderKey, int>::iterator it = orders.find(key);
+  bool found = (it != orders.end());
+  if (found)
+    order = it->second;
+  pthread_mutex_unlock(&mutex);
+  return found;
+}
+
+void FormOrderCache::insert(const FormOrderKey& key, int order)
+{
+  pthread_mutex_lock(&mutex);
+  orders[key] = order;
+  pthread_mutex_unlock(&mutex);
+}
+
+void FormOrderCache::clear()
+{
+  pthread_mutex_lock(&mutex);
+  orders.clear();
+  pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,45 @@
+#ifndef __P09_FORM_ORDER_CACHE_H
+#define __P09_FORM_ORDER_CACHE_H
+
+#include <pthread.h>
+#include <map>
+#include <vector>
+
+/// Identifies the situation in which the integration order of a form is
+/// determined: the form, the element mode, the increase of the order by
+/// a non-constant reference map, and the polynomial orders of all
+/// functions the form's ord() sees (the solution components, which are
+/// the basis and test functions as well, followed by the external
+/// functions).
+struct FormOrderKey
+{
+  bool operator<(const FormOrderKey& other) const;
+
+  int form;
+  int mode;
+  int inc;
+  std::vector<int> orders;
+};
+
+/// Integration orders of the forms of a discrete problem, so that ord()
+/// runs once per key instead of once per element. Lookups may come from
+/// several threads at a time.
+class FormOrderCache
+{
+public:
+  FormOrderCache();
+  ~FormOrderCache();
+
+  /// Stores the order for the key in order and returns true if known.
+  bool find(const FormOrderKey& key, int& order);
+  void insert(const FormOrderKey& key, int order);
+  void clear();
+
+  int get_num_entries() const { return orders.size(); }
+
+protected:
+  std::map<FormOrderKey, int> orders;
+  pthread_mutex_t mutex;
+};
+
+#endif
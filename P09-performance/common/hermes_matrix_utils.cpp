@@ -0,0 +1,70 @@
+#include "hermes_matrix_utils.h"
+
+template<typename Scalar>
+bool import_hermes_matrix(SparseMatrix<Scalar>* src, CSRMatrix<Scalar>* dst)
+{
+  CSCMatrix<Scalar>* csc = dynamic_cast<CSCMatrix<Scalar>*>(src);
+  if (csc == NULL) 
+    return false;
+
+  int size = src->get_size();
+  int* Ap = csc->get_Ap();
+  int* Ai = csc->get_Ai();
+  Scalar* Ax = csc->get_Ax();
+
+  // The CSC arrays of A are the CSR arrays of the transpose, so the
+  // conversion is a transposition by counting. Rows come out sorted.
+  std::vector<int> row_ptr(size + 1, 0);
+  for (int k = 0; k < Ap[size]; k++) 
+    row_ptr[Ai[k] + 1]++;
+  for (int i = 0; i < size; i++) 
+    row_ptr[i + 1] += row_ptr[i];
+
+  std::vector<int> col_idx(Ap[size]);
+  std::vector<int> next(row_ptr.begin(), row_ptr.end() - 1);
+  std::vector<int> position(Ap[size]);
+  for (int col = 0; col < size; col++)
+  {
+    for (int k = Ap[col]; k < Ap[col + 1]; k++)
+    {
+      position[k] = next[Ai[k]]++;
+      col_idx[position[k]] = col;
+    }
+  }
+
+  dst->create(size, &row_ptr[0], col_idx.empty() ? NULL : &col_idx[0]);
+  Scalar* values = dst->get_values();
+  for (int k = 0; k < Ap[size]; k++) 
+    values[position[k]] = Ax[k];
+  return true;
+}
+
+template bool import_hermes_matrix<double>(SparseMatrix<double>* src, CSRMatrix<double>* dst);
+template bool import_hermes_matrix<std::complex<double> >(SparseMatrix<std::complex<double> >* src, 
+                                                          CSRMatrix<std::complex<double> >* dst);
+
+void get_constant_coefficients(Space<double>* space, std::vector<double>& coeffs)
+{
+  coeffs.assign(space->get_num_dofs(), 0.0);
+  Shapeset* shapeset = space->get_shapeset();
+  AsmList<double> al;
+  Element* e;
+  for_all_active_elements(e, space->get_mesh())
+  {
+    space->get_element_assembly_list(e, &al);
+    for (unsigned int v = 0; v < e->nvert; v++)
+    {
+      int index = shapeset->get_vertex_index(v, e->get_mode());
+      for (unsigned int k = 0; k < al.cnt; k++)
+        if (al.idx[k] == index && al.dof[k] >= 0 && al.coef[k] == 1.0)
+          coeffs[al.dof[k]] = 1.0;
+    }
+  }
+}
+
+void get_block_offsets(Hermes::vector<Space<double>*> spaces, std::vector<int>& offsets)
+{
+  offsets.assign(1, 0);
+  for (unsigned int i = 0; i < spaces.size(); i++)
+    offsets.push_back(offsets.back() + spaces[i]->get_num_dofs());
+}
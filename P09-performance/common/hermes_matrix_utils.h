@@ -0,0 +1,28 @@
+#ifndef __P09_HERMES_MATRIX_UTILS_H
+#define __P09_HERMES_MATRIX_UTILS_H
+
+#include "hermes2d.h"
+#include "csr_matrix.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Copies a matrix assembled by Hermes into CSR storage. Only compressed
+/// column matrices (UMFPackMatrix and its relatives) are supported, the
+/// function returns false for other matrix types.
+template<typename Scalar>
+bool import_hermes_matrix(SparseMatrix<Scalar>* src, CSRMatrix<Scalar>* dst);
+
+/// Coefficients of the constant function 1 in the basis of an H1 space,
+/// one per DOF. The hierarchic shapeset represents it by the vertex
+/// functions alone, so vertex DOFs get 1 and all others 0. A vertex DOF is
+/// recognized as the vertex function of an element with coefficient 1,
+/// constrained (hanging) vertices enter with other coefficients.
+void get_constant_coefficients(Space<double>* space, std::vector<double>& coeffs);
+
+/// Offsets of the DOFs of the spaces of a system in the assembled matrix,
+/// offsets[i] ... offsets[i + 1] - 1 belong to spaces[i]. The spaces have
+/// to be numbered one after another, as Space::assign_dofs() does.
+void get_block_offsets(Hermes::vector<Space<double>*> spaces, std::vector<int>& offsets);
+
+#endif
@@ -0,0 +1,75 @@
+#include "iterative_solver.h"
+#include "hermes2d.h"
+
+using namespace Hermes;
+
+IterativeSolver::IterativeSolver(NativeSolverType type, CSRMatrix<double>* matrix, double* rhs)
+  : NativeLinearSolver<double>(matrix, rhs), type(type), op(matrix), precond(NULL), own_precond(true)
+{
+  switch (type)
+  {
+  case NATIVE_SOLVER_CG: krylov = new CGSolver(&op); break;
+  case NATIVE_SOLVER_GMRES: krylov = new GMRESSolver(&op); break;
+  case NATIVE_SOLVER_BICGSTAB: krylov = new BiCGStabSolver(&op); break;
+  default: throw Hermes::Exceptions::Exception("IterativeSolver needs a Krylov method.");
+  }
+  set_preconditioner(type == NATIVE_SOLVER_CG ? NATIVE_PRECOND_SSOR : NATIVE_PRECOND_ILU0);
+}
+
+IterativeSolver::~IterativeSolver()
+{
+  delete krylov;
+  if (own_precond)
+    delete precond;
+}
+
+void IterativeSolver::set_preconditioner(NativePreconditionerType precond_type)
+{
+  if (own_precond)
+    delete precond;
+  this->precond_type = precond_type;
+  precond = create_native_preconditioner(precond_type);
+  own_precond = true;
+  krylov->set_preconditioner(precond);
+  forget_matrix();
+}
+
+void IterativeSolver::set_preconditioner(Preconditioner* precond)
+{
+  if (own_precond)
+    delete this->precond;
+  precond_type = NATIVE_PRECOND_USER;
+  this->precond = precond;
+  own_precond = false;
+  krylov->set_preconditioner(precond);
+  forget_matrix();
+}
+
+void IterativeSolver::set_restart(int restart)
+{
+  GMRESSolver* gmres = dynamic_cast<GMRESSolver*>(krylov);
+  if (gmres != NULL)
+    gmres->set_restart(restart);
+}
+
+bool IterativeSolver::solve()
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  int size = matrix->get_size();
+  delete [] sln;
+  sln = new double[size];
+  std::fill(sln, sln + size, 0.0);
+
+  // The preconditioner is built again when the matrix changed.
+  if (check_matrix() != NATIVE_REUSE_FACTORIZATION_COMPLETELY)
+  {
+    krylov->update_preconditioner();
+    num_factorizations++;
+  }
+  bool converged = krylov->solve(rhs, sln);
+
+  time = timer.tick().last();
+  return converged;
+}
@@ -0,0 +1,54 @@
+#ifndef __P09_ITERATIVE_SOLVER_H
+#define __P09_ITERATIVE_SOLVER_H
+
+#include "native_solvers.h"
+#include "krylov_solvers.h"
+#include "preconditioners.h"
+
+/// A Krylov solver with a preconditioner as a NativeLinearSolver. The
+/// preconditioner is built again in solve() when the matrix changed, the
+/// factorization scheme applies to it. The iteration starts from zero.
+///
+/// The default preconditioner is SSOR for CG, which also works with
+/// symmetric storage, and ILU(0) for GMRES and BiCGStab.
+class IterativeSolver : public NativeLinearSolver<double>
+{
+public:
+  IterativeSolver(NativeSolverType type, CSRMatrix<double>* matrix, double* rhs);
+  virtual ~IterativeSolver();
+
+  virtual bool solve();
+
+  void set_preconditioner(NativePreconditionerType precond_type);
+
+  /// Uses a preconditioner created by the user (NATIVE_PRECOND_USER). It is
+  /// not deleted by the solver.
+  void set_preconditioner(Preconditioner* precond);
+  NativePreconditionerType get_preconditioner_type() const { return precond_type; }
+
+  /// The preconditioner, e.g. to set the parameters of an AMGPreconditioner.
+  Preconditioner* get_preconditioner() { return precond; }
+
+  /// Relative tolerance of the residual norm (default 1e-10) and iteration
+  /// limit (default 10000).
+  void set_tolerance(double tolerance) { krylov->set_tolerance(tolerance); }
+  double get_tolerance() const { return krylov->get_tolerance(); }
+  void set_max_iterations(int max_iterations) { krylov->set_max_iterations(max_iterations); }
+
+  /// Restart of GMRES (default 30), ignored by the other methods.
+  void set_restart(int restart);
+
+  /// Iterations and residual norm of the last solve().
+  int get_num_iterations() const { return krylov->get_num_iterations(); }
+  double get_residual_norm() const { return krylov->get_residual_norm(); }
+
+protected:
+  NativeSolverType type;
+  CSRMatrixOperator op;
+  KrylovSolver* krylov;
+  NativePreconditionerType precond_type;
+  Preconditioner* precond;
+  bool own_precond;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "jfnk_solver.h"
+#include <cmath>
+#include <limits>
+
+void JFNKSolver::FiniteDifferenceJacobian::set_point(int size, double* u, const double* residual)
+{
+  this->size = size;
+  this->u = u;
+  this->residual = residual;
+  u_norm = vector_norm(size, u);
+  u_shifted.resize(size);
+}
+
+void JFNKSolver::FiniteDifferenceJacobian::apply(const double* x, double* y)
+{
+  double x_norm = vector_norm(size, x);
+  if (x_norm == 0.0)
+  {
+    std::fill(y, y + size, 0.0);
+    return;
+  }
+
+  // The step balances the truncation error of the difference against the
+  // rounding error of the residuals.
+  double h = std::sqrt(std::numeric_limits<double>::epsilon()) * (1.0 + u_norm) / x_norm;
+  for (int i = 0; i < size; i++)
+    u_shifted[i] = u[i] + h * x[i];
+  dp->assemble_residual(&u_shifted[0], y);
+  num_assemblies++;
+  for (int i = 0; i < size; i++)
+    y[i] = (y[i] - residual[i]) / h;
+}
+
+void JFNKSolver::FiniteDifferenceJacobian::get_diagonal(double*)
+{
+  throw Hermes::Exceptions::Exception("The finite difference Jacobian has no diagonal, use a preconditioner "
+                                      "discrete problem.");
+}
+
+JFNKSolver::JFNKSolver(NativeDiscreteProblem* dp, NativeDiscreteProblem* precond_dp,
+                       NativePreconditionerType precond_type)
+  : dp(dp), precond_dp(precond_dp), jacobian(dp), precond_op(&precond_matrix), precond(NULL),
+    assembled_precond(NULL), gmres(&jacobian), forcing(NEWTON_FORCING_EISENSTAT_WALKER_2), gmres_tolerance(1e-10),
+    verbose_output(true), sln_vector(NULL), num_iterations(0), num_gmres_iterations(0)
+{
+  if (precond_dp != NULL)
+    precond = create_native_preconditioner(precond_type);
+  if (precond != NULL)
+  {
+    assembled_precond = new AssembledPreconditioner(precond, &precond_op);
+    gmres.set_preconditioner(assembled_precond);
+  }
+  else
+    gmres.set_preconditioner(NULL);
+}
+
+JFNKSolver::~JFNKSolver()
+{
+  delete assembled_precond;
+  delete precond;
+  delete [] sln_vector;
+}
+
+void JFNKSolver::solve(double* coeff_vec, double newton_tol, int newton_max_iter)
+{
+  int ndof = dp->get_num_dofs();
+  if (dp->get_static_condensation())
+    throw Hermes::Exceptions::Exception("JFNKSolver needs a problem without static condensation.");
+  if (precond_dp != NULL && (precond_dp->get_num_dofs() != ndof
+                             || precond_dp->get_dof_ordering() != dp->get_dof_ordering()))
+    throw Hermes::Exceptions::Exception("The preconditioner problem of JFNKSolver does not match the problem.");
+
+  // The iteration works in the numbering of the global system.
+  std::vector<double> coeffs(std::max(1, ndof), 0.0), residual(std::max(1, ndof)), rhs(std::max(1, ndof)),
+    delta(std::max(1, ndof));
+  if (coeff_vec != NULL)
+    dp->get_system_vector(coeff_vec, &coeffs[0]);
+
+  forcing.reset();
+  jacobian.num_assemblies = 0;
+  num_iterations = 0;
+  num_gmres_iterations = 0;
+  while (true)
+  {
+    dp->assemble_residual(&coeffs[0], &residual[0]);
+    jacobian.num_assemblies++;
+    double residual_norm = vector_norm(ndof, &residual[0]);
+    if (verbose_output)
+      info("---- Newton iter %d, ndof %d, residual norm %g", num_iterations + 1, ndof, residual_norm);
+    if (residual_norm < newton_tol)
+      break;
+    if (num_iterations >= newton_max_iter)
+      throw Hermes::Exceptions::Exception("Newton's iteration did not converge.");
+
+    // The preconditioner matrix at the current iterate.
+    if (precond_dp != NULL)
+    {
+      precond_dp->assemble(&coeffs[0], &precond_matrix, NULL);
+      gmres.update_preconditioner();
+    }
+
+    // J delta = -F to the tolerance of the forcing term. The step is taken
+    // if GMRES reduced the linear residual at all.
+    for (int i = 0; i < ndof; i++)
+      rhs[i] = -residual[i];
+    double eta = gmres_tolerance;
+    if (forcing.get_type() != NEWTON_FORCING_NONE)
+      eta = forcing.next(residual_norm, newton_tol);
+    gmres.set_tolerance(eta);
+    jacobian.set_point(ndof, &coeffs[0], &residual[0]);
+    std::fill(delta.begin(), delta.end(), 0.0);
+    bool converged = gmres.solve(&rhs[0], &delta[0]);
+    if (!converged && !(gmres.get_residual_norm() < residual_norm))
+      throw Hermes::Exceptions::Exception("GMRES failed in the Jacobian-free Newton iteration.");
+    forcing.set_linear_residual_norm(gmres.get_residual_norm());
+    num_gmres_iterations += gmres.get_num_iterations();
+    if (verbose_output)
+      info("---- GMRES: %d iterations, tolerance %g.", gmres.get_num_iterations(), eta);
+
+    for (int i = 0; i < ndof; i++)
+      coeffs[i] += delta[i];
+    num_iterations++;
+  }
+
+  delete [] sln_vector;
+  sln_vector = new double[dp->get_num_space_dofs()];
+  dp->get_space_vector(&coeffs[0], sln_vector);
+}
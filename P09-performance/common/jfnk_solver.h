@@ -0,0 +1,114 @@
+#ifndef __P09_JFNK_SOLVER_H
+#define __P09_JFNK_SOLVER_H
+
+#include "native_newton.h"
+#include "krylov_solvers.h"
+
+/// Jacobian-free Newton-Krylov method. The linear systems are solved by
+/// GMRES, whose products with the Jacobian are finite differences of
+/// residual assemblies,
+///
+///   J v ~ (F(u + h v) - F(u)) / h,  h = sqrt(eps) (1 + |u|) / |v|,
+///
+/// so the Jacobian forms of the weak form are never integrated and may be
+/// missing. Every GMRES iteration costs one residual assembly.
+///
+/// GMRES is preconditioned by a matrix assembled from a simpler weak form,
+/// e.g. the Jacobian without the terms of derivatives of coefficients, or
+/// of a linearized or decoupled operator (as PreconditionerForm_0/1 of
+/// P07-trilinos/05-trilinos-coupled). It is assembled once per Newton step
+/// at the current iterate and factorized by the preconditioner of the
+/// given type. Its discrete problem must have the spaces and the DOF
+/// ordering of the problem. Without it GMRES is not preconditioned.
+///
+/// The tolerance of GMRES follows the forcing term, Eisenstat-Walker
+/// choice 2 by default. The discrete problem must not condense bubbles.
+class JFNKSolver
+{
+public:
+  JFNKSolver(NativeDiscreteProblem* dp, NativeDiscreteProblem* precond_dp = NULL,
+             NativePreconditionerType precond_type = NATIVE_PRECOND_ILU0);
+  ~JFNKSolver();
+
+  void set_verbose_output(bool verbose_output) { this->verbose_output = verbose_output; }
+
+  /// Forcing term of GMRES, see NewtonForcing. With NEWTON_FORCING_NONE
+  /// GMRES uses the tolerance of set_gmres_tolerance() (default 1e-10).
+  void set_forcing(NewtonForcingType type) { forcing.set_type(type); }
+  NewtonForcing* get_forcing() { return &forcing; }
+  void set_gmres_tolerance(double gmres_tolerance) { this->gmres_tolerance = gmres_tolerance; }
+
+  /// Restart (default 30) and iteration limit (default 10000) of GMRES.
+  void set_restart(int restart) { gmres.set_restart(restart); }
+  void set_max_gmres_iterations(int max_iterations) { gmres.set_max_iterations(max_iterations); }
+
+  /// Iterates until the Euclidean norm of the residual drops below
+  /// newton_tol, starting from coeff_vec (zero if NULL). Throws an exception
+  /// if the tolerance is not reached in newton_max_iter iterations, or if
+  /// GMRES does not reduce the linear residual. coeff_vec and the solution
+  /// are numbered as the DOFs of the spaces.
+  void solve(double* coeff_vec = NULL, double newton_tol = 1e-8, int newton_max_iter = 100);
+
+  double* get_sln_vector() { return sln_vector; }
+  int get_num_iterations() const { return num_iterations; }
+
+  /// GMRES iterations and residual assemblies of the last solve().
+  int get_num_gmres_iterations() const { return num_gmres_iterations; }
+  int get_num_residual_assemblies() const { return jacobian.num_assemblies; }
+
+protected:
+  /// Finite difference Jacobian at the point u with the residual F(u).
+  class FiniteDifferenceJacobian : public LinearOperator
+  {
+  public:
+    FiniteDifferenceJacobian(NativeDiscreteProblem* dp) : dp(dp), num_assemblies(0) {}
+
+    /// Sets the point, u and F(u) are not copied.
+    void set_point(int size, double* u, const double* residual);
+
+    virtual int get_size() { return size; }
+    virtual void apply(const double* x, double* y);
+
+    /// Not available without the matrix, throws an exception.
+    virtual void get_diagonal(double* diag);
+
+    NativeDiscreteProblem* dp;
+    int size;
+    double* u;
+    const double* residual;
+    double u_norm;
+    std::vector<double> u_shifted;
+    int num_assemblies;
+  };
+
+  /// The preconditioner of the assembled matrix, set up from that matrix
+  /// instead of the operator of GMRES.
+  class AssembledPreconditioner : public Preconditioner
+  {
+  public:
+    AssembledPreconditioner(Preconditioner* precond, CSRMatrixOperator* op) : precond(precond), op(op) {}
+    virtual void setup(LinearOperator*) { precond->setup(op); }
+    virtual void apply(const double* r, double* z) { precond->apply(r, z); }
+
+  protected:
+    Preconditioner* precond;
+    CSRMatrixOperator* op;
+  };
+
+  NativeDiscreteProblem* dp;
+  NativeDiscreteProblem* precond_dp;
+  FiniteDifferenceJacobian jacobian;
+  CSRMatrix<double> precond_matrix;
+  CSRMatrixOperator precond_op;
+  Preconditioner* precond;
+  AssembledPreconditioner* assembled_precond;
+  GMRESSolver gmres;
+  NewtonForcing forcing;
+  double gmres_tolerance;
+  bool verbose_output;
+  double* sln_vector;
+  int num_iterations;
+  int num_gmres_iterations;
+};
+
+#endif
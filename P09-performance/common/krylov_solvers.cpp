@@ -0,0 +1,288 @@
+#include "krylov_solvers.h"
+#include "hermes2d.h"
+#include <cmath>
+
+using namespace Hermes;
+
+static double dot(int n, const double* x, const double* y)
+{
+  double result = 0.0;
+  for (int i = 0; i < n; i++)
+    result += x[i] * y[i];
+  return result;
+}
+
+KrylovSolver::KrylovSolver(LinearOperator* op)
+  : op(op), tolerance(1e-10), max_iterations(10000), precond(&jacobi), precond_valid(false),
+    num_iterations(0), residual_norm(0.0)
+{
+}
+
+void KrylovSolver::set_preconditioner(Preconditioner* precond)
+{
+  this->precond = precond;
+  precond_valid = false;
+}
+
+void KrylovSolver::set_jacobi(bool use_jacobi)
+{
+  set_preconditioner(use_jacobi ? &jacobi : NULL);
+}
+
+void KrylovSolver::prepare()
+{
+  if (precond != NULL && !precond_valid)
+    precond->setup(op);
+  precond_valid = true;
+}
+
+void KrylovSolver::precondition(const double* r, double* z)
+{
+  if (precond != NULL)
+    precond->apply(r, z);
+  else
+    std::copy(r, r + op->get_size(), z);
+}
+
+double KrylovSolver::calc_residual(const double* b, const double* x, double* r)
+{
+  int n = op->get_size();
+  op->apply(x, r);
+  for (int i = 0; i < n; i++)
+    r[i] = b[i] - r[i];
+  return std::sqrt(dot(n, r, r));
+}
+
+double KrylovSolver::calc_stop(const double* b)
+{
+  double b_norm = std::sqrt(dot(op->get_size(), b, b));
+  return tolerance * (b_norm > 0.0 ? b_norm : 1.0);
+}
+
+CGSolver::CGSolver(LinearOperator* op) : KrylovSolver(op)
+{
+}
+
+bool CGSolver::solve(const double* b, double* x)
+{
+  int n = op->get_size();
+  r.resize(n);
+  z.resize(n);
+  p.resize(n);
+  q.resize(n);
+  prepare();
+
+  double stop = calc_stop(b);
+  residual_norm = calc_residual(b, x, &r[0]);
+  num_iterations = 0;
+
+  double rz = 0.0;
+  while (residual_norm > stop && num_iterations < max_iterations)
+  {
+    precondition(&r[0], &z[0]);
+    double rz_new = dot(n, &r[0], &z[0]);
+    if (num_iterations == 0)
+      p = z;
+    else
+    {
+      double beta = rz_new / rz;
+      for (int i = 0; i < n; i++)
+        p[i] = z[i] + beta * p[i];
+    }
+    rz = rz_new;
+
+    op->apply(&p[0], &q[0]);
+    double pq = dot(n, &p[0], &q[0]);
+    if (pq <= 0.0)
+      return false;
+    double alpha = rz / pq;
+    for (int i = 0; i < n; i++)
+    {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+    }
+    residual_norm = std::sqrt(dot(n, &r[0], &r[0]));
+    num_iterations++;
+  }
+  return residual_norm <= stop;
+}
+
+GMRESSolver::GMRESSolver(LinearOperator* op, int restart) : KrylovSolver(op)
+{
+  set_restart(restart);
+}
+
+void GMRESSolver::set_restart(int restart)
+{
+  if (restart < 1)
+    throw Hermes::Exceptions::Exception("The restart of GMRES must be positive.");
+  this->restart = restart;
+}
+
+bool GMRESSolver::solve(const double* b, double* x)
+{
+  int n = op->get_size();
+  int m = restart;
+  v.resize(m + 1);
+  for (int j = 0; j <= m; j++)
+    v[j].resize(n);
+  h.resize((m + 1) * m);
+  cs.resize(m);
+  sn.resize(m);
+  g.resize(m + 1);
+  y.resize(m);
+  w.resize(n);
+  z.resize(n);
+  prepare();
+
+  double stop = calc_stop(b);
+  double beta = calc_residual(b, x, &v[0][0]);
+  residual_norm = beta;
+  num_iterations = 0;
+
+  while (beta > stop && num_iterations < max_iterations)
+  {
+    for (int i = 0; i < n; i++)
+      v[0][i] /= beta;
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = beta;
+
+    // Arnoldi process with modified Gram-Schmidt; the Hessenberg matrix
+    // h(i, j) = h[i * m + j] is reduced to triangular form by Givens
+    // rotations on the fly, |g[k]| is then the residual norm.
+    int k = 0;
+    while (k < m && num_iterations < max_iterations)
+    {
+      precondition(&v[k][0], &z[0]);
+      op->apply(&z[0], &w[0]);
+      for (int i = 0; i <= k; i++)
+      {
+        double hik = dot(n, &w[0], &v[i][0]);
+        h[i * m + k] = hik;
+        for (int l = 0; l < n; l++)
+          w[l] -= hik * v[i][l];
+      }
+      double h_next = std::sqrt(dot(n, &w[0], &w[0]));
+      if (h_next > 0.0)
+        for (int l = 0; l < n; l++)
+          v[k + 1][l] = w[l] / h_next;
+
+      for (int i = 0; i < k; i++)
+      {
+        double temp = cs[i] * h[i * m + k] + sn[i] * h[(i + 1) * m + k];
+        h[(i + 1) * m + k] = -sn[i] * h[i * m + k] + cs[i] * h[(i + 1) * m + k];
+        h[i * m + k] = temp;
+      }
+      double denom = std::sqrt(h[k * m + k] * h[k * m + k] + h_next * h_next);
+      if (denom == 0.0)
+        return false;
+      cs[k] = h[k * m + k] / denom;
+      sn[k] = h_next / denom;
+      h[k * m + k] = denom;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] *= cs[k];
+
+      k++;
+      num_iterations++;
+      residual_norm = std::abs(g[k]);
+      if (residual_norm <= stop || h_next == 0.0)
+        break;
+    }
+
+    // x += M^{-1} V y, where H y = g.
+    for (int i = k - 1; i >= 0; i--)
+    {
+      double sum = g[i];
+      for (int j = i + 1; j < k; j++)
+        sum -= h[i * m + j] * y[j];
+      y[i] = sum / h[i * m + i];
+    }
+    std::fill(w.begin(), w.end(), 0.0);
+    for (int j = 0; j < k; j++)
+      for (int l = 0; l < n; l++)
+        w[l] += y[j] * v[j][l];
+    precondition(&w[0], &z[0]);
+    for (int l = 0; l < n; l++)
+      x[l] += z[l];
+
+    // The restart starts from the true residual.
+    beta = calc_residual(b, x, &v[0][0]);
+    residual_norm = beta;
+  }
+  return residual_norm <= stop;
+}
+
+BiCGStabSolver::BiCGStabSolver(LinearOperator* op) : KrylovSolver(op)
+{
+}
+
+bool BiCGStabSolver::solve(const double* b, double* x)
+{
+  int n = op->get_size();
+  r.resize(n);
+  r0.resize(n);
+  p.resize(n);
+  v.resize(n);
+  s.resize(n);
+  t.resize(n);
+  p_hat.resize(n);
+  s_hat.resize(n);
+  prepare();
+
+  double stop = calc_stop(b);
+  residual_norm = calc_residual(b, x, &r[0]);
+  r0 = r;
+  num_iterations = 0;
+
+  double rho = 1.0, alpha = 1.0, omega = 1.0;
+  while (residual_norm > stop && num_iterations < max_iterations)
+  {
+    double rho_new = dot(n, &r0[0], &r[0]);
+    if (rho_new == 0.0)
+      return false;
+    if (num_iterations == 0)
+      p = r;
+    else
+    {
+      double beta = (rho_new / rho) * (alpha / omega);
+      for (int i = 0; i < n; i++)
+        p[i] = r[i] + beta * (p[i] - omega * v[i]);
+    }
+    rho = rho_new;
+
+    precondition(&p[0], &p_hat[0]);
+    op->apply(&p_hat[0], &v[0]);
+    double r0v = dot(n, &r0[0], &v[0]);
+    if (r0v == 0.0)
+      return false;
+    alpha = rho / r0v;
+    for (int i = 0; i < n; i++)
+      s[i] = r[i] - alpha * v[i];
+    num_iterations++;
+
+    // Half a step may be enough.
+    double s_norm = std::sqrt(dot(n, &s[0], &s[0]));
+    if (s_norm <= stop)
+    {
+      for (int i = 0; i < n; i++)
+        x[i] += alpha * p_hat[i];
+      r = s;
+      residual_norm = s_norm;
+      break;
+    }
+
+    precondition(&s[0], &s_hat[0]);
+    op->apply(&s_hat[0], &t[0]);
+    double tt = dot(n, &t[0], &t[0]);
+    omega = (tt > 0.0) ? dot(n, &t[0], &s[0]) / tt : 0.0;
+    for (int i = 0; i < n; i++)
+    {
+      x[i] += alpha * p_hat[i] + omega * s_hat[i];
+      r[i] = s[i] - omega * t[i];
+    }
+    residual_norm = std::sqrt(dot(n, &r[0], &r[0]));
+    if (omega == 0.0)
+      return false;
+  }
+  return residual_norm <= stop;
+}
@@ -0,0 +1,107 @@
+#ifndef __P09_KRYLOV_SOLVERS_H
+#define __P09_KRYLOV_SOLVERS_H
+
+#include "linear_operator.h"
+#include "preconditioners.h"
+#include <vector>
+
+/// Common part of the Krylov solvers. The iteration stops when the residual
+/// norm drops below tolerance times the norm of the right-hand side.
+///
+/// The preconditioner is built from the operator by the first call to
+/// solve(), and again after update_preconditioner(), e.g. when the values
+/// of the operator changed. Jacobi preconditioning is used by default.
+class KrylovSolver
+{
+public:
+  KrylovSolver(LinearOperator* op);
+  virtual ~KrylovSolver() {}
+
+  void set_tolerance(double tolerance) { this->tolerance = tolerance; }
+  double get_tolerance() const { return tolerance; }
+  void set_max_iterations(int max_iterations) { this->max_iterations = max_iterations; }
+
+  /// Preconditioner, NULL for none. The solver does not take ownership.
+  void set_preconditioner(Preconditioner* precond);
+
+  /// Switches between the built-in Jacobi preconditioner and none.
+  void set_jacobi(bool use_jacobi);
+
+  void update_preconditioner() { precond_valid = false; }
+
+  /// Solves A x = b, x holds the initial guess on entry. Returns false if
+  /// the tolerance was not reached.
+  virtual bool solve(const double* b, double* x) = 0;
+
+  int get_num_iterations() const { return num_iterations; }
+  double get_residual_norm() const { return residual_norm; }
+
+protected:
+  /// Builds the preconditioner if needed.
+  void prepare();
+
+  /// z = M^{-1} r, or a copy of r without a preconditioner.
+  void precondition(const double* r, double* z);
+
+  /// r = b - A x, returns the norm of r.
+  double calc_residual(const double* b, const double* x, double* r);
+
+  /// Tolerance for the residual norm.
+  double calc_stop(const double* b);
+
+  LinearOperator* op;
+  double tolerance;
+  int max_iterations;
+  JacobiPreconditioner jacobi;
+  Preconditioner* precond;
+  bool precond_valid;
+  int num_iterations;
+  double residual_norm;
+};
+
+/// Conjugate gradient method for symmetric positive definite operators.
+/// The preconditioner must be symmetric positive definite as well.
+class CGSolver : public KrylovSolver
+{
+public:
+  CGSolver(LinearOperator* op);
+
+  virtual bool solve(const double* b, double* x);
+
+protected:
+  std::vector<double> r, z, p, q;
+};
+
+/// Restarted GMRES(m) for general operators, preconditioned from the right,
+/// so the residual it minimizes is the residual of the original system.
+/// Every iteration stores one more vector, up to m of them.
+class GMRESSolver : public KrylovSolver
+{
+public:
+  GMRESSolver(LinearOperator* op, int restart = 30);
+
+  void set_restart(int restart);
+
+  virtual bool solve(const double* b, double* x);
+
+protected:
+  int restart;
+  std::vector<std::vector<double> > v;
+  std::vector<double> h, cs, sn, g, y, w, z;
+};
+
+/// BiCGStab for general operators, preconditioned from the right. Its
+/// memory does not grow with the iterations, but the convergence is not
+/// monotone and the method can break down.
+class BiCGStabSolver : public KrylovSolver
+{
+public:
+  BiCGStabSolver(LinearOperator* op);
+
+  virtual bool solve(const double* b, double* x);
+
+protected:
+  std::vector<double> r, r0, p, v, s, t, p_hat, s_hat;
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include "ldlt_solver.h"
+#include "sparse_ordering.h"
+#include "hermes2d.h"
+#include <limits>
+
+using namespace Hermes;
+
+LDLTSolver::LDLTSolver(CSRMatrix<double>* matrix, double* rhs)
+  : NativeLinearSolver<double>(matrix, rhs), analyzed(false), single_precision(false), reordering(true), size(0), nnz(0),
+    num_analyses(0)
+{
+}
+
+void LDLTSolver::set_single_precision(bool single_precision)
+{
+  this->single_precision = single_precision;
+  analyzed = false;
+  forget_matrix();
+}
+
+void LDLTSolver::set_reordering(bool reordering)
+{
+  this->reordering = reordering;
+  analyzed = false;
+  forget_matrix();
+}
+
+void LDLTSolver::analyze()
+{
+  if (!matrix->is_symmetric())
+    throw Hermes::Exceptions::Exception("LDLTSolver needs a symmetric matrix.");
+
+  size = matrix->get_size();
+  nnz = matrix->get_nnz();
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+
+  if (reordering)
+    rcm_ordering(size, row_ptr, col_idx, perm);
+  else
+  {
+    perm.resize(size);
+    for (int i = 0; i < size; i++)
+      perm[i] = i;
+  }
+  invert_permutation(perm, pinv);
+
+  // The entry (i, j) of the upper triangle goes to the column
+  // max(pinv[i], pinv[j]) of the reordered upper triangle. amap remembers
+  // where every stored value of the matrix goes.
+  ap.assign(size + 1, 0);
+  for (int i = 0; i < size; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      ap[std::max(pinv[i], pinv[col_idx[k]]) + 1]++;
+  for (int j = 0; j < size; j++)
+    ap[j + 1] += ap[j];
+  ai.resize(nnz);
+  amap.resize(nnz);
+  std::vector<int> pos(ap.begin(), ap.end() - 1);
+  for (int i = 0; i < size; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      int pi = pinv[i], pj = pinv[col_idx[k]];
+      int col = std::max(pi, pj);
+      ai[pos[col]] = std::min(pi, pj);
+      amap[k] = pos[col]++;
+    }
+
+  // Elimination tree and column counts of L.
+  parent.assign(size, -1);
+  std::vector<int> flag(size), lnz(size, 0);
+  for (int k = 0; k < size; k++)
+  {
+    flag[k] = k;
+    for (int p = ap[k]; p < ap[k + 1]; p++)
+    {
+      int i = ai[p];
+      for (; i < k && flag[i] != k; i = parent[i])
+      {
+        if (parent[i] == -1)
+          parent[i] = k;
+        lnz[i]++;
+        flag[i] = k;
+      }
+    }
+  }
+  lp.resize(size + 1);
+  lp[0] = 0;
+  for (int k = 0; k < size; k++)
+    lp[k + 1] = lp[k] + lnz[k];
+  li.resize(lp[size]);
+  if (single_precision)
+  {
+    lx_single.resize(lp[size]);
+    d_single.resize(size);
+    std::vector<double>().swap(lx);
+    std::vector<double>().swap(d);
+  }
+  else
+  {
+    lx.resize(lp[size]);
+    d.resize(size);
+    std::vector<float>().swap(lx_single);
+    std::vector<float>().swap(d_single);
+  }
+
+  analyzed = true;
+}
+
+bool LDLTSolver::factorize()
+{
+  if (single_precision)
+    return factorize_factor(lx_single, d_single);
+  return factorize_factor(lx, d);
+}
+
+template<typename Factor>
+bool LDLTSolver::factorize_factor(std::vector<Factor>& l_values, std::vector<Factor>& diag)
+{
+  const double* values = matrix->get_values();
+  std::vector<Factor> ax(nnz);
+  for (int k = 0; k < nnz; k++)
+    ax[amap[k]] = (Factor) values[k];
+
+  // Row k of L is the solution of a triangular system with the rows
+  // already computed, its pattern follows the elimination tree.
+  std::vector<Factor> y(size, Factor(0));
+  std::vector<int> flag(size), lnz(size, 0), pattern(size);
+  for (int k = 0; k < size; k++)
+  {
+    int top = size;
+    flag[k] = k;
+    for (int p = ap[k]; p < ap[k + 1]; p++)
+    {
+      int i = ai[p];
+      y[i] += ax[p];
+      int len = 0;
+      for (; flag[i] != k; i = parent[i])
+      {
+        pattern[len++] = i;
+        flag[i] = k;
+      }
+      while (len > 0)
+        pattern[--top] = pattern[--len];
+    }
+
+    diag[k] = y[k];
+    y[k] = Factor(0);
+    for (; top < size; top++)
+    {
+      int i = pattern[top];
+      Factor yi = y[i];
+      y[i] = Factor(0);
+      int p2 = lp[i] + lnz[i];
+      for (int p = lp[i]; p < p2; p++)
+        y[li[p]] -= l_values[p] * yi;
+      Factor l_ki = yi / diag[i];
+      diag[k] -= l_ki * yi;
+      li[p2] = k;
+      l_values[p2] = l_ki;
+      lnz[i]++;
+    }
+    // Zero, infinite or NaN, the last two happen in single precision only.
+    if (!(std::abs(diag[k]) > Factor(0) && std::abs(diag[k]) <= std::numeric_limits<Factor>::max()))
+      return false;
+  }
+  return true;
+}
+
+void LDLTSolver::substitute(const double* b, double* x)
+{
+  if (single_precision)
+    substitute_factor(lx_single, d_single, b, x);
+  else
+    substitute_factor(lx, d, b, x);
+}
+
+template<typename Factor>
+void LDLTSolver::substitute_factor(const std::vector<Factor>& l_values, const std::vector<Factor>& diag,
+                                   const double* b, double* x)
+{
+  // The substitution runs in double precision also with a single precision
+  // factor, it costs the same and loses nothing more.
+  std::vector<double> y(size);
+  for (int k = 0; k < size; k++)
+    y[k] = b[perm[k]];
+
+  for (int j = 0; j < size; j++)
+    for (int p = lp[j]; p < lp[j + 1]; p++)
+      y[li[p]] -= l_values[p] * y[j];
+  for (int j = 0; j < size; j++)
+    y[j] /= diag[j];
+  for (int j = size - 1; j >= 0; j--)
+    for (int p = lp[j]; p < lp[j + 1]; p++)
+      y[j] -= l_values[p] * y[li[p]];
+
+  for (int k = 0; k < size; k++)
+    x[perm[k]] = y[k];
+}
+
+void LDLTSolver::substitute_block(const double* b, double* x, int num_rhs)
+{
+  if (single_precision)
+    substitute_block_factor(lx_single, d_single, b, x, num_rhs);
+  else
+    substitute_block_factor(lx, d, b, x, num_rhs);
+}
+
+template<typename Factor>
+void LDLTSolver::substitute_block_factor(const std::vector<Factor>& l_values, const std::vector<Factor>& diag,
+                                         const double* b, double* x, int num_rhs)
+{
+  // The right-hand sides are interleaved, y[k * m + c] is the row k of the
+  // case c, so an entry of the factor updates m contiguous values.
+  int m = num_rhs;
+  std::vector<double> y((size_t) size * m);
+  for (int k = 0; k < size; k++)
+    for (int c = 0; c < m; c++)
+      y[(size_t) k * m + c] = b[(size_t) c * size + perm[k]];
+
+  for (int j = 0; j < size; j++)
+  {
+    const double* yj = &y[(size_t) j * m];
+    for (int p = lp[j]; p < lp[j + 1]; p++)
+    {
+      double l = l_values[p];
+      double* yi = &y[(size_t) li[p] * m];
+      for (int c = 0; c < m; c++)
+        yi[c] -= l * yj[c];
+    }
+  }
+  for (int j = 0; j < size; j++)
+  {
+    double dj = diag[j];
+    for (int c = 0; c < m; c++)
+      y[(size_t) j * m + c] /= dj;
+  }
+  for (int j = size - 1; j >= 0; j--)
+  {
+    double* yj = &y[(size_t) j * m];
+    for (int p = lp[j]; p < lp[j + 1]; p++)
+    {
+      double l = l_values[p];
+      const double* yi = &y[(size_t) li[p] * m];
+      for (int c = 0; c < m; c++)
+        yj[c] -= l * yi[c];
+    }
+  }
+
+  for (int k = 0; k < size; k++)
+    for (int c = 0; c < m; c++)
+      x[(size_t) c * size + perm[k]] = y[(size_t) k * m + c];
+}
+
+bool LDLTSolver::setup()
+{
+  // The factorization scheme decides what is kept from the last call.
+  NativeFactorizationScheme work = check_matrix();
+  if (work == NATIVE_FACTORIZE_FROM_SCRATCH || !analyzed)
+  {
+    analyze();
+    num_analyses++;
+  }
+  if (work != NATIVE_REUSE_FACTORIZATION_COMPLETELY)
+  {
+    num_factorizations++;
+    if (!factorize())
+    {
+      forget_matrix();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LDLTSolver::solve()
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  if (!setup())
+    return false;
+
+  delete [] sln;
+  sln = new double[size];
+  substitute(rhs, sln);
+
+  time = timer.tick().last();
+  return true;
+}
+
+size_t LDLTSolver::get_memory_size() const
+{
+  return lp.size() * sizeof(int) + li.size() * sizeof(int) + lx.size() * sizeof(double) + d.size() * sizeof(double)
+    + lx_single.size() * sizeof(float) + d_single.size() * sizeof(float);
+}
@@ -0,0 +1,94 @@
+#ifndef __P09_LDLT_SOLVER_H
+#define __P09_LDLT_SOLVER_H
+
+#include "native_solvers.h"
+
+/// Sparse LDL^T factorization of a symmetric matrix stored as its upper
+/// triangle (CSRMatrix::is_symmetric()). The rows and columns are first
+/// renumbered by the reverse Cuthill-McKee ordering to reduce the fill-in
+/// (unless the matrix is already ordered, see set_reordering()), then the
+/// factor is computed row by row along the elimination tree. No
+/// pivoting is done, which is fine for symmetric positive definite matrices
+/// and many indefinite ones. solve() fails on a zero pivot.
+///
+/// The factor can be computed and stored in single precision, which halves
+/// its memory; the solution is then only accurate to about 1e-7 relative
+/// to the condition number, see MixedPrecisionSolver for the refinement.
+class LDLTSolver : public NativeLinearSolver<double>
+{
+public:
+  LDLTSolver(CSRMatrix<double>* matrix, double* rhs);
+
+  virtual bool solve();
+
+  /// Analysis and factorization as in solve() but without a right-hand
+  /// side, for solvers that only call substitute(). Returns false on a
+  /// zero pivot.
+  bool setup();
+
+  /// Ordering and elimination tree, done by solve() whenever the sparsity
+  /// pattern changes (see set_factorization_scheme()).
+  void analyze();
+
+  /// Numerical factorization. Returns false on a zero pivot.
+  bool factorize();
+
+  /// Forward and backward substitution with the current factor, x may
+  /// be the same array as b.
+  void substitute(const double* b, double* x);
+
+  /// Substitution for num_rhs right-hand sides at once, stored one after
+  /// the other (column c of b starts at b + c * n). Every entry of the
+  /// factor is read once for all of them. x may be the same array as b.
+  void substitute_block(const double* b, double* x, int num_rhs);
+
+  /// Computes and stores the factor in single precision (default false).
+  void set_single_precision(bool single_precision);
+  bool is_single_precision() const { return single_precision; }
+
+  /// Renumber the matrix by reverse Cuthill-McKee (default), or factorize it
+  /// in its own numbering, e.g. when the discrete problem ordered the DOFs
+  /// (NativeDiscreteProblem::set_dof_ordering()).
+  void set_reordering(bool reordering);
+  bool get_reordering() const { return reordering; }
+
+  /// Analyses done by solve() so far.
+  int get_num_analyses() const { return num_analyses; }
+
+  /// Number of nonzeros of the factor L (without the diagonal).
+  int get_factor_nnz() const { return lp.empty() ? 0 : lp.back(); }
+
+  /// Memory occupied by the factor in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  /// Numerical factorization and substitution in the precision of the factor.
+  template<typename Factor>
+  bool factorize_factor(std::vector<Factor>& l_values, std::vector<Factor>& diag);
+  template<typename Factor>
+  void substitute_factor(const std::vector<Factor>& l_values, const std::vector<Factor>& diag, const double* b,
+                         double* x);
+  template<typename Factor>
+  void substitute_block_factor(const std::vector<Factor>& l_values, const std::vector<Factor>& diag,
+                               const double* b, double* x, int num_rhs);
+
+  bool analyzed;
+  bool single_precision;
+  bool reordering;
+  int size;
+  int nnz;
+  int num_analyses;
+
+  /// perm[k] is the original index of the row k of the reordered matrix.
+  std::vector<int> perm, pinv;
+
+  /// Upper triangle of the reordered matrix, by columns.
+  std::vector<int> ap, ai, amap;
+
+  /// Elimination tree and factor; column j of L holds the rows li[lp[j]...].
+  std::vector<int> parent, lp, li;
+  std::vector<double> lx, d;
+  std::vector<float> lx_single, d_single;
+};
+
+#endif
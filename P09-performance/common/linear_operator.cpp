@@ -0,0 +1,16 @@
+#include "linear_operator.h"
+#include <cmath>
+
+void CSRMatrixOperator::get_diagonal(double* diag)
+{
+  for (int i = 0; i < matrix->get_size(); i++)
+    diag[i] = matrix->get(i, i);
+}
+
+double vector_norm(int n, const double* x)
+{
+  double result = 0.0;
+  for (int i = 0; i < n; i++)
+    result += x[i] * x[i];
+  return std::sqrt(result);
+}
@@ -0,0 +1,42 @@
+#ifndef __P09_LINEAR_OPERATOR_H
+#define __P09_LINEAR_OPERATOR_H
+
+#include "csr_matrix.h"
+
+/// Square linear operator given by its action y = A x. Iterative solvers
+/// of this tutorial part only use this interface, so they work with
+/// assembled matrices and with matrix-free operators alike.
+class LinearOperator
+{
+public:
+  virtual ~LinearOperator() {}
+
+  virtual int get_size() = 0;
+
+  /// y = A x. The arrays hold get_size() entries and do not overlap.
+  virtual void apply(const double* x, double* y) = 0;
+
+  /// Diagonal of A, e.g. for Jacobi preconditioning.
+  virtual void get_diagonal(double* diag) = 0;
+};
+
+/// An assembled CSRMatrix as a LinearOperator.
+class CSRMatrixOperator : public LinearOperator
+{
+public:
+  CSRMatrixOperator(const CSRMatrix<double>* matrix) : matrix(matrix) {}
+
+  virtual int get_size() { return matrix->get_size(); }
+  virtual void apply(const double* x, double* y) { matrix->multiply(x, y); }
+  virtual void get_diagonal(double* diag);
+
+  const CSRMatrix<double>* get_matrix() const { return matrix; }
+
+protected:
+  const CSRMatrix<double>* matrix;
+};
+
+/// Euclidean norm of a vector of n entries.
+double vector_norm(int n, const double* x);
+
+#endif
@@ -0,0 +1,271 @@
+#include "lu_solver.h"
+#include "sparse_ordering.h"
+#include "hermes2d.h"
+
+using namespace Hermes;
+
+template<typename Scalar>
+LUSolver<Scalar>::LUSolver(CSRMatrix<Scalar>* matrix, Scalar* rhs)
+  : NativeLinearSolver<Scalar>(matrix, rhs), analyzed(false), size(0), num_analyses(0), pivot_threshold(0.1)
+{
+}
+
+template<typename Scalar>
+void LUSolver<Scalar>::set_pivot_threshold(double pivot_threshold)
+{
+  if (pivot_threshold <= 0.0 || pivot_threshold > 1.0)
+    throw Hermes::Exceptions::Exception("The pivot threshold must lie in (0, 1].");
+  this->pivot_threshold = pivot_threshold;
+  this->forget_matrix();
+}
+
+template<typename Scalar>
+void LUSolver<Scalar>::analyze()
+{
+  if (this->matrix->is_symmetric())
+    throw Hermes::Exceptions::Exception("LUSolver needs a matrix stored in full.");
+
+  size = this->matrix->get_size();
+  rcm_ordering(size, this->matrix->get_row_ptr(), this->matrix->get_col_idx(), q);
+  analyzed = true;
+}
+
+template<typename Scalar>
+bool LUSolver<Scalar>::factorize()
+{
+  const int* row_ptr = this->matrix->get_row_ptr();
+  const int* col_idx = this->matrix->get_col_idx();
+  const Scalar* values = this->matrix->get_values();
+
+  lp.assign(size + 1, 0);
+  up.assign(size + 1, 0);
+  li.clear();
+  lx.clear();
+  ui.clear();
+  ux.clear();
+  pinv.assign(size, -1);
+
+  // x is the dense work column. The nonzero pattern of column k of L and U
+  // is the set of rows reachable from the pattern of the column of A^T in
+  // the graph of the columns of L computed so far; the depth-first search
+  // leaves it in reach[top ... size - 1] in topological order.
+  std::vector<Scalar> x(size, Scalar(0));
+  std::vector<int> reach(size), stack(size), next(size), mark(size, -1);
+  for (int k = 0; k < size; k++)
+  {
+    int col = q[k];
+    int top = size;
+    for (int p = row_ptr[col]; p < row_ptr[col + 1]; p++)
+    {
+      if (mark[col_idx[p]] == k)
+        continue;
+      int head = 0;
+      stack[0] = col_idx[p];
+      while (head >= 0)
+      {
+        int j = stack[head];
+        int jnew = pinv[j];
+        if (mark[j] != k)
+        {
+          mark[j] = k;
+          next[head] = (jnew < 0) ? 0 : lp[jnew];
+        }
+        int end = (jnew < 0) ? 0 : lp[jnew + 1];
+        int p2 = next[head];
+        for (; p2 < end; p2++)
+          if (mark[li[p2]] != k)
+            break;
+        if (p2 < end)
+        {
+          next[head] = p2 + 1;
+          stack[++head] = li[p2];
+        }
+        else
+        {
+          head--;
+          reach[--top] = j;
+        }
+      }
+    }
+
+    // Triangular solve with the columns of L in the reach.
+    for (int p = row_ptr[col]; p < row_ptr[col + 1]; p++)
+      x[col_idx[p]] = values[p];
+    for (int t = top; t < size; t++)
+    {
+      int j = reach[t];
+      int jnew = pinv[j];
+      if (jnew < 0)
+        continue;
+      Scalar xj = x[j];
+      for (int p = lp[jnew]; p < lp[jnew + 1]; p++)
+        x[li[p]] -= lx[p] * xj;
+    }
+
+    // Rows pivoted before go to U, the others are pivot candidates.
+    int ipiv = -1;
+    double amax = 0.0;
+    for (int t = top; t < size; t++)
+    {
+      int i = reach[t];
+      if (pinv[i] < 0)
+      {
+        double a = std::abs(x[i]);
+        if (a > amax)
+        {
+          amax = a;
+          ipiv = i;
+        }
+      }
+      else
+      {
+        ui.push_back(pinv[i]);
+        ux.push_back(x[i]);
+      }
+    }
+    if (ipiv < 0)
+      return false;
+    if (pinv[col] < 0 && std::abs(x[col]) >= pivot_threshold * amax)
+      ipiv = col;
+
+    Scalar pivot = x[ipiv];
+    ui.push_back(k);
+    ux.push_back(pivot);
+    pinv[ipiv] = k;
+    for (int t = top; t < size; t++)
+    {
+      int i = reach[t];
+      if (pinv[i] < 0)
+      {
+        li.push_back(i);
+        lx.push_back(x[i] / pivot);
+      }
+      x[i] = Scalar(0);
+    }
+    lp[k + 1] = li.size();
+    up[k + 1] = ui.size();
+  }
+
+  // Rows of L in the pivot order.
+  for (unsigned int p = 0; p < li.size(); p++)
+    li[p] = pinv[li[p]];
+  return true;
+}
+
+template<typename Scalar>
+void LUSolver<Scalar>::substitute(const Scalar* b, Scalar* x)
+{
+  // P A^T Q = L U, so A = Q U^T L^T P.
+  std::vector<Scalar> y(size);
+  for (int k = 0; k < size; k++)
+    y[k] = b[q[k]];
+
+  for (int k = 0; k < size; k++)
+  {
+    Scalar sum = y[k];
+    for (int p = up[k]; p < up[k + 1] - 1; p++)
+      sum -= ux[p] * y[ui[p]];
+    y[k] = sum / ux[up[k + 1] - 1];
+  }
+  for (int k = size - 1; k >= 0; k--)
+  {
+    Scalar sum = y[k];
+    for (int p = lp[k]; p < lp[k + 1]; p++)
+      sum -= lx[p] * y[li[p]];
+    y[k] = sum;
+  }
+
+  for (int i = 0; i < size; i++)
+    x[i] = y[pinv[i]];
+}
+
+template<typename Scalar>
+void LUSolver<Scalar>::substitute_block(const Scalar* b, Scalar* x, int num_rhs)
+{
+  // As substitute() with interleaved right-hand sides, y[k * m + c] is the
+  // row k of the case c.
+  int m = num_rhs;
+  std::vector<Scalar> y((size_t) size * m);
+  for (int k = 0; k < size; k++)
+    for (int c = 0; c < m; c++)
+      y[(size_t) k * m + c] = b[(size_t) c * size + q[k]];
+
+  for (int k = 0; k < size; k++)
+  {
+    Scalar* yk = &y[(size_t) k * m];
+    for (int p = up[k]; p < up[k + 1] - 1; p++)
+    {
+      Scalar u = ux[p];
+      const Scalar* yi = &y[(size_t) ui[p] * m];
+      for (int c = 0; c < m; c++)
+        yk[c] -= u * yi[c];
+    }
+    Scalar diag = ux[up[k + 1] - 1];
+    for (int c = 0; c < m; c++)
+      yk[c] /= diag;
+  }
+  for (int k = size - 1; k >= 0; k--)
+  {
+    Scalar* yk = &y[(size_t) k * m];
+    for (int p = lp[k]; p < lp[k + 1]; p++)
+    {
+      Scalar l = lx[p];
+      const Scalar* yi = &y[(size_t) li[p] * m];
+      for (int c = 0; c < m; c++)
+        yk[c] -= l * yi[c];
+    }
+  }
+
+  for (int i = 0; i < size; i++)
+    for (int c = 0; c < m; c++)
+      x[(size_t) c * size + i] = y[(size_t) pinv[i] * m + c];
+}
+
+template<typename Scalar>
+bool LUSolver<Scalar>::setup()
+{
+  // The factorization scheme decides what is kept from the last call.
+  NativeFactorizationScheme work = this->check_matrix();
+  if (work == NATIVE_FACTORIZE_FROM_SCRATCH || !analyzed)
+  {
+    analyze();
+    num_analyses++;
+  }
+  if (work != NATIVE_REUSE_FACTORIZATION_COMPLETELY)
+  {
+    this->num_factorizations++;
+    if (!factorize())
+    {
+      this->forget_matrix();
+      return false;
+    }
+  }
+  return true;
+}
+
+template<typename Scalar>
+bool LUSolver<Scalar>::solve()
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  if (!setup())
+    return false;
+
+  delete [] this->sln;
+  this->sln = new Scalar[size];
+  substitute(this->rhs, this->sln);
+
+  this->time = timer.tick().last();
+  return true;
+}
+
+template<typename Scalar>
+size_t LUSolver<Scalar>::get_memory_size() const
+{
+  return (lp.size() + li.size() + up.size() + ui.size() + pinv.size() + q.size()) * sizeof(int)
+    + (lx.size() + ux.size()) * sizeof(Scalar);
+}
+
+template class LUSolver<double>;
+template class LUSolver<std::complex<double> >;
@@ -0,0 +1,77 @@
+#ifndef __P09_LU_SOLVER_H
+#define __P09_LU_SOLVER_H
+
+#include "native_solvers.h"
+
+/// Sparse LU factorization of a general matrix stored in full, for real
+/// and complex matrices. The columns are renumbered by the reverse
+/// Cuthill-McKee ordering, then the factor is computed column by column
+/// (left-looking, Gilbert-Peierls) with threshold partial pivoting. The
+/// factorized matrix is A^T, whose columns are the CSR rows of A, so no
+/// transposed copy of the matrix is needed.
+///
+/// The diagonal entry is kept as the pivot as long as it is not much
+/// smaller than the largest candidate, which preserves the fill-reducing
+/// ordering for the diagonally dominant matrices of finite elements.
+/// solve() fails if a column has no nonzero pivot.
+template<typename Scalar>
+class LUSolver : public NativeLinearSolver<Scalar>
+{
+public:
+  LUSolver(CSRMatrix<Scalar>* matrix, Scalar* rhs);
+
+  virtual bool solve();
+
+  /// Analysis and factorization as in solve() but without a right-hand
+  /// side. Returns false if the matrix is singular.
+  bool setup();
+
+  /// Column ordering, done by solve() whenever the sparsity pattern
+  /// changes (see set_factorization_scheme()).
+  void analyze();
+
+  /// Numerical factorization with pivoting. Returns false if the matrix is
+  /// singular.
+  bool factorize();
+
+  /// Forward and backward substitution with the current factors, x may be
+  /// the same array as b.
+  void substitute(const Scalar* b, Scalar* x);
+
+  /// Substitution for num_rhs right-hand sides at once, stored one after
+  /// the other (column c of b starts at b + c * n). Every entry of the
+  /// factors is read once for all of them. x may be the same array as b.
+  void substitute_block(const Scalar* b, Scalar* x, int num_rhs);
+
+  /// Relative pivot threshold in (0, 1] (default 0.1); 1 is plain partial
+  /// pivoting.
+  void set_pivot_threshold(double pivot_threshold);
+
+  /// Analyses done by solve() so far.
+  int get_num_analyses() const { return num_analyses; }
+
+  /// Number of nonzeros of L (without the unit diagonal) and U.
+  int get_factor_nnz() const { return (int) (li.size() + ui.size()); }
+
+  /// Memory occupied by the factors in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  bool analyzed;
+  int size;
+  int num_analyses;
+  double pivot_threshold;
+
+  /// Column k of the factorized matrix is the row q[k] of A.
+  std::vector<int> q;
+
+  /// The row i of A^T was the pivot in the step pinv[i].
+  std::vector<int> pinv;
+
+  /// Factors by columns, L with a unit diagonal, the diagonal of U is the
+  /// last entry of its column.
+  std::vector<int> lp, li, up, ui;
+  std::vector<Scalar> lx, ux;
+};
+
+#endif
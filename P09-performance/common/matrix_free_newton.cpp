@@ -0,0 +1,60 @@
+#include "matrix_free_newton.h"
+#include <cmath>
+
+MatrixFreeNewtonSolver::MatrixFreeNewtonSolver(NativeDiscreteProblem* dp, LinearOperator* jacobian)
+  : dp(dp), jacobian(jacobian), cg(jacobian), verbose_output(true), sln_vector(NULL), num_iterations(0),
+    num_cg_iterations(0)
+{
+}
+
+MatrixFreeNewtonSolver::~MatrixFreeNewtonSolver()
+{
+  delete [] sln_vector;
+}
+
+void MatrixFreeNewtonSolver::solve(double* coeff_vec, double newton_tol, int newton_max_iter)
+{
+  int ndof = dp->get_num_dofs();
+  if (dp->get_dof_ordering() != DOF_ORDERING_NATURAL || dp->get_static_condensation())
+    throw Hermes::Exceptions::Exception("The matrix-free Newton solver needs the DOF numbering of the spaces.");
+  if (jacobian->get_size() != ndof)
+    throw Hermes::Exceptions::Exception("The size of the Jacobian operator does not match the discrete problem.");
+
+  delete [] sln_vector;
+  sln_vector = new double[ndof];
+  for (int i = 0; i < ndof; i++)
+    sln_vector[i] = (coeff_vec != NULL) ? coeff_vec[i] : 0.0;
+
+  std::vector<double> residual(ndof), delta(ndof);
+  cg.update_preconditioner();
+  num_iterations = 0;
+  num_cg_iterations = 0;
+  while (true)
+  {
+    dp->assemble_residual(sln_vector, &residual[0]);
+    double residual_norm = 0.0;
+    for (int i = 0; i < ndof; i++)
+      residual_norm += residual[i] * residual[i];
+    residual_norm = std::sqrt(residual_norm);
+    if (verbose_output)
+      info("---- Newton iter %d, ndof %d, residual norm %g", num_iterations + 1, ndof, residual_norm);
+    if (residual_norm < newton_tol)
+      break;
+    if (num_iterations >= newton_max_iter)
+      throw Hermes::Exceptions::Exception("Newton's iteration did not converge.");
+
+    // J delta = -F.
+    for (int i = 0; i < ndof; i++)
+      residual[i] = -residual[i];
+    std::fill(delta.begin(), delta.end(), 0.0);
+    if (!cg.solve(&residual[0], &delta[0]))
+      throw Hermes::Exceptions::Exception("CG did not converge in Newton's iteration.");
+    num_cg_iterations += cg.get_num_iterations();
+    if (verbose_output)
+      info("---- CG: %d iterations.", cg.get_num_iterations());
+
+    for (int i = 0; i < ndof; i++)
+      sln_vector[i] += delta[i];
+    num_iterations++;
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef __P09_MATRIX_FREE_NEWTON_H
+#define __P09_MATRIX_FREE_NEWTON_H
+
+#include "native_discrete_problem.h"
+#include "krylov_solvers.h"
+
+/// Newton's method whose linear systems are solved by the conjugate
+/// gradient method with a LinearOperator as the Jacobian, so no matrix is
+/// assembled. The residual is assembled by the NativeDiscreteProblem.
+/// The interface follows Hermes' NewtonSolver.
+///
+/// The operator is used as it is in every iteration. With a
+/// MatrixFreeOperator, i.e., constant coefficients, this is the exact
+/// Jacobian of a linear problem, which then takes one iteration. The
+/// operator works in the numbering of the spaces, so the discrete problem
+/// must neither reorder nor condense the DOFs.
+class MatrixFreeNewtonSolver
+{
+public:
+  MatrixFreeNewtonSolver(NativeDiscreteProblem* dp, LinearOperator* jacobian);
+  ~MatrixFreeNewtonSolver();
+
+  /// Relative tolerance and iteration limit of the inner CG solver.
+  void set_cg_tolerance(double tolerance) { cg.set_tolerance(tolerance); }
+  void set_max_cg_iterations(int max_iterations) { cg.set_max_iterations(max_iterations); }
+
+  void set_verbose_output(bool verbose_output) { this->verbose_output = verbose_output; }
+
+  /// Iterates until the Euclidean norm of the residual drops below
+  /// newton_tol, starting from coeff_vec (zero if NULL). Throws an exception
+  /// if the tolerance is not reached in newton_max_iter iterations.
+  void solve(double* coeff_vec = NULL, double newton_tol = 1e-8, int newton_max_iter = 100);
+
+  double* get_sln_vector() { return sln_vector; }
+  int get_num_iterations() const { return num_iterations; }
+
+  /// CG iterations of all Newton steps of the last solve().
+  int get_num_cg_iterations() const { return num_cg_iterations; }
+
+protected:
+  NativeDiscreteProblem* dp;
+  LinearOperator* jacobian;
+  CGSolver cg;
+  bool verbose_output;
+  double* sln_vector;
+  int num_iterations;
+  int num_cg_iterations;
+};
+
+#endif
@@ -0,0 +1,526 @@
+#include "matrix_free_operator.h"
+#include <algorithm>
+#include <cmath>
+
+// Does a form defined on the given areas apply to the marker?
+static bool form_applies(const Hermes::vector<std::string>& areas, const std::string& marker)
+{
+  for (unsigned int i = 0; i < areas.size(); i++)
+    if (areas[i] == HERMES_ANY || areas[i] == marker)
+      return true;
+  return false;
+}
+
+// Gauss-Legendre rule with n points on (-1, 1).
+static void gauss_legendre(int n, std::vector<double>& pt, std::vector<double>& wt)
+{
+  pt.resize(n);
+  wt.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    // Newton's method for the root of P_n, started from Chebyshev's estimate.
+    double x = -std::cos(M_PI * (i + 0.75) / (n + 0.5));
+    double dp = 1.0;
+    for (int it = 0; it < 100; it++)
+    {
+      double p0 = 1.0, p1 = x;
+      for (int k = 2; k <= n; k++)
+      {
+        double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+        p0 = p1;
+        p1 = p2;
+      }
+      dp = n * (x * p1 - p0) / (x * x - 1.0);
+      double dx = p1 / dp;
+      x -= dx;
+      if (std::abs(dx) < 1e-15)
+        break;
+    }
+    pt[i] = x;
+    wt[i] = 2.0 / ((1.0 - x * x) * dp * dp);
+  }
+}
+
+static void add_coefficients(AffineCoefficients& sum, const AffineCoefficients& c, bool transposed, double factor)
+{
+  for (int a = 0; a < 2; a++)
+    for (int b = 0; b < 2; b++)
+      sum.diffusion[a][b] += factor * (transposed ? c.diffusion[b][a] : c.diffusion[a][b]);
+  sum.advection[0] += factor * c.advection[0];
+  sum.advection[1] += factor * c.advection[1];
+  sum.mass += factor * c.mass;
+}
+
+MatrixFreeOperator::MatrixFreeOperator(const WeakForm<double>* wf, Space<double>* space)
+{
+  spaces.push_back(space);
+  init(wf);
+}
+
+MatrixFreeOperator::MatrixFreeOperator(const WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces)
+  : spaces(spaces)
+{
+  init(wf);
+}
+
+void MatrixFreeOperator::init(const WeakForm<double>* wf)
+{
+  if (wf == NULL)
+    throw Hermes::Exceptions::Exception("Weak form is NULL in MatrixFreeOperator.");
+  if (wf->get_neq() != spaces.size())
+    throw Hermes::Exceptions::Exception("Number of spaces does not match the number of equations in MatrixFreeOperator.");
+  if (!wf->get_mfsurf().empty())
+    throw Hermes::Exceptions::Exception("MatrixFreeOperator does not support surface matrix forms.");
+
+  this->wf = wf;
+  mesh = spaces[0]->get_mesh();
+  ndof = 0;
+  nq = 0;
+  n1 = 0;
+  num_elements = 0;
+
+  Hermes::vector<MatrixFormVol<double>*> mfvol = wf->get_mfvol();
+  for (unsigned int k = 0; k < mfvol.size(); k++)
+  {
+    AffineMatrixForm* affine = dynamic_cast<AffineMatrixForm*>(mfvol[k]);
+    AffineCoefficients c;
+    if (affine == NULL || !affine->get_affine_coefficients(c))
+      throw Hermes::Exceptions::Exception("MatrixFreeOperator needs matrix forms with constant coefficients (AffineMatrixForm).");
+
+    forms.push_back(mfvol[k]);
+    form_coeffs.push_back(c);
+    form_block.push_back(find_block(mfvol[k]->i, mfvol[k]->j));
+    if (mfvol[k]->sym != HERMES_NONSYM && mfvol[k]->i != mfvol[k]->j)
+    {
+      // The transposed block would need the advection term on the test function.
+      if (c.advection[0] != 0.0 || c.advection[1] != 0.0)
+        throw Hermes::Exceptions::Exception("MatrixFreeOperator does not support symmetric advection forms.");
+      form_block_t.push_back(find_block(mfvol[k]->j, mfvol[k]->i));
+    }
+    else
+      form_block_t.push_back(-1);
+  }
+}
+
+int MatrixFreeOperator::find_block(int i, int j)
+{
+  for (unsigned int b = 0; b < blocks.size(); b++)
+    if (blocks[b].i == i && blocks[b].j == j)
+      return b;
+  Block block;
+  block.i = i;
+  block.j = j;
+  blocks.push_back(block);
+  return blocks.size() - 1;
+}
+
+int MatrixFreeOperator::get_size()
+{
+  return Space<double>::get_num_dofs(spaces);
+}
+
+size_t MatrixFreeOperator::get_memory_size() const
+{
+  return fn_start.size() * sizeof(int) + fns.size() * sizeof(TensorFunction)
+         + coeffs.size() * sizeof(AffineCoefficients) + geometry.size() * sizeof(double);
+}
+
+void MatrixFreeOperator::update()
+{
+  int neq = spaces.size();
+  for (int s = 0; s < neq; s++)
+    if (spaces[s]->get_mesh() != mesh)
+      throw Hermes::Exceptions::Exception("All spaces of MatrixFreeOperator must share one mesh.");
+  ndof = get_size();
+
+  std::vector<Element*> elements;
+  Element* e;
+  int p_max = 1;
+  bool affine = true;
+  for_all_active_elements(e, mesh)
+  {
+    if (!e->is_quad() || e->is_curved())
+      throw Hermes::Exceptions::Exception("MatrixFreeOperator needs quadrilaterals with straight edges.");
+    elements.push_back(e);
+    double dx = e->vn[0]->x + e->vn[2]->x - e->vn[1]->x - e->vn[3]->x;
+    double dy = e->vn[0]->y + e->vn[2]->y - e->vn[1]->y - e->vn[3]->y;
+    double h = std::abs(e->vn[2]->x - e->vn[0]->x) + std::abs(e->vn[2]->y - e->vn[0]->y);
+    if (std::abs(dx) + std::abs(dy) > 1e-12 * h)
+      affine = false;
+    for (int s = 0; s < neq; s++)
+    {
+      int order = spaces[s]->get_element_order(e->id);
+      p_max = std::max(p_max, std::max(H2D_GET_H_ORDER(order), H2D_GET_V_ORDER(order)));
+    }
+  }
+  num_elements = elements.size();
+
+  // On parallelograms, products of two functions of degree p are integrated
+  // exactly with p + 1 points. Other quadrilaterals have a rational
+  // integrand, they get one more point. The decompositions are valid for
+  // one rule only.
+  int n = p_max + (affine ? 1 : 2);
+  if (n != nq)
+  {
+    nq = n;
+    gauss_legendre(nq, gauss_pt, gauss_wt);
+    basis_fns.clear();
+    decompositions.clear();
+  }
+
+  // Shape functions of the free DOFs.
+  AsmList<double> al;
+  fn_start.resize(num_elements * neq + 1);
+  fns.clear();
+  for (int k = 0; k < num_elements; k++)
+  {
+    for (int s = 0; s < neq; s++)
+    {
+      fn_start[k * neq + s] = fns.size();
+      spaces[s]->get_element_assembly_list(elements[k], &al);
+      Shapeset* shapeset = spaces[s]->get_shapeset();
+      for (unsigned int l = 0; l < al.cnt; l++)
+      {
+        if (al.dof[l] < 0) continue;
+        TensorFunction tf = decompose(shapeset, al.idx[l]);
+        tf.scale *= al.coef[l];
+        tf.dof = al.dof[l];
+        fns.push_back(tf);
+      }
+    }
+  }
+  fn_start[num_elements * neq] = fns.size();
+
+  n1 = basis_fns.size();
+  basis_val.resize(nq * n1);
+  basis_der.resize(nq * n1);
+  for (int q = 0; q < nq; q++)
+    for (int k = 0; k < n1; k++)
+    {
+      basis_val[q * n1 + k] = basis_fns[k][q];
+      basis_der[q * n1 + k] = basis_fns[k][nq + q];
+    }
+
+  // Coefficients of the blocks.
+  int nb = blocks.size();
+  coeffs.assign(num_elements * nb, AffineCoefficients());
+  for (int k = 0; k < num_elements; k++)
+  {
+    std::string marker = mesh->get_element_markers_conversion().get_user_marker(elements[k]->marker).marker;
+    for (unsigned int f = 0; f < forms.size(); f++)
+    {
+      if (!form_applies(forms[f]->areas, marker)) continue;
+      add_coefficients(coeffs[k * nb + form_block[f]], form_coeffs[f], false, 1.0);
+      if (form_block_t[f] >= 0)
+        add_coefficients(coeffs[k * nb + form_block_t[f]], form_coeffs[f], true, forms[f]->sym);
+    }
+  }
+
+  // Bilinear reference map, the vertices of the reference square are
+  // (-1, -1), (1, -1), (1, 1), (-1, 1).
+  geometry.resize(num_elements * nq * nq * 5);
+  for (int k = 0; k < num_elements; k++)
+  {
+    Node** vn = elements[k]->vn;
+    for (int q1 = 0; q1 < nq; q1++)
+      for (int q2 = 0; q2 < nq; q2++)
+      {
+        double xi = gauss_pt[q1], eta = gauss_pt[q2];
+        double n_xi[4] = { -(1 - eta) / 4, (1 - eta) / 4, (1 + eta) / 4, -(1 + eta) / 4 };
+        double n_eta[4] = { -(1 - xi) / 4, -(1 + xi) / 4, (1 + xi) / 4, (1 - xi) / 4 };
+        double j00 = 0.0, j01 = 0.0, j10 = 0.0, j11 = 0.0;
+        for (int v = 0; v < 4; v++)
+        {
+          j00 += vn[v]->x * n_xi[v];
+          j01 += vn[v]->x * n_eta[v];
+          j10 += vn[v]->y * n_xi[v];
+          j11 += vn[v]->y * n_eta[v];
+        }
+        double det = j00 * j11 - j01 * j10;
+        double* g = &geometry[((k * nq + q1) * nq + q2) * 5];
+        g[0] = gauss_wt[q1] * gauss_wt[q2] * std::abs(det);
+        g[1] = j11 / det;
+        g[2] = -j01 / det;
+        g[3] = -j10 / det;
+        g[4] = j00 / det;
+      }
+  }
+
+  seq.resize(neq);
+  for (int s = 0; s < neq; s++)
+    seq[s] = spaces[s]->get_seq();
+
+  U.resize(n1 * n1);
+  V.resize(n1 * n1);
+  u.resize(nq * nq);
+  u_xi.resize(nq * nq);
+  u_eta.resize(nq * nq);
+  r.resize(nq * nq);
+  f_xi.resize(nq * nq);
+  f_eta.resize(nq * nq);
+  tmp0.resize(nq * n1);
+  tmp1.resize(nq * n1);
+}
+
+MatrixFreeOperator::TensorFunction MatrixFreeOperator::decompose(Shapeset* shapeset, int index)
+{
+  std::pair<int, int> key(shapeset->get_id(), index);
+  std::map<std::pair<int, int>, TensorFunction>::iterator it = decompositions.find(key);
+  if (it != decompositions.end())
+    return it->second;
+
+  std::vector<double> val(nq * nq), dx(nq * nq), dy(nq * nq);
+  int pivot = 0;
+  for (int q1 = 0; q1 < nq; q1++)
+    for (int q2 = 0; q2 < nq; q2++)
+    {
+      int q = q1 * nq + q2;
+      val[q] = shapeset->get_fn_value(index, gauss_pt[q1], gauss_pt[q2], 0, HERMES_MODE_QUAD);
+      dx[q] = shapeset->get_dx_value(index, gauss_pt[q1], gauss_pt[q2], 0, HERMES_MODE_QUAD);
+      dy[q] = shapeset->get_dy_value(index, gauss_pt[q1], gauss_pt[q2], 0, HERMES_MODE_QUAD);
+      if (std::abs(val[q]) > std::abs(val[pivot]))
+        pivot = q;
+    }
+
+  // phi(xi, eta) = a(xi) b(eta), with b = 1 at the pivot.
+  int p1 = pivot / nq, p2 = pivot % nq;
+  double pv = val[pivot];
+  std::vector<double> a(nq), da(nq), b(nq), db(nq);
+  for (int q = 0; q < nq; q++)
+  {
+    a[q] = val[q * nq + p2];
+    da[q] = dx[q * nq + p2];
+    b[q] = val[p1 * nq + q] / pv;
+    db[q] = dy[p1 * nq + q] / pv;
+  }
+
+  double max_val = 0.0, max_dx = 0.0, max_dy = 0.0;
+  double err_val = 0.0, err_dx = 0.0, err_dy = 0.0;
+  for (int q1 = 0; q1 < nq; q1++)
+    for (int q2 = 0; q2 < nq; q2++)
+    {
+      int q = q1 * nq + q2;
+      max_val = std::max(max_val, std::abs(val[q]));
+      max_dx = std::max(max_dx, std::abs(dx[q]));
+      max_dy = std::max(max_dy, std::abs(dy[q]));
+      err_val = std::max(err_val, std::abs(val[q] - a[q1] * b[q2]));
+      err_dx = std::max(err_dx, std::abs(dx[q] - da[q1] * b[q2]));
+      err_dy = std::max(err_dy, std::abs(dy[q] - a[q1] * db[q2]));
+    }
+  if (pv == 0.0 || err_val > 1e-10 * max_val || err_dx > 1e-10 * (1.0 + max_dx) || err_dy > 1e-10 * (1.0 + max_dy))
+    throw Hermes::Exceptions::Exception("Shape function %d is not a tensor product, MatrixFreeOperator needs the H1 shapeset.",
+                                        index);
+
+  TensorFunction tf;
+  double scale_a, scale_b;
+  tf.ix = find_basis_function(a, da, scale_a);
+  tf.iy = find_basis_function(b, db, scale_b);
+  tf.scale = scale_a * scale_b;
+  tf.dof = -1;
+  decompositions[key] = tf;
+  return tf;
+}
+
+int MatrixFreeOperator::find_basis_function(const std::vector<double>& val, const std::vector<double>& der,
+                                            double& scale)
+{
+  std::vector<double> f(val);
+  f.insert(f.end(), der.begin(), der.end());
+  double f_max = 0.0;
+  for (unsigned int q = 0; q < f.size(); q++)
+    f_max = std::max(f_max, std::abs(f[q]));
+
+  for (unsigned int k = 0; k < basis_fns.size(); k++)
+  {
+    const std::vector<double>& g = basis_fns[k];
+    double fg = 0.0, gg = 0.0;
+    for (unsigned int q = 0; q < f.size(); q++)
+    {
+      fg += f[q] * g[q];
+      gg += g[q] * g[q];
+    }
+    double s = fg / gg;
+    double err = 0.0;
+    for (unsigned int q = 0; q < f.size(); q++)
+      err = std::max(err, std::abs(f[q] - s * g[q]));
+    if (err <= 1e-10 * f_max)
+    {
+      scale = s;
+      return k;
+    }
+  }
+
+  basis_fns.push_back(f);
+  scale = 1.0;
+  return basis_fns.size() - 1;
+}
+
+void MatrixFreeOperator::interpolate(const double* U, double* u, double* u_xi, double* u_eta)
+{
+  const double* B = &basis_val[0];
+  const double* D = &basis_der[0];
+
+  // Along xi.
+  for (int q1 = 0; q1 < nq; q1++)
+    for (int iy = 0; iy < n1; iy++)
+    {
+      double t0 = 0.0, t1 = 0.0;
+      for (int ix = 0; ix < n1; ix++)
+      {
+        t0 += B[q1 * n1 + ix] * U[ix * n1 + iy];
+        t1 += D[q1 * n1 + ix] * U[ix * n1 + iy];
+      }
+      tmp0[q1 * n1 + iy] = t0;
+      tmp1[q1 * n1 + iy] = t1;
+    }
+
+  // Along eta.
+  for (int q1 = 0; q1 < nq; q1++)
+    for (int q2 = 0; q2 < nq; q2++)
+    {
+      double v = 0.0, v_xi = 0.0, v_eta = 0.0;
+      for (int iy = 0; iy < n1; iy++)
+      {
+        v += tmp0[q1 * n1 + iy] * B[q2 * n1 + iy];
+        v_xi += tmp1[q1 * n1 + iy] * B[q2 * n1 + iy];
+        v_eta += tmp0[q1 * n1 + iy] * D[q2 * n1 + iy];
+      }
+      u[q1 * nq + q2] = v;
+      u_xi[q1 * nq + q2] = v_xi;
+      u_eta[q1 * nq + q2] = v_eta;
+    }
+}
+
+void MatrixFreeOperator::integrate(const double* r, const double* f_xi, const double* f_eta, double* V)
+{
+  const double* B = &basis_val[0];
+  const double* D = &basis_der[0];
+
+  // Along eta.
+  for (int q1 = 0; q1 < nq; q1++)
+    for (int iy = 0; iy < n1; iy++)
+    {
+      double t0 = 0.0, t1 = 0.0;
+      for (int q2 = 0; q2 < nq; q2++)
+      {
+        int q = q1 * nq + q2;
+        t0 += r[q] * B[q2 * n1 + iy] + f_eta[q] * D[q2 * n1 + iy];
+        t1 += f_xi[q] * B[q2 * n1 + iy];
+      }
+      tmp0[q1 * n1 + iy] = t0;
+      tmp1[q1 * n1 + iy] = t1;
+    }
+
+  // Along xi.
+  for (int ix = 0; ix < n1; ix++)
+    for (int iy = 0; iy < n1; iy++)
+    {
+      double v = 0.0;
+      for (int q1 = 0; q1 < nq; q1++)
+        v += B[q1 * n1 + ix] * tmp0[q1 * n1 + iy] + D[q1 * n1 + ix] * tmp1[q1 * n1 + iy];
+      V[ix * n1 + iy] = v;
+    }
+}
+
+void MatrixFreeOperator::apply(const double* x, double* y)
+{
+  bool changed = (ndof == 0);
+  for (unsigned int s = 0; s < spaces.size() && !changed; s++)
+    changed = (spaces[s]->get_seq() != seq[s]);
+  if (changed)
+    update();
+
+  int neq = spaces.size();
+  int nb = blocks.size();
+  int np = nq * nq;
+  std::fill(y, y + ndof, 0.0);
+  for (int k = 0; k < num_elements; k++)
+  {
+    const double* geom = &geometry[k * np * 5];
+    for (int b = 0; b < nb; b++)
+    {
+      const AffineCoefficients& c = coeffs[k * nb + b];
+      const double (*d)[2] = c.diffusion;
+      const double* adv = c.advection;
+      if (d[0][0] == 0.0 && d[0][1] == 0.0 && d[1][0] == 0.0 && d[1][1] == 0.0
+          && adv[0] == 0.0 && adv[1] == 0.0 && c.mass == 0.0)
+        continue;
+
+      // Solution of the basis space in tensor form.
+      std::fill(U.begin(), U.end(), 0.0);
+      for (int l = fn_start[k * neq + blocks[b].j]; l < fn_start[k * neq + blocks[b].j + 1]; l++)
+        U[fns[l].ix * n1 + fns[l].iy] += fns[l].scale * x[fns[l].dof];
+      interpolate(&U[0], &u[0], &u_xi[0], &u_eta[0]);
+
+      for (int q = 0; q < np; q++)
+      {
+        const double* g = geom + q * 5;
+        // Physical gradient J^{-T} grad u, the flux is D grad u.
+        double gx = g[1] * u_xi[q] + g[3] * u_eta[q];
+        double gy = g[2] * u_xi[q] + g[4] * u_eta[q];
+        double fx = d[0][0] * gx + d[0][1] * gy;
+        double fy = d[1][0] * gx + d[1][1] * gy;
+        f_xi[q] = g[0] * (g[1] * fx + g[2] * fy);
+        f_eta[q] = g[0] * (g[3] * fx + g[4] * fy);
+        r[q] = g[0] * (adv[0] * gx + adv[1] * gy + c.mass * u[q]);
+      }
+
+      integrate(&r[0], &f_xi[0], &f_eta[0], &V[0]);
+      for (int l = fn_start[k * neq + blocks[b].i]; l < fn_start[k * neq + blocks[b].i + 1]; l++)
+        y[fns[l].dof] += fns[l].scale * V[fns[l].ix * n1 + fns[l].iy];
+    }
+  }
+}
+
+void MatrixFreeOperator::get_diagonal(double* diag)
+{
+  bool changed = (ndof == 0);
+  for (unsigned int s = 0; s < spaces.size() && !changed; s++)
+    changed = (spaces[s]->get_seq() != seq[s]);
+  if (changed)
+    update();
+
+  int neq = spaces.size();
+  int nb = blocks.size();
+  const double* B = &basis_val[0];
+  const double* D = &basis_der[0];
+  std::fill(diag, diag + ndof, 0.0);
+  for (int k = 0; k < num_elements; k++)
+  {
+    const double* geom = &geometry[k * nq * nq * 5];
+    for (int b = 0; b < nb; b++)
+    {
+      if (blocks[b].i != blocks[b].j) continue;
+      const AffineCoefficients& c = coeffs[k * nb + b];
+      int first = fn_start[k * neq + blocks[b].i], last = fn_start[k * neq + blocks[b].i + 1];
+
+      // Several functions of an element may belong to one DOF (constrained
+      // nodes), all their pairs contribute.
+      for (int l = first; l < last; l++)
+        for (int m = first; m < last; m++)
+        {
+          if (fns[l].dof != fns[m].dof) continue;
+          const TensorFunction& fu = fns[m];
+          const TensorFunction& fv = fns[l];
+          double sum = 0.0;
+          for (int q1 = 0; q1 < nq; q1++)
+            for (int q2 = 0; q2 < nq; q2++)
+            {
+              const double* g = geom + (q1 * nq + q2) * 5;
+              double u = B[q1 * n1 + fu.ix] * B[q2 * n1 + fu.iy];
+              double u_xi = D[q1 * n1 + fu.ix] * B[q2 * n1 + fu.iy];
+              double u_eta = B[q1 * n1 + fu.ix] * D[q2 * n1 + fu.iy];
+              double v = B[q1 * n1 + fv.ix] * B[q2 * n1 + fv.iy];
+              double v_xi = D[q1 * n1 + fv.ix] * B[q2 * n1 + fv.iy];
+              double v_eta = B[q1 * n1 + fv.ix] * D[q2 * n1 + fv.iy];
+              double ux = g[1] * u_xi + g[3] * u_eta, uy = g[2] * u_xi + g[4] * u_eta;
+              double vx = g[1] * v_xi + g[3] * v_eta, vy = g[2] * v_xi + g[4] * v_eta;
+              sum += g[0] * ((c.diffusion[0][0] * ux + c.diffusion[0][1] * uy) * vx
+                             + (c.diffusion[1][0] * ux + c.diffusion[1][1] * uy) * vy
+                             + (c.advection[0] * ux + c.advection[1] * uy) * v + c.mass * u * v);
+            }
+          diag[fv.dof] += fu.scale * fv.scale * sum;
+        }
+    }
+  }
+}
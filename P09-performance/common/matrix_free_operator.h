@@ -0,0 +1,118 @@
+#ifndef __P09_MATRIX_FREE_OPERATOR_H
+#define __P09_MATRIX_FREE_OPERATOR_H
+
+#include "hermes2d.h"
+#include "linear_operator.h"
+#include "affine_templates.h"
+#include <map>
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Action of the matrix of a weak form without assembling it, for H1 spaces
+/// on meshes of quadrilaterals with straight edges.
+///
+/// The shape functions of Hermes' H1 shapeset on quadrilaterals are products
+/// phi(xi, eta) = a(xi) b(eta) of one-dimensional functions. The operator
+/// evaluates the solution and its gradient at the points of a tensor Gauss
+/// rule with n points per direction by sum factorization: first along xi,
+/// then along eta. This costs O(p^3) operations per element, instead of the
+/// O(p^4) of a local matrix, and only the geometry at the integration
+/// points is stored.
+///
+/// All volumetric matrix forms must implement AffineMatrixForm, that is,
+/// have constant coefficients (per element marker). Surface matrix forms
+/// are not supported. The operator works on the free DOFs, Dirichlet DOFs
+/// are not part of it, exactly as in an assembled matrix.
+class MatrixFreeOperator : public LinearOperator
+{
+public:
+  MatrixFreeOperator(const WeakForm<double>* wf, Space<double>* space);
+  MatrixFreeOperator(const WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces);
+
+  virtual int get_size();
+  virtual void apply(const double* x, double* y);
+  virtual void get_diagonal(double* diag);
+
+  /// Recomputes the geometry and the DOF lists. Called automatically when
+  /// a space changed since the last call.
+  void update();
+
+  /// Number of integration points per direction.
+  int get_num_points() const { return nq; }
+
+  /// Memory occupied by the geometry, the coefficients and the DOF lists
+  /// in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  /// Block (i, j) of the system.
+  struct Block
+  {
+    int i, j;
+  };
+
+  /// A shape function of an element as scale * a_ix(xi) a_iy(eta), with
+  /// the coefficient of the assembly list included in the scale.
+  struct TensorFunction
+  {
+    int ix, iy;
+    double scale;
+    int dof;
+  };
+
+  void init(const WeakForm<double>* wf);
+
+  /// Index of the block (i, j), added if it does not exist yet.
+  int find_block(int i, int j);
+
+  /// Writes the shape function index of the shapeset as a product of two
+  /// functions of basis_val / basis_der.
+  TensorFunction decompose(Shapeset* shapeset, int index);
+
+  /// Index of the one-dimensional function (val, der) in the basis, up to
+  /// a factor that is stored in scale. New functions are added.
+  int find_basis_function(const std::vector<double>& val, const std::vector<double>& der, double& scale);
+
+  /// Values at the integration points of the element from the coefficients
+  /// U[ix * n1 + iy]: u, du/dxi, du/deta.
+  void interpolate(const double* U, double* u, double* u_xi, double* u_eta);
+
+  /// V[ix * n1 + iy] = sum over points of r a_ix a_iy + f_xi a'_ix a_iy + f_eta a_ix a'_iy.
+  void integrate(const double* r, const double* f_xi, const double* f_eta, double* V);
+
+  const WeakForm<double>* wf;
+  Hermes::vector<Space<double>*> spaces;
+  Mesh* mesh;
+  std::vector<int> seq;
+  int ndof;
+
+  /// Forms with their coefficients, their block and the transposed block
+  /// (-1 for nonsymmetric forms and diagonal blocks).
+  std::vector<MatrixFormVol<double>*> forms;
+  std::vector<AffineCoefficients> form_coeffs;
+  std::vector<int> form_block, form_block_t;
+  std::vector<Block> blocks;
+
+  /// One-dimensional Gauss rule and basis functions at its points,
+  /// basis_val[q * n1 + k] is the value of function k at point q.
+  int nq;
+  std::vector<double> gauss_pt, gauss_wt;
+  int n1;
+  std::vector<std::vector<double> > basis_fns;
+  std::vector<double> basis_val, basis_der;
+  std::map<std::pair<int, int>, TensorFunction> decompositions;
+
+  /// Per element: functions of every space, coefficients of every block,
+  /// and at every point the weight times |det J| and the inverse Jacobian.
+  std::vector<int> fn_start;
+  std::vector<TensorFunction> fns;
+  std::vector<AffineCoefficients> coeffs;
+  std::vector<double> geometry;
+  int num_elements;
+
+  /// Work arrays.
+  std::vector<double> U, V, u, u_xi, u_eta, r, f_xi, f_eta, tmp0, tmp1;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "mixed_precision_solver.h"
+#include "hermes2d.h"
+#include <cmath>
+
+using namespace Hermes;
+
+const char* get_mixed_refinement_name(MixedRefinementType type)
+{
+  switch (type)
+  {
+  case MIXED_REFINEMENT_CLASSIC: return "classic";
+  case MIXED_REFINEMENT_GMRES: return "GMRES-IR";
+  }
+  return "unknown";
+}
+
+MixedPrecisionSolver::MixedPrecisionSolver(CSRMatrix<double>* matrix, double* rhs, MixedRefinementType type)
+  : NativeLinearSolver<double>(matrix, rhs), type(type), ldlt(matrix, NULL), op(matrix), factor_precond(&ldlt),
+    gmres(&op), tolerance(1e-12), max_iterations(20), stall_factor(0.5), num_refinements(0),
+    num_inner_iterations(0), residual_norm(0.0), fallen_back(false)
+{
+  ldlt.set_single_precision(true);
+  gmres.set_preconditioner(&factor_precond);
+  gmres.set_tolerance(1e-6);
+}
+
+double MixedPrecisionSolver::calc_residual(const double* x, double* r)
+{
+  int n = matrix->get_size();
+  matrix->multiply(x, r);
+  double norm = 0.0;
+  for (int i = 0; i < n; i++)
+  {
+    r[i] = rhs[i] - r[i];
+    norm += r[i] * r[i];
+  }
+  return std::sqrt(norm);
+}
+
+bool MixedPrecisionSolver::refine(double* x)
+{
+  int n = matrix->get_size();
+  std::vector<double> r(n), dx(n);
+  std::fill(x, x + n, 0.0);
+  double b_norm = calc_residual(x, &r[0]);
+  double scale = (b_norm > 0.0) ? b_norm : 1.0;
+  double norm = b_norm;
+  residual_norm = norm / scale;
+
+  // Every iteration gains about the digits of the single precision
+  // factor, relative to the condition number of the matrix.
+  while (residual_norm > tolerance)
+  {
+    if (num_refinements == max_iterations)
+      return false;
+
+    if (type == MIXED_REFINEMENT_GMRES)
+    {
+      std::fill(dx.begin(), dx.end(), 0.0);
+      gmres.solve(&r[0], &dx[0]);
+      num_inner_iterations += gmres.get_num_iterations();
+    }
+    else
+      ldlt.substitute(&r[0], &dx[0]);
+    for (int i = 0; i < n; i++)
+      x[i] += dx[i];
+
+    double new_norm = calc_residual(x, &r[0]);
+    num_refinements++;
+    residual_norm = new_norm / scale;
+    if (residual_norm > tolerance && !(new_norm <= stall_factor * norm))
+      return false;
+    norm = new_norm;
+  }
+  return true;
+}
+
+bool MixedPrecisionSolver::solve_double(double* x)
+{
+  if (!ldlt.setup())
+    return false;
+  ldlt.substitute(rhs, x);
+
+  std::vector<double> r(matrix->get_size());
+  double b_norm = 0.0;
+  for (int i = 0; i < matrix->get_size(); i++)
+    b_norm += rhs[i] * rhs[i];
+  b_norm = std::sqrt(b_norm);
+  residual_norm = calc_residual(x, &r[0]) / (b_norm > 0.0 ? b_norm : 1.0);
+  return true;
+}
+
+bool MixedPrecisionSolver::solve()
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  delete [] sln;
+  sln = new double[matrix->get_size()];
+  num_refinements = 0;
+  num_inner_iterations = 0;
+
+  // The factorization scheme applies to the factor.
+  ldlt.set_factorization_scheme(factorization_scheme);
+  bool ok = false;
+  if (!fallen_back)
+  {
+    bool factorized = ldlt.setup();
+    ok = factorized && refine(sln);
+    if (!ok)
+    {
+      if (!factorized)
+        warn("Single precision LDL^T factorization failed, factorizing in double precision.");
+      else
+        warn("Mixed precision refinement stalled (residual %g after %d iterations), factorizing in double precision.",
+             residual_norm, num_refinements);
+      fallen_back = true;
+      ldlt.set_single_precision(false);
+      num_refinements = 0;
+    }
+  }
+  if (fallen_back)
+    ok = solve_double(sln);
+  num_factorizations = ldlt.get_num_factorizations();
+
+  time = timer.tick().last();
+  return ok;
+}
@@ -0,0 +1,105 @@
+#ifndef __P09_MIXED_PRECISION_SOLVER_H
+#define __P09_MIXED_PRECISION_SOLVER_H
+
+#include "ldlt_solver.h"
+#include "krylov_solvers.h"
+
+/// How MixedPrecisionSolver computes the corrections of the refinement.
+enum MixedRefinementType
+{
+  MIXED_REFINEMENT_CLASSIC,   ///< d = (LDL^T)^{-1} r with the single precision factor.
+  MIXED_REFINEMENT_GMRES      ///< GMRES on A d = r preconditioned by the factor (GMRES-IR), for
+                              ///< matrices too ill-conditioned for the classic refinement.
+};
+
+/// Name of the refinement type, for reports.
+const char* get_mixed_refinement_name(MixedRefinementType type);
+
+/// Direct solver of a symmetric matrix with half the memory of the factor:
+/// the LDL^T factorization (LDLTSolver) is computed and stored in single
+/// precision, the double precision accuracy is recovered by iterative
+/// refinement with the residual r = b - A x computed with the double
+/// precision matrix.
+///
+/// The refinement stops when the residual norm drops below the tolerance
+/// times the norm of b. If it stalls (the residual norm does not decrease
+/// at least by the stall factor in an iteration) or does not converge in
+/// the iteration limit, or if the single precision factorization fails,
+/// the solver factorizes the matrix in double precision and solves the
+/// system again. It stays in double precision from then on, see
+/// has_fallen_back().
+class MixedPrecisionSolver : public NativeLinearSolver<double>
+{
+public:
+  MixedPrecisionSolver(CSRMatrix<double>* matrix, double* rhs, MixedRefinementType type = MIXED_REFINEMENT_CLASSIC);
+
+  virtual bool solve();
+
+  /// The refinement type, e.g. of a solver from create_native_linear_solver(),
+  /// which uses MIXED_REFINEMENT_CLASSIC.
+  void set_refinement(MixedRefinementType type) { this->type = type; }
+  MixedRefinementType get_refinement() const { return type; }
+
+  /// Relative tolerance of the residual norm (default 1e-12), limit of the
+  /// refinement iterations (default 20) and stall factor (default 0.5).
+  void set_tolerance(double tolerance) { this->tolerance = tolerance; }
+  void set_max_iterations(int max_iterations) { this->max_iterations = max_iterations; }
+  void set_stall_factor(double stall_factor) { this->stall_factor = stall_factor; }
+
+  /// Relative tolerance of GMRES in every refinement iteration of
+  /// MIXED_REFINEMENT_GMRES (default 1e-6).
+  void set_inner_tolerance(double inner_tolerance) { gmres.set_tolerance(inner_tolerance); }
+
+  /// Refinement iterations of the last solve(), 0 after a fallback.
+  int get_num_refinements() const { return num_refinements; }
+
+  /// GMRES iterations of all refinement iterations of the last solve().
+  int get_num_inner_iterations() const { return num_inner_iterations; }
+
+  /// Relative residual norm of the last solve().
+  double get_residual_norm() const { return residual_norm; }
+
+  /// True if the solver switched to the double precision factorization.
+  bool has_fallen_back() const { return fallen_back; }
+
+  /// The LDL^T solver, e.g. for its memory.
+  LDLTSolver* get_ldlt_solver() { return &ldlt; }
+
+protected:
+  /// Iterative refinement from x = 0, returns false if it stalls.
+  bool refine(double* x);
+
+  /// Solve with the double precision factor.
+  bool solve_double(double* x);
+
+  /// r = b - A x, returns the norm of r.
+  double calc_residual(const double* x, double* r);
+
+  /// The single precision factor as a preconditioner of GMRES.
+  class FactorPreconditioner : public Preconditioner
+  {
+  public:
+    FactorPreconditioner(LDLTSolver* ldlt) : ldlt(ldlt) {}
+    virtual void setup(LinearOperator*) {}
+    virtual void apply(const double* r, double* z) { ldlt->substitute(r, z); }
+
+  protected:
+    LDLTSolver* ldlt;
+  };
+
+  MixedRefinementType type;
+  LDLTSolver ldlt;
+  CSRMatrixOperator op;
+  FactorPreconditioner factor_precond;
+  GMRESSolver gmres;
+  double tolerance;
+  int max_iterations;
+  double stall_factor;
+
+  int num_refinements;
+  int num_inner_iterations;
+  double residual_norm;
+  bool fallen_back;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "multi_load_solver.h"
+
+MultiLoadSolver::MultiLoadSolver(NativeDiscreteProblem* dp, NativeSolverType solver_type)
+  : dp(dp), solver_type(solver_type), linear_solver(NULL), factorized(false), matrix_time(0.0), rhs_time(0.0),
+    factorization_time(0.0), substitution_time(0.0)
+{
+  if (solver_type != NATIVE_SOLVER_LDLT && solver_type != NATIVE_SOLVER_LU)
+    throw Hermes::Exceptions::Exception("MultiLoadSolver needs a direct solver, %s was given.",
+                                        get_native_solver_name(solver_type));
+  rhs.resize(std::max(1, dp->get_num_dofs()));
+  linear_solver = create_native_linear_solver(solver_type, &matrix, &rhs[0]);
+}
+
+MultiLoadSolver::~MultiLoadSolver()
+{
+  for (unsigned int c = 0; c < load_cases.size(); c++)
+    delete load_cases[c].dp;
+  delete linear_solver;
+}
+
+int MultiLoadSolver::add_load_case(const WeakForm<double>* wf, Space<double>* space)
+{
+  return add_load_case(wf, Hermes::vector<Space<double>*>(space));
+}
+
+int MultiLoadSolver::add_load_case(const WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces)
+{
+  LoadCase load_case;
+  load_case.dp = new NativeDiscreteProblem(wf, spaces);
+  load_case.dp->set_num_threads(dp->get_num_threads());
+  load_case.dp->set_static_condensation(dp->get_static_condensation());
+  load_case.dp->set_dof_ordering(dp->get_dof_ordering());
+  load_cases.push_back(load_case);
+  return (int) load_cases.size() - 1;
+}
+
+void MultiLoadSolver::solve(bool reassemble_matrix)
+{
+  int ndof = dp->get_num_dofs();
+  int num_cases = load_cases.size();
+  TimePeriod timer;
+
+  // The DOFs of the load cases must be those of the matrix. The orderings
+  // follow from the same graph, so equal numbers of DOFs suffice.
+  for (int c = 0; c < num_cases; c++)
+    if (load_cases[c].dp->get_num_dofs() != ndof
+        || load_cases[c].dp->get_num_space_dofs() != dp->get_num_space_dofs())
+      throw Hermes::Exceptions::Exception("The spaces of the load case %d do not match the problem.", c);
+
+  matrix_time = 0.0;
+  factorization_time = 0.0;
+  if (!factorized || reassemble_matrix)
+  {
+    timer.tick(HERMES_SKIP);
+    dp->assemble(NULL, &matrix, NULL);
+    matrix_time = timer.tick().last();
+
+    timer.tick(HERMES_SKIP);
+    bool success;
+    if (solver_type == NATIVE_SOLVER_LDLT)
+      success = static_cast<LDLTSolver*>(linear_solver)->setup();
+    else
+      success = static_cast<LUSolver<double>*>(linear_solver)->setup();
+    factorization_time = timer.tick().last();
+    if (!success)
+      throw Hermes::Exceptions::Exception("The %s factorization failed in MultiLoadSolver.",
+                                          get_native_solver_name(solver_type));
+    factorized = true;
+  }
+
+  // Right-hand side c occupies block[c * ndof ...].
+  timer.tick(HERMES_SKIP);
+  block.resize(std::max(1, ndof * num_cases));
+  for (int c = 0; c < num_cases; c++)
+    load_cases[c].dp->assemble(NULL, (CSRMatrix<double>*) NULL, &block[(size_t) c * ndof]);
+  rhs_time = timer.tick().last();
+
+  timer.tick(HERMES_SKIP);
+  if (num_cases > 0)
+  {
+    if (solver_type == NATIVE_SOLVER_LDLT)
+      static_cast<LDLTSolver*>(linear_solver)->substitute_block(&block[0], &block[0], num_cases);
+    else
+      static_cast<LUSolver<double>*>(linear_solver)->substitute_block(&block[0], &block[0], num_cases);
+  }
+  substitution_time = timer.tick().last();
+
+  // Bubbles and numbering of the spaces, from the local systems of the
+  // load case.
+  for (int c = 0; c < num_cases; c++)
+  {
+    load_cases[c].sln_vector.resize(std::max(1, load_cases[c].dp->get_num_space_dofs()));
+    load_cases[c].dp->get_space_vector(&block[(size_t) c * ndof], &load_cases[c].sln_vector[0]);
+  }
+}
+
+double* MultiLoadSolver::get_sln_vector(int load_case)
+{
+  if (load_case < 0 || load_case >= (int) load_cases.size() || load_cases[load_case].sln_vector.empty())
+    return NULL;
+  return &load_cases[load_case].sln_vector[0];
+}
@@ -0,0 +1,80 @@
+#ifndef __P09_MULTI_LOAD_SOLVER_H
+#define __P09_MULTI_LOAD_SOLVER_H
+
+#include "native_discrete_problem.h"
+#include "ldlt_solver.h"
+#include "lu_solver.h"
+
+/// Linear problem with several load cases that share one matrix, e.g. a
+/// sweep over source terms and Dirichlet values. The matrix is assembled
+/// and factorized once, the right-hand sides of all cases are assembled
+/// into one block and solved together by the blocked triangular solves of
+/// LDLTSolver::substitute_block() (NATIVE_SOLVER_LDLT, which needs
+/// symmetric storage, see NativeDiscreteProblem::set_symmetric_storage())
+/// or LUSolver::substitute_block() (NATIVE_SOLVER_LU).
+///
+/// A load case is a weak form and its spaces. The vector forms of the weak
+/// form give the sources, the essential boundary conditions of the spaces
+/// the Dirichlet values; its matrix forms must be those of the problem, they
+/// are only integrated for the lift on elements with Dirichlet DOFs. The
+/// spaces must have the DOFs of the spaces of the problem: the same mesh,
+/// degrees and Dirichlet markers, only the values may differ. A load case is
+/// assembled with the threads, static condensation and DOF ordering the
+/// problem has when the case is added.
+class MultiLoadSolver
+{
+public:
+  MultiLoadSolver(NativeDiscreteProblem* dp, NativeSolverType solver_type = NATIVE_SOLVER_LDLT);
+  ~MultiLoadSolver();
+
+  /// Adds a load case, returns its index. The weak form and the spaces are
+  /// not owned.
+  int add_load_case(const WeakForm<double>* wf, Space<double>* space);
+  int add_load_case(const WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces);
+  int get_num_load_cases() const { return (int) load_cases.size(); }
+
+  /// Assembles and solves all load cases. The matrix is assembled and
+  /// factorized by the first call only, unless reassemble_matrix is true
+  /// (e.g. after the problem changed). Throws an exception if the spaces of
+  /// a load case do not match or if the factorization fails.
+  void solve(bool reassemble_matrix = false);
+
+  /// Solution of a load case, numbered as the DOFs of its spaces (for
+  /// Solution::vector_to_solution()).
+  double* get_sln_vector(int load_case);
+
+  /// Times of the last solve(): assembly of the matrix (0 if it was kept),
+  /// of the block of right-hand sides, factorization and substitution.
+  double get_matrix_time() const { return matrix_time; }
+  double get_rhs_time() const { return rhs_time; }
+  double get_factorization_time() const { return factorization_time; }
+  double get_substitution_time() const { return substitution_time; }
+
+  /// The linear solver, e.g. for the size of its factor.
+  NativeLinearSolver<double>* get_linear_solver() { return linear_solver; }
+
+protected:
+  struct LoadCase
+  {
+    NativeDiscreteProblem* dp;
+    std::vector<double> sln_vector;
+  };
+
+  NativeDiscreteProblem* dp;
+  NativeSolverType solver_type;
+  CSRMatrix<double> matrix;
+  std::vector<double> rhs;
+  NativeLinearSolver<double>* linear_solver;
+  bool factorized;
+  std::vector<LoadCase> load_cases;
+
+  /// Right-hand sides and solutions of all cases, one after the other.
+  std::vector<double> block;
+
+  double matrix_time;
+  double rhs_time;
+  double factorization_time;
+  double substitution_time;
+};
+
+#endif
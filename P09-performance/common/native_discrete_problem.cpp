@@ -0,0 +1,1897 @@
+#include "native_discrete_problem.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <new>
+#include <typeinfo>
+
+// Does a form defined on the given areas apply to the marker?
+static bool form_applies(const Hermes::vector<std::string>& areas, const std::string& marker)
+{
+  for (unsigned int i = 0; i < areas.size(); i++)
+    if (areas[i] == HERMES_ANY || areas[i] == marker)
+      return true;
+  return false;
+}
+
+// Overwrites the n x m matrix b (by rows) with a^{-1} b, where a is a dense
+// n x n matrix, by Gaussian elimination with row pivots. a is destroyed.
+// Returns false if it is singular.
+static bool solve_dense(double* a, int n, double* b, int m)
+{
+  for (int j = 0; j < n; j++)
+  {
+    int p = j;
+    for (int i = j + 1; i < n; i++)
+      if (std::abs(a[i * n + j]) > std::abs(a[p * n + j]))
+        p = i;
+    if (a[p * n + j] == 0.0)
+      return false;
+    if (p != j)
+    {
+      for (int k = j; k < n; k++)
+        std::swap(a[j * n + k], a[p * n + k]);
+      for (int k = 0; k < m; k++)
+        std::swap(b[j * m + k], b[p * m + k]);
+    }
+    for (int i = j + 1; i < n; i++)
+    {
+      double l = a[i * n + j] / a[j * n + j];
+      if (l == 0.0) continue;
+      for (int k = j + 1; k < n; k++)
+        a[i * n + k] -= l * a[j * n + k];
+      for (int k = 0; k < m; k++)
+        b[i * m + k] -= l * b[j * m + k];
+    }
+  }
+  for (int i = n - 1; i >= 0; i--)
+    for (int k = 0; k < m; k++)
+    {
+      double sum = b[i * m + k];
+      for (int j = i + 1; j < n; j++)
+        sum -= a[i * n + j] * b[j * m + k];
+      b[i * m + k] = sum / a[i * n + i];
+    }
+  return true;
+}
+
+// Position of the entry (major, minor) in compressed storage, -1 if absent.
+static int find_slot(const int* ptr, const int* idx, int major, int minor)
+{
+  const int* begin = idx + ptr[major];
+  const int* end = idx + ptr[major + 1];
+  const int* it = std::lower_bound(begin, end, minor);
+  if (it == end || *it != minor) return -1;
+  return (int) (it - idx);
+}
+
+NativeDiscreteProblem::NativeDiscreteProblem(const WeakForm<double>* wf, Space<double>* space)
+{
+  spaces.push_back(space);
+  init(wf);
+}
+
+NativeDiscreteProblem::NativeDiscreteProblem(const WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces)
+  : spaces(spaces)
+{
+  Space<double>::assign_dofs(spaces);
+  init(wf);
+}
+
+void NativeDiscreteProblem::init(const WeakForm<double>* wf)
+{
+  if (wf == NULL)
+    throw Hermes::Exceptions::Exception("Weak form is NULL in NativeDiscreteProblem.");
+  if (wf->get_neq() != spaces.size())
+    throw Hermes::Exceptions::Exception("Number of spaces does not match the number of equations in NativeDiscreteProblem.");
+
+  this->wf = wf;
+  mfvol = wf->get_mfvol();
+  mfsurf = wf->get_mfsurf();
+  vfvol = wf->get_vfvol();
+  vfsurf = wf->get_vfsurf();
+  for (unsigned int k = 0; k < mfvol.size(); k++)
+    mfvol_batched.push_back(dynamic_cast<BatchedMatrixForm*>(mfvol[k]));
+  use_batched_forms = true;
+  for (unsigned int k = 0; k < mfvol.size(); k++)
+    mfvol_affine.push_back(dynamic_cast<AffineMatrixForm*>(mfvol[k]));
+  use_affine_templates = true;
+  use_order_cache = true;
+
+  // Names of the forms in the statistics, in the numbering of the forms.
+  char name[64];
+  for (unsigned int k = 0; k < mfvol.size(); k++)
+  {
+    sprintf(name, "matrix form vol %u (%u, %u)", k, mfvol[k]->i, mfvol[k]->j);
+    form_stats.push_back(FormOrderStats());
+    form_stats.back().name = name;
+  }
+  for (unsigned int k = 0; k < mfsurf.size(); k++)
+  {
+    sprintf(name, "matrix form surf %u (%u, %u)", k, mfsurf[k]->i, mfsurf[k]->j);
+    form_stats.push_back(FormOrderStats());
+    form_stats.back().name = name;
+  }
+  for (unsigned int k = 0; k < vfvol.size(); k++)
+  {
+    sprintf(name, "vector form vol %u (%u)", k, vfvol[k]->i);
+    form_stats.push_back(FormOrderStats());
+    form_stats.back().name = name;
+  }
+  for (unsigned int k = 0; k < vfsurf.size(); k++)
+  {
+    sprintf(name, "vector form surf %u (%u)", k, vfsurf[k]->i);
+    form_stats.push_back(FormOrderStats());
+    form_stats.back().name = name;
+  }
+  fixed_orders.assign(form_stats.size(), -1);
+  for (unsigned int k = 0; k < form_stats.size(); k++)
+    form_stats[k].fixed_order = -1;
+  reset_form_order_stats();
+
+  // Forms of the same class share an entry of the profiler.
+  for (unsigned int k = 0; k < mfvol.size(); k++)
+    profile_names.push_back("matrix form vol " + AssemblyProfiler::get_class_name(typeid(*mfvol[k])));
+  for (unsigned int k = 0; k < mfsurf.size(); k++)
+    profile_names.push_back("matrix form surf " + AssemblyProfiler::get_class_name(typeid(*mfsurf[k])));
+  for (unsigned int k = 0; k < vfvol.size(); k++)
+    profile_names.push_back("vector form vol " + AssemblyProfiler::get_class_name(typeid(*vfvol[k])));
+  for (unsigned int k = 0; k < vfsurf.size(); k++)
+    profile_names.push_back("vector form surf " + AssemblyProfiler::get_class_name(typeid(*vfsurf[k])));
+
+  mesh = spaces[0]->get_mesh();
+  ndof = 0;
+  num_threads = 1;
+  batch_size = 4096;
+  coeff_vec = NULL;
+  target = NULL;
+  rhs_values = NULL;
+  shape_cache = ShapeTableCache::get_instance();
+  symmetric_storage = false;
+  use_pattern_cache = true;
+  pattern_valid = false;
+  pattern_version = 0;
+  storage_matrix = NULL;
+  storage_version = 0;
+  reset_assembly_times();
+  profiler = NULL;
+  reassembly_tolerance = 0.0;
+  stored_valid = false;
+  selective = false;
+  patching = false;
+  reset_reassembly_stats();
+  static_condensation = false;
+  dof_ordering = DOF_ORDERING_NATURAL;
+  num_system_dofs = 0;
+  condensed_rhs_valid = false;
+
+  // Symmetric forms also fill the transposed block.
+  int neq = spaces.size();
+  block_used.assign(neq, std::vector<bool>(neq, false));
+  for (unsigned int k = 0; k < mfvol.size(); k++)
+  {
+    block_used[mfvol[k]->i][mfvol[k]->j] = true;
+    if (mfvol[k]->sym != HERMES_NONSYM)
+      block_used[mfvol[k]->j][mfvol[k]->i] = true;
+  }
+  for (unsigned int k = 0; k < mfsurf.size(); k++)
+    block_used[mfsurf[k]->i][mfsurf[k]->j] = true;
+
+  pthread_mutex_init(&ext_mutex, NULL);
+  pthread_mutex_init(&curved_mutex, NULL);
+  pthread_mutex_init(&barrier_mutex, NULL);
+  pthread_cond_init(&barrier_cond, NULL);
+  barrier_waiting = 0;
+  barrier_generation = 0;
+  num_active_threads = 1;
+  thread_exception = NULL;
+}
+
+NativeDiscreteProblem::~NativeDiscreteProblem()
+{
+  pthread_mutex_destroy(&ext_mutex);
+  pthread_mutex_destroy(&curved_mutex);
+  pthread_mutex_destroy(&barrier_mutex);
+  pthread_cond_destroy(&barrier_cond);
+}
+
+void NativeDiscreteProblem::set_num_threads(int num_threads)
+{
+  this->num_threads = std::max(1, num_threads);
+}
+
+void NativeDiscreteProblem::set_batch_size(int batch_size)
+{
+  this->batch_size = std::max(1, batch_size);
+}
+
+void NativeDiscreteProblem::set_batched_forms(bool use_batched_forms)
+{
+  this->use_batched_forms = use_batched_forms;
+}
+
+void NativeDiscreteProblem::set_affine_templates(bool use_affine_templates)
+{
+  this->use_affine_templates = use_affine_templates;
+}
+
+void NativeDiscreteProblem::set_symmetric_storage(bool symmetric_storage)
+{
+  this->symmetric_storage = symmetric_storage;
+  pattern_valid = false;
+}
+
+void NativeDiscreteProblem::set_static_condensation(bool static_condensation)
+{
+  this->static_condensation = static_condensation;
+  dof_map_seq.clear();
+  condensed_elements.clear();
+  condensed_rhs_valid = false;
+  pattern_valid = false;
+  stored_valid = false;
+}
+
+void NativeDiscreteProblem::set_dof_ordering(DofOrdering dof_ordering)
+{
+  this->dof_ordering = dof_ordering;
+  dof_map_seq.clear();
+  condensed_elements.clear();
+  condensed_rhs_valid = false;
+  pattern_valid = false;
+  stored_valid = false;
+}
+
+void NativeDiscreteProblem::set_pattern_cache(bool use_pattern_cache)
+{
+  this->use_pattern_cache = use_pattern_cache;
+  pattern_valid = false;
+}
+
+void NativeDiscreteProblem::set_order_cache(bool use_order_cache)
+{
+  this->use_order_cache = use_order_cache;
+  order_cache.clear();
+}
+
+void NativeDiscreteProblem::set_form_order(const Form<double>* form, int order)
+{
+  std::vector<const Form<double>*> forms;
+  forms.insert(forms.end(), mfvol.begin(), mfvol.end());
+  forms.insert(forms.end(), mfsurf.begin(), mfsurf.end());
+  forms.insert(forms.end(), vfvol.begin(), vfvol.end());
+  forms.insert(forms.end(), vfsurf.begin(), vfsurf.end());
+  std::vector<const Form<double>*>::iterator it = std::find(forms.begin(), forms.end(), form);
+  if (it == forms.end())
+    throw Hermes::Exceptions::Exception("The form does not belong to the weak form of NativeDiscreteProblem.");
+
+  int id = it - forms.begin();
+  fixed_orders[id] = std::max(-1, order);
+  form_stats[id].fixed_order = fixed_orders[id];
+  order_cache.clear();
+}
+
+void NativeDiscreteProblem::reset_form_order_stats()
+{
+  for (unsigned int k = 0; k < form_stats.size(); k++)
+  {
+    form_stats[k].min_order = -1;
+    form_stats[k].max_order = -1;
+    form_stats[k].uses = 0;
+    form_stats[k].evaluations = 0;
+  }
+}
+
+void NativeDiscreteProblem::print_form_orders()
+{
+  for (unsigned int k = 0; k < form_stats.size(); k++)
+  {
+    const FormOrderStats& fs = form_stats[k];
+    if (fs.uses == 0)
+      info("%-28s  not used", fs.name.c_str());
+    else if (fs.fixed_order >= 0)
+      info("%-28s  order %2d - %2d (fixed %d), %lu uses, %lu calls of ord()", fs.name.c_str(),
+           fs.min_order, fs.max_order, fs.fixed_order, fs.uses, fs.evaluations);
+    else
+      info("%-28s  order %2d - %2d, %lu uses, %lu calls of ord()", fs.name.c_str(),
+           fs.min_order, fs.max_order, fs.uses, fs.evaluations);
+  }
+}
+
+void NativeDiscreteProblem::reset_assembly_times()
+{
+  times.pattern = 0.0;
+  times.allocation = 0.0;
+  times.integration = 0.0;
+  times.vector_integration = 0.0;
+  times.num_patterns = 0;
+  times.num_allocations = 0;
+  times.num_matrix_assemblies = 0;
+  times.num_vector_assemblies = 0;
+}
+
+void NativeDiscreteProblem::set_profiler(AssemblyProfiler* profiler)
+{
+  this->profiler = profiler;
+}
+
+void NativeDiscreteProblem::set_reassembly_tolerance(double tolerance)
+{
+  reassembly_tolerance = tolerance;
+}
+
+void NativeDiscreteProblem::reset_reassembly_stats()
+{
+  num_skipped_elements = 0;
+  num_integrated_elements = 0;
+}
+
+void NativeDiscreteProblem::invalidate_matrix()
+{
+  stored_valid = false;
+}
+
+bool NativeDiscreteProblem::can_patch(double* coeff_vec, int size, int nnz)
+{
+  if (reassembly_tolerance <= 0.0 || coeff_vec == NULL || !stored_valid)
+    return false;
+  if (size != get_num_dofs() || nnz != (int) stored_values.size()
+      || mesh->get_num_active_elements() != (int) stored_jacobians.size())
+    return false;
+  for (unsigned int s = 0; s < spaces.size(); s++)
+    if (spaces[s]->get_seq() != stored_seq[s])
+      return false;
+  return true;
+}
+
+int NativeDiscreteProblem::get_num_dofs()
+{
+  if (!has_dof_map())
+    return Space<double>::get_num_dofs(spaces);
+  update_dof_map();
+  return num_system_dofs;
+}
+
+int NativeDiscreteProblem::get_num_space_dofs()
+{
+  return Space<double>::get_num_dofs(spaces);
+}
+
+void NativeDiscreteProblem::update_dof_map()
+{
+  int neq = spaces.size();
+  bool same = ((int) dof_map_seq.size() == neq);
+  for (int s = 0; same && s < neq; s++)
+    if (spaces[s]->get_seq() != dof_map_seq[s])
+      same = false;
+  if (same)
+    return;
+
+  // Bubbles of other spaces, e.g. of L2 spaces, are not local to an
+  // element in the sense of the condensation, they stay in the system.
+  int n = Space<double>::get_num_dofs(spaces);
+  std::vector<bool> bubble(n, false);
+  AsmList<double> al;
+  for (int s = 0; static_condensation && s < neq; s++)
+  {
+    if (dynamic_cast<H1Space<double>*>(spaces[s]) == NULL)
+      continue;
+    Shapeset* shapeset = spaces[s]->get_shapeset();
+    Element* e;
+    for_all_active_elements(e, mesh)
+    {
+      spaces[s]->get_element_assembly_list(e, &al);
+      int order = spaces[s]->get_element_order(e->id);
+      int* indices = shapeset->get_bubble_indices(order, e->get_mode());
+      int num = shapeset->get_num_bubbles(order, e->get_mode());
+      for (unsigned int k = 0; k < al.cnt; k++)
+        if (al.dof[k] >= 0 && std::find(indices, indices + num, al.idx[k]) != indices + num)
+          bubble[al.dof[k]] = true;
+    }
+  }
+
+  system_dof.resize(n);
+  num_system_dofs = 0;
+  for (int i = 0; i < n; i++)
+    system_dof[i] = bubble[i] ? -1 : num_system_dofs++;
+
+  // The ordering permutes the rows that remain.
+  if (dof_ordering != DOF_ORDERING_NATURAL)
+  {
+    std::vector<int> row_ptr, col_idx, perm, pinv;
+    build_pattern(num_system_dofs, true, row_ptr, col_idx);
+    if (dof_ordering == DOF_ORDERING_RCM)
+      rcm_ordering(num_system_dofs, &row_ptr[0], col_idx.empty() ? NULL : &col_idx[0], perm);
+    else
+      nested_dissection_ordering(num_system_dofs, &row_ptr[0], col_idx.empty() ? NULL : &col_idx[0], perm);
+    invert_permutation(perm, pinv);
+    for (int i = 0; i < n; i++)
+      if (system_dof[i] >= 0)
+        system_dof[i] = pinv[system_dof[i]];
+  }
+
+  dof_map_seq.resize(neq);
+  for (int s = 0; s < neq; s++)
+    dof_map_seq[s] = spaces[s]->get_seq();
+  condensed_elements.clear();
+  condensed_rhs_valid = false;
+}
+
+void NativeDiscreteProblem::get_space_vector(const double* sln, double* space_sln)
+{
+  if (!has_dof_map())
+  {
+    std::copy(sln, sln + get_num_dofs(), space_sln);
+    return;
+  }
+  update_dof_map();
+  int n = system_dof.size();
+  for (int i = 0; i < n; i++)
+    if (system_dof[i] >= 0)
+      space_sln[i] = sln[system_dof[i]];
+  if (!static_condensation)
+    return;
+
+  if (!condensed_rhs_valid || mesh->get_num_active_elements() != (int) condensed_elements.size())
+    throw Hermes::Exceptions::Exception("Bubbles can be recovered after an assembly of the right-hand side only.");
+  for (unsigned int k = 0; k < condensed_elements.size(); k++)
+  {
+    const CondensedElement& ce = condensed_elements[k];
+    int nb = ce.bubbles.size();
+    int nd = ce.dofs.size();
+    for (int b = 0; b < nb; b++)
+    {
+      double sum = ce.rhs[b];
+      for (int d = 0; d < nd; d++)
+        sum -= ce.coupling[b * nd + d] * sln[ce.dofs[d]];
+      space_sln[ce.bubbles[b]] = sum;
+    }
+  }
+}
+
+void NativeDiscreteProblem::get_system_vector(const double* space_sln, double* sln)
+{
+  if (!has_dof_map())
+  {
+    std::copy(space_sln, space_sln + get_num_dofs(), sln);
+    return;
+  }
+  update_dof_map();
+  int n = system_dof.size();
+  for (int i = 0; i < n; i++)
+    if (system_dof[i] >= 0)
+      sln[system_dof[i]] = space_sln[i];
+}
+
+size_t NativeDiscreteProblem::get_condensation_memory_size() const
+{
+  size_t size = system_dof.size() * sizeof(int);
+  for (unsigned int k = 0; k < condensed_elements.size(); k++)
+  {
+    const CondensedElement& ce = condensed_elements[k];
+    size += (ce.bubbles.size() + ce.dofs.size()) * sizeof(int)
+            + (ce.coupling.size() + ce.rhs.size()) * sizeof(double);
+  }
+  return size;
+}
+
+void NativeDiscreteProblem::prepare()
+{
+  for (unsigned int s = 0; s < spaces.size(); s++)
+    if (spaces[s]->get_mesh() != mesh)
+      throw Hermes::Exceptions::Exception("All spaces of NativeDiscreteProblem must share one mesh.");
+
+  Hermes::vector<Hermes::vector<MeshFunction<double>*> > ext;
+  for (unsigned int k = 0; k < mfvol.size(); k++) ext.push_back(mfvol[k]->ext);
+  for (unsigned int k = 0; k < mfsurf.size(); k++) ext.push_back(mfsurf[k]->ext);
+  for (unsigned int k = 0; k < vfvol.size(); k++) ext.push_back(vfvol[k]->ext);
+  for (unsigned int k = 0; k < vfsurf.size(); k++) ext.push_back(vfsurf[k]->ext);
+  for (unsigned int k = 0; k < ext.size(); k++)
+    for (unsigned int l = 0; l < ext[k].size(); l++)
+      if (ext[k][l]->get_mesh() != mesh)
+        throw Hermes::Exceptions::Exception("External functions of NativeDiscreteProblem must live on the mesh of the spaces.");
+
+  ndof = get_num_dofs();
+
+  elements.clear();
+  Element* e;
+  for_all_active_elements(e, mesh)
+    elements.push_back(e);
+}
+
+void NativeDiscreteProblem::get_sparsity_pattern(std::vector<int>& row_ptr, std::vector<int>& col_idx)
+{
+  update_sparsity_pattern();
+  row_ptr = pattern_row_ptr;
+  col_idx = pattern_col_idx;
+}
+
+void NativeDiscreteProblem::update_sparsity_pattern()
+{
+  prepare();
+
+  int neq = spaces.size();
+  if (use_pattern_cache && pattern_valid && (int) pattern_row_ptr.size() == ndof + 1)
+  {
+    bool same = true;
+    for (int s = 0; s < neq; s++)
+      if (spaces[s]->get_seq() != pattern_seq[s])
+        same = false;
+    if (same)
+      return;
+  }
+
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+  build_pattern(ndof, symmetric_storage, pattern_row_ptr, pattern_col_idx);
+
+  pattern_seq.resize(neq);
+  for (int s = 0; s < neq; s++)
+    pattern_seq[s] = spaces[s]->get_seq();
+  pattern_valid = true;
+  pattern_version++;
+  double elapsed = timer.tick().last();
+  times.pattern += elapsed;
+  times.num_patterns++;
+  if (profiler != NULL)
+  {
+    AssemblyProfiler::Stats stats;
+    stats.time = elapsed;
+    stats.calls = 1;
+    profiler->add_phase(AssemblyProfiler::PATTERN, stats);
+  }
+}
+
+void NativeDiscreteProblem::build_pattern(int size, bool upper, std::vector<int>& row_ptr, std::vector<int>& col_idx)
+{
+  int neq = spaces.size();
+  std::vector<AsmList<double>*> al(neq);
+  for (int s = 0; s < neq; s++)
+    al[s] = new AsmList<double>;
+
+  // DOFs of the global system, without the bubbles with static condensation.
+  std::vector<std::vector<int> > dofs(neq);
+  SparsityPatternBuilder builder(size);
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    for (int s = 0; s < neq; s++)
+    {
+      spaces[s]->get_element_assembly_list(e, al[s]);
+      dofs[s].resize(al[s]->cnt);
+      for (unsigned int ii = 0; ii < al[s]->cnt; ii++)
+        dofs[s][ii] = get_system_dof(al[s]->dof[ii]);
+    }
+    for (int i = 0; i < neq; i++)
+      for (int j = 0; j < neq; j++)
+      {
+        if (!block_used[i][j]) continue;
+        for (unsigned int ii = 0; ii < dofs[i].size(); ii++)
+        {
+          if (dofs[i][ii] < 0) continue;
+          for (unsigned int jj = 0; jj < dofs[j].size(); jj++)
+            if (dofs[j][jj] >= 0 && (!upper || dofs[j][jj] >= dofs[i][ii]))
+              builder.add(dofs[i][ii], dofs[j][jj]);
+        }
+      }
+  }
+  builder.finalize(row_ptr, col_idx);
+
+  for (int s = 0; s < neq; s++)
+    delete al[s];
+}
+
+bool NativeDiscreteProblem::has_pattern_storage(const void* mat, int size, int nnz)
+{
+  return use_pattern_cache && mat == storage_matrix && storage_version == pattern_version
+         && size == ndof && nnz == (int) pattern_col_idx.size();
+}
+
+void NativeDiscreteProblem::assemble(double* coeff_vec, SparseMatrix<double>* mat, Vector<double>* rhs,
+                                     bool force_diagonal_blocks, Table* block_weights)
+{
+  if (force_diagonal_blocks || block_weights != NULL)
+    throw Hermes::Exceptions::Exception("NativeDiscreteProblem does not support diagonal blocks and block weights.");
+  if (symmetric_storage && mat != NULL)
+    throw Hermes::Exceptions::Exception("Symmetric storage of NativeDiscreteProblem needs a CSRMatrix.");
+
+  MatrixTarget target;
+  target.values = NULL;
+  target.ptr = NULL;
+  target.idx = NULL;
+  target.column_major = false;
+  target.upper = false;
+  target.fallback = NULL;
+
+  bool patch = false;
+  if (mat != NULL)
+  {
+    // Hermes compressed column matrices are filled in place, column
+    // ranges are distributed among the threads.
+    CSCMatrix<double>* csc = dynamic_cast<CSCMatrix<double>*>(mat);
+    patch = (csc != NULL) && can_patch(coeff_vec, mat->get_size(), mat->get_nnz());
+    if (!patch)
+    {
+      update_sparsity_pattern();
+      TimePeriod timer;
+      timer.tick(HERMES_SKIP);
+      if (has_pattern_storage(mat, mat->get_size(), mat->get_nnz()))
+        mat->zero();
+      else
+      {
+        mat->free();
+        mat->prealloc(ndof);
+        for (int i = 0; i < ndof; i++)
+          for (int k = pattern_row_ptr[i]; k < pattern_row_ptr[i + 1]; k++)
+            mat->pre_add_ij(i, pattern_col_idx[k]);
+        mat->alloc();
+        mat->zero();
+        storage_matrix = mat;
+        storage_version = pattern_version;
+        times.num_allocations++;
+      }
+      double elapsed = timer.tick().last();
+      times.allocation += elapsed;
+      if (profiler != NULL)
+      {
+        AssemblyProfiler::Stats stats;
+        stats.time = elapsed;
+        stats.calls = 1;
+        profiler->add_phase(AssemblyProfiler::ALLOCATION, stats);
+      }
+    }
+
+    if (csc != NULL)
+    {
+      target.values = csc->get_Ax();
+      target.ptr = csc->get_Ap();
+      target.idx = csc->get_Ai();
+      target.column_major = true;
+    }
+    else
+      target.fallback = mat;
+  }
+
+  if (rhs != NULL)
+    rhs_buffer.resize(std::max(1, get_num_dofs()));
+  assemble(coeff_vec, mat != NULL ? &target : NULL, rhs != NULL ? &rhs_buffer[0] : NULL, patch);
+
+  if (rhs != NULL)
+  {
+    rhs->alloc(ndof);
+    for (int i = 0; i < ndof; i++)
+      rhs->set(i, rhs_buffer[i]);
+  }
+}
+
+void NativeDiscreteProblem::assemble(double* coeff_vec, Vector<double>* rhs,
+                                     bool force_diagonal_blocks, Table* block_weights)
+{
+  assemble(coeff_vec, NULL, rhs, force_diagonal_blocks, block_weights);
+}
+
+void NativeDiscreteProblem::assemble(SparseMatrix<double>* mat, Vector<double>* rhs)
+{
+  assemble(NULL, mat, rhs);
+}
+
+void NativeDiscreteProblem::assemble(double* coeff_vec, CSRMatrix<double>* mat, double* rhs)
+{
+  MatrixTarget target;
+  target.values = NULL;
+  target.ptr = NULL;
+  target.idx = NULL;
+  target.column_major = false;
+  target.upper = false;
+  target.fallback = NULL;
+
+  bool patch = false;
+  if (mat != NULL)
+  {
+    if (symmetric_storage)
+      for (unsigned int k = 0; k < mfvol.size(); k++)
+        if (mfvol[k]->sym != HERMES_SYM)
+          throw Hermes::Exceptions::Exception("Symmetric storage needs symmetric volumetric matrix forms.");
+
+    patch = (mat->is_symmetric() == symmetric_storage) && can_patch(coeff_vec, mat->get_size(), mat->get_nnz());
+    if (!patch)
+    {
+      update_sparsity_pattern();
+      TimePeriod timer;
+      timer.tick(HERMES_SKIP);
+      if (mat->is_symmetric() == symmetric_storage && has_pattern_storage(mat, mat->get_size(), mat->get_nnz()))
+        mat->zero();
+      else
+      {
+        mat->create(ndof, &pattern_row_ptr[0], pattern_col_idx.empty() ? NULL : &pattern_col_idx[0],
+                    symmetric_storage);
+        storage_matrix = mat;
+        storage_version = pattern_version;
+        times.num_allocations++;
+      }
+      double elapsed = timer.tick().last();
+      times.allocation += elapsed;
+      if (profiler != NULL)
+      {
+        AssemblyProfiler::Stats stats;
+        stats.time = elapsed;
+        stats.calls = 1;
+        profiler->add_phase(AssemblyProfiler::ALLOCATION, stats);
+      }
+    }
+    target.values = mat->get_values();
+    target.ptr = mat->get_row_ptr();
+    target.idx = mat->get_col_idx();
+    target.upper = symmetric_storage;
+  }
+
+  assemble(coeff_vec, mat != NULL ? &target : NULL, rhs, patch);
+}
+
+void NativeDiscreteProblem::assemble_residual(double* coeff_vec, double* residual)
+{
+  assemble(coeff_vec, (MatrixTarget*) NULL, residual, false);
+}
+
+void NativeDiscreteProblem::assemble(double* coeff_vec, MatrixTarget* target, double* rhs, bool patch)
+{
+  prepare();
+  if (static_condensation)
+  {
+    if (coeff_vec != NULL)
+      throw Hermes::Exceptions::Exception("Static condensation of NativeDiscreteProblem needs a linear problem.");
+    condensed_elements.resize(elements.size());
+  }
+
+  this->coeff_vec = coeff_vec;
+  this->target = target;
+  rhs_values = rhs;
+  want_rhs = (rhs != NULL);
+  want_matrix = (target != NULL);
+  // Linear problems need the matrix forms for the Dirichlet lift.
+  want_matrix_forms = want_matrix || (coeff_vec == NULL && want_rhs);
+  if (want_rhs)
+    std::fill(rhs, rhs + ndof, 0.0);
+
+  // Selective reassembly keeps the local Jacobians of all elements. When
+  // patching, the matrix is restored from the copy of the last assembly,
+  // so it does not matter what the solver did with it in the meantime.
+  selective = reassembly_tolerance > 0.0 && coeff_vec != NULL && want_matrix && target->fallback == NULL;
+  patching = selective && patch;
+  if (patching)
+    std::copy(stored_values.begin(), stored_values.end(), target->values);
+  else if (selective)
+    stored_jacobians.assign(elements.size(), StoredJacobian());
+  coeff_scale = 0.0;
+  for (int i = 0; selective && i < ndof; i++)
+    coeff_scale = std::max(coeff_scale, std::abs(coeff_vec[i]));
+
+  batch.resize(std::min(batch_size, std::max(1, (int) elements.size())));
+
+  // Contexts are created serially, Hermes reference maps are not thread
+  // safe during initialization.
+  contexts.resize(num_threads);
+  for (int t = 0; t < num_threads; t++)
+    contexts[t] = create_thread_context();
+
+  // The threads wait in the first barrier of run_thread() until all of
+  // them are created. If a thread cannot be created, the assembly goes on
+  // with the ones that were.
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+  barrier_waiting = 0;
+  num_active_threads = num_threads;
+  std::vector<pthread_t> threads(num_threads);
+  std::vector<ThreadArgs> args(num_threads);
+  int num_created = 1;
+  for (int t = 1; t < num_threads; t++, num_created++)
+  {
+    args[t].dp = this;
+    args[t].thread = t;
+    if (pthread_create(&threads[t], NULL, thread_entry, &args[t]) != 0)
+      break;
+  }
+  if (num_created < num_threads)
+  {
+    warn("Only %d of %d assembly threads could be created.", num_created, num_threads);
+    pthread_mutex_lock(&barrier_mutex);
+    num_active_threads = num_created;
+    pthread_mutex_unlock(&barrier_mutex);
+  }
+
+  // Every thread owns a contiguous range of DOFs, i.e., of matrix rows
+  // (columns for CSC storage) and of right-hand side entries.
+  dof_range.resize(num_active_threads + 1);
+  for (int t = 0; t <= num_active_threads; t++)
+    dof_range[t] = (int) ((long long) ndof * t / num_active_threads);
+
+  run_thread(0);
+  for (int t = 1; t < num_created; t++)
+    pthread_join(threads[t], NULL);
+  double elapsed = timer.tick().last();
+  times.integration += elapsed;
+  if (want_matrix)
+    times.num_matrix_assemblies++;
+  else
+  {
+    times.vector_integration += elapsed;
+    times.num_vector_assemblies++;
+  }
+  if (profiler != NULL)
+    profiler->add_assembly(elapsed);
+
+  bool condensation_failed = false;
+  for (int t = 0; t < num_threads; t++)
+  {
+    condensation_failed = condensation_failed || contexts[t]->condensation_failed;
+    if (contexts[t]->profiling)
+    {
+      for (int p = 0; p < AssemblyProfiler::NUM_PHASES; p++)
+        profiler->add_phase((AssemblyProfiler::Phase) p, contexts[t]->phase_stats[p]);
+      for (unsigned int k = 0; k < profile_names.size(); k++)
+        if (contexts[t]->form_profile[k].calls > 0)
+          profiler->add_form(profile_names[k], contexts[t]->form_profile[k]);
+    }
+    num_skipped_elements += contexts[t]->num_skipped;
+    num_integrated_elements += contexts[t]->num_integrated;
+    for (unsigned int k = 0; k < form_stats.size(); k++)
+    {
+      const FormOrderStats& fs = contexts[t]->form_stats[k];
+      if (fs.uses == 0) continue;
+      if (form_stats[k].uses == 0 || fs.min_order < form_stats[k].min_order)
+        form_stats[k].min_order = fs.min_order;
+      form_stats[k].max_order = std::max(form_stats[k].max_order, fs.max_order);
+      form_stats[k].uses += fs.uses;
+      form_stats[k].evaluations += fs.evaluations;
+    }
+    free_thread_context(contexts[t]);
+  }
+  contexts.clear();
+
+  if (selective)
+  {
+    stored_values.assign(target->values, target->values + target->ptr[ndof]);
+    stored_seq.resize(spaces.size());
+    for (unsigned int s = 0; s < spaces.size(); s++)
+      stored_seq[s] = spaces[s]->get_seq();
+    stored_valid = true;
+  }
+  else if (want_matrix)
+    stored_valid = false;
+
+  // No tables are in use now.
+  shape_cache->trim();
+  template_cache.trim();
+
+  if (thread_exception != NULL)
+  {
+    ThreadException* e = thread_exception;
+    thread_exception = NULL;
+    stored_valid = false;
+    condensed_rhs_valid = false;
+    try
+    {
+      e->rethrow();
+    }
+    catch(...)
+    {
+      delete e;
+      throw;
+    }
+  }
+
+  if (static_condensation)
+  {
+    condensed_rhs_valid = want_rhs && !condensation_failed;
+    if (condensation_failed)
+      throw Hermes::Exceptions::Exception("Singular matrix of the bubbles of an element in the static condensation.");
+  }
+}
+
+void* NativeDiscreteProblem::thread_entry(void* args)
+{
+  ThreadArgs* thread_args = (ThreadArgs*) args;
+  thread_args->dp->run_thread(thread_args->thread);
+  return NULL;
+}
+
+void NativeDiscreteProblem::run_thread(int thread)
+{
+  // All threads are created.
+  barrier();
+  run_batches(thread);
+}
+
+void NativeDiscreteProblem::run_batches(int thread)
+{
+  ThreadContext* ctx = contexts[thread];
+  int num_elements = elements.size();
+  for (int first = 0; first < num_elements; first += batch_size)
+  {
+    int last = std::min(first + batch_size, num_elements);
+
+    // Elements are dealt out cyclically, neighbouring elements tend
+    // to have similar cost. After an exception in any thread the batches
+    // are only walked through the barriers.
+    if (!has_thread_exception())
+      assemble_batch(thread, first, last);
+    barrier();
+
+    if (!has_thread_exception())
+    {
+      double start = profile_clock(ctx);
+      scatter_batch(thread, first, last);
+      profile_phase(ctx, AssemblyProfiler::INSERTION, start);
+    }
+    barrier();
+  }
+}
+
+void NativeDiscreteProblem::assemble_batch(int thread, int first, int last)
+{
+  // Exceptions are copied with their own type. C++98 cannot copy an
+  // exception of an unknown type, so the derived Hermes exceptions are
+  // caught one by one; others are kept as their nearest base listed here.
+  using namespace Hermes::Exceptions;
+  try
+  {
+    ThreadContext* ctx = contexts[thread];
+    for (int k = first + thread; k < last; k += num_active_threads)
+      assemble_element(ctx, k, &batch[k - first]);
+  }
+  catch(NullException& e)
+  {
+    set_thread_exception(new ThreadExceptionCopy<NullException>(e));
+  }
+  catch(LengthException& e)
+  {
+    set_thread_exception(new ThreadExceptionCopy<LengthException>(e));
+  }
+  catch(ValueException& e)
+  {
+    set_thread_exception(new ThreadExceptionCopy<ValueException>(e));
+  }
+  catch(Exception& e)
+  {
+    set_thread_exception(new ThreadExceptionCopy<Exception>(e));
+  }
+  catch(std::bad_alloc& e)
+  {
+    set_thread_exception(new ThreadExceptionCopy<std::bad_alloc>(e));
+  }
+  catch(std::exception& e)
+  {
+    set_thread_exception(new ThreadExceptionCopy<Exception>(Exception("Assembly thread %d: %s", thread, e.what())));
+  }
+  catch(...)
+  {
+    set_thread_exception(new ThreadExceptionCopy<Exception>(Exception("Unknown exception in assembly thread %d.",
+                                                                      thread)));
+  }
+}
+
+void NativeDiscreteProblem::set_thread_exception(ThreadException* e)
+{
+  pthread_mutex_lock(&barrier_mutex);
+  if (thread_exception == NULL)
+  {
+    thread_exception = e;
+    e = NULL;
+  }
+  pthread_mutex_unlock(&barrier_mutex);
+  delete e;
+}
+
+bool NativeDiscreteProblem::has_thread_exception()
+{
+  pthread_mutex_lock(&barrier_mutex);
+  bool result = (thread_exception != NULL);
+  pthread_mutex_unlock(&barrier_mutex);
+  return result;
+}
+
+void NativeDiscreteProblem::barrier()
+{
+  pthread_mutex_lock(&barrier_mutex);
+  int generation = barrier_generation;
+  if (++barrier_waiting == num_active_threads)
+  {
+    barrier_waiting = 0;
+    barrier_generation++;
+    pthread_cond_broadcast(&barrier_cond);
+  }
+  else
+    while (generation == barrier_generation)
+      pthread_cond_wait(&barrier_cond, &barrier_mutex);
+  pthread_mutex_unlock(&barrier_mutex);
+}
+
+void NativeDiscreteProblem::scatter_batch(int thread, int first, int last)
+{
+  int lo = dof_range[thread];
+  int hi = dof_range[thread + 1];
+
+  for (int k = first; k < last; k++)
+  {
+    LocalSystem& ls = batch[k - first];
+    int n = ls.dofs.size();
+
+    if (want_rhs)
+      for (int r = 0; r < n; r++)
+        if (ls.dofs[r] >= lo && ls.dofs[r] < hi)
+          rhs_values[ls.dofs[r]] += ls.rhs[r];
+
+    if (!want_matrix || ls.matrix_skipped) continue;
+
+    // Matrices without accessible storage are filled by the first thread.
+    if (target->fallback != NULL)
+    {
+      if (thread != 0) continue;
+      for (int r = 0; r < n; r++)
+      {
+        if (ls.dofs[r] < 0) continue;
+        for (int c = 0; c < n; c++)
+          if (ls.dofs[c] >= 0)
+            target->fallback->add(ls.dofs[r], ls.dofs[c], ls.mat[r * n + c]);
+      }
+      continue;
+    }
+
+    for (int r = 0; r < n; r++)
+    {
+      int row = ls.dofs[r];
+      if (row < 0) continue;
+      if (!target->column_major && (row < lo || row >= hi)) continue;
+      for (int c = 0; c < n; c++)
+      {
+        int col = ls.dofs[c];
+        if (col < 0 || (target->upper && col < row)) continue;
+        int slot;
+        if (target->column_major)
+        {
+          if (col < lo || col >= hi) continue;
+          slot = find_slot(target->ptr, target->idx, col, row);
+        }
+        else
+          slot = find_slot(target->ptr, target->idx, row, col);
+        if (slot >= 0)
+          target->values[slot] += ls.mat[r * n + c];
+      }
+    }
+  }
+}
+
+void NativeDiscreteProblem::assemble_element(ThreadContext* ctx, int index, LocalSystem* ls)
+{
+  Element* e = elements[index];
+  int neq = spaces.size();
+
+  ls->dofs.clear();
+  for (int s = 0; s < neq; s++)
+  {
+    spaces[s]->get_element_assembly_list(e, ctx->al[s]);
+    ctx->offset[s] = ls->dofs.size();
+    ls->dofs.insert(ls->dofs.end(), ctx->al[s]->dof, ctx->al[s]->dof + ctx->al[s]->cnt);
+
+    int order = spaces[s]->get_element_order(e->id);
+    if (e->is_quad())
+      order = std::max(H2D_GET_H_ORDER(order), H2D_GET_V_ORDER(order));
+    ctx->fn_order[s] = order;
+  }
+  int n = ls->dofs.size();
+
+  // Renumbered DOFs; with static condensation condense_element() does this
+  // after the bubbles are identified.
+  if (has_dof_map() && !static_condensation)
+    for (int r = 0; r < n; r++)
+      ls->dofs[r] = get_system_dof(ls->dofs[r]);
+
+  // The element keeps its previous Jacobian if its coefficients did not
+  // change enough.
+  ls->matrix_skipped = false;
+  if (patching)
+  {
+    StoredJacobian& sj = stored_jacobians[index];
+    double change = 0.0;
+    for (int r = 0; r < n; r++)
+      if (ls->dofs[r] >= 0)
+        change = std::max(change, std::abs(coeff_vec[ls->dofs[r]] - sj.coeffs[r]));
+    ls->matrix_skipped = (change <= reassembly_tolerance * coeff_scale);
+  }
+  if (ls->matrix_skipped)
+    ctx->num_skipped++;
+  else if (want_matrix)
+    ctx->num_integrated++;
+
+  // The right-hand side of a linear problem needs the matrix forms only
+  // for the lift, i.e. on elements with Dirichlet DOFs, unless the bubbles
+  // are condensed.
+  if (coeff_vec == NULL && !want_matrix && !static_condensation)
+  {
+    ls->matrix_skipped = true;
+    for (int r = 0; r < n && ls->matrix_skipped; r++)
+      ls->matrix_skipped = (ls->dofs[r] >= 0);
+  }
+
+  ls->mat.assign(want_matrix_forms && !ls->matrix_skipped ? n * n : 0, 0.0);
+  ls->rhs.assign(n, 0.0);
+
+  // The reference maps of curved elements share static data in Hermes.
+  bool curved = e->is_curved();
+  if (curved)
+    pthread_mutex_lock(&curved_mutex);
+
+  double start = profile_clock(ctx);
+  ctx->quad.set_mode(e->get_mode());
+  ctx->refmap.set_active_element(e);
+  profile_phase(ctx, AssemblyProfiler::GEOMETRY, start);
+
+  std::string marker = mesh->get_element_markers_conversion().get_user_marker(e->marker).marker;
+  assemble_volume_forms(ctx, e, ls, marker);
+  assemble_surface_forms(ctx, e, ls);
+  free_quadrature_data(ctx);
+
+  if (curved)
+    pthread_mutex_unlock(&curved_mutex);
+
+  // Linear problems: columns of Dirichlet DOFs go to the right-hand side.
+  if (coeff_vec == NULL && want_matrix_forms && !ls->matrix_skipped)
+  {
+    start = profile_clock(ctx);
+    for (int r = 0; r < n; r++)
+    {
+      if (ls->dofs[r] < 0) continue;
+      for (int c = 0; c < n; c++)
+        if (ls->dofs[c] < 0)
+          ls->rhs[r] -= ls->mat[r * n + c];
+    }
+    profile_phase(ctx, AssemblyProfiler::DIRICHLET_LIFT, start);
+  }
+
+  // The bubbles are eliminated after the lift, their right-hand side
+  // contains it.
+  if (static_condensation && want_matrix_forms)
+  {
+    start = profile_clock(ctx);
+    condense_element(ctx, index, ls);
+    profile_phase(ctx, AssemblyProfiler::CONDENSATION, start);
+  }
+
+  // The matrix contains the previous Jacobian of the element, the
+  // difference is added.
+  if (selective && !ls->matrix_skipped)
+  {
+    StoredJacobian& sj = stored_jacobians[index];
+    if (patching)
+    {
+      for (int r = 0; r < n * n; r++)
+      {
+        double value = ls->mat[r];
+        ls->mat[r] -= sj.mat[r];
+        sj.mat[r] = value;
+      }
+    }
+    else
+      sj.mat = ls->mat;
+    sj.coeffs.resize(n);
+    for (int r = 0; r < n; r++)
+      sj.coeffs[r] = (ls->dofs[r] >= 0) ? coeff_vec[ls->dofs[r]] : 0.0;
+  }
+}
+
+void NativeDiscreteProblem::condense_element(ThreadContext* ctx, int index, LocalSystem* ls)
+{
+  int n = ls->dofs.size();
+  std::vector<int>& b = ctx->bubble_pos;
+  std::vector<int>& d = ctx->other_pos;
+  b.clear();
+  d.clear();
+  for (int r = 0; r < n; r++)
+  {
+    if (ls->dofs[r] < 0) continue;
+    if (system_dof[ls->dofs[r]] < 0)
+      b.push_back(r);
+    else
+      d.push_back(r);
+  }
+  int nb = b.size();
+  int nd = d.size();
+  int m = nd + 1;
+
+  CondensedElement& ce = condensed_elements[index];
+  ce.bubbles.resize(nb);
+  ce.dofs.resize(nd);
+  ce.coupling.resize(nb * nd);
+  ce.rhs.resize(nb);
+  for (int i = 0; i < nb; i++)
+    ce.bubbles[i] = ls->dofs[b[i]];
+  for (int i = 0; i < nd; i++)
+    ce.dofs[i] = system_dof[ls->dofs[d[i]]];
+
+  if (nb > 0)
+  {
+    // W = K_bb^{-1} [K_bi f_b].
+    std::vector<double>& a = ctx->bubble_mat;
+    std::vector<double>& w = ctx->bubble_rhs;
+    a.resize(nb * nb);
+    w.resize(nb * m);
+    for (int i = 0; i < nb; i++)
+    {
+      for (int j = 0; j < nb; j++)
+        a[i * nb + j] = ls->mat[b[i] * n + b[j]];
+      for (int j = 0; j < nd; j++)
+        w[i * m + j] = ls->mat[b[i] * n + d[j]];
+      w[i * m + nd] = ls->rhs[b[i]];
+    }
+    if (!solve_dense(&a[0], nb, &w[0], m))
+      ctx->condensation_failed = true;
+    else
+    {
+      // K_ii - K_ib K_bb^{-1} K_bi and f_i - K_ib K_bb^{-1} f_b.
+      for (int i = 0; i < nd; i++)
+        for (int k = 0; k < nb; k++)
+        {
+          double l = ls->mat[d[i] * n + b[k]];
+          if (l == 0.0) continue;
+          for (int j = 0; j < nd; j++)
+            ls->mat[d[i] * n + d[j]] -= l * w[k * m + j];
+          ls->rhs[d[i]] -= l * w[k * m + nd];
+        }
+      for (int i = 0; i < nb; i++)
+      {
+        std::copy(w.begin() + i * m, w.begin() + i * m + nd, ce.coupling.begin() + i * nd);
+        ce.rhs[i] = w[i * m + nd];
+      }
+    }
+  }
+
+  // Bubbles are not added to the global system.
+  for (int r = 0; r < n; r++)
+    if (ls->dofs[r] >= 0)
+      ls->dofs[r] = system_dof[ls->dofs[r]];
+}
+
+void NativeDiscreteProblem::assemble_volume_forms(ThreadContext* ctx, Element* e, LocalSystem* ls, const std::string& marker)
+{
+  int n = ls->dofs.size();
+  bool linear = (coeff_vec == NULL);
+
+  for (unsigned int k = 0; want_matrix_forms && !ls->matrix_skipped && k < mfvol.size(); k++)
+  {
+    MatrixFormVol<double>* mfv = mfvol[k];
+    if (!form_applies(mfv->areas, marker)) continue;
+
+    double start = profile_clock(ctx);
+    int order = calc_matrix_form_order(ctx, mfv, k, e);
+    profile_phase(ctx, AssemblyProfiler::ORDERS, start);
+    AsmList<double>* al_i = ctx->al[mfv->i];
+    AsmList<double>* al_j = ctx->al[mfv->j];
+    int off_i = ctx->offset[mfv->i];
+    int off_j = ctx->offset[mfv->j];
+    bool sym = (mfv->sym != HERMES_NONSYM);
+
+    // Constant coefficients on an affine element: no quadrature at all.
+    AffineCoefficients coeffs;
+    bool affine = use_affine_templates && mfvol_affine[k] != NULL && ctx->refmap.is_jacobian_const()
+                  && mfvol_affine[k]->get_affine_coefficients(coeffs);
+    QuadratureData* qd = NULL;
+    ExtData<double>* ext = NULL;
+    Func<double>** u_ext = NULL;
+    BatchedMatrixForm* batched = NULL;
+    start = profile_clock(ctx);
+    if (affine)
+    {
+      ctx->form_values.resize(al_i->cnt * al_j->cnt);
+      contract_reference_template(*get_reference_template(ctx, mfv, order, e), coeffs,
+                                  ctx->refmap.get_const_jacobian(), *ctx->refmap.get_const_inv_ref_map(),
+                                  &ctx->form_values[0]);
+    }
+    else
+    {
+      qd = get_quadrature_data(ctx, order, -1, e);
+      start = profile_clock(ctx);
+      ext = init_ext_fns(mfv->ext, e, qd->eo);
+      u_ext = linear ? NULL : &qd->u_ext[0];
+
+      // All pairs at once; symmetric forms compute the lower triangle too,
+      // this is cheaper than leaving the batch.
+      batched = use_batched_forms ? mfvol_batched[k] : NULL;
+      if (batched != NULL)
+      {
+        ctx->form_values.resize(al_i->cnt * al_j->cnt);
+        batched->value_batch(qd->np, &qd->jwt[0], u_ext, get_basis_block(qd, mfv->j), get_basis_block(qd, mfv->i),
+                             qd->geom, ext, &ctx->form_values[0]);
+      }
+    }
+
+    for (unsigned int ii = 0; ii < al_i->cnt; ii++)
+    {
+      // Symmetric forms on a diagonal block: upper triangle only.
+      unsigned int jj_start = (sym && mfv->i == mfv->j) ? ii : 0;
+      for (unsigned int jj = jj_start; jj < al_j->cnt; jj++)
+      {
+        bool need_ij = al_i->dof[ii] >= 0 && (linear || al_j->dof[jj] >= 0);
+        bool need_ji = sym && (mfv->i != mfv->j || jj != ii)
+                       && al_j->dof[jj] >= 0 && (linear || al_i->dof[ii] >= 0);
+        if (!need_ij && !need_ji) continue;
+
+        double val = (affine || batched != NULL) ? ctx->form_values[ii * al_j->cnt + jj]
+                     : mfv->value(qd->np, &qd->jwt[0], u_ext, qd->fns[mfv->j][jj], qd->fns[mfv->i][ii], qd->geom, ext);
+        val *= al_i->coef[ii] * al_j->coef[jj];
+        if (need_ij)
+          ls->mat[(off_i + ii) * n + off_j + jj] += val;
+        if (need_ji)
+          ls->mat[(off_j + jj) * n + off_i + ii] += mfv->sym * val;
+      }
+    }
+    if (ext != NULL)
+      free_ext_fns(ext);
+    profile_form(ctx, k, start, qd != NULL ? qd->np : 0);
+  }
+
+  if (!want_rhs) return;
+
+  for (unsigned int k = 0; k < vfvol.size(); k++)
+  {
+    VectorFormVol<double>* vfv = vfvol[k];
+    if (!form_applies(vfv->areas, marker)) continue;
+
+    int id = mfvol.size() + mfsurf.size() + k;
+    double start = profile_clock(ctx);
+    int order = calc_vector_form_order(ctx, vfv, id, e);
+    profile_phase(ctx, AssemblyProfiler::ORDERS, start);
+    QuadratureData* qd = get_quadrature_data(ctx, order, -1, e);
+    start = profile_clock(ctx);
+    ExtData<double>* ext = init_ext_fns(vfv->ext, e, qd->eo);
+    Func<double>** u_ext = linear ? NULL : &qd->u_ext[0];
+
+    AsmList<double>* al_i = ctx->al[vfv->i];
+    int off_i = ctx->offset[vfv->i];
+    for (unsigned int ii = 0; ii < al_i->cnt; ii++)
+    {
+      if (al_i->dof[ii] < 0) continue;
+      ls->rhs[off_i + ii] += vfv->value(qd->np, &qd->jwt[0], u_ext, qd->fns[vfv->i][ii], qd->geom, ext) * al_i->coef[ii];
+    }
+    free_ext_fns(ext);
+    profile_form(ctx, id, start, qd->np);
+  }
+}
+
+void NativeDiscreteProblem::assemble_surface_forms(ThreadContext* ctx, Element* e, LocalSystem* ls)
+{
+  int n = ls->dofs.size();
+  bool linear = (coeff_vec == NULL);
+
+  for (unsigned int isurf = 0; isurf < e->nvert; isurf++)
+  {
+    if (!e->en[isurf]->bnd) continue;
+    std::string marker = mesh->get_boundary_markers_conversion().get_user_marker(e->en[isurf]->marker).marker;
+
+    // The reference edge has length 2, hence the factor 0.5.
+    for (unsigned int k = 0; want_matrix_forms && !ls->matrix_skipped && k < mfsurf.size(); k++)
+    {
+      MatrixFormSurf<double>* mfs = mfsurf[k];
+      if (!form_applies(mfs->areas, marker)) continue;
+
+      int id = mfvol.size() + k;
+      double start = profile_clock(ctx);
+      int order = calc_matrix_form_order(ctx, mfs, id, e);
+      profile_phase(ctx, AssemblyProfiler::ORDERS, start);
+      QuadratureData* qd = get_quadrature_data(ctx, order, isurf, e);
+      start = profile_clock(ctx);
+      ExtData<double>* ext = init_ext_fns(mfs->ext, e, qd->eo);
+      Func<double>** u_ext = linear ? NULL : &qd->u_ext[0];
+
+      AsmList<double>* al_i = ctx->al[mfs->i];
+      AsmList<double>* al_j = ctx->al[mfs->j];
+      int off_i = ctx->offset[mfs->i];
+      int off_j = ctx->offset[mfs->j];
+      for (unsigned int ii = 0; ii < al_i->cnt; ii++)
+      {
+        if (al_i->dof[ii] < 0) continue;
+        for (unsigned int jj = 0; jj < al_j->cnt; jj++)
+        {
+          if (!linear && al_j->dof[jj] < 0) continue;
+          double val = mfs->value(qd->np, &qd->jwt[0], u_ext, qd->fns[mfs->j][jj], qd->fns[mfs->i][ii], qd->geom, ext);
+          ls->mat[(off_i + ii) * n + off_j + jj] += 0.5 * val * al_i->coef[ii] * al_j->coef[jj];
+        }
+      }
+      free_ext_fns(ext);
+      profile_form(ctx, id, start, qd->np);
+    }
+
+    for (unsigned int k = 0; want_rhs && k < vfsurf.size(); k++)
+    {
+      VectorFormSurf<double>* vfs = vfsurf[k];
+      if (!form_applies(vfs->areas, marker)) continue;
+
+      int id = mfvol.size() + mfsurf.size() + vfvol.size() + k;
+      double start = profile_clock(ctx);
+      int order = calc_vector_form_order(ctx, vfs, id, e);
+      profile_phase(ctx, AssemblyProfiler::ORDERS, start);
+      QuadratureData* qd = get_quadrature_data(ctx, order, isurf, e);
+      start = profile_clock(ctx);
+      ExtData<double>* ext = init_ext_fns(vfs->ext, e, qd->eo);
+      Func<double>** u_ext = linear ? NULL : &qd->u_ext[0];
+
+      AsmList<double>* al_i = ctx->al[vfs->i];
+      int off_i = ctx->offset[vfs->i];
+      for (unsigned int ii = 0; ii < al_i->cnt; ii++)
+      {
+        if (al_i->dof[ii] < 0) continue;
+        double val = vfs->value(qd->np, &qd->jwt[0], u_ext, qd->fns[vfs->i][ii], qd->geom, ext);
+        ls->rhs[off_i + ii] += 0.5 * val * al_i->coef[ii];
+      }
+      free_ext_fns(ext);
+      profile_form(ctx, id, start, qd->np);
+    }
+  }
+}
+
+template<typename FormType>
+int NativeDiscreteProblem::calc_matrix_form_order(ThreadContext* ctx, FormType* form, int id, Element* e)
+{
+  int order;
+  if (find_form_order(ctx, id, form->ext, e, order))
+    return order;
+  int inc = ctx->refmap.is_jacobian_const() ? 0 : ctx->refmap.get_inv_ref_order();
+  if (fixed_orders[id] >= 0)
+    return store_form_order(ctx, id, limit_order(ctx, fixed_orders[id] + inc, e));
+
+  int neq = spaces.size();
+
+  Func<Ord>** u_ext_ord = new Func<Ord>*[neq];
+  for (int s = 0; s < neq; s++)
+    u_ext_ord[s] = init_fn_ord(ctx->fn_order[s]);
+  Func<Ord>* ou = init_fn_ord(ctx->fn_order[form->j]);
+  Func<Ord>* ov = init_fn_ord(ctx->fn_order[form->i]);
+  ExtData<Ord>* ext = init_ext_fns_ord(form->ext, e, 0);
+
+  double fake_wt = 1.0;
+  Ord o = form->ord(1, &fake_wt, u_ext_ord, ou, ov, ctx->geom_ord, ext);
+
+  free_ext_fns_ord(ext);
+  ou->free_ord();
+  delete ou;
+  ov->free_ord();
+  delete ov;
+  for (int s = 0; s < neq; s++)
+  {
+    u_ext_ord[s]->free_ord();
+    delete u_ext_ord[s];
+  }
+  delete [] u_ext_ord;
+
+  ctx->form_stats[id].evaluations++;
+  return store_form_order(ctx, id, limit_order(ctx, o.get_order() + inc, e));
+}
+
+template<typename FormType>
+int NativeDiscreteProblem::calc_vector_form_order(ThreadContext* ctx, FormType* form, int id, Element* e)
+{
+  int order;
+  if (find_form_order(ctx, id, form->ext, e, order))
+    return order;
+  int inc = ctx->refmap.is_jacobian_const() ? 0 : ctx->refmap.get_inv_ref_order();
+  if (fixed_orders[id] >= 0)
+    return store_form_order(ctx, id, limit_order(ctx, fixed_orders[id] + inc, e));
+
+  int neq = spaces.size();
+
+  Func<Ord>** u_ext_ord = new Func<Ord>*[neq];
+  for (int s = 0; s < neq; s++)
+    u_ext_ord[s] = init_fn_ord(ctx->fn_order[s]);
+  Func<Ord>* ov = init_fn_ord(ctx->fn_order[form->i]);
+  ExtData<Ord>* ext = init_ext_fns_ord(form->ext, e, 0);
+
+  double fake_wt = 1.0;
+  Ord o = form->ord(1, &fake_wt, u_ext_ord, ov, ctx->geom_ord, ext);
+
+  free_ext_fns_ord(ext);
+  ov->free_ord();
+  delete ov;
+  for (int s = 0; s < neq; s++)
+  {
+    u_ext_ord[s]->free_ord();
+    delete u_ext_ord[s];
+  }
+  delete [] u_ext_ord;
+
+  ctx->form_stats[id].evaluations++;
+  return store_form_order(ctx, id, limit_order(ctx, o.get_order() + inc, e));
+}
+
+bool NativeDiscreteProblem::find_form_order(ThreadContext* ctx, int id, Hermes::vector<MeshFunction<double>*>& ext,
+                                            Element* e, int& order)
+{
+  if (!use_order_cache)
+    return false;
+
+  FormOrderKey& key = ctx->order_key;
+  key.form = id;
+  key.mode = e->get_mode();
+  key.inc = ctx->refmap.is_jacobian_const() ? 0 : ctx->refmap.get_inv_ref_order();
+  key.orders.assign(ctx->fn_order.begin(), ctx->fn_order.end());
+  if (!ext.empty())
+  {
+    pthread_mutex_lock(&ext_mutex);
+    for (unsigned int k = 0; k < ext.size(); k++)
+    {
+      ext[k]->set_active_element(e);
+      key.orders.push_back(ext[k]->get_fn_order());
+    }
+    pthread_mutex_unlock(&ext_mutex);
+  }
+
+  std::map<FormOrderKey, int>::iterator it = ctx->form_orders.find(key);
+  if (it != ctx->form_orders.end())
+    order = it->second;
+  else if (order_cache.find(key, order))
+    ctx->form_orders[key] = order;
+  else
+    return false;
+  count_form_order(ctx, id, order);
+  return true;
+}
+
+int NativeDiscreteProblem::store_form_order(ThreadContext* ctx, int id, int order)
+{
+  if (use_order_cache)
+  {
+    ctx->form_orders[ctx->order_key] = order;
+    order_cache.insert(ctx->order_key, order);
+  }
+  count_form_order(ctx, id, order);
+  return order;
+}
+
+void NativeDiscreteProblem::count_form_order(ThreadContext* ctx, int id, int order)
+{
+  FormOrderStats& fs = ctx->form_stats[id];
+  int h_order = H2D_GET_H_ORDER(order);
+  if (fs.uses == 0 || h_order < fs.min_order)
+    fs.min_order = h_order;
+  fs.max_order = std::max(fs.max_order, h_order);
+  fs.uses++;
+}
+
+int NativeDiscreteProblem::limit_order(ThreadContext* ctx, int order, Element* e)
+{
+  int max_order = H2D_GET_H_ORDER(ctx->quad.get_max_order());
+  if (order > max_order)
+    order = max_order;
+  if (order < 0)
+    order = 0;
+  if (e->is_quad())
+    order = H2D_MAKE_QUAD_ORDER(order, order);
+  return order;
+}
+
+double NativeDiscreteProblem::profile_clock(ThreadContext* ctx)
+{
+  return ctx->profiling ? AssemblyProfiler::now() : 0.0;
+}
+
+void NativeDiscreteProblem::profile_phase(ThreadContext* ctx, AssemblyProfiler::Phase phase, double start, int points)
+{
+  if (!ctx->profiling) return;
+  AssemblyProfiler::Stats& stats = ctx->phase_stats[phase];
+  stats.time += AssemblyProfiler::now() - start;
+  stats.calls++;
+  stats.points += points;
+}
+
+void NativeDiscreteProblem::profile_form(ThreadContext* ctx, int id, double start, int points)
+{
+  if (!ctx->profiling) return;
+  AssemblyProfiler::Stats& stats = ctx->form_profile[id];
+  double elapsed = AssemblyProfiler::now() - start;
+  stats.time += elapsed;
+  stats.calls++;
+  stats.points += points;
+  ctx->phase_stats[AssemblyProfiler::FORMS].time += elapsed;
+  ctx->phase_stats[AssemblyProfiler::FORMS].calls++;
+  ctx->phase_stats[AssemblyProfiler::FORMS].points += points;
+}
+
+NativeDiscreteProblem::QuadratureData* NativeDiscreteProblem::get_quadrature_data(ThreadContext* ctx, int order, int isurf, Element* e)
+{
+  std::pair<int, int> key(order, isurf);
+  std::map<std::pair<int, int>, QuadratureData*>::iterator it = ctx->quad_data.find(key);
+  if (it != ctx->quad_data.end())
+    return it->second;
+
+  double start = profile_clock(ctx);
+  QuadratureData* qd = new QuadratureData;
+  qd->eo = (isurf < 0) ? order : ctx->quad.get_edge_points(isurf, order);
+  qd->np = ctx->quad.get_num_points(qd->eo);
+  double3* pt = ctx->quad.get_points(qd->eo);
+  qd->jwt.resize(qd->np);
+
+  if (isurf < 0)
+  {
+    qd->geom = init_geom_vol(&ctx->refmap, qd->eo);
+    if (ctx->refmap.is_jacobian_const())
+    {
+      double jac = ctx->refmap.get_const_jacobian();
+      for (int k = 0; k < qd->np; k++)
+        qd->jwt[k] = pt[k][2] * jac;
+    }
+    else
+    {
+      double* jac = ctx->refmap.get_jacobian(qd->eo);
+      for (int k = 0; k < qd->np; k++)
+        qd->jwt[k] = pt[k][2] * jac[k];
+    }
+  }
+  else
+  {
+    SurfPos surf_pos;
+    surf_pos.marker = e->en[isurf]->marker;
+    surf_pos.surf_num = isurf;
+    qd->geom = init_geom_surf(&ctx->refmap, &surf_pos, qd->eo);
+    double3* tan = ctx->refmap.get_tangent(isurf, qd->eo);
+    for (int k = 0; k < qd->np; k++)
+      qd->jwt[k] = pt[k][2] * tan[k][2];
+  }
+  profile_phase(ctx, AssemblyProfiler::GEOMETRY, start, qd->np);
+  start = profile_clock(ctx);
+
+  int neq = spaces.size();
+  qd->fns.resize(neq);
+  qd->soa_ready.assign(neq, false);
+  qd->soa_val.resize(neq);
+  qd->soa_dx.resize(neq);
+  qd->soa_dy.resize(neq);
+  for (int s = 0; s < neq; s++)
+  {
+    AsmList<double>* al = ctx->al[s];
+    qd->fns[s].resize(al->cnt);
+    for (unsigned int k = 0; k < al->cnt; k++)
+      qd->fns[s][k] = init_shape_fn(ctx, s, al->idx[k], qd, e);
+  }
+
+  // Previous Newton iterate, including the Dirichlet lift.
+  if (coeff_vec != NULL)
+  {
+    qd->u_ext.resize(neq);
+    for (int s = 0; s < neq; s++)
+    {
+      Func<double>* u = new Func<double>(qd->np, 1);
+      u->val = new double[qd->np];
+      u->dx = new double[qd->np];
+      u->dy = new double[qd->np];
+      std::fill(u->val, u->val + qd->np, 0.0);
+      std::fill(u->dx, u->dx + qd->np, 0.0);
+      std::fill(u->dy, u->dy + qd->np, 0.0);
+
+      AsmList<double>* al = ctx->al[s];
+      for (unsigned int k = 0; k < al->cnt; k++)
+      {
+        double c = (al->dof[k] >= 0) ? coeff_vec[get_system_dof(al->dof[k])] * al->coef[k] : al->coef[k];
+        Func<double>* fn = qd->fns[s][k];
+        for (int p = 0; p < qd->np; p++)
+        {
+          u->val[p] += c * fn->val[p];
+          u->dx[p] += c * fn->dx[p];
+          u->dy[p] += c * fn->dy[p];
+        }
+      }
+      qd->u_ext[s] = u;
+    }
+  }
+  profile_phase(ctx, AssemblyProfiler::SHAPE_FUNCTIONS, start, qd->np);
+
+  ctx->quad_data[key] = qd;
+  return qd;
+}
+
+const ReferenceTemplate* NativeDiscreteProblem::get_reference_template(ThreadContext* ctx, MatrixFormVol<double>* form,
+                                                                        int order, Element* e)
+{
+  AsmList<double>* al_u = ctx->al[form->j];
+  AsmList<double>* al_v = ctx->al[form->i];
+  ReferenceTemplateKey& key = ctx->template_key;
+  key.shapeset_u = spaces[form->j]->get_shapeset()->get_id();
+  key.shapeset_v = spaces[form->i]->get_shapeset()->get_id();
+  key.mode = e->get_mode();
+  key.order = order;
+  key.idx_u.assign(al_u->idx, al_u->idx + al_u->cnt);
+  key.idx_v.assign(al_v->idx, al_v->idx + al_v->cnt);
+
+  std::map<ReferenceTemplateKey, const ReferenceTemplate*>::iterator it = ctx->templates.find(key);
+  if (it != ctx->templates.end())
+    return it->second;
+  const ReferenceTemplate* tpl = template_cache.get(key, spaces[form->j]->get_shapeset(),
+                                                    spaces[form->i]->get_shapeset(), &ctx->quad);
+  ctx->templates[key] = tpl;
+  return tpl;
+}
+
+BasisBlock NativeDiscreteProblem::get_basis_block(QuadratureData* qd, int s)
+{
+  int n = qd->fns[s].size();
+  int np = qd->np;
+  if (!qd->soa_ready[s])
+  {
+    qd->soa_val[s].resize(n * np);
+    qd->soa_dx[s].resize(n * np);
+    qd->soa_dy[s].resize(n * np);
+    for (int k = 0; k < n; k++)
+    {
+      std::copy(qd->fns[s][k]->val, qd->fns[s][k]->val + np, qd->soa_val[s].begin() + k * np);
+      std::copy(qd->fns[s][k]->dx, qd->fns[s][k]->dx + np, qd->soa_dx[s].begin() + k * np);
+      std::copy(qd->fns[s][k]->dy, qd->fns[s][k]->dy + np, qd->soa_dy[s].begin() + k * np);
+    }
+    qd->soa_ready[s] = true;
+  }
+
+  BasisBlock block;
+  block.n = n;
+  block.np = np;
+  block.val = n > 0 ? &qd->soa_val[s][0] : NULL;
+  block.dx = n > 0 ? &qd->soa_dx[s][0] : NULL;
+  block.dy = n > 0 ? &qd->soa_dy[s][0] : NULL;
+  return block;
+}
+
+Func<double>* NativeDiscreteProblem::init_shape_fn(ThreadContext* ctx, int s, int index, QuadratureData* qd, Element* e)
+{
+  Shapeset* shapeset = spaces[s]->get_shapeset();
+  ShapeTableKey key(shapeset->get_id(), e->get_mode(), qd->eo, index);
+  const ShapeTable* table;
+  std::map<ShapeTableKey, const ShapeTable*>::iterator it = ctx->shape_tables.find(key);
+  if (it != ctx->shape_tables.end())
+    table = it->second;
+  else
+  {
+    table = shape_cache->get(shapeset, &ctx->quad, e->get_mode(), qd->eo, index);
+    ctx->shape_tables[key] = table;
+  }
+
+  int np = qd->np;
+  Func<double>* fn = new Func<double>(np, 1);
+  fn->val = new double[np];
+  fn->dx = new double[np];
+  fn->dy = new double[np];
+  std::copy(table->val.begin(), table->val.end(), fn->val);
+
+  // Derivatives are transformed by the inverse reference map.
+  if (ctx->refmap.is_jacobian_const())
+  {
+    double2x2* m = ctx->refmap.get_const_inv_ref_map();
+    for (int k = 0; k < np; k++)
+    {
+      fn->dx[k] = table->dx[k] * (*m)[0][0] + table->dy[k] * (*m)[0][1];
+      fn->dy[k] = table->dx[k] * (*m)[1][0] + table->dy[k] * (*m)[1][1];
+    }
+  }
+  else
+  {
+    double2x2* m = ctx->refmap.get_inv_ref_map(qd->eo);
+    for (int k = 0; k < np; k++)
+    {
+      fn->dx[k] = table->dx[k] * m[k][0][0] + table->dy[k] * m[k][0][1];
+      fn->dy[k] = table->dx[k] * m[k][1][0] + table->dy[k] * m[k][1][1];
+    }
+  }
+  return fn;
+}
+
+void NativeDiscreteProblem::free_quadrature_data(ThreadContext* ctx)
+{
+  std::map<std::pair<int, int>, QuadratureData*>::iterator it;
+  for (it = ctx->quad_data.begin(); it != ctx->quad_data.end(); it++)
+  {
+    QuadratureData* qd = it->second;
+    qd->geom->free();
+    delete qd->geom;
+    for (unsigned int s = 0; s < qd->fns.size(); s++)
+      for (unsigned int k = 0; k < qd->fns[s].size(); k++)
+      {
+        qd->fns[s][k]->free_fn();
+        delete qd->fns[s][k];
+      }
+    for (unsigned int s = 0; s < qd->u_ext.size(); s++)
+    {
+      qd->u_ext[s]->free_fn();
+      delete qd->u_ext[s];
+    }
+    delete qd;
+  }
+  ctx->quad_data.clear();
+}
+
+ExtData<double>* NativeDiscreteProblem::init_ext_fns(Hermes::vector<MeshFunction<double>*>& ext, Element* e, int order)
+{
+  ExtData<double>* ext_data = new ExtData<double>;
+  ext_data->nf = ext.size();
+  ext_data->fn = ext.empty() ? NULL : new Func<double>*[ext.size()];
+  if (ext.empty())
+    return ext_data;
+
+  // Mesh functions keep their active element, they are shared by all threads.
+  pthread_mutex_lock(&ext_mutex);
+  for (unsigned int k = 0; k < ext.size(); k++)
+  {
+    ext[k]->set_active_element(e);
+    ext_data->fn[k] = init_fn(ext[k], order);
+  }
+  pthread_mutex_unlock(&ext_mutex);
+  return ext_data;
+}
+
+ExtData<Ord>* NativeDiscreteProblem::init_ext_fns_ord(Hermes::vector<MeshFunction<double>*>& ext, Element* e, int inc)
+{
+  ExtData<Ord>* ext_data = new ExtData<Ord>;
+  ext_data->nf = ext.size();
+  ext_data->fn = ext.empty() ? NULL : new Func<Ord>*[ext.size()];
+  if (ext.empty())
+    return ext_data;
+
+  pthread_mutex_lock(&ext_mutex);
+  for (unsigned int k = 0; k < ext.size(); k++)
+  {
+    ext[k]->set_active_element(e);
+    ext_data->fn[k] = init_fn_ord(ext[k]->get_fn_order() + inc);
+  }
+  pthread_mutex_unlock(&ext_mutex);
+  return ext_data;
+}
+
+void NativeDiscreteProblem::free_ext_fns(ExtData<double>* ext)
+{
+  for (int k = 0; k < ext->nf; k++)
+  {
+    ext->fn[k]->free_fn();
+    delete ext->fn[k];
+  }
+  delete [] ext->fn;
+  delete ext;
+}
+
+void NativeDiscreteProblem::free_ext_fns_ord(ExtData<Ord>* ext)
+{
+  for (int k = 0; k < ext->nf; k++)
+  {
+    ext->fn[k]->free_ord();
+    delete ext->fn[k];
+  }
+  delete [] ext->fn;
+  delete ext;
+}
+
+NativeDiscreteProblem::ThreadContext* NativeDiscreteProblem::create_thread_context()
+{
+  int neq = spaces.size();
+  ThreadContext* ctx = new ThreadContext;
+  ctx->refmap.set_quad_2d(&ctx->quad);
+  ctx->al.resize(neq);
+  ctx->offset.resize(neq);
+  ctx->fn_order.resize(neq);
+  for (int s = 0; s < neq; s++)
+    ctx->al[s] = new AsmList<double>;
+  ctx->geom_ord = init_geom_ord();
+  ctx->condensation_failed = false;
+  ctx->num_skipped = 0;
+  ctx->num_integrated = 0;
+  ctx->form_stats.resize(form_stats.size());
+  for (unsigned int k = 0; k < form_stats.size(); k++)
+  {
+    ctx->form_stats[k].min_order = -1;
+    ctx->form_stats[k].max_order = -1;
+    ctx->form_stats[k].uses = 0;
+    ctx->form_stats[k].evaluations = 0;
+  }
+  ctx->profiling = (profiler != NULL);
+  if (ctx->profiling)
+    ctx->form_profile.resize(profile_names.size());
+  return ctx;
+}
+
+void NativeDiscreteProblem::free_thread_context(ThreadContext* ctx)
+{
+  for (unsigned int s = 0; s < ctx->al.size(); s++)
+    delete ctx->al[s];
+  delete ctx->geom_ord;
+  delete ctx;
+}
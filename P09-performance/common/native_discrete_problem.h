@@ -0,0 +1,547 @@
+#ifndef __P09_NATIVE_DISCRETE_PROBLEM_H
+#define __P09_NATIVE_DISCRETE_PROBLEM_H
+
+#include "hermes2d.h"
+#include "csr_matrix.h"
+#include "shape_table_cache.h"
+#include "batched_forms.h"
+#include "affine_templates.h"
+#include "form_order_cache.h"
+#include "assembly_profiler.h"
+#include "sparse_ordering.h"
+#include <pthread.h>
+#include <map>
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Discrete problem that assembles the weak form with several threads.
+///
+/// Elements are processed in batches. In the first phase of a batch every
+/// thread integrates the local matrices and vectors of its share of the
+/// elements. In the second phase every thread adds the local contributions
+/// to its own contiguous range of matrix rows (columns for CSC matrices)
+/// and of the right-hand side. No locks are needed, and since every entry
+/// receives its contributions in the order of the elements, the result is
+/// identical for any number of threads.
+///
+/// The class implements DiscreteProblemInterface, so it can be passed to
+/// the NewtonSolver in place of the DiscreteProblem. All spaces must be
+/// defined on the same mesh, and external functions of the forms must
+/// live on that mesh as well.
+///
+/// Shape functions are evaluated from the tables of the process-wide
+/// ShapeTableCache, so repeated assemblies, also by other instances of
+/// the class, do not recompute them. Matrix forms that implement the
+/// BatchedMatrixForm interface are evaluated for all pairs of basis
+/// functions of an element in one call. Forms with constant coefficients
+/// (AffineMatrixForm) are not integrated at all on elements with a constant
+/// Jacobian, their local matrices are contracted from reference templates.
+/// The sparsity pattern is computed again only when a space changes, and
+/// the integration order of a form is determined by its ord() once per
+/// combination of function orders and element type.
+class NativeDiscreteProblem : public DiscreteProblemInterface<double>
+{
+public:
+  NativeDiscreteProblem(const WeakForm<double>* wf, Space<double>* space);
+  NativeDiscreteProblem(const WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces);
+  virtual ~NativeDiscreteProblem();
+
+  /// Number of threads used by the assembly (1 by default).
+  void set_num_threads(int num_threads);
+  int get_num_threads() const { return num_threads; }
+
+  /// Number of elements integrated before the contributions are added
+  /// to the global system.
+  void set_batch_size(int batch_size);
+
+  /// Use value_batch() of forms that implement BatchedMatrixForm (default),
+  /// or always call value().
+  void set_batched_forms(bool use_batched_forms);
+
+  /// Use reference templates for forms that implement AffineMatrixForm on
+  /// elements with a constant Jacobian (default), or integrate them.
+  void set_affine_templates(bool use_affine_templates);
+
+  /// Templates kept by this problem, e.g. to read the statistics.
+  ReferenceTemplateCache* get_template_cache() { return &template_cache; }
+
+  /// Selective reassembly of the Jacobian in Newton's method. An element on
+  /// which no coefficient changed by more than tolerance * max |coeff_vec|
+  /// since it was last integrated keeps its contribution to the matrix,
+  /// other elements are integrated again and the difference to their old
+  /// contribution is added. This needs the local Jacobians of all elements
+  /// (n^2 values per element) and a copy of the matrix values, and works
+  /// with compressed (CSC or CSR) matrices whose structure did not change.
+  /// The residual is always assembled in full. Forms whose external
+  /// functions change between assemblies require invalidate_matrix().
+  /// 0 (default) integrates all elements.
+  void set_reassembly_tolerance(double tolerance);
+
+  /// Elements skipped and integrated by Jacobian assemblies since the
+  /// last reset.
+  unsigned long get_num_skipped_elements() const { return num_skipped_elements; }
+  unsigned long get_num_integrated_elements() const { return num_integrated_elements; }
+  void reset_reassembly_stats();
+
+  /// Assemble CSRMatrix targets as symmetric matrices that store the upper
+  /// triangle only (off by default). All volumetric matrix forms must be
+  /// declared HERMES_SYM, they are integrated once per pair of functions
+  /// anyway. Surface matrix forms have no symmetry flag in Hermes and
+  /// cannot be checked: they must be symmetric as well, the lower triangle
+  /// of their element matrices is dropped. Hermes matrices are always
+  /// stored in full.
+  void set_symmetric_storage(bool symmetric_storage);
+
+  /// Keep the sparsity pattern while the spaces do not change (default).
+  /// A matrix allocated for the pattern by the previous assembly keeps its
+  /// storage, only its values are set to zero.
+  void set_pattern_cache(bool use_pattern_cache);
+
+  /// Keep the integration orders of the forms (default). The ord() method
+  /// of a form must then depend on its arguments only.
+  void set_order_cache(bool use_order_cache);
+
+  /// Integrate the form with the given order instead of the one returned by
+  /// its ord(). The order is still increased on elements with a non-constant
+  /// Jacobian and limited to the maximum order of the quadrature. A negative
+  /// order restores ord(). The form must belong to the weak form.
+  void set_form_order(const Form<double>* form, int order);
+
+  /// Integration orders chosen for a form by the assemblies since the last
+  /// reset (orders of quadrilaterals in one direction).
+  struct FormOrderStats
+  {
+    std::string name;
+    int fixed_order;             ///< Order set by set_form_order(), -1 if none.
+    int min_order;               ///< -1 if the form was not used.
+    int max_order;
+    unsigned long uses;          ///< Elements and edges the form was integrated on.
+    unsigned long evaluations;   ///< Calls of ord().
+  };
+  const std::vector<FormOrderStats>& get_form_order_stats() const { return form_stats; }
+  void reset_form_order_stats();
+
+  /// Prints the statistics of all forms, one line per form.
+  void print_form_orders();
+
+  /// Wall clock time of the phases of all assemblies since the last reset.
+  struct AssemblyTimes
+  {
+    double pattern;              ///< Computation of sparsity patterns.
+    double allocation;           ///< Allocation of matrices, or zeroing of reused ones.
+    double integration;          ///< Integration and addition to the global system.
+    double vector_integration;   ///< The part of integration spent by assemblies without a matrix.
+    int num_patterns;            ///< Number of computed patterns.
+    int num_allocations;         ///< Number of allocated matrices.
+    int num_matrix_assemblies;   ///< Number of assemblies with a matrix.
+    int num_vector_assemblies;   ///< Number of assemblies of the residual (right-hand side) only.
+  };
+  const AssemblyTimes& get_assembly_times() const { return times; }
+  void reset_assembly_times();
+
+  /// Adds detailed timings of every assembly to the profiler (NULL, the
+  /// default, switches the measurements off). The profiler is not owned,
+  /// it may collect the assemblies of several problems.
+  void set_profiler(AssemblyProfiler* profiler);
+  AssemblyProfiler* get_profiler() const { return profiler; }
+
+  /// Static condensation of the bubble functions of H1 spaces (off by
+  /// default). A bubble couples only with the functions of its element, so
+  /// every element eliminates its bubbles from the local system before the
+  /// system is added to the global one. The global system then contains the
+  /// vertex and edge functions only, get_num_dofs() returns their number.
+  /// The bubbles are recovered from the solution of the global system by
+  /// get_space_vector(). Linear problems only, the local matrix of the
+  /// bubbles of every element must be regular.
+  void set_static_condensation(bool static_condensation);
+  bool get_static_condensation() const { return static_condensation; }
+
+  /// Renumbering of the DOFs of the global system (DOF_ORDERING_NATURAL by
+  /// default). The ordering is computed from the graph of the matrix
+  /// whenever the spaces change. RCM gives a small bandwidth and thus good
+  /// locality of the vectors in matrix-vector products, nested dissection
+  /// a small fill-in of direct factorizations (see also
+  /// LDLTSolver::set_reordering()). Matrices, right-hand sides and
+  /// coefficient vectors of assemble() are numbered as the global system,
+  /// get_space_vector() and get_system_vector() convert to and from the
+  /// numbering of the spaces, which Solution::vector_to_solution() and the
+  /// projections use. Helpers that derive structure from the spaces, e.g.
+  /// get_block_offsets(), need the natural ordering; PMultigridPreconditioner
+  /// needs the problem to renumber its data.
+  void set_dof_ordering(DofOrdering dof_ordering);
+  DofOrdering get_dof_ordering() const { return dof_ordering; }
+
+  /// Number of DOFs of the spaces, bubbles included.
+  int get_num_space_dofs();
+
+  /// Coefficient vector of the spaces (get_num_space_dofs() entries) from a
+  /// vector of the global system, e.g. its solution. Without static
+  /// condensation the entries are just renumbered. Otherwise the bubbles of
+  /// every element are computed from the local systems of the last
+  /// assembly, x_b = K_bb^{-1} (f_b - K_bi x_i), which must have included
+  /// the right-hand side.
+  void get_space_vector(const double* sln, double* space_sln);
+
+  /// Vector of the global system from a coefficient vector of the spaces,
+  /// e.g. a projection used as the initial guess of Newton's method. The
+  /// coefficients of condensed bubbles are dropped.
+  void get_system_vector(const double* space_sln, double* sln);
+
+  /// Memory of the local data kept for get_space_vector(), in bytes.
+  size_t get_condensation_memory_size() const;
+
+  virtual int get_num_dofs();
+  virtual bool is_matrix_free() { return false; }
+
+  /// The next Jacobian assembly integrates all elements.
+  virtual void invalidate_matrix();
+
+  /// Assembles the Jacobian matrix and the residual vector for the
+  /// coefficient vector coeff_vec. If coeff_vec is NULL, the problem is
+  /// treated as linear: the matrix and the right-hand side are assembled,
+  /// and the Dirichlet lift is moved to the right-hand side.
+  virtual void assemble(double* coeff_vec, SparseMatrix<double>* mat, Vector<double>* rhs = NULL,
+                        bool force_diagonal_blocks = false, Table* block_weights = NULL);
+
+  /// Assembles the residual vector only.
+  virtual void assemble(double* coeff_vec, Vector<double>* rhs = NULL,
+                        bool force_diagonal_blocks = false, Table* block_weights = NULL);
+
+  /// Linear problems.
+  void assemble(SparseMatrix<double>* mat, Vector<double>* rhs = NULL);
+
+  /// Assembles into native storage. The matrix is created with the
+  /// sparsity pattern of the problem, rhs must hold get_num_dofs() entries.
+  /// Either of mat and rhs may be NULL.
+  void assemble(double* coeff_vec, CSRMatrix<double>* mat, double* rhs);
+
+  /// Assembles the residual F(coeff_vec) alone into residual, which must
+  /// hold get_num_dofs() entries, e.g. for the convergence test of Newton's
+  /// method or the trial steps of a line search. Matrix forms are neither
+  /// evaluated nor asked for their orders, no sparsity pattern is computed
+  /// and no matrix is touched, the vector is summed in place. If coeff_vec
+  /// is NULL, this is the right-hand side of a linear problem, for which
+  /// the matrix forms are integrated on elements with Dirichlet DOFs only
+  /// (the lift).
+  void assemble_residual(double* coeff_vec, double* residual);
+
+  /// Sparsity pattern of the matrix in CSR format (the upper triangle with
+  /// symmetric storage).
+  void get_sparsity_pattern(std::vector<int>& row_ptr, std::vector<int>& col_idx);
+
+protected:
+  /// Local matrix and vector of one element. The local numbering
+  /// concatenates the assembly lists of all spaces.
+  struct LocalSystem
+  {
+    std::vector<int> dofs;
+    std::vector<double> mat;
+    std::vector<double> rhs;
+    bool matrix_skipped;
+  };
+
+  /// What static condensation keeps of an element: its bubbles (DOFs of the
+  /// spaces), its other DOFs (numbered globally), K_bb^{-1} K_bi stored by
+  /// rows and K_bb^{-1} f_b.
+  struct CondensedElement
+  {
+    std::vector<int> bubbles;
+    std::vector<int> dofs;
+    std::vector<double> coupling;
+    std::vector<double> rhs;
+  };
+
+  /// Local Jacobian of an element as it is contained in the matrix, and
+  /// the coefficients it was computed for.
+  struct StoredJacobian
+  {
+    std::vector<double> coeffs;
+    std::vector<double> mat;
+  };
+
+  /// Basis functions, geometry and integration weights on the active
+  /// element for one integration order (volume) or one edge and order.
+  struct QuadratureData
+  {
+    int eo;
+    int np;
+    Geom<double>* geom;
+    std::vector<double> jwt;
+    std::vector<std::vector<Func<double>*> > fns;
+    std::vector<Func<double>*> u_ext;
+
+    /// The same functions as structure of arrays, filled on demand.
+    std::vector<bool> soa_ready;
+    std::vector<std::vector<double> > soa_val, soa_dx, soa_dy;
+  };
+
+  /// Everything a thread needs to integrate elements on its own. Hermes
+  /// quadratures keep the active element mode, so every thread has its own.
+  /// Shape tables taken from the cache are remembered for the rest of the
+  /// assembly, so the cache is locked only once per table and thread.
+  struct ThreadContext
+  {
+    Quad2DStd quad;
+    RefMap refmap;
+    std::map<ShapeTableKey, const ShapeTable*> shape_tables;
+    std::map<ReferenceTemplateKey, const ReferenceTemplate*> templates;
+    ReferenceTemplateKey template_key;
+    std::map<FormOrderKey, int> form_orders;
+    FormOrderKey order_key;
+    std::vector<FormOrderStats> form_stats;
+    std::vector<double> form_values;
+    std::vector<AsmList<double>*> al;
+    std::vector<int> offset;
+    std::vector<int> fn_order;
+    std::map<std::pair<int, int>, QuadratureData*> quad_data;
+    Geom<Ord>* geom_ord;
+    std::vector<int> bubble_pos, other_pos;
+    std::vector<double> bubble_mat, bubble_rhs;
+    bool condensation_failed;
+    unsigned long num_skipped;
+    unsigned long num_integrated;
+
+    /// Measurements of the thread, added to the profiler after the assembly.
+    bool profiling;
+    AssemblyProfiler::Stats phase_stats[AssemblyProfiler::NUM_PHASES];
+    std::vector<AssemblyProfiler::Stats> form_profile;
+  };
+
+  /// Where the second phase adds matrix entries. Compressed storage (CSR or
+  /// CSC) is filled directly; any other Hermes matrix is filled serially.
+  struct MatrixTarget
+  {
+    double* values;
+    const int* ptr;
+    const int* idx;
+    bool column_major;
+    bool upper;
+    SparseMatrix<double>* fallback;
+  };
+
+  struct ThreadArgs
+  {
+    NativeDiscreteProblem* dp;
+    int thread;
+  };
+
+  /// Copy of an exception of an assembly thread that keeps its type, so
+  /// that assemble() can throw it again in the calling thread.
+  class ThreadException
+  {
+  public:
+    virtual ~ThreadException() {}
+    virtual void rethrow() const = 0;
+  };
+
+  template<typename T>
+  class ThreadExceptionCopy : public ThreadException
+  {
+  public:
+    ThreadExceptionCopy(const T& exception) : exception(exception) {}
+    virtual void rethrow() const { throw exception; }
+
+  protected:
+    T exception;
+  };
+
+  void init(const WeakForm<double>* wf);
+
+  /// Checks the spaces and external functions, collects active elements.
+  void prepare();
+
+  /// Assembly common to all public variants. The right-hand side (if rhs
+  /// is not NULL) is summed directly into rhs. If patch is true, the target
+  /// matrix has the structure of the previous selective assembly and only
+  /// changed elements are integrated.
+  void assemble(double* coeff_vec, MatrixTarget* target, double* rhs, bool patch);
+
+  /// Computes the sparsity pattern, unless the spaces did not change
+  /// since it was computed last time.
+  void update_sparsity_pattern();
+
+  /// Was the matrix allocated for the current pattern by this problem?
+  bool has_pattern_storage(const void* mat, int size, int nnz);
+
+  /// Can the previous selective assembly be updated into a matrix of the
+  /// given size and number of nonzeros?
+  bool can_patch(double* coeff_vec, int size, int nnz);
+
+  /// Body of one assembly thread. An exception does not leave the thread:
+  /// the first one is kept for assemble() to rethrow, and the threads pass
+  /// all barriers without further work.
+  void run_thread(int thread);
+  void run_batches(int thread);
+  static void* thread_entry(void* args);
+
+  /// Computes the local system of element e.
+  void assemble_element(ThreadContext* ctx, int index, LocalSystem* ls);
+  void assemble_volume_forms(ThreadContext* ctx, Element* e, LocalSystem* ls, const std::string& marker);
+  void assemble_surface_forms(ThreadContext* ctx, Element* e, LocalSystem* ls);
+
+  /// Does the global system number the DOFs differently from the spaces?
+  bool has_dof_map() const { return static_condensation || dof_ordering != DOF_ORDERING_NATURAL; }
+
+  /// Numbers the DOFs of the global system when the spaces changed.
+  void update_dof_map();
+
+  /// Row of the global system of a DOF of the spaces (-1 for bubbles with
+  /// static condensation, negative for Dirichlet lifts).
+  int get_system_dof(int dof) const { return (dof >= 0 && has_dof_map()) ? system_dof[dof] : dof; }
+
+  /// Sparsity pattern of a global system of the given size in the current
+  /// numbering, the upper triangle only if upper is true.
+  void build_pattern(int size, bool upper, std::vector<int>& row_ptr, std::vector<int>& col_idx);
+
+  /// Eliminates the bubbles from the local system of the element with the
+  /// given index and numbers its DOFs globally.
+  void condense_element(ThreadContext* ctx, int index, LocalSystem* ls);
+
+  /// Adds the local systems of the current batch to the global system,
+  /// restricted to the range owned by the thread.
+  void scatter_batch(int thread, int first, int last);
+
+  /// Integration order of a form on the active element. Forms are numbered
+  /// in the order mfvol, mfsurf, vfvol, vfsurf.
+  template<typename FormType>
+  int calc_matrix_form_order(ThreadContext* ctx, FormType* form, int id, Element* e);
+  template<typename FormType>
+  int calc_vector_form_order(ThreadContext* ctx, FormType* form, int id, Element* e);
+  int limit_order(ThreadContext* ctx, int order, Element* e);
+
+  /// Measurements: the clock reads 0 if the thread does not profile, the
+  /// others add the time since start to a phase or to the form with the id.
+  double profile_clock(ThreadContext* ctx);
+  void profile_phase(ThreadContext* ctx, AssemblyProfiler::Phase phase, double start, int points = 0);
+  void profile_form(ThreadContext* ctx, int id, double start, int points);
+
+  /// Looks up the order of the form in the caches, the key is left in
+  /// ctx->order_key. store_form_order() records an order that was not found.
+  bool find_form_order(ThreadContext* ctx, int id, Hermes::vector<MeshFunction<double>*>& ext, Element* e,
+                       int& order);
+  int store_form_order(ThreadContext* ctx, int id, int order);
+  void count_form_order(ThreadContext* ctx, int id, int order);
+
+  QuadratureData* get_quadrature_data(ThreadContext* ctx, int order, int isurf, Element* e);
+
+  /// Reference template of the form on the active (affine) element.
+  const ReferenceTemplate* get_reference_template(ThreadContext* ctx, MatrixFormVol<double>* form, int order,
+                                                  Element* e);
+
+  /// Functions of space s as structure of arrays.
+  BasisBlock get_basis_block(QuadratureData* qd, int s);
+
+  /// Shape function of space s with the given index at the points of the
+  /// quadrature data, transformed to the physical element.
+  Func<double>* init_shape_fn(ThreadContext* ctx, int s, int index, QuadratureData* qd, Element* e);
+  void free_quadrature_data(ThreadContext* ctx);
+
+  ExtData<double>* init_ext_fns(Hermes::vector<MeshFunction<double>*>& ext, Element* e, int order);
+  ExtData<Ord>* init_ext_fns_ord(Hermes::vector<MeshFunction<double>*>& ext, Element* e, int inc);
+  void free_ext_fns(ExtData<double>* ext);
+  void free_ext_fns_ord(ExtData<Ord>* ext);
+
+  ThreadContext* create_thread_context();
+  void free_thread_context(ThreadContext* ctx);
+
+  /// Waits until all threads reach the same point.
+  void barrier();
+
+  /// Keeps the first exception of the threads of an assembly (and deletes
+  /// the others), and tells whether one was thrown.
+  void set_thread_exception(ThreadException* e);
+  bool has_thread_exception();
+
+  /// Assembles the elements of one thread in a batch; exceptions are kept
+  /// by set_thread_exception().
+  void assemble_batch(int thread, int first, int last);
+
+  const WeakForm<double>* wf;
+  Hermes::vector<MatrixFormVol<double>*> mfvol;
+  Hermes::vector<MatrixFormSurf<double>*> mfsurf;
+  Hermes::vector<VectorFormVol<double>*> vfvol;
+  Hermes::vector<VectorFormSurf<double>*> vfsurf;
+  std::vector<BatchedMatrixForm*> mfvol_batched;
+  bool use_batched_forms;
+  std::vector<AffineMatrixForm*> mfvol_affine;
+  bool use_affine_templates;
+  ReferenceTemplateCache template_cache;
+  bool use_order_cache;
+  FormOrderCache order_cache;
+  std::vector<int> fixed_orders;
+  std::vector<FormOrderStats> form_stats;
+  Hermes::vector<Space<double>*> spaces;
+  Mesh* mesh;
+  int ndof;
+
+  ShapeTableCache* shape_cache;
+
+  int num_threads;
+  int batch_size;
+
+  bool symmetric_storage;
+
+  /// Cached sparsity pattern, and the matrix that was last allocated for it.
+  bool use_pattern_cache;
+  bool pattern_valid;
+  std::vector<int> pattern_row_ptr;
+  std::vector<int> pattern_col_idx;
+  std::vector<int> pattern_seq;
+  unsigned long pattern_version;
+  const void* storage_matrix;
+  unsigned long storage_version;
+  AssemblyTimes times;
+  AssemblyProfiler* profiler;
+  std::vector<std::string> profile_names;
+
+  /// Selective reassembly.
+  double reassembly_tolerance;
+  std::vector<StoredJacobian> stored_jacobians;
+  std::vector<double> stored_values;
+  std::vector<int> stored_seq;
+  bool stored_valid;
+  unsigned long num_skipped_elements;
+  unsigned long num_integrated_elements;
+
+  /// Static condensation and ordering: global DOF of every DOF of the
+  /// spaces (-1 for bubbles), and the data of the elements for the
+  /// recovery of the bubbles.
+  bool static_condensation;
+  DofOrdering dof_ordering;
+  std::vector<int> system_dof;
+  std::vector<int> dof_map_seq;
+  int num_system_dofs;
+  std::vector<CondensedElement> condensed_elements;
+  bool condensed_rhs_valid;
+
+  /// Blocks (i, j) of the matrix that have a form.
+  std::vector<std::vector<bool> > block_used;
+
+  /// State of the assembly in progress.
+  std::vector<Element*> elements;
+  std::vector<ThreadContext*> contexts;
+  std::vector<LocalSystem> batch;
+  std::vector<int> dof_range;
+  double* coeff_vec;
+  bool want_matrix;
+  bool want_matrix_forms;
+  bool want_rhs;
+  bool selective;
+  bool patching;
+  double coeff_scale;
+  MatrixTarget* target;
+  double* rhs_values;
+  std::vector<double> rhs_buffer;
+
+  pthread_mutex_t ext_mutex;
+  pthread_mutex_t curved_mutex;
+  pthread_mutex_t barrier_mutex;
+  pthread_cond_t barrier_cond;
+  int barrier_waiting;
+  int barrier_generation;
+  int num_active_threads;
+  ThreadException* thread_exception;
+};
+
+#endif
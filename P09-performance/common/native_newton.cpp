@@ -0,0 +1,372 @@
+#include "native_newton.h"
+#include "iterative_solver.h"
+#include <cmath>
+
+const char* get_newton_forcing_name(NewtonForcingType type)
+{
+  switch (type)
+  {
+  case NEWTON_FORCING_NONE: return "none";
+  case NEWTON_FORCING_EISENSTAT_WALKER_1: return "Eisenstat-Walker 1";
+  case NEWTON_FORCING_EISENSTAT_WALKER_2: return "Eisenstat-Walker 2";
+  }
+  return "unknown";
+}
+
+NewtonForcing::NewtonForcing(NewtonForcingType type)
+  : type(type), eta_initial(0.5), eta_max(0.9), gamma(0.9), alpha(2.0), num_steps(0), eta(0.0), residual_norm(0.0),
+    linear_residual_norm(0.0)
+{
+}
+
+double NewtonForcing::next(double residual_norm, double newton_tol)
+{
+  double eta_new = eta_initial;
+  if (num_steps > 0 && type == NEWTON_FORCING_EISENSTAT_WALKER_1)
+  {
+    eta_new = std::abs(residual_norm - linear_residual_norm) / this->residual_norm;
+    double safeguard = std::pow(eta, 0.5 * (1.0 + std::sqrt(5.0)));
+    if (safeguard > 0.1)
+      eta_new = std::max(eta_new, safeguard);
+  }
+  else if (num_steps > 0 && type == NEWTON_FORCING_EISENSTAT_WALKER_2)
+  {
+    eta_new = gamma * std::pow(residual_norm / this->residual_norm, alpha);
+    double safeguard = gamma * std::pow(eta, alpha);
+    if (safeguard > 0.1)
+      eta_new = std::max(eta_new, safeguard);
+  }
+  eta_new = std::min(eta_new, eta_max);
+
+  // A residual of newton_tol / 2 is enough for the last step.
+  if (residual_norm > 0.0)
+    eta_new = std::min(eta_max, std::max(eta_new, 0.5 * newton_tol / residual_norm));
+
+  eta = eta_new;
+  this->residual_norm = residual_norm;
+  num_steps++;
+  return eta;
+}
+
+NativeNewtonSolver::NativeNewtonSolver(NativeDiscreteProblem* dp, NativeSolverType solver_type)
+  : dp(dp), solver_type(solver_type), max_contraction(0.0), max_reuse(0), prediction_factor(1.0),
+    globalization(NEWTON_GLOBALIZATION_NONE), armijo(1e-4), min_step_length(1e-4), initial_trust_radius(0.0),
+    trust_radius(0.0), verbose_output(true), sln_vector(NULL), num_iterations(0), num_linear_iterations(0),
+    num_jacobian_assemblies(0), num_jacobian_reuses(0), num_residual_assemblies(0), num_step_reductions(0),
+    num_predictions(0), num_wrong_predictions(0), linear_solver_time(0.0)
+{
+  residual.resize(std::max(1, dp->get_num_dofs()));
+  linear_solver = create_native_linear_solver(solver_type, &jacobian, &residual[0]);
+}
+
+NativeNewtonSolver::~NativeNewtonSolver()
+{
+  delete linear_solver;
+  delete [] sln_vector;
+}
+
+void NativeNewtonSolver::set_jacobian_reuse(double max_contraction, int max_reuse)
+{
+  this->max_contraction = max_contraction;
+  this->max_reuse = std::max(0, max_reuse);
+}
+
+void NativeNewtonSolver::set_globalization(NewtonGlobalizationType globalization)
+{
+  this->globalization = globalization;
+}
+
+void NativeNewtonSolver::set_line_search_parameters(double armijo, double min_step_length)
+{
+  this->armijo = armijo;
+  this->min_step_length = min_step_length;
+}
+
+/// Restores the tolerance of an IterativeSolver when the Newton iteration
+/// ends, also by an exception.
+class ToleranceGuard
+{
+public:
+  ToleranceGuard(IterativeSolver* solver) : solver(solver), tolerance(solver != NULL ? solver->get_tolerance() : 0.0) {}
+  ~ToleranceGuard() { if (solver != NULL) solver->set_tolerance(tolerance); }
+
+private:
+  IterativeSolver* solver;
+  double tolerance;
+};
+
+void NativeNewtonSolver::solve(double* coeff_vec, double newton_tol, int newton_max_iter)
+{
+  int ndof = dp->get_num_dofs();
+  if ((int) residual.size() < ndof)
+    throw Hermes::Exceptions::Exception("The number of DOFs changed since NativeNewtonSolver was created.");
+
+  // The iteration works in the numbering of the global system, which may
+  // differ from the one of the spaces (see set_dof_ordering()).
+  coeffs.assign(std::max(1, ndof), 0.0);
+  if (coeff_vec != NULL)
+    dp->get_system_vector(coeff_vec, &coeffs[0]);
+  if (globalization != NEWTON_GLOBALIZATION_NONE)
+  {
+    trial_coeffs.resize(coeffs.size());
+    trial_residual.resize(coeffs.size());
+  }
+  if (globalization == NEWTON_GLOBALIZATION_DOGLEG)
+  {
+    gradient.resize(coeffs.size());
+    step.resize(coeffs.size());
+    work.resize(coeffs.size());
+  }
+  trust_radius = initial_trust_radius;
+
+  // The forcing term applies to iterative solvers only.
+  IterativeSolver* iterative = dynamic_cast<IterativeSolver*>(linear_solver);
+  bool inexact = (iterative != NULL && forcing.get_type() != NEWTON_FORCING_NONE);
+  ToleranceGuard tolerance_guard(inexact ? iterative : NULL);
+  forcing.reset();
+
+  bool chord = (max_contraction > 0.0);
+  double last_residual_norm = 0.0, previous_residual_norm = 0.0;
+  int reuse = 0;
+
+  // The globalization leaves the residual of the accepted step in place,
+  // and asks for a new Jacobian when it fails with a reused one.
+  bool have_residual = false;
+  bool force_refresh = false;
+
+  num_iterations = 0;
+  num_linear_iterations = 0;
+  num_jacobian_assemblies = 0;
+  num_jacobian_reuses = 0;
+  num_residual_assemblies = 0;
+  num_step_reductions = 0;
+  num_predictions = 0;
+  num_wrong_predictions = 0;
+  linear_solver_time = 0.0;
+  while (true)
+  {
+    // The Jacobian is assembled with the residual in one pass over the
+    // elements, unless the chord method may reuse the last one or the last
+    // contraction predicts convergence. Then the residual comes alone, as
+    // after an accepted globalized step.
+    bool predicted = (!have_residual && !chord && num_iterations >= 2 && last_residual_norm * last_residual_norm
+                      < prediction_factor * newton_tol * previous_residual_norm);
+    bool have_jacobian = false;
+    if (!have_residual && !predicted && (!chord || num_iterations == 0))
+    {
+      dp->assemble(&coeffs[0], &jacobian, &residual[0]);
+      num_jacobian_assemblies++;
+      num_residual_assemblies++;
+      have_jacobian = true;
+    }
+    else if (!have_residual)
+    {
+      dp->assemble_residual(&coeffs[0], &residual[0]);
+      num_residual_assemblies++;
+    }
+    double residual_norm = vector_norm(ndof, &residual[0]);
+    if (verbose_output)
+      info("---- Newton iter %d, ndof %d, residual norm %g", num_iterations + 1, ndof, residual_norm);
+    if (predicted)
+    {
+      num_predictions++;
+      if (residual_norm >= newton_tol)
+        num_wrong_predictions++;
+    }
+    if (residual_norm < newton_tol)
+      break;
+    if (num_iterations >= newton_max_iter)
+      throw Hermes::Exceptions::Exception("Newton's iteration did not converge.");
+
+    bool reused = false;
+    if (have_jacobian)
+      reuse = 0;
+    else if (chord && !force_refresh && num_iterations > 0 && residual_norm <= max_contraction * last_residual_norm
+        && (max_reuse == 0 || reuse < max_reuse))
+    {
+      reuse++;
+      num_jacobian_reuses++;
+      reused = true;
+    }
+    else
+    {
+      if (verbose_output && chord && num_iterations > 0)
+        info("---- Jacobian refreshed (contraction %g, reused %d times).", residual_norm / last_residual_norm,
+             reuse);
+      dp->assemble(&coeffs[0], &jacobian, (double*) NULL);
+      num_jacobian_assemblies++;
+      reuse = 0;
+    }
+    previous_residual_norm = last_residual_norm;
+    last_residual_norm = residual_norm;
+    force_refresh = false;
+
+    // J delta = -F. An inexact step only has to reduce the linear residual
+    // below eta |F|, it is taken also if the solver did not get there.
+    for (int i = 0; i < ndof; i++)
+      residual[i] = -residual[i];
+    double eta = 0.0;
+    if (inexact)
+    {
+      eta = forcing.next(residual_norm, newton_tol);
+      iterative->set_tolerance(eta);
+    }
+    bool converged = linear_solver->solve();
+    if (!converged && !(inexact && iterative->get_residual_norm() < residual_norm))
+      throw Hermes::Exceptions::Exception("The %s solver failed in Newton's iteration.",
+                                          get_native_solver_name(solver_type));
+    linear_solver_time += linear_solver->get_time();
+    if (iterative != NULL)
+    {
+      num_linear_iterations += iterative->get_num_iterations();
+      forcing.set_linear_residual_norm(iterative->get_residual_norm());
+    }
+    if (verbose_output && inexact)
+      info("---- %s: %d iterations, forcing term %g.", get_native_solver_name(solver_type),
+           iterative->get_num_iterations(), eta);
+    else if (verbose_output && iterative != NULL)
+      info("---- %s: %d iterations.", get_native_solver_name(solver_type), iterative->get_num_iterations());
+
+    double* delta = linear_solver->get_sln_vector();
+    num_iterations++;
+    if (globalization == NEWTON_GLOBALIZATION_NONE)
+    {
+      for (int i = 0; i < ndof; i++)
+        coeffs[i] += delta[i];
+      continue;
+    }
+
+    bool accepted = (globalization == NEWTON_GLOBALIZATION_LINE_SEARCH)
+      ? line_search(ndof, delta, residual_norm) : dogleg_step(ndof, delta, residual_norm);
+    if (accepted)
+      std::copy(trial_residual.begin(), trial_residual.begin() + ndof, residual.begin());
+    else
+    {
+      // The step of a reused Jacobian may just be poor, a new one is tried
+      // from the same iterate.
+      if (!reused)
+        throw Hermes::Exceptions::Exception("The %s found no step that reduces the residual.",
+                                            globalization == NEWTON_GLOBALIZATION_LINE_SEARCH ? "line search" :
+                                            "trust region");
+      for (int i = 0; i < ndof; i++)
+        residual[i] = -residual[i];
+      force_refresh = true;
+    }
+    have_residual = true;
+  }
+
+  delete [] sln_vector;
+  sln_vector = new double[dp->get_num_space_dofs()];
+  dp->get_space_vector(&coeffs[0], sln_vector);
+}
+
+bool NativeNewtonSolver::line_search(int ndof, const double* delta, double residual_norm)
+{
+  // Backtracking from the full step. The next length minimizes the
+  // quadratic through |F(u)|^2, its slope -2 |F(u)|^2 along the Newton step
+  // and |F(u + t delta)|^2, kept within [0.1 t, 0.5 t].
+  double f0 = residual_norm * residual_norm;
+  double t = 1.0;
+  while (true)
+  {
+    for (int i = 0; i < ndof; i++)
+      trial_coeffs[i] = coeffs[i] + t * delta[i];
+    dp->assemble_residual(&trial_coeffs[0], &trial_residual[0]);
+    num_residual_assemblies++;
+    double trial_norm = vector_norm(ndof, &trial_residual[0]);
+    if (trial_norm <= (1.0 - armijo * t) * residual_norm)
+    {
+      if (verbose_output && t < 1.0)
+        info("---- Line search: step length %g.", t);
+      coeffs.swap(trial_coeffs);
+      return true;
+    }
+    if (t <= min_step_length)
+      return false;
+
+    double denominator = trial_norm * trial_norm - f0 + 2.0 * f0 * t;
+    double t_min = (denominator > 0.0) ? f0 * t * t / denominator : 0.5 * t;
+    t = std::max(0.1 * t, std::min(0.5 * t, t_min));
+    num_step_reductions++;
+  }
+}
+
+bool NativeNewtonSolver::dogleg_step(int ndof, const double* delta, double residual_norm)
+{
+  // The residual holds -F. The steepest descent direction of |F|^2 / 2 is
+  // -g, g = J^T F, and the Cauchy point minimizes the linear model along
+  // it: s_C = -(|g|^2 / |J g|^2) g.
+  jacobian.multiply_transpose(&residual[0], &gradient[0]);
+  for (int i = 0; i < ndof; i++)
+    gradient[i] = -gradient[i];
+  jacobian.multiply(&gradient[0], &work[0]);
+  double g_norm = vector_norm(ndof, &gradient[0]);
+  double jg_norm = vector_norm(ndof, &work[0]);
+  double cauchy_scale = (jg_norm > 0.0) ? (g_norm * g_norm) / (jg_norm * jg_norm) : 0.0;
+  double newton_norm = vector_norm(ndof, delta);
+  if (trust_radius <= 0.0)
+    trust_radius = newton_norm;
+  double f0 = residual_norm * residual_norm;
+
+  while (true)
+  {
+    // The dogleg path from 0 to s_C to the Newton step, cut by the radius.
+    if (newton_norm <= trust_radius || g_norm == 0.0)
+      std::copy(delta, delta + ndof, step.begin());
+    else if (cauchy_scale * g_norm >= trust_radius)
+    {
+      for (int i = 0; i < ndof; i++)
+        step[i] = -trust_radius / g_norm * gradient[i];
+    }
+    else
+    {
+      // s = s_C + tau (s_N - s_C) with |s| = radius.
+      double a = 0.0, b = 0.0, c = 0.0;
+      for (int i = 0; i < ndof; i++)
+      {
+        double s_c = -cauchy_scale * gradient[i];
+        double d = delta[i] - s_c;
+        a += d * d;
+        b += 2.0 * s_c * d;
+        c += s_c * s_c;
+      }
+      c -= trust_radius * trust_radius;
+      double tau = (-b + std::sqrt(std::max(0.0, b * b - 4.0 * a * c))) / (2.0 * a);
+      for (int i = 0; i < ndof; i++)
+      {
+        double s_c = -cauchy_scale * gradient[i];
+        step[i] = s_c + tau * (delta[i] - s_c);
+      }
+    }
+    double step_norm = vector_norm(ndof, &step[0]);
+
+    // Reduction predicted by the linear model, |F|^2 - |F + J s|^2, and the
+    // actual one.
+    jacobian.multiply(&step[0], &work[0]);
+    for (int i = 0; i < ndof; i++)
+      work[i] -= residual[i];
+    double predicted = f0 - std::pow(vector_norm(ndof, &work[0]), 2);
+    for (int i = 0; i < ndof; i++)
+      trial_coeffs[i] = coeffs[i] + step[i];
+    dp->assemble_residual(&trial_coeffs[0], &trial_residual[0]);
+    num_residual_assemblies++;
+    double actual = f0 - std::pow(vector_norm(ndof, &trial_residual[0]), 2);
+    double rho = (predicted > 0.0) ? actual / predicted : -1.0;
+
+    if (rho < 0.25)
+      trust_radius = 0.5 * step_norm;
+    else if (rho > 0.75 && step_norm >= 0.99 * trust_radius)
+      trust_radius = 2.0 * trust_radius;
+
+    if (rho > armijo)
+    {
+      if (verbose_output && step_norm < newton_norm)
+        info("---- Trust region: step %g of the Newton step, radius %g.", step_norm / newton_norm, trust_radius);
+      coeffs.swap(trial_coeffs);
+      return true;
+    }
+    num_step_reductions++;
+    if (trust_radius <= min_step_length * newton_norm)
+      return false;
+  }
+}
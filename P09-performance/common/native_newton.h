@@ -0,0 +1,228 @@
+#ifndef __P09_NATIVE_NEWTON_H
+#define __P09_NATIVE_NEWTON_H
+
+#include "native_discrete_problem.h"
+#include "native_solvers.h"
+
+/// Choice of the forcing term of inexact Newton methods, the relative
+/// tolerance eta_k of the linear system of iteration k: the step s_k only
+/// has to satisfy |F_k + J_k s_k| <= eta_k |F_k|.
+enum NewtonForcingType
+{
+  NEWTON_FORCING_NONE,                ///< The tolerance of the linear solver is left as it is.
+  NEWTON_FORCING_EISENSTAT_WALKER_1,  ///< eta_k = | |F_k| - |F_k-1 + J_k-1 s_k-1| | / |F_k-1|.
+  NEWTON_FORCING_EISENSTAT_WALKER_2   ///< eta_k = gamma (|F_k| / |F_k-1|)^alpha.
+};
+
+/// Name of the forcing type, for reports.
+const char* get_newton_forcing_name(NewtonForcingType type);
+
+/// Globalization of Newton's method, the choice of the step from the
+/// solution delta of the linear system.
+enum NewtonGlobalizationType
+{
+  NEWTON_GLOBALIZATION_NONE,         ///< Full steps, u_k+1 = u_k + delta.
+  NEWTON_GLOBALIZATION_LINE_SEARCH,  ///< Backtracking to the Armijo condition along delta.
+  NEWTON_GLOBALIZATION_DOGLEG        ///< Dogleg steps within a trust region.
+};
+
+/// Forcing term of Eisenstat and Walker. Early iterations, far from the
+/// solution, get loose tolerances, the tolerance tightens as the residual
+/// converges, which keeps the local convergence of Newton's method. The
+/// safeguards of Eisenstat and Walker keep eta_k from dropping much faster
+/// than eta_k-1, and eta_k is not chosen smaller than needed to reach the
+/// Newton tolerance (no oversolving in the last iteration).
+class NewtonForcing
+{
+public:
+  NewtonForcing(NewtonForcingType type = NEWTON_FORCING_NONE);
+
+  void set_type(NewtonForcingType type) { this->type = type; }
+  NewtonForcingType get_type() const { return type; }
+
+  /// Tolerance of the first iteration (default 0.5) and upper bound of all
+  /// of them (default 0.9).
+  void set_initial_forcing(double eta_initial) { this->eta_initial = eta_initial; }
+  void set_max_forcing(double eta_max) { this->eta_max = eta_max; }
+
+  /// gamma (default 0.9) and alpha (default 2) of choice 2.
+  void set_gamma(double gamma) { this->gamma = gamma; }
+  void set_alpha(double alpha) { this->alpha = alpha; }
+
+  /// Starts a new Newton iteration.
+  void reset() { num_steps = 0; }
+
+  /// Relative tolerance of the linear system of the next iteration, whose
+  /// residual has the given norm.
+  double next(double residual_norm, double newton_tol);
+
+  /// The norm |F_k + J_k s_k| reached by the linear solver, for choice 1.
+  void set_linear_residual_norm(double linear_residual_norm) { this->linear_residual_norm = linear_residual_norm; }
+
+protected:
+  NewtonForcingType type;
+  double eta_initial;
+  double eta_max;
+  double gamma;
+  double alpha;
+  int num_steps;
+  double eta;
+  double residual_norm;
+  double linear_residual_norm;
+};
+
+/// Newton's method with the native assembly and the native solvers. The
+/// Jacobian is assembled as a CSRMatrix by the NativeDiscreteProblem and
+/// solved by a NativeLinearSolver of the given type. The interface follows
+/// Hermes' NewtonSolver, which can only use the solvers of MatrixSolverType.
+///
+/// NATIVE_SOLVER_LDLT and NATIVE_SOLVER_LDLT_MIXED need symmetric storage, see
+/// NativeDiscreteProblem::set_symmetric_storage().
+///
+/// The Jacobian and the residual of an iterate are assembled in one pass
+/// over the elements. The residual is assembled alone, see
+/// NativeDiscreteProblem::assemble_residual(), where the Jacobian may not
+/// follow: in the chord mode, in the trial steps of the globalization, and
+/// when the contraction of the last step predicts convergence (see
+/// set_convergence_prediction()). A right prediction saves the Jacobian of
+/// the converged iterate, a wrong one costs a residual assembly.
+///
+/// With an iterative linear solver the method can be inexact: the forcing
+/// term (set_forcing()) sets the tolerance of the solver in every iteration;
+/// solve() restores the tolerance of the user when it returns or throws.
+///
+/// In the chord mode (set_jacobian_reuse()) the Jacobian and its
+/// factorization are kept over several iterations, only the residual is
+/// assembled.
+///
+/// Far from the solution full Newton steps may diverge. The line search
+/// and the trust region (set_globalization()) shorten the steps by
+/// residual assemblies only, the residual of the accepted step is the one
+/// of the next iteration.
+class NativeNewtonSolver
+{
+public:
+  NativeNewtonSolver(NativeDiscreteProblem* dp, NativeSolverType solver_type);
+  ~NativeNewtonSolver();
+
+  /// The linear solver, e.g. to set the preconditioner of an IterativeSolver.
+  NativeLinearSolver<double>* get_linear_solver() { return linear_solver; }
+
+  void set_verbose_output(bool verbose_output) { this->verbose_output = verbose_output; }
+
+  /// Forcing term of IterativeSolver (NEWTON_FORCING_NONE by default, the
+  /// tolerance set by the user is used in all iterations). Other solvers
+  /// ignore it. The forcing object holds the parameters.
+  void set_forcing(NewtonForcingType type) { forcing.set_type(type); }
+  NewtonForcing* get_forcing() { return &forcing; }
+
+  /// Chord method: the last Jacobian and its factorization are used as
+  /// long as the residual contracts, |F_k| <= max_contraction |F_k-1|, and
+  /// for at most max_reuse steps (0 for no limit). The Jacobian is assembled
+  /// again at the current iterate when either fails. max_contraction = 0
+  /// (default) assembles it in every iteration. The linear solver detects
+  /// the unchanged matrix and keeps its factorization (unless its scheme is
+  /// NATIVE_FACTORIZE_FROM_SCRATCH).
+  void set_jacobian_reuse(double max_contraction, int max_reuse = 0);
+
+  /// Convergence is predicted when the last contraction carried over to the
+  /// next step, |F_k|^2 / |F_k-1|, is below factor times the Newton
+  /// tolerance; the residual is then assembled alone first. With quadratic
+  /// convergence the true residual is much smaller. factor = 1 by default,
+  /// 0 never predicts and assembles the Jacobian with every residual.
+  void set_convergence_prediction(double factor) { prediction_factor = factor; }
+
+  /// Predictions of the last solve(), and the wrong ones, after which the
+  /// Jacobian was assembled alone. Every right one saved a Jacobian.
+  int get_num_predictions() const { return num_predictions; }
+  int get_num_wrong_predictions() const { return num_wrong_predictions; }
+
+  /// Jacobian assemblies and iterations with a reused Jacobian of the last
+  /// solve().
+  int get_num_jacobian_assemblies() const { return num_jacobian_assemblies; }
+  int get_num_jacobian_reuses() const { return num_jacobian_reuses; }
+
+  /// Globalization of the steps, NEWTON_GLOBALIZATION_NONE by default.
+  ///
+  /// The line search tries the step lengths t = 1, ... along delta until
+  /// |F(u + t delta)| <= (1 - armijo t) |F(u)|, the next length minimizes
+  /// the quadratic interpolation of |F|^2 within [0.1 t, 0.5 t].
+  ///
+  /// The dogleg step is the Newton step if it lies in the trust region,
+  /// otherwise the point where the path from the Cauchy point (the
+  /// minimizer of the linear model along the steepest descent of |F|^2) to
+  /// the Newton step leaves the region. A step is accepted if the actual
+  /// reduction of |F|^2 is more than armijo times the predicted one; the
+  /// radius is halved after poor predictions and doubled after good ones.
+  ///
+  /// If no step is found, the Jacobian is assembled again if it was reused
+  /// (see set_jacobian_reuse()), otherwise solve() throws an exception.
+  void set_globalization(NewtonGlobalizationType globalization);
+  NewtonGlobalizationType get_globalization() const { return globalization; }
+
+  /// Sufficient decrease factor (default 1e-4), and the shortest step of
+  /// the line search or smallest trust radius relative to the Newton step
+  /// (default 1e-4) before the globalization fails.
+  void set_line_search_parameters(double armijo, double min_step_length);
+
+  /// Initial radius of the trust region; 0 (default) takes the length of
+  /// the first Newton step.
+  void set_trust_radius(double trust_radius) { initial_trust_radius = trust_radius; }
+
+  /// Residual assemblies and step reductions (backtracks or rejected trust
+  /// region steps) of the last solve().
+  int get_num_residual_assemblies() const { return num_residual_assemblies; }
+  int get_num_step_reductions() const { return num_step_reductions; }
+
+  /// Iterates until the Euclidean norm of the residual drops below
+  /// newton_tol, starting from coeff_vec (zero if NULL). Throws an exception
+  /// if the tolerance is not reached in newton_max_iter iterations, or if
+  /// the linear solver fails. coeff_vec and the solution are numbered as
+  /// the DOFs of the spaces, also when the discrete problem orders them
+  /// differently.
+  void solve(double* coeff_vec = NULL, double newton_tol = 1e-8, int newton_max_iter = 100);
+
+  double* get_sln_vector() { return sln_vector; }
+  int get_num_iterations() const { return num_iterations; }
+
+  /// Time spent in the linear solver by the last solve().
+  double get_linear_solver_time() const { return linear_solver_time; }
+
+  /// Iterations of IterativeSolver in all Newton steps of the last solve().
+  int get_num_linear_iterations() const { return num_linear_iterations; }
+
+protected:
+  /// Backtracking and dogleg steps from coeffs along delta. On success
+  /// coeffs is the new iterate and trial_residual its residual.
+  bool line_search(int ndof, const double* delta, double residual_norm);
+  bool dogleg_step(int ndof, const double* delta, double residual_norm);
+
+  NativeDiscreteProblem* dp;
+  NativeSolverType solver_type;
+  CSRMatrix<double> jacobian;
+  std::vector<double> residual;
+  NativeLinearSolver<double>* linear_solver;
+  NewtonForcing forcing;
+  double max_contraction;
+  int max_reuse;
+  double prediction_factor;
+  NewtonGlobalizationType globalization;
+  double armijo;
+  double min_step_length;
+  double initial_trust_radius;
+  double trust_radius;
+  std::vector<double> coeffs, trial_coeffs, trial_residual, gradient, step, work;
+  bool verbose_output;
+  double* sln_vector;
+  int num_iterations;
+  int num_linear_iterations;
+  int num_jacobian_assemblies;
+  int num_jacobian_reuses;
+  int num_residual_assemblies;
+  int num_step_reductions;
+  int num_predictions;
+  int num_wrong_predictions;
+  double linear_solver_time;
+};
+
+#endif
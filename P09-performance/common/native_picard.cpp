@@ -0,0 +1,247 @@
+#include "native_picard.h"
+#include "linear_operator.h"
+#include <cmath>
+
+AndersonAcceleration::AndersonAcceleration(int depth, double beta)
+  : size(0), depth(std::max(0, depth)), beta(beta), max_condition(1e10), num_columns(0), head(0),
+    have_previous(false)
+{
+}
+
+void AndersonAcceleration::set_depth(int depth)
+{
+  this->depth = std::max(0, depth);
+  reset(size);
+}
+
+void AndersonAcceleration::reset(int size)
+{
+  this->size = size;
+  num_columns = 0;
+  head = 0;
+  have_previous = false;
+  du.assign(depth, std::vector<double>(size));
+  q.assign(depth, std::vector<double>(size));
+  r_values.assign(depth * depth, 0.0);
+  gamma.assign(depth, 0.0);
+  u_previous.assign(depth > 0 ? size : 0, 0.0);
+  g_previous.assign(depth > 0 ? size : 0, 0.0);
+  dg.assign(depth > 0 ? size : 0, 0.0);
+}
+
+size_t AndersonAcceleration::get_memory_size() const
+{
+  size_t num_values = (du.size() + q.size()) * size + u_previous.size() + g_previous.size() + dg.size()
+    + r_values.size();
+  return num_values * sizeof(double);
+}
+
+void AndersonAcceleration::delete_oldest()
+{
+  // Without its first column R is upper Hessenberg. Givens rotations of
+  // rows j, j + 1 restore the triangle, the same rotations of the columns
+  // j, j + 1 of Q keep Q R = dG; the last column of Q drops out.
+  for (int j = 0; j < num_columns - 1; j++)
+    for (int i = 0; i <= j + 1; i++)
+      r(i, j) = r(i, j + 1);
+  for (int j = 0; j < num_columns - 1; j++)
+  {
+    double a = r(j, j), b = r(j + 1, j);
+    double h = std::sqrt(a * a + b * b);
+    double c = (h > 0.0) ? a / h : 1.0;
+    double s = (h > 0.0) ? b / h : 0.0;
+    r(j, j) = h;
+    r(j + 1, j) = 0.0;
+    for (int k = j + 1; k < num_columns - 1; k++)
+    {
+      double t1 = r(j, k), t2 = r(j + 1, k);
+      r(j, k) = c * t1 + s * t2;
+      r(j + 1, k) = -s * t1 + c * t2;
+    }
+    std::vector<double>& q1 = q[j];
+    std::vector<double>& q2 = q[j + 1];
+    for (int i = 0; i < size; i++)
+    {
+      double t1 = q1[i], t2 = q2[i];
+      q1[i] = c * t1 + s * t2;
+      q2[i] = -s * t1 + c * t2;
+    }
+  }
+  num_columns--;
+  head = (head + 1) % depth;
+}
+
+void AndersonAcceleration::next(double* u, const double* g)
+{
+  double mixing = 1.0 - beta;
+  if (depth > 0 && have_previous)
+  {
+    // The new column of dG is orthogonalized against Q (modified
+    // Gram-Schmidt), the column of dU goes to the ring buffer.
+    for (int i = 0; i < size; i++)
+      dg[i] = g[i] - g_previous[i];
+    if (num_columns == depth)
+      delete_oldest();
+    int k = num_columns;
+    for (int j = 0; j < k; j++)
+    {
+      double dot = 0.0;
+      for (int i = 0; i < size; i++)
+        dot += q[j][i] * dg[i];
+      r(j, k) = dot;
+      for (int i = 0; i < size; i++)
+        dg[i] -= dot * q[j][i];
+    }
+    double dg_norm = vector_norm(size, &dg[0]);
+    if (dg_norm > 0.0)
+    {
+      r(k, k) = dg_norm;
+      std::vector<double>& du_new = du[(head + k) % depth];
+      for (int i = 0; i < size; i++)
+      {
+        q[k][i] = dg[i] / dg_norm;
+        du_new[i] = u[i] - u_previous[i];
+      }
+      num_columns++;
+    }
+
+    // Nearly dependent columns: the oldest ones go first.
+    while (num_columns > 1)
+    {
+      double r_min = std::abs(r(0, 0)), r_max = r_min;
+      for (int j = 1; j < num_columns; j++)
+      {
+        r_min = std::min(r_min, std::abs(r(j, j)));
+        r_max = std::max(r_max, std::abs(r(j, j)));
+      }
+      if (r_max <= max_condition * r_min)
+        break;
+      delete_oldest();
+    }
+  }
+  if (depth > 0)
+  {
+    std::copy(u, u + size, u_previous.begin());
+    std::copy(g, g + size, g_previous.begin());
+    have_previous = true;
+  }
+
+  // u + (1 - beta) (g - Q Q^T g) - dU R^-1 Q^T g.
+  for (int j = 0; j < num_columns; j++)
+  {
+    double dot = 0.0;
+    for (int i = 0; i < size; i++)
+      dot += q[j][i] * g[i];
+    gamma[j] = dot;
+  }
+  for (int i = 0; i < size; i++)
+    u[i] += mixing * g[i];
+  for (int j = 0; j < num_columns; j++)
+    for (int i = 0; i < size; i++)
+      u[i] -= mixing * gamma[j] * q[j][i];
+  for (int j = num_columns - 1; j >= 0; j--)
+  {
+    for (int l = j + 1; l < num_columns; l++)
+      gamma[j] -= r(j, l) * gamma[l];
+    gamma[j] /= r(j, j);
+  }
+  for (int j = 0; j < num_columns; j++)
+  {
+    const std::vector<double>& du_j = du[(head + j) % depth];
+    for (int i = 0; i < size; i++)
+      u[i] -= gamma[j] * du_j[i];
+  }
+}
+
+NativePicardSolver::NativePicardSolver(NativeDiscreteProblem* dp, NativeDiscreteProblem* picard_dp,
+                                       NativeSolverType solver_type)
+  : dp(dp), picard_dp(picard_dp), solver_type(solver_type), newton(NULL), stall_ratio(0.9),
+    verbose_output(true), sln_vector(NULL), num_picard_iterations(0), num_newton_iterations(0),
+    linear_solver_time(0.0)
+{
+  residual.resize(std::max(1, dp->get_num_dofs()));
+  linear_solver = create_native_linear_solver(solver_type, &matrix, &residual[0]);
+}
+
+NativePicardSolver::~NativePicardSolver()
+{
+  delete linear_solver;
+  delete [] sln_vector;
+}
+
+void NativePicardSolver::set_anderson(int num_last_iter_used, double beta)
+{
+  anderson.set_depth(num_last_iter_used - 1);
+  anderson.set_beta(beta);
+}
+
+void NativePicardSolver::set_newton_switch(NativeNewtonSolver* newton, double stall_ratio)
+{
+  this->newton = newton;
+  this->stall_ratio = stall_ratio;
+}
+
+void NativePicardSolver::solve(double* coeff_vec, double tol, int max_iter)
+{
+  int ndof = dp->get_num_dofs();
+  if ((int) residual.size() < ndof)
+    throw Hermes::Exceptions::Exception("The number of DOFs changed since NativePicardSolver was created.");
+  if (picard_dp->get_num_dofs() != ndof || picard_dp->get_dof_ordering() != dp->get_dof_ordering())
+    throw Hermes::Exceptions::Exception("The Picard problem of NativePicardSolver does not match the problem.");
+
+  // The iteration works in the numbering of the global system.
+  std::vector<double> coeffs(std::max(1, ndof), 0.0);
+  if (coeff_vec != NULL)
+    dp->get_system_vector(coeff_vec, &coeffs[0]);
+  anderson.reset(ndof);
+
+  std::vector<double> residual_norms;
+  num_picard_iterations = 0;
+  num_newton_iterations = 0;
+  linear_solver_time = 0.0;
+  delete [] sln_vector;
+  sln_vector = new double[dp->get_num_space_dofs()];
+  while (true)
+  {
+    dp->assemble_residual(&coeffs[0], &residual[0]);
+    double residual_norm = vector_norm(ndof, &residual[0]);
+    residual_norms.push_back(residual_norm);
+    if (verbose_output)
+      info("---- Picard iter %d, ndof %d, residual norm %g", num_picard_iterations + 1, ndof, residual_norm);
+    if (residual_norm < tol)
+      break;
+    if (num_picard_iterations >= max_iter)
+      throw Hermes::Exceptions::Exception("Picard's iteration did not converge.");
+
+    // Newton's method takes over when the contraction of Picard's method
+    // stops improving.
+    int k = residual_norms.size() - 1;
+    double contraction = (k >= 1) ? residual_norm / residual_norms[k - 1] : 1.0;
+    double last_contraction = (k >= 2) ? residual_norms[k - 1] / residual_norms[k - 2] : 1.0;
+    if (newton != NULL && contraction < 1.0 && contraction > stall_ratio * last_contraction)
+    {
+      if (verbose_output)
+        info("---- Switching to Newton's method (contraction %g, previous %g).", contraction, last_contraction);
+      dp->get_space_vector(&coeffs[0], sln_vector);
+      newton->solve(sln_vector, tol, max_iter - num_picard_iterations);
+      num_newton_iterations = newton->get_num_iterations();
+      linear_solver_time += newton->get_linear_solver_time();
+      std::copy(newton->get_sln_vector(), newton->get_sln_vector() + dp->get_num_space_dofs(), sln_vector);
+      return;
+    }
+
+    // A(u_k) delta = -F(u_k).
+    picard_dp->assemble(&coeffs[0], &matrix, (double*) NULL);
+    for (int i = 0; i < ndof; i++)
+      residual[i] = -residual[i];
+    if (!linear_solver->solve())
+      throw Hermes::Exceptions::Exception("The %s solver failed in Picard's iteration.",
+                                          get_native_solver_name(solver_type));
+    linear_solver_time += linear_solver->get_time();
+    num_picard_iterations++;
+
+    anderson.next(&coeffs[0], linear_solver->get_sln_vector());
+  }
+
+  dp->get_space_vector(&coeffs[0], sln_vector);
+}
@@ -0,0 +1,149 @@
+#ifndef __P09_NATIVE_PICARD_H
+#define __P09_NATIVE_PICARD_H
+
+#include "native_newton.h"
+
+/// Anderson acceleration of a fixed point iteration u -> G(u). From the
+/// iterate u_k and its update g_k = G(u_k) - u_k the next iterate is
+///
+///   u_k+1 = u_k + (1 - beta) g_k - (dU + (1 - beta) dG) gamma,
+///
+/// where the columns of dU and dG are the differences of the last depth
+/// consecutive iterates and updates, and gamma minimizes |g_k - dG gamma|.
+/// beta = 0 is the undamped method; beta has the meaning of the parameter
+/// of Hermes' PicardSolver.
+///
+/// Only coefficient vectors are kept: the columns of dU in a ring buffer and
+/// the factor Q of dG = QR, which is updated when a column is appended
+/// (Gram-Schmidt) or the oldest one is dropped (Givens rotations), so dG
+/// itself is not needed, dG gamma = Q Q^T g_k. One step costs O(depth ndof)
+/// operations and 2 depth + 3 vectors of memory. Columns are also dropped
+/// while R is too ill-conditioned.
+class AndersonAcceleration
+{
+public:
+  AndersonAcceleration(int depth = 0, double beta = 0.0);
+
+  /// Number of differences used, 0 turns the acceleration off (only the
+  /// damping by beta remains). Resets the history.
+  void set_depth(int depth);
+  int get_depth() const { return depth; }
+
+  void set_beta(double beta) { this->beta = beta; }
+  double get_beta() const { return beta; }
+
+  /// Bound of the ratio of the largest and smallest diagonal entries of R
+  /// (default 1e10), the estimate of the condition number.
+  void set_max_condition(double max_condition) { this->max_condition = max_condition; }
+
+  /// Starts a new iteration with vectors of the given size.
+  void reset(int size);
+
+  /// Replaces u = u_k with u_k+1, given g = g_k.
+  void next(double* u, const double* g);
+
+  /// Differences used by the last step.
+  int get_num_columns() const { return num_columns; }
+
+  /// Memory of the history in bytes.
+  size_t get_memory_size() const;
+
+protected:
+  /// Removes the oldest column of dU and dG.
+  void delete_oldest();
+
+  double& r(int i, int j) { return r_values[i * depth + j]; }
+
+  int size;
+  int depth;
+  double beta;
+  double max_condition;
+  int num_columns;
+  int head;
+  bool have_previous;
+  std::vector<std::vector<double> > du;
+  std::vector<std::vector<double> > q;
+  std::vector<double> r_values;
+  std::vector<double> u_previous, g_previous, dg;
+  std::vector<double> gamma;
+};
+
+/// Picard's method with the native assembly. The iteration
+///
+///   A(u_k) delta_k = -F(u_k),  u_k+1 = u_k + delta_k,
+///
+/// takes the residual F from the discrete problem and the matrix A from a
+/// second one, picard_dp, whose matrix forms linearize the problem with
+/// the coefficients frozen at the current iterate, e.g. lambda(u_k) grad
+/// u . grad v for -div(lambda(u) grad u). For the problems of
+/// P02-nonlinear this is the Picard iteration -div(lambda(u_k) grad u_k+1)
+/// = f in correction form. Only the matrix forms of picard_dp are used; it
+/// must have the spaces and the DOF ordering of the problem. A is cheaper
+/// than the Jacobian, and often symmetric, see
+/// NativeDiscreteProblem::set_symmetric_storage().
+///
+/// The steps can be accelerated by AndersonAcceleration (set_anderson()).
+/// Picard's method converges linearly; once its contraction stalls, the
+/// iteration can continue with a NativeNewtonSolver (set_newton_switch()),
+/// whose quadratic convergence finishes it from the Picard iterate.
+class NativePicardSolver
+{
+public:
+  NativePicardSolver(NativeDiscreteProblem* dp, NativeDiscreteProblem* picard_dp, NativeSolverType solver_type);
+  ~NativePicardSolver();
+
+  /// The solver of the Picard systems.
+  NativeLinearSolver<double>* get_linear_solver() { return linear_solver; }
+
+  void set_verbose_output(bool verbose_output) { this->verbose_output = verbose_output; }
+
+  /// Anderson acceleration with the last num_last_iter_used iterates, as
+  /// PicardSolver::solve() of Hermes: 1 (default) turns it off, beta is the
+  /// damping. The object holds the other parameters.
+  void set_anderson(int num_last_iter_used, double beta);
+  AndersonAcceleration* get_anderson() { return &anderson; }
+
+  /// Continues with Newton's method once the contraction of the residual,
+  /// rho_k = |F_k| / |F_k-1|, stalls: Picard's method still converges,
+  /// rho_k < 1, but rho_k > stall_ratio rho_k-1. Far from the solution the
+  /// contraction improves from step to step; when it settles at the linear
+  /// rate of the method, Newton's method is faster. The Newton solver is
+  /// not owned and keeps its settings, e.g. a line search; it must solve the
+  /// problem dp. NULL (default) keeps Picard's method to the end.
+  void set_newton_switch(NativeNewtonSolver* newton, double stall_ratio = 0.9);
+
+  /// Iterates until the Euclidean norm of the residual drops below tol,
+  /// starting from coeff_vec (zero if NULL). Throws an exception if the
+  /// tolerance is not reached in max_iter iterations of both methods
+  /// together, or if a linear solver fails. coeff_vec and the solution are
+  /// numbered as the DOFs of the spaces.
+  void solve(double* coeff_vec = NULL, double tol = 1e-8, int max_iter = 100);
+
+  double* get_sln_vector() { return sln_vector; }
+
+  /// Iterations of the last solve(): all, Picard and Newton steps.
+  int get_num_iterations() const { return num_picard_iterations + num_newton_iterations; }
+  int get_num_picard_iterations() const { return num_picard_iterations; }
+  int get_num_newton_iterations() const { return num_newton_iterations; }
+
+  /// Time spent in the linear solvers by the last solve(), Newton included.
+  double get_linear_solver_time() const { return linear_solver_time; }
+
+protected:
+  NativeDiscreteProblem* dp;
+  NativeDiscreteProblem* picard_dp;
+  NativeSolverType solver_type;
+  CSRMatrix<double> matrix;
+  std::vector<double> residual;
+  NativeLinearSolver<double>* linear_solver;
+  AndersonAcceleration anderson;
+  NativeNewtonSolver* newton;
+  double stall_ratio;
+  bool verbose_output;
+  double* sln_vector;
+  int num_picard_iterations;
+  int num_newton_iterations;
+  double linear_solver_time;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "native_solvers.h"
+#include "ldlt_solver.h"
+#include "lu_solver.h"
+#include "mixed_precision_solver.h"
+#include "iterative_solver.h"
+#include "hermes2d.h"
+#include <algorithm>
+
+const char* get_native_solver_name(NativeSolverType type)
+{
+  switch (type)
+  {
+  case NATIVE_SOLVER_LDLT: return "LDLT";
+  case NATIVE_SOLVER_CG: return "CG";
+  case NATIVE_SOLVER_GMRES: return "GMRES";
+  case NATIVE_SOLVER_BICGSTAB: return "BiCGStab";
+  case NATIVE_SOLVER_LU: return "LU";
+  case NATIVE_SOLVER_LDLT_MIXED: return "LDLT mixed precision";
+  }
+  return "unknown";
+}
+
+template<typename Scalar>
+NativeLinearSolver<Scalar>::NativeLinearSolver(CSRMatrix<Scalar>* matrix, Scalar* rhs)
+  : matrix(matrix), rhs(rhs), sln(NULL), time(0.0), factorization_scheme(NATIVE_REUSE_MATRIX_REORDERING),
+    num_factorizations(0)
+{
+}
+
+template<typename Scalar>
+NativeLinearSolver<Scalar>::~NativeLinearSolver()
+{
+  delete [] sln;
+}
+
+template<typename Scalar>
+NativeFactorizationScheme NativeLinearSolver<Scalar>::check_matrix()
+{
+  if (factorization_scheme == NATIVE_FACTORIZE_FROM_SCRATCH)
+  {
+    forget_matrix();
+    return NATIVE_FACTORIZE_FROM_SCRATCH;
+  }
+
+  // The first matrix, or one of another size, is always factorized.
+  int size = matrix->get_size();
+  int nnz = matrix->get_nnz();
+  bool same_size = (int) last_row_ptr.size() == size + 1;
+  if (factorization_scheme == NATIVE_REUSE_FACTORIZATION_COMPLETELY && same_size)
+    return NATIVE_REUSE_FACTORIZATION_COMPLETELY;
+
+  bool same_pattern = same_size && (int) last_col_idx.size() == nnz
+    && std::equal(last_row_ptr.begin(), last_row_ptr.end(), matrix->get_row_ptr())
+    && std::equal(last_col_idx.begin(), last_col_idx.end(), matrix->get_col_idx());
+  NativeFactorizationScheme result;
+  if (!same_pattern)
+    result = NATIVE_FACTORIZE_FROM_SCRATCH;
+  else if (!std::equal(last_values.begin(), last_values.end(), matrix->get_values()))
+    result = NATIVE_REUSE_MATRIX_REORDERING;
+  else
+    return NATIVE_REUSE_FACTORIZATION_COMPLETELY;
+
+  if (!same_pattern)
+  {
+    last_row_ptr.assign(matrix->get_row_ptr(), matrix->get_row_ptr() + size + 1);
+    last_col_idx.assign(matrix->get_col_idx(), matrix->get_col_idx() + nnz);
+  }
+  last_values.assign(matrix->get_values(), matrix->get_values() + nnz);
+  return result;
+}
+
+NativeLinearSolver<double>* create_native_linear_solver(NativeSolverType type, CSRMatrix<double>* matrix,
+                                                        double* rhs)
+{
+  switch (type)
+  {
+  case NATIVE_SOLVER_LDLT: return new LDLTSolver(matrix, rhs);
+  case NATIVE_SOLVER_CG:
+  case NATIVE_SOLVER_GMRES:
+  case NATIVE_SOLVER_BICGSTAB: return new IterativeSolver(type, matrix, rhs);
+  case NATIVE_SOLVER_LU: return new LUSolver<double>(matrix, rhs);
+  case NATIVE_SOLVER_LDLT_MIXED: return new MixedPrecisionSolver(matrix, rhs);
+  }
+  throw Hermes::Exceptions::Exception("Unknown native solver type.");
+  return NULL;
+}
+
+template class NativeLinearSolver<double>;
+template class NativeLinearSolver<std::complex<double> >;
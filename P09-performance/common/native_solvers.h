@@ -0,0 +1,87 @@
+#ifndef __P09_NATIVE_SOLVERS_H
+#define __P09_NATIVE_SOLVERS_H
+
+#include "csr_matrix.h"
+
+/// Linear solvers of this tutorial part. They work with CSRMatrix and do
+/// not need any external library. Hermes' MatrixSolverType cannot be
+/// extended from outside the library, the solvers are selected by
+/// NativeSolverType instead.
+enum NativeSolverType
+{
+  NATIVE_SOLVER_LDLT,         ///< Sparse LDL^T factorization of a symmetric matrix.
+  NATIVE_SOLVER_CG,           ///< Conjugate gradients, symmetric positive definite matrices.
+  NATIVE_SOLVER_GMRES,        ///< Restarted GMRES.
+  NATIVE_SOLVER_BICGSTAB,     ///< BiCGStab.
+  NATIVE_SOLVER_LU,           ///< Sparse LU factorization with pivoting, general matrices.
+  NATIVE_SOLVER_LDLT_MIXED    ///< LDL^T in single precision with iterative refinement (MixedPrecisionSolver).
+};
+
+/// Name of the solver type, for reports.
+const char* get_native_solver_name(NativeSolverType type);
+
+/// What a solver keeps between calls to solve(): the factorization of
+/// LDLTSolver, the preconditioner of IterativeSolver.
+enum NativeFactorizationScheme
+{
+  NATIVE_FACTORIZE_FROM_SCRATCH,          ///< Analyze and factorize in every call.
+  NATIVE_REUSE_MATRIX_REORDERING,         ///< Analyze when the sparsity pattern changes, factorize when the
+                                          ///< values change (default).
+  NATIVE_REUSE_FACTORIZATION_COMPLETELY   ///< Factorize once, the matrix is assumed not to change.
+};
+
+/// Common interface of the native solvers, modelled after Hermes'
+/// LinearSolver: the matrix and the right-hand side are given to the
+/// constructor, their contents may change between calls to solve().
+template<typename Scalar>
+class NativeLinearSolver
+{
+public:
+  NativeLinearSolver(CSRMatrix<Scalar>* matrix, Scalar* rhs);
+  virtual ~NativeLinearSolver();
+
+  /// Solves the system. Returns false if the solver failed.
+  virtual bool solve() = 0;
+
+  /// Solution of the last call to solve().
+  Scalar* get_sln_vector() { return sln; }
+
+  /// Wall clock time of the last call to solve() in seconds.
+  double get_time() const { return time; }
+
+  /// Reuse of the factorization between calls to solve(). The matrix is
+  /// compared with the one of the previous call, which needs a copy of it.
+  void set_factorization_scheme(NativeFactorizationScheme scheme) { factorization_scheme = scheme; }
+  NativeFactorizationScheme get_factorization_scheme() const { return factorization_scheme; }
+
+  /// Factorizations (or preconditioner setups) done by solve() so far.
+  int get_num_factorizations() const { return num_factorizations; }
+
+protected:
+  /// What solve() has to do with the current matrix: everything
+  /// (NATIVE_FACTORIZE_FROM_SCRATCH), a new numerical factorization only
+  /// (NATIVE_REUSE_MATRIX_REORDERING), or nothing. Remembers the matrix
+  /// for the next call.
+  NativeFactorizationScheme check_matrix();
+
+  /// Forgets the matrix, the next check_matrix() asks for everything.
+  /// Called when a factorization failed or its parameters changed.
+  void forget_matrix() { last_row_ptr.clear(); }
+
+  CSRMatrix<Scalar>* matrix;
+  Scalar* rhs;
+  Scalar* sln;
+  double time;
+
+  NativeFactorizationScheme factorization_scheme;
+  int num_factorizations;
+  std::vector<int> last_row_ptr, last_col_idx;
+  std::vector<Scalar> last_values;
+};
+
+/// Creates a native solver of the given type. Iterative solvers (see
+/// IterativeSolver) get their default preconditioner.
+NativeLinearSolver<double>* create_native_linear_solver(NativeSolverType type, CSRMatrix<double>* matrix,
+                                                        double* rhs);
+
+#endif
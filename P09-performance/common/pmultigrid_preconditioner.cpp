@@ -0,0 +1,399 @@
+#include "pmultigrid_preconditioner.h"
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+// y = b - A x.
+static void residual(const std::vector<int>& ptr, const std::vector<int>& idx, const std::vector<double>& val,
+                     const std::vector<double>& b, const std::vector<double>& x, std::vector<double>& y)
+{
+  int n = (int) ptr.size() - 1;
+  for (int i = 0; i < n; i++)
+  {
+    double sum = b[i];
+    for (int k = ptr[i]; k < ptr[i + 1]; k++)
+      sum -= val[k] * x[idx[k]];
+    y[i] = sum;
+  }
+}
+
+// Inverts the dense n x n matrix a in place by Gauss-Jordan elimination
+// with row pivots. Returns false if it is singular.
+static bool invert(double* a, int n)
+{
+  std::vector<int> piv(n);
+  for (int j = 0; j < n; j++)
+  {
+    int p = j;
+    for (int i = j + 1; i < n; i++)
+      if (std::abs(a[i * n + j]) > std::abs(a[p * n + j]))
+        p = i;
+    if (a[p * n + j] == 0.0)
+      return false;
+    piv[j] = p;
+    if (p != j)
+      for (int k = 0; k < n; k++)
+        std::swap(a[j * n + k], a[p * n + k]);
+
+    double d = 1.0 / a[j * n + j];
+    a[j * n + j] = 1.0;
+    for (int k = 0; k < n; k++)
+      a[j * n + k] *= d;
+    for (int i = 0; i < n; i++)
+    {
+      if (i == j) continue;
+      double l = a[i * n + j];
+      if (l == 0.0) continue;
+      a[i * n + j] = 0.0;
+      for (int k = 0; k < n; k++)
+        a[i * n + k] -= l * a[j * n + k];
+    }
+  }
+  // Row swaps of A are column swaps of the inverse, undone in reverse order.
+  for (int j = n - 1; j >= 0; j--)
+    if (piv[j] != j)
+      for (int i = 0; i < n; i++)
+        std::swap(a[i * n + j], a[i * n + piv[j]]);
+  return true;
+}
+
+PMultigridPreconditioner::PMultigridPreconditioner(Space<double>* space, NativeDiscreteProblem* dp)
+  : coarsening(PMG_COARSEN_HALVE), smoothing_steps(2), damping(0.7), max_order(1), coarse_solver(NULL),
+    setup_time(0.0)
+{
+  analyze_space(space);
+  if (dp != NULL)
+    map_to_system(dp);
+}
+
+PMultigridPreconditioner::~PMultigridPreconditioner()
+{
+  delete coarse_solver;
+}
+
+void PMultigridPreconditioner::set_smoothing(int steps, double damping)
+{
+  if (steps < 1)
+    throw Hermes::Exceptions::Exception("The p-multigrid smoother needs at least one step.");
+  smoothing_steps = steps;
+  this->damping = damping;
+}
+
+void PMultigridPreconditioner::analyze_space(Space<double>* space)
+{
+  int ndof = space->get_num_dofs();
+  dof_order.assign(ndof, 1);
+  dof_block.assign(ndof, -1);
+  max_order = 1;
+  Shapeset* shapeset = space->get_shapeset();
+
+  // Edge of every edge function, for triangles and quads.
+  std::map<int, int> edge_of[2];
+  for (int mode = HERMES_MODE_TRIANGLE; mode <= HERMES_MODE_QUAD; mode++)
+    for (int edge = 0; edge < (mode == HERMES_MODE_TRIANGLE ? 3 : 4); edge++)
+      for (int ori = 0; ori < 2; ori++)
+        for (int o = 2; o <= shapeset->get_max_order(); o++)
+          edge_of[mode][shapeset->get_edge_index(edge, ori, o, mode)] = edge;
+
+  // Constrained (hanging) functions are skipped, their DOFs appear
+  // unconstrained in a neighbouring element. A DOF shared by several
+  // elements gets its block from the first one.
+  int num_blocks = 0;
+  AsmList<double> al;
+  Element* e;
+  for_all_active_elements(e, space->get_mesh())
+  {
+    space->get_element_assembly_list(e, &al);
+    int mode = e->get_mode();
+    int edge_block[4] = { -1, -1, -1, -1 };
+    int bubble_block = -1;
+    for (unsigned int k = 0; k < al.cnt; k++)
+    {
+      int dof = al.dof[k];
+      if (dof < 0 || al.idx[k] < 0 || al.coef[k] != 1.0)
+        continue;
+      int order = shapeset->get_order(al.idx[k], mode);
+      dof_order[dof] = std::max(H2D_GET_H_ORDER(order), H2D_GET_V_ORDER(order));
+      max_order = std::max(max_order, dof_order[dof]);
+      if (dof_block[dof] >= 0)
+        continue;
+
+      bool vertex = false;
+      for (unsigned int v = 0; v < e->nvert; v++)
+        if (shapeset->get_vertex_index(v, mode) == al.idx[k])
+          vertex = true;
+      std::map<int, int>::iterator it = edge_of[mode].find(al.idx[k]);
+      if (vertex)
+        dof_block[dof] = num_blocks++;
+      else if (it != edge_of[mode].end())
+      {
+        if (edge_block[it->second] < 0)
+          edge_block[it->second] = num_blocks++;
+        dof_block[dof] = edge_block[it->second];
+      }
+      else
+      {
+        if (bubble_block < 0)
+          bubble_block = num_blocks++;
+        dof_block[dof] = bubble_block;
+      }
+    }
+  }
+  for (int i = 0; i < ndof; i++)
+    if (dof_block[i] < 0)
+      dof_block[i] = num_blocks++;
+}
+
+void PMultigridPreconditioner::map_to_system(NativeDiscreteProblem* dp)
+{
+  int ndof = dof_order.size();
+  if (dp->get_num_space_dofs() != ndof)
+    throw Hermes::Exceptions::Exception("The discrete problem does not belong to the space of the p-multigrid "
+                                        "preconditioner.");
+
+  // get_system_vector() renumbers the DOFs and drops condensed bubbles.
+  std::vector<double> space_values(std::max(1, ndof)), system_values(std::max(1, dp->get_num_dofs()));
+  for (int i = 0; i < ndof; i++)
+    space_values[i] = dof_order[i];
+  dp->get_system_vector(&space_values[0], &system_values[0]);
+  dof_order.assign(system_values.begin(), system_values.begin() + dp->get_num_dofs());
+  for (int i = 0; i < ndof; i++)
+    space_values[i] = dof_block[i];
+  dp->get_system_vector(&space_values[0], &system_values[0]);
+  dof_block.assign(system_values.begin(), system_values.begin() + dp->get_num_dofs());
+}
+
+void PMultigridPreconditioner::build_blocks(Level& level, const std::vector<int>& dofs)
+{
+  int n = (int) dofs.size();
+
+  // Group the DOFs of the level by their blocks.
+  std::map<int, std::vector<int> > blocks;
+  for (int i = 0; i < n; i++)
+    blocks[dof_block[dofs[i]]].push_back(i);
+  level.block_ptr.assign(1, 0);
+  level.block_dofs.clear();
+  level.inv_ptr.assign(1, 0);
+  level.inv.clear();
+
+  std::vector<int> pos(n, -1);
+  for (std::map<int, std::vector<int> >::iterator it = blocks.begin(); it != blocks.end(); it++)
+  {
+    const std::vector<int>& block = it->second;
+    int m = (int) block.size();
+    for (int j = 0; j < m; j++)
+      pos[block[j]] = j;
+
+    int start = (int) level.inv.size();
+    level.inv.resize(start + m * m, 0.0);
+    double* a = &level.inv[start];
+    for (int j = 0; j < m; j++)
+    {
+      int i = block[j];
+      for (int k = level.ptr[i]; k < level.ptr[i + 1]; k++)
+        if (pos[level.idx[k]] >= 0)
+          a[j * m + pos[level.idx[k]]] += level.val[k];
+    }
+    if (!invert(a, m))
+      throw Hermes::Exceptions::Exception("Singular diagonal block in the p-multigrid preconditioner.");
+
+    for (int j = 0; j < m; j++)
+      pos[block[j]] = -1;
+    level.block_dofs.insert(level.block_dofs.end(), block.begin(), block.end());
+    level.block_ptr.push_back(level.block_dofs.size());
+    level.inv_ptr.push_back(level.inv.size());
+  }
+}
+
+void PMultigridPreconditioner::setup(LinearOperator* op)
+{
+  TimePeriod timer;
+  timer.tick(HERMES_SKIP);
+
+  const CSRMatrix<double>* matrix = get_operator_matrix(op, "p-multigrid");
+  int n = matrix->get_size();
+  if (n != (int) dof_order.size())
+    throw Hermes::Exceptions::Exception("The matrix does not belong to the space of the p-multigrid preconditioner, "
+                                        "renumbered matrices need the discrete problem in the constructor.");
+
+  // The finest level, symmetric storage is expanded.
+  levels.clear();
+  levels.push_back(Level());
+  Level& finest = levels[0];
+  finest.order = max_order;
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+  const double* values = matrix->get_values();
+  finest.ptr.assign(n + 1, 0);
+  for (int i = 0; i < n; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      finest.ptr[i + 1]++;
+      if (matrix->is_symmetric() && col_idx[k] != i)
+        finest.ptr[col_idx[k] + 1]++;
+    }
+  for (int i = 0; i < n; i++)
+    finest.ptr[i + 1] += finest.ptr[i];
+  finest.idx.resize(finest.ptr[n]);
+  finest.val.resize(finest.ptr[n]);
+  std::vector<int> next(finest.ptr.begin(), finest.ptr.end() - 1);
+  for (int i = 0; i < n; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      finest.idx[next[i]] = col_idx[k];
+      finest.val[next[i]++] = values[k];
+      if (matrix->is_symmetric() && col_idx[k] != i)
+      {
+        finest.idx[next[col_idx[k]]] = i;
+        finest.val[next[col_idx[k]]++] = values[k];
+      }
+    }
+
+  // Coarser levels keep the DOFs up to their order; a level that would
+  // drop no DOF only lowers the order of the previous one.
+  std::vector<std::vector<int> > dofs(1);
+  for (int i = 0; i < n; i++)
+    dofs[0].push_back(i);
+  int order = max_order;
+  while (order > 1)
+  {
+    order = (coarsening == PMG_COARSEN_HALVE) ? order / 2 : order - 1;
+    const Level& fine = levels.back();
+    const std::vector<int>& fine_dofs = dofs.back();
+    int fine_size = (int) fine_dofs.size();
+
+    std::vector<int> coarse_index(fine_size, -1);
+    Level coarse;
+    std::vector<int> coarse_dofs;
+    coarse.order = order;
+    for (int i = 0; i < fine_size; i++)
+      if (dof_order[fine_dofs[i]] <= order)
+      {
+        coarse_index[i] = coarse.fine.size();
+        coarse.fine.push_back(i);
+        coarse_dofs.push_back(fine_dofs[i]);
+      }
+    if (coarse_dofs.size() == fine_dofs.size())
+    {
+      levels.back().order = order;
+      continue;
+    }
+
+    coarse.ptr.assign(1, 0);
+    for (unsigned int ii = 0; ii < coarse.fine.size(); ii++)
+    {
+      int i = coarse.fine[ii];
+      for (int k = fine.ptr[i]; k < fine.ptr[i + 1]; k++)
+        if (coarse_index[fine.idx[k]] >= 0)
+        {
+          coarse.idx.push_back(coarse_index[fine.idx[k]]);
+          coarse.val.push_back(fine.val[k]);
+        }
+      coarse.ptr.push_back(coarse.idx.size());
+    }
+    levels.push_back(coarse);
+    dofs.push_back(coarse_dofs);
+  }
+
+  for (unsigned int l = 0; l < levels.size(); l++)
+  {
+    Level& level = levels[l];
+    int size = (int) dofs[l].size();
+    level.x.resize(size);
+    level.b.resize(size);
+    level.res.resize(size);
+    if (l + 1 < levels.size())
+      build_blocks(level, dofs[l]);
+  }
+
+  // Upper triangle of the coarsest level with sorted columns.
+  const Level& coarsest = levels.back();
+  int nc = (int) dofs.back().size();
+  std::vector<std::vector<std::pair<int, double> > > rows(nc);
+  for (int i = 0; i < nc; i++)
+  {
+    for (int k = coarsest.ptr[i]; k < coarsest.ptr[i + 1]; k++)
+      if (coarsest.idx[k] >= i)
+        rows[i].push_back(std::make_pair(coarsest.idx[k], coarsest.val[k]));
+    std::sort(rows[i].begin(), rows[i].end());
+  }
+  std::vector<int> coarse_ptr(1, 0), coarse_idx;
+  std::vector<double> coarse_val;
+  for (int i = 0; i < nc; i++)
+  {
+    for (unsigned int k = 0; k < rows[i].size(); k++)
+    {
+      coarse_idx.push_back(rows[i][k].first);
+      coarse_val.push_back(rows[i][k].second);
+    }
+    coarse_ptr.push_back(coarse_idx.size());
+  }
+  coarse_matrix.create(nc, &coarse_ptr[0], coarse_idx.empty() ? NULL : &coarse_idx[0], true);
+  std::copy(coarse_val.begin(), coarse_val.end(), coarse_matrix.get_values());
+
+  if (coarse_solver == NULL)
+    coarse_solver = new LDLTSolver(&coarse_matrix, NULL);
+  coarse_solver->analyze();
+  if (!coarse_solver->factorize())
+    throw Hermes::Exceptions::Exception("The p = 1 matrix of the p-multigrid preconditioner is singular.");
+
+  setup_time = timer.tick().last();
+}
+
+void PMultigridPreconditioner::smooth(Level& level)
+{
+  int num_blocks = (int) level.block_ptr.size() - 1;
+  for (int step = 0; step < smoothing_steps; step++)
+  {
+    residual(level.ptr, level.idx, level.val, level.b, level.x, level.res);
+    for (int blk = 0; blk < num_blocks; blk++)
+    {
+      const int* dofs = &level.block_dofs[level.block_ptr[blk]];
+      int m = level.block_ptr[blk + 1] - level.block_ptr[blk];
+      const double* inv = &level.inv[level.inv_ptr[blk]];
+      for (int j = 0; j < m; j++)
+      {
+        double sum = 0.0;
+        for (int k = 0; k < m; k++)
+          sum += inv[j * m + k] * level.res[dofs[k]];
+        level.x[dofs[j]] += damping * sum;
+      }
+    }
+  }
+}
+
+void PMultigridPreconditioner::cycle(int l)
+{
+  Level& level = levels[l];
+  int n = (int) level.x.size();
+
+  if (l + 1 == (int) levels.size())
+  {
+    if (n > 0)
+      coarse_solver->substitute(&level.b[0], &level.x[0]);
+    return;
+  }
+
+  std::fill(level.x.begin(), level.x.end(), 0.0);
+  smooth(level);
+
+  // Restriction drops the high order DOFs, prolongation injects.
+  Level& coarse = levels[l + 1];
+  residual(level.ptr, level.idx, level.val, level.b, level.x, level.res);
+  for (unsigned int i = 0; i < coarse.fine.size(); i++)
+    coarse.b[i] = level.res[coarse.fine[i]];
+  cycle(l + 1);
+  for (unsigned int i = 0; i < coarse.fine.size(); i++)
+    level.x[coarse.fine[i]] += coarse.x[i];
+
+  smooth(level);
+}
+
+void PMultigridPreconditioner::apply(const double* r, double* z)
+{
+  if (levels.empty() || levels[0].x.empty())
+    return;
+  std::copy(r, r + levels[0].b.size(), levels[0].b.begin());
+  cycle(0);
+  std::copy(levels[0].x.begin(), levels[0].x.end(), z);
+}
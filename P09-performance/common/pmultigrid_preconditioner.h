@@ -0,0 +1,116 @@
+#ifndef __P09_PMULTIGRID_PRECONDITIONER_H
+#define __P09_PMULTIGRID_PRECONDITIONER_H
+
+#include "hermes2d.h"
+#include "preconditioners.h"
+#include "ldlt_solver.h"
+#include "native_discrete_problem.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Order sequence of the p-multigrid levels.
+enum PMultigridCoarsening
+{
+  PMG_COARSEN_HALVE,           ///< p, p / 2, p / 4, ..., 1.
+  PMG_COARSEN_DECREMENT        ///< p, p - 1, p - 2, ..., 1.
+};
+
+/// p-multigrid for the matrix of an H1 space, one V-cycle per application.
+///
+/// The H1 shapeset is hierarchic: the shape functions of order at most q
+/// span the space of order q. The level of order q therefore consists of
+/// the DOFs whose shape functions have order at most q, the restriction
+/// drops the other DOFs and the prolongation injects, and the matrix of the
+/// level is a submatrix of the finest one (the Galerkin product). The
+/// coarsest level (p = 1, the vertex functions) is solved by the sparse
+/// LDL^T factorization, so the matrix has to be symmetric.
+///
+/// The other levels are smoothed by damped block Jacobi. The blocks are the
+/// DOFs of one edge or of the interior of one element, i.e. the strongly
+/// coupled high order functions; a vertex DOF is a block of its own. The
+/// same smoothing before and after the coarse correction keeps the V-cycle
+/// symmetric, so it can precondition CG.
+///
+/// The DOF orders and blocks are taken from the space in the constructor;
+/// the space must not change until the last setup(). They are numbered as
+/// the DOFs of the space. A matrix of a NativeDiscreteProblem with another
+/// DOF ordering (NativeDiscreteProblem::set_dof_ordering()) or with static
+/// condensation needs the problem in the constructor, which then maps them
+/// to the numbering of its global system. Without it such a matrix would
+/// get arbitrary levels and blocks; only a different size is detected.
+class PMultigridPreconditioner : public Preconditioner
+{
+public:
+  PMultigridPreconditioner(Space<double>* space, NativeDiscreteProblem* dp = NULL);
+  virtual ~PMultigridPreconditioner();
+
+  virtual void setup(LinearOperator* op);
+  virtual void apply(const double* r, double* z);
+
+  /// Order sequence of the levels (default PMG_COARSEN_HALVE).
+  void set_coarsening(PMultigridCoarsening coarsening) { this->coarsening = coarsening; }
+
+  /// Block Jacobi steps before and after the coarse correction and their
+  /// damping (default 2 steps, 0.7).
+  void set_smoothing(int steps, double damping = 0.7);
+
+  int get_num_levels() const { return (int) levels.size(); }
+  int get_level_order(int level) const { return levels[level].order; }
+  int get_level_size(int level) const { return (int) levels[level].ptr.size() - 1; }
+
+  /// Highest order of a shape function of the space.
+  int get_max_order() const { return max_order; }
+
+  /// Wall clock time of the last setup() in seconds.
+  double get_setup_time() const { return setup_time; }
+
+protected:
+  struct Level
+  {
+    int order;
+
+    /// Matrix of the level in full CSR storage.
+    std::vector<int> ptr, idx;
+    std::vector<double> val;
+
+    /// fine[i] is the index of the DOF i in the next finer level.
+    std::vector<int> fine;
+
+    /// DOFs of the blocks (block_ptr) and the inverses of their diagonal
+    /// blocks, row-wise (inv_ptr).
+    std::vector<int> block_ptr, block_dofs, inv_ptr;
+    std::vector<double> inv;
+
+    std::vector<double> x, b, res;
+  };
+
+  /// Reads the orders and blocks of the DOFs from the space.
+  void analyze_space(Space<double>* space);
+
+  /// Renumbers the orders and blocks as the global system of dp.
+  void map_to_system(NativeDiscreteProblem* dp);
+
+  /// Blocks of a level and the inverses of their diagonal blocks.
+  void build_blocks(Level& level, const std::vector<int>& dofs);
+
+  void smooth(Level& level);
+  void cycle(int l);
+
+  PMultigridCoarsening coarsening;
+  int smoothing_steps;
+  double damping;
+
+  int max_order;
+  std::vector<int> dof_order, dof_block;
+
+  std::vector<Level> levels;
+
+  /// Coarsest level, upper triangle for the LDL^T factorization.
+  CSRMatrix<double> coarse_matrix;
+  LDLTSolver* coarse_solver;
+
+  double setup_time;
+};
+
+#endif
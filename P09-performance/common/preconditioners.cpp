@@ -0,0 +1,186 @@
+#include "preconditioners.h"
+#include "amg_preconditioner.h"
+#include "hermes2d.h"
+
+using namespace Hermes;
+
+const char* get_native_preconditioner_name(NativePreconditionerType type)
+{
+  switch (type)
+  {
+  case NATIVE_PRECOND_NONE: return "none";
+  case NATIVE_PRECOND_JACOBI: return "Jacobi";
+  case NATIVE_PRECOND_SSOR: return "SSOR";
+  case NATIVE_PRECOND_ILU0: return "ILU(0)";
+  case NATIVE_PRECOND_AMG: return "AMG";
+  case NATIVE_PRECOND_USER: return "user";
+  }
+  return "unknown";
+}
+
+Preconditioner* create_native_preconditioner(NativePreconditionerType type)
+{
+  switch (type)
+  {
+  case NATIVE_PRECOND_NONE: return NULL;
+  case NATIVE_PRECOND_JACOBI: return new JacobiPreconditioner;
+  case NATIVE_PRECOND_SSOR: return new SSORPreconditioner;
+  case NATIVE_PRECOND_ILU0: return new ILU0Preconditioner;
+  case NATIVE_PRECOND_AMG: return new AMGPreconditioner;
+  case NATIVE_PRECOND_USER:
+    throw Hermes::Exceptions::Exception("A user preconditioner has to be passed to the solver.");
+  }
+  throw Hermes::Exceptions::Exception("Unknown preconditioner type.");
+  return NULL;
+}
+
+const CSRMatrix<double>* get_operator_matrix(LinearOperator* op, const char* name)
+{
+  CSRMatrixOperator* csr_op = dynamic_cast<CSRMatrixOperator*>(op);
+  if (csr_op == NULL)
+    throw Hermes::Exceptions::Exception("The %s preconditioner needs an assembled matrix.", name);
+  return csr_op->get_matrix();
+}
+
+// Positions of the diagonal entries, all of them must be nonzero.
+static void find_diagonal(const CSRMatrix<double>* matrix, const double* values, std::vector<int>& diag_pos,
+                          const char* name)
+{
+  int n = matrix->get_size();
+  diag_pos.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    diag_pos[i] = matrix->find(i, i);
+    if (diag_pos[i] < 0 || values[diag_pos[i]] == 0.0)
+      throw Hermes::Exceptions::Exception("Zero diagonal entry in row %d in the %s preconditioner.", i, name);
+  }
+}
+
+void JacobiPreconditioner::setup(LinearOperator* op)
+{
+  int n = op->get_size();
+  inv_diag.resize(n);
+  if (n > 0)
+    op->get_diagonal(&inv_diag[0]);
+  for (int i = 0; i < n; i++)
+    inv_diag[i] = (inv_diag[i] != 0.0) ? 1.0 / inv_diag[i] : 1.0;
+}
+
+void JacobiPreconditioner::apply(const double* r, double* z)
+{
+  for (unsigned int i = 0; i < inv_diag.size(); i++)
+    z[i] = inv_diag[i] * r[i];
+}
+
+SSORPreconditioner::SSORPreconditioner(double omega) : omega(omega), matrix(NULL)
+{
+  if (omega <= 0.0 || omega >= 2.0)
+    throw Hermes::Exceptions::Exception("The SSOR parameter must lie in (0, 2).");
+}
+
+void SSORPreconditioner::setup(LinearOperator* op)
+{
+  matrix = get_operator_matrix(op, "SSOR");
+  find_diagonal(matrix, matrix->get_values(), diag_pos, "SSOR");
+  work.resize(matrix->get_size());
+}
+
+void SSORPreconditioner::apply(const double* r, double* z)
+{
+  int n = matrix->get_size();
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+  const double* values = matrix->get_values();
+  double scale = omega * (2.0 - omega);
+
+  // (D + omega L) y = omega (2 - omega) r, y is kept in z. With symmetric
+  // storage L is the transpose of the stored upper triangle, its columns
+  // are applied as soon as y_i is known (the sums are collected in work).
+  if (matrix->is_symmetric())
+  {
+    std::fill(work.begin(), work.end(), 0.0);
+    for (int i = 0; i < n; i++)
+    {
+      z[i] = (scale * r[i] - omega * work[i]) / values[diag_pos[i]];
+      for (int k = diag_pos[i] + 1; k < row_ptr[i + 1]; k++)
+        work[col_idx[k]] += values[k] * z[i];
+    }
+  }
+  else
+  {
+    for (int i = 0; i < n; i++)
+    {
+      double sum = 0.0;
+      for (int k = row_ptr[i]; k < diag_pos[i]; k++)
+        sum += values[k] * z[col_idx[k]];
+      z[i] = (scale * r[i] - omega * sum) / values[diag_pos[i]];
+    }
+  }
+
+  // (D + omega U) z = D y.
+  for (int i = n - 1; i >= 0; i--)
+  {
+    double sum = 0.0;
+    for (int k = diag_pos[i] + 1; k < row_ptr[i + 1]; k++)
+      sum += values[k] * z[col_idx[k]];
+    z[i] -= omega * sum / values[diag_pos[i]];
+  }
+}
+
+void ILU0Preconditioner::setup(LinearOperator* op)
+{
+  matrix = get_operator_matrix(op, "ILU(0)");
+  if (matrix->is_symmetric())
+    throw Hermes::Exceptions::Exception("The ILU(0) preconditioner needs a matrix stored in full.");
+
+  int n = matrix->get_size();
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+  lu.assign(matrix->get_values(), matrix->get_values() + matrix->get_nnz());
+  find_diagonal(matrix, &lu[0], diag_pos, "ILU(0)");
+
+  // Row by row: every entry left of the diagonal eliminates with the
+  // (already factorized) row of its column, updates outside the pattern
+  // of row i are dropped. pos[j] is the position of (i, j), -1 if absent.
+  pos.assign(n, -1);
+  for (int i = 0; i < n; i++)
+  {
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      pos[col_idx[k]] = k;
+    for (int k = row_ptr[i]; k < diag_pos[i]; k++)
+    {
+      int j = col_idx[k];
+      lu[k] /= lu[diag_pos[j]];
+      for (int kk = diag_pos[j] + 1; kk < row_ptr[j + 1]; kk++)
+        if (pos[col_idx[kk]] >= 0)
+          lu[pos[col_idx[kk]]] -= lu[k] * lu[kk];
+    }
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      pos[col_idx[k]] = -1;
+    if (lu[diag_pos[i]] == 0.0)
+      throw Hermes::Exceptions::Exception("Zero pivot in row %d in the ILU(0) preconditioner.", i);
+  }
+}
+
+void ILU0Preconditioner::apply(const double* r, double* z)
+{
+  int n = matrix->get_size();
+  const int* row_ptr = matrix->get_row_ptr();
+  const int* col_idx = matrix->get_col_idx();
+
+  // L has a unit diagonal.
+  for (int i = 0; i < n; i++)
+  {
+    double sum = r[i];
+    for (int k = row_ptr[i]; k < diag_pos[i]; k++)
+      sum -= lu[k] * z[col_idx[k]];
+    z[i] = sum;
+  }
+  for (int i = n - 1; i >= 0; i--)
+  {
+    double sum = z[i];
+    for (int k = diag_pos[i] + 1; k < row_ptr[i + 1]; k++)
+      sum -= lu[k] * z[col_idx[k]];
+    z[i] = sum / lu[diag_pos[i]];
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef __P09_PRECONDITIONERS_H
+#define __P09_PRECONDITIONERS_H
+
+#include "linear_operator.h"
+#include <vector>
+
+/// Preconditioners of the Krylov solvers.
+enum NativePreconditionerType
+{
+  NATIVE_PRECOND_NONE,
+  NATIVE_PRECOND_JACOBI,       ///< Inverse of the diagonal, any LinearOperator.
+  NATIVE_PRECOND_SSOR,         ///< Symmetric successive over-relaxation, CSRMatrixOperator only.
+  NATIVE_PRECOND_ILU0,         ///< Incomplete LU without fill-in, CSRMatrixOperator with full storage only.
+  NATIVE_PRECOND_AMG,          ///< Smoothed aggregation AMG (AMGPreconditioner), CSRMatrixOperator only.
+  NATIVE_PRECOND_USER          ///< Created by the user, e.g. PMultigridPreconditioner, which needs the Space.
+};
+
+/// Name of the preconditioner type, for reports.
+const char* get_native_preconditioner_name(NativePreconditionerType type);
+
+/// Approximate inverse M^{-1} of an operator.
+class Preconditioner
+{
+public:
+  virtual ~Preconditioner() {}
+
+  /// Builds the preconditioner, again whenever the values of the
+  /// operator change.
+  virtual void setup(LinearOperator* op) = 0;
+
+  /// z = M^{-1} r. The arrays do not overlap.
+  virtual void apply(const double* r, double* z) = 0;
+};
+
+/// Creates a preconditioner of the given type, NULL for NATIVE_PRECOND_NONE.
+Preconditioner* create_native_preconditioner(NativePreconditionerType type);
+
+/// Matrix of a CSRMatrixOperator, for preconditioners that need the
+/// entries. Throws an exception for other operators, name is the name of
+/// the preconditioner in the message.
+const CSRMatrix<double>* get_operator_matrix(LinearOperator* op, const char* name);
+
+class JacobiPreconditioner : public Preconditioner
+{
+public:
+  virtual void setup(LinearOperator* op);
+  virtual void apply(const double* r, double* z);
+
+protected:
+  std::vector<double> inv_diag;
+};
+
+/// M = (D + omega L) D^{-1} (D + omega U) / (omega (2 - omega)), a forward
+/// and a backward Gauss-Seidel sweep for omega = 1. M is symmetric if A is,
+/// so SSOR can precondition CG. Works with symmetric storage as well.
+class SSORPreconditioner : public Preconditioner
+{
+public:
+  SSORPreconditioner(double omega = 1.0);
+
+  virtual void setup(LinearOperator* op);
+  virtual void apply(const double* r, double* z);
+
+protected:
+  double omega;
+  const CSRMatrix<double>* matrix;
+  std::vector<int> diag_pos;
+  std::vector<double> work;
+};
+
+/// M = L U, where L and U have the sparsity pattern of the lower and upper
+/// triangle of A, and the product agrees with A on the pattern of A.
+class ILU0Preconditioner : public Preconditioner
+{
+public:
+  virtual void setup(LinearOperator* op);
+  virtual void apply(const double* r, double* z);
+
+  /// Memory occupied by the factors in bytes.
+  size_t get_memory_size() const { return lu.size() * sizeof(double) + diag_pos.size() * sizeof(int); }
+
+protected:
+  const CSRMatrix<double>* matrix;
+  std::vector<double> lu;
+  std::vector<int> diag_pos;
+  std::vector<int> pos;
+};
+
+#endif
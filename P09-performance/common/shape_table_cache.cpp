@@ -0,0 +1,112 @@
+#include "shape_table_cache.h"
+#include <algorithm>
+
+bool ShapeTableKey::operator<(const ShapeTableKey& other) const
+{
+  if (shapeset_id != other.shapeset_id) return shapeset_id < other.shapeset_id;
+  if (mode != other.mode) return mode < other.mode;
+  if (order != other.order) return order < other.order;
+  return index < other.index;
+}
+
+ShapeTableCache::ShapeTableCache() : max_memory(64 * 1024 * 1024), memory(0), clock(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+  reset_stats();
+}
+
+ShapeTableCache::~ShapeTableCache()
+{
+  clear();
+  pthread_mutex_destroy(&mutex);
+}
+
+ShapeTableCache* ShapeTableCache::get_instance()
+{
+  static ShapeTableCache instance;
+  return &instance;
+}
+
+const ShapeTable* ShapeTableCache::get(Shapeset* shapeset, Quad2D* quad, int mode, int order, int index)
+{
+  ShapeTableKey key(shapeset->get_id(), mode, order, index);
+
+  pthread_mutex_lock(&mutex);
+  Entry* entry;
+  std::map<ShapeTableKey, Entry*>::iterator it = tables.find(key);
+  if (it != tables.end())
+  {
+    entry = it->second;
+    num_hits++;
+  }
+  else
+  {
+    entry = new Entry;
+    ShapeTable& table = entry->table;
+    table.np = quad->get_num_points(order);
+    table.val.resize(table.np);
+    table.dx.resize(table.np);
+    table.dy.resize(table.np);
+    double3* pt = quad->get_points(order);
+    for (int k = 0; k < table.np; k++)
+    {
+      table.val[k] = shapeset->get_fn_value(index, pt[k][0], pt[k][1], 0, mode);
+      table.dx[k] = shapeset->get_dx_value(index, pt[k][0], pt[k][1], 0, mode);
+      table.dy[k] = shapeset->get_dy_value(index, pt[k][0], pt[k][1], 0, mode);
+    }
+    tables[key] = entry;
+    memory += sizeof(Entry) + 3 * table.np * sizeof(double);
+    num_misses++;
+  }
+  entry->last_use = clock++;
+  pthread_mutex_unlock(&mutex);
+
+  return &entry->table;
+}
+
+void ShapeTableCache::set_max_memory(size_t bytes)
+{
+  max_memory = bytes;
+}
+
+void ShapeTableCache::trim()
+{
+  pthread_mutex_lock(&mutex);
+  if (memory > max_memory)
+  {
+    // Oldest tables first.
+    std::vector<std::pair<unsigned long, ShapeTableKey> > order;
+    std::map<ShapeTableKey, Entry*>::iterator it;
+    for (it = tables.begin(); it != tables.end(); it++)
+      order.push_back(std::make_pair(it->second->last_use, it->first));
+    std::sort(order.begin(), order.end());
+
+    for (unsigned int k = 0; k < order.size() && memory > max_memory; k++)
+    {
+      it = tables.find(order[k].second);
+      memory -= sizeof(Entry) + 3 * it->second->table.np * sizeof(double);
+      delete it->second;
+      tables.erase(it);
+      num_evictions++;
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+void ShapeTableCache::clear()
+{
+  pthread_mutex_lock(&mutex);
+  std::map<ShapeTableKey, Entry*>::iterator it;
+  for (it = tables.begin(); it != tables.end(); it++)
+    delete it->second;
+  tables.clear();
+  memory = 0;
+  pthread_mutex_unlock(&mutex);
+}
+
+void ShapeTableCache::reset_stats()
+{
+  num_hits = 0;
+  num_misses = 0;
+  num_evictions = 0;
+}
@@ -0,0 +1,94 @@
+#ifndef __P09_SHAPE_TABLE_CACHE_H
+#define __P09_SHAPE_TABLE_CACHE_H
+
+#include "hermes2d.h"
+#include <pthread.h>
+#include <map>
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+/// Values and derivatives with respect to the reference coordinates of one
+/// shape function at the points of one quadrature (volume or edge).
+struct ShapeTable
+{
+  int np;
+  std::vector<double> val;
+  std::vector<double> dx;
+  std::vector<double> dy;
+};
+
+/// Identifies a shape table. Negative shape indices denote constrained
+/// edge functions, they are cached like any other function.
+struct ShapeTableKey
+{
+  ShapeTableKey(int shapeset_id, int mode, int order, int index)
+    : shapeset_id(shapeset_id), mode(mode), order(order), index(index) {}
+
+  bool operator<(const ShapeTableKey& other) const;
+
+  int shapeset_id;
+  int mode;
+  int order;
+  int index;
+};
+
+/// Process-wide cache of shape tables. Reference values do not depend on
+/// the element, so the tables survive the spaces and discrete problems
+/// that created them (for example across the steps of an adaptivity loop,
+/// where every step constructs a new reference space).
+///
+/// Lookups may come from several threads at a time. A returned table stays
+/// valid until the next call to trim() or clear(), these must not run
+/// concurrently with an assembly. The memory used by the tables is bounded,
+/// trim() evicts least recently used tables beyond the bound.
+class ShapeTableCache
+{
+public:
+  static ShapeTableCache* get_instance();
+
+  /// Table of the shape function index of the shapeset at the points
+  /// of the given quadrature order. The quadrature must be set to the mode.
+  const ShapeTable* get(Shapeset* shapeset, Quad2D* quad, int mode, int order, int index);
+
+  /// Bound of the memory occupied by the tables in bytes (64 MB by default).
+  void set_max_memory(size_t bytes);
+  size_t get_max_memory() const { return max_memory; }
+
+  /// Evicts least recently used tables until the memory bound holds.
+  void trim();
+
+  /// Removes all tables.
+  void clear();
+
+  unsigned long get_num_hits() const { return num_hits; }
+  unsigned long get_num_misses() const { return num_misses; }
+  unsigned long get_num_evictions() const { return num_evictions; }
+  void reset_stats();
+
+  int get_num_tables() const { return tables.size(); }
+  size_t get_memory_size() const { return memory; }
+
+protected:
+  ShapeTableCache();
+  ~ShapeTableCache();
+
+  struct Entry
+  {
+    ShapeTable table;
+    unsigned long last_use;
+  };
+
+  std::map<ShapeTableKey, Entry*> tables;
+  pthread_mutex_t mutex;
+
+  size_t max_memory;
+  size_t memory;
+  unsigned long clock;
+
+  unsigned long num_hits;
+  unsigned long num_misses;
+  unsigned long num_evictions;
+};
+
+#endif
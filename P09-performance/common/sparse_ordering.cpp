@@ -0,0 +1,287 @@
+#include "sparse_ordering.h"
+#include <algorithm>
+#include <cstdlib>
+
+// Symmetric adjacency structure without the diagonal.
+static void build_graph(int size, const int* row_ptr, const int* col_idx,
+                        std::vector<int>& adj_ptr, std::vector<int>& adj)
+{
+  std::vector<int> degree(size, 0);
+  for (int i = 0; i < size; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      if (col_idx[k] != i)
+      {
+        degree[i]++;
+        degree[col_idx[k]]++;
+      }
+
+  adj_ptr.resize(size + 1);
+  adj_ptr[0] = 0;
+  for (int i = 0; i < size; i++)
+    adj_ptr[i + 1] = adj_ptr[i] + degree[i];
+  adj.resize(adj_ptr[size]);
+  std::vector<int> pos(adj_ptr.begin(), adj_ptr.end() - 1);
+  for (int i = 0; i < size; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+    {
+      int j = col_idx[k];
+      if (j == i) continue;
+      adj[pos[i]++] = j;
+      adj[pos[j]++] = i;
+    }
+
+  // A full pattern lists every edge twice.
+  for (int i = 0; i < size; i++)
+  {
+    std::sort(adj.begin() + adj_ptr[i], adj.begin() + adj_ptr[i + 1]);
+    degree[i] = std::unique(adj.begin() + adj_ptr[i], adj.begin() + adj_ptr[i + 1]) - adj.begin() - adj_ptr[i];
+  }
+  int nnz = 0;
+  for (int i = 0; i < size; i++)
+  {
+    int begin = adj_ptr[i];
+    adj_ptr[i] = nnz;
+    for (int k = 0; k < degree[i]; k++)
+      adj[nnz++] = adj[begin + k];
+  }
+  adj_ptr[size] = nnz;
+  adj.resize(nnz);
+}
+
+struct DegreeLess
+{
+  DegreeLess(const std::vector<int>& adj_ptr) : adj_ptr(adj_ptr) {}
+  bool operator()(int a, int b) const
+  {
+    return adj_ptr[a + 1] - adj_ptr[a] < adj_ptr[b + 1] - adj_ptr[b];
+  }
+  const std::vector<int>& adj_ptr;
+};
+
+// Breadth first search from root over unvisited nodes. Appends the nodes
+// to order, neighbours in the order of increasing degree. Returns the
+// number of levels.
+static int bfs(int root, const std::vector<int>& adj_ptr, const std::vector<int>& adj,
+               std::vector<int>& mark, int stamp, std::vector<int>& order)
+{
+  int first = order.size();
+  order.push_back(root);
+  mark[root] = stamp;
+  int levels = 0;
+  int level_end = order.size();
+  std::vector<int> neighbours;
+  for (unsigned int head = first; head < order.size(); head++)
+  {
+    if ((int) head == level_end)
+    {
+      levels++;
+      level_end = order.size();
+    }
+    int i = order[head];
+    neighbours.clear();
+    for (int k = adj_ptr[i]; k < adj_ptr[i + 1]; k++)
+      if (mark[adj[k]] != stamp)
+      {
+        mark[adj[k]] = stamp;
+        neighbours.push_back(adj[k]);
+      }
+    std::stable_sort(neighbours.begin(), neighbours.end(), DegreeLess(adj_ptr));
+    order.insert(order.end(), neighbours.begin(), neighbours.end());
+  }
+  return levels + 1;
+}
+
+void rcm_ordering(int size, const int* row_ptr, const int* col_idx, std::vector<int>& perm)
+{
+  std::vector<int> adj_ptr, adj;
+  build_graph(size, row_ptr, col_idx, adj_ptr, adj);
+
+  perm.clear();
+  perm.reserve(size);
+  std::vector<int> mark(size, -1);
+  std::vector<int> done(size, 0);
+  std::vector<int> level;
+  int stamp = 0;
+  for (int start = 0; start < size; start++)
+  {
+    if (done[start]) continue;
+
+    // Pseudo-peripheral node of the component: repeat the search from
+    // the last node reached while the number of levels grows.
+    int root = start;
+    level.clear();
+    int levels = bfs(root, adj_ptr, adj, mark, stamp++, level);
+    for (int it = 0; it < 8; it++)
+    {
+      int candidate = level.back();
+      std::vector<int> trial;
+      int trial_levels = bfs(candidate, adj_ptr, adj, mark, stamp++, trial);
+      if (trial_levels <= levels) break;
+      root = candidate;
+      levels = trial_levels;
+      level.swap(trial);
+    }
+
+    for (unsigned int k = 0; k < level.size(); k++)
+      done[level[k]] = 1;
+    perm.insert(perm.end(), level.begin(), level.end());
+  }
+  std::reverse(perm.begin(), perm.end());
+}
+
+const char* get_dof_ordering_name(DofOrdering ordering)
+{
+  switch (ordering)
+  {
+  case DOF_ORDERING_NATURAL: return "natural";
+  case DOF_ORDERING_RCM: return "RCM";
+  case DOF_ORDERING_NESTED_DISSECTION: return "nested dissection";
+  default: return "unknown";
+  }
+}
+
+// Recursive bisection of the graph for nested_dissection_ordering(). Nodes
+// of the part being dissected share a region number, separators and ordered
+// nodes get -1, so later searches do not enter them.
+struct NestedDissection
+{
+  NestedDissection(int size, int leaf_size) : region(size, 0), mark(size, -1), level(size, 0), num_regions(1),
+                                              stamp(0), leaf_size(leaf_size) {}
+
+  // Breadth first search from root within the region id, records the level
+  // of every node reached. Returns the number of levels.
+  int search(int root, int id, std::vector<int>& order);
+
+  // Orders the nodes of the region id, appends them to perm.
+  void dissect(const std::vector<int>& nodes, int id);
+
+  std::vector<int> adj_ptr, adj;
+  std::vector<int> region, mark, level;
+  std::vector<int> perm;
+  int num_regions;
+  int stamp;
+  int leaf_size;
+};
+
+int NestedDissection::search(int root, int id, std::vector<int>& order)
+{
+  stamp++;
+  order.assign(1, root);
+  mark[root] = stamp;
+  level[root] = 0;
+  for (unsigned int head = 0; head < order.size(); head++)
+  {
+    int i = order[head];
+    for (int k = adj_ptr[i]; k < adj_ptr[i + 1]; k++)
+    {
+      int j = adj[k];
+      if (region[j] == id && mark[j] != stamp)
+      {
+        mark[j] = stamp;
+        level[j] = level[i] + 1;
+        order.push_back(j);
+      }
+    }
+  }
+  return level[order.back()] + 1;
+}
+
+void NestedDissection::dissect(const std::vector<int>& nodes, int id)
+{
+  std::vector<int> order, trial;
+  for (unsigned int n = 0; n < nodes.size(); n++)
+  {
+    // Every connected part of the region is dissected on its own.
+    if (region[nodes[n]] != id) continue;
+
+    // Pseudo-peripheral node as in rcm_ordering().
+    int root = nodes[n];
+    int levels = search(root, id, order);
+    for (int it = 0; it < 8; it++)
+    {
+      int trial_levels = search(order.back(), id, trial);
+      if (trial_levels <= levels) break;
+      root = trial[0];
+      levels = trial_levels;
+      order.swap(trial);
+    }
+    levels = search(root, id, order);
+    int part_stamp = stamp;
+
+    if ((int) order.size() <= leaf_size || levels < 3)
+    {
+      for (unsigned int k = 0; k < order.size(); k++)
+        region[order[k]] = -1;
+      perm.insert(perm.end(), order.rbegin(), order.rend());
+      continue;
+    }
+
+    // The middle level separates the levels above and below it. Its nodes
+    // without a neighbour below are not needed in the separator.
+    int middle = levels / 2;
+    int id_a = num_regions++;
+    int id_b = num_regions++;
+    std::vector<int> part_a, part_b, separator;
+    for (unsigned int k = 0; k < order.size(); k++)
+    {
+      int i = order[k];
+      bool below = (level[i] > middle);
+      if (level[i] == middle)
+      {
+        for (int p = adj_ptr[i]; p < adj_ptr[i + 1] && !below; p++)
+          below = (mark[adj[p]] == part_stamp && level[adj[p]] == middle + 1);
+        if (below)
+        {
+          separator.push_back(i);
+          continue;
+        }
+      }
+      if (below)
+      {
+        region[i] = id_b;
+        part_b.push_back(i);
+      }
+      else
+      {
+        region[i] = id_a;
+        part_a.push_back(i);
+      }
+    }
+    for (unsigned int k = 0; k < separator.size(); k++)
+      region[separator[k]] = -1;
+
+    dissect(part_a, id_a);
+    dissect(part_b, id_b);
+    perm.insert(perm.end(), separator.begin(), separator.end());
+  }
+}
+
+void nested_dissection_ordering(int size, const int* row_ptr, const int* col_idx, std::vector<int>& perm,
+                                int leaf_size)
+{
+  NestedDissection nd(size, std::max(1, leaf_size));
+  build_graph(size, row_ptr, col_idx, nd.adj_ptr, nd.adj);
+  nd.perm.reserve(size);
+
+  std::vector<int> nodes(size);
+  for (int i = 0; i < size; i++)
+    nodes[i] = i;
+  nd.dissect(nodes, 0);
+  perm.swap(nd.perm);
+}
+
+int pattern_bandwidth(int size, const int* row_ptr, const int* col_idx)
+{
+  int bandwidth = 0;
+  for (int i = 0; i < size; i++)
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+      bandwidth = std::max(bandwidth, std::abs(col_idx[k] - i));
+  return bandwidth;
+}
+
+void invert_permutation(const std::vector<int>& perm, std::vector<int>& pinv)
+{
+  pinv.resize(perm.size());
+  for (unsigned int k = 0; k < perm.size(); k++)
+    pinv[perm[k]] = k;
+}
@@ -0,0 +1,41 @@
+#ifndef __P09_SPARSE_ORDERING_H
+#define __P09_SPARSE_ORDERING_H
+
+#include <vector>
+
+/// Orderings of the DOFs of a discrete problem, see
+/// NativeDiscreteProblem::set_dof_ordering().
+enum DofOrdering
+{
+  DOF_ORDERING_NATURAL,              ///< As numbered by the spaces.
+  DOF_ORDERING_RCM,                  ///< Reverse Cuthill-McKee, small bandwidth.
+  DOF_ORDERING_NESTED_DISSECTION     ///< Nested dissection, small fill-in.
+};
+
+/// Name of the ordering, for reports.
+const char* get_dof_ordering_name(DofOrdering ordering);
+
+/// Reverse Cuthill-McKee ordering of the graph of a sparse matrix given by
+/// its CSR structure. The structure may be the full pattern or, for a
+/// symmetric matrix, its upper triangle; both directions of every edge are
+/// taken into account. perm[k] is the old index of the row that becomes
+/// row k.
+void rcm_ordering(int size, const int* row_ptr, const int* col_idx, std::vector<int>& perm);
+
+/// Nested dissection ordering of the same graph. Every connected part is
+/// split by the middle level of a breadth first search from a pseudo
+/// peripheral node into two halves and a separator, the halves are
+/// dissected recursively and ordered before the separator. Parts of at
+/// most leaf_size nodes are ordered by reverse Cuthill-McKee. This reduces
+/// the fill-in of a direct factorization of matrices of 2D meshes more than
+/// a small profile does.
+void nested_dissection_ordering(int size, const int* row_ptr, const int* col_idx, std::vector<int>& perm,
+                                int leaf_size = 64);
+
+/// Largest distance |row - col| of an entry of the pattern from the diagonal.
+int pattern_bandwidth(int size, const int* row_ptr, const int* col_idx);
+
+/// Inverse permutation, pinv[perm[k]] = k.
+void invert_permutation(const std::vector<int>& perm, std::vector<int>& pinv);
+
+#endif